@@ -423,6 +423,34 @@ libev_initialize (VALUE self)
     return Qnil;
 }
 
+#ifdef HAVE_EPOLL_EVENT_LOOP
+static VALUE
+epoll_s_default (VALUE klass)
+{
+    VALUE rb_event_loop;
+    MilterEventLoop *event_loop;
+
+    event_loop = milter_epoll_event_loop_default();
+    rb_event_loop = GOBJ2RVAL(event_loop);
+    g_object_unref(event_loop);
+    rb_milter_event_loop_setup(event_loop);
+
+    return rb_event_loop;
+}
+
+static VALUE
+epoll_initialize (VALUE self)
+{
+    MilterEventLoop *event_loop;
+
+    event_loop = milter_epoll_event_loop_new();
+    G_INITIALIZE(self, event_loop);
+    rb_milter_event_loop_setup(event_loop);
+
+    return Qnil;
+}
+#endif
+
 #ifdef HAVE_RB_THREAD_CHECK_INTS
 static gboolean
 custom_iterate (MilterEventLoop *loop, gboolean may_block, gpointer user_data)
@@ -475,6 +503,9 @@ void
 Init_milter_event_loop (void)
 {
     VALUE rb_cMilterEventLoop, rb_cMilterGLibEventLoop, rb_cMilterLibevEventLoop;
+#ifdef HAVE_EPOLL_EVENT_LOOP
+    VALUE rb_cMilterEpollEventLoop;
+#endif
 
     rb_cMilterEventLoop = G_DEF_CLASS_WITH_GC_FUNC(MILTER_TYPE_EVENT_LOOP,
 						   "EventLoop", rb_mMilter,
@@ -512,4 +543,15 @@ Init_milter_event_loop (void)
 		     libev_initialize, 0);
 
     G_DEF_SETTERS(rb_cMilterGLibEventLoop);
+
+#ifdef HAVE_EPOLL_EVENT_LOOP
+    rb_cMilterEpollEventLoop = G_DEF_CLASS(MILTER_TYPE_EPOLL_EVENT_LOOP,
+                                           "EpollEventLoop", rb_mMilter);
+
+    rb_define_singleton_method(rb_cMilterEpollEventLoop, "default",
+			       epoll_s_default, 0);
+
+    rb_define_method(rb_cMilterEpollEventLoop, "initialize",
+		     epoll_initialize, 0);
+#endif
 }
@@ -17,10 +17,24 @@
  *
  */
 
+#include <rb-milter-core-private.h>
 #include "rb-milter-manager-private.h"
 
 #define SELF(self) (MILTER_MANAGER_APPLICABLE_CONDITION(RVAL2GOBJ(self)))
 
+#define RVAL2STAGE(stage)                                               \
+    (RVAL2GENUM(stage, MILTER_TYPE_MANAGER_APPLICABLE_CONDITION_STAGE))
+
+static ID id_call;
+
+typedef struct _StopperCallArguments StopperCallArguments;
+struct _StopperCallArguments
+{
+    VALUE stopper;
+    int argc;
+    VALUE *argv;
+};
+
 static VALUE
 initialize (VALUE self, VALUE name)
 {
@@ -39,19 +53,184 @@ merge (VALUE self, VALUE other)
     return self;
 }
 
+static VALUE
+stopper_arguments_to_ruby_object (MilterManagerApplicableConditionStage stage,
+				  const GValue *arguments)
+{
+    const gchar *chunk;
+    gsize chunk_size;
+
+    switch (stage) {
+      case MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_CONNECT:
+	return rb_ary_new3(2,
+			   CSTR2RVAL(g_value_get_string(&arguments[0])),
+			   ADDRESS2RVAL(g_value_get_pointer(&arguments[1]),
+					g_value_get_uint(&arguments[2])));
+      case MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_HELO:
+      case MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_ENVELOPE_FROM:
+      case MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_ENVELOPE_RECIPIENT:
+	return rb_ary_new3(1, CSTR2RVAL(g_value_get_string(&arguments[0])));
+      case MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_HEADER:
+	return rb_ary_new3(2,
+			   CSTR2RVAL(g_value_get_string(&arguments[0])),
+			   CSTR2RVAL(g_value_get_string(&arguments[1])));
+      case MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_BODY:
+	chunk = g_value_get_string(&arguments[0]);
+#if GLIB_SIZEOF_SIZE_T == 8
+	chunk_size = g_value_get_uint64(&arguments[1]);
+#else
+	chunk_size = g_value_get_uint(&arguments[1]);
+#endif
+	return rb_ary_new3(1, rb_str_new(chunk, chunk_size));
+      default:
+	return rb_ary_new();
+    }
+}
+
+static VALUE
+invoke_stopper (VALUE data)
+{
+    StopperCallArguments *arguments = (StopperCallArguments *)data;
+
+    return rb_funcall2(arguments->stopper, id_call,
+		       arguments->argc, arguments->argv);
+}
+
+static gboolean
+cb_stop (MilterManagerApplicableCondition *condition,
+	 MilterManagerApplicableConditionStage stage,
+	 MilterManagerChild *child,
+	 MilterManagerChildren *children,
+	 MilterClientContext *context,
+	 guint n_arguments,
+	 const GValue *arguments,
+	 gpointer user_data)
+{
+    StopperCallArguments call_arguments;
+    VALUE rb_arguments, result;
+    int state = 0;
+
+    rb_arguments = rb_ary_new3(3,
+			       GOBJ2RVAL(child),
+			       GOBJ2RVAL(children),
+			       GOBJ2RVAL(context));
+    rb_ary_concat(rb_arguments,
+		  stopper_arguments_to_ruby_object(stage, arguments));
+
+    call_arguments.stopper = *((VALUE *)user_data);
+    call_arguments.argc = RARRAY_LEN(rb_arguments);
+    call_arguments.argv = RARRAY_PTR(rb_arguments);
+    result = rb_protect(invoke_stopper, (VALUE)&call_arguments, &state);
+    if (state) {
+	milter_error("[applicable-condition][stop][error] <%s>: %s",
+		     milter_manager_applicable_condition_get_name(condition),
+		     rb_milter__inspect(rb_errinfo()));
+	return FALSE;
+    }
+
+    return RVAL2CBOOL(result);
+}
+
+/*
+ * The condition may outlive its Ruby object. The stopper
+ * is marked while the condition has it.
+ */
+static void
+stopper_free (gpointer data)
+{
+    VALUE *rb_stopper = data;
+
+    rb_gc_unregister_address(rb_stopper);
+    g_free(rb_stopper);
+}
+
+static VALUE
+set_stopper (int argc, VALUE *argv, VALUE self)
+{
+    VALUE rb_stage, rb_stopper;
+    VALUE *stopper;
+    MilterManagerApplicableConditionStage stage;
+
+    rb_scan_args(argc, argv, "11", &rb_stage, &rb_stopper);
+    if (NIL_P(rb_stopper) && rb_block_given_p())
+	rb_stopper = rb_block_proc();
+
+    stage = RVAL2STAGE(rb_stage);
+    if (NIL_P(rb_stopper)) {
+	milter_manager_applicable_condition_set_stopper(SELF(self), stage,
+							NULL, NULL, NULL);
+    } else {
+	stopper = g_new(VALUE, 1);
+	*stopper = rb_stopper;
+	rb_gc_register_address(stopper);
+	milter_manager_applicable_condition_set_stopper(SELF(self), stage,
+							cb_stop,
+							stopper,
+							stopper_free);
+    }
+
+    return self;
+}
+
+static VALUE
+have_stopper (VALUE self, VALUE rb_stage)
+{
+    return CBOOL2RVAL(milter_manager_applicable_condition_has_stopper(
+			  SELF(self), RVAL2STAGE(rb_stage)));
+}
+
+static VALUE
+get_n_stopper_calls (VALUE self, VALUE rb_stage)
+{
+    return UINT2NUM(milter_manager_applicable_condition_get_n_stopper_calls(
+			SELF(self), RVAL2STAGE(rb_stage)));
+}
+
+static VALUE
+get_stopper_elapsed (VALUE self, VALUE rb_stage)
+{
+    return rb_float_new(milter_manager_applicable_condition_get_stopper_elapsed(
+			    SELF(self), RVAL2STAGE(rb_stage)));
+}
+
+static VALUE
+reset_stopper_statistics (VALUE self)
+{
+    milter_manager_applicable_condition_reset_stopper_statistics(SELF(self));
+    return self;
+}
+
 void
 Init_milter_manager_applicable_condition (void)
 {
     VALUE rb_cMilterManagerApplicableCondition;
 
+    id_call = rb_intern("call");
+
     rb_cMilterManagerApplicableCondition =
 	G_DEF_CLASS(MILTER_TYPE_MANAGER_APPLICABLE_CONDITION,
                     "ApplicableCondition", rb_mMilterManager);
 
+    G_DEF_CLASS(MILTER_TYPE_MANAGER_APPLICABLE_CONDITION_STAGE,
+		"Stage", rb_cMilterManagerApplicableCondition);
+    G_DEF_CONSTANTS(rb_cMilterManagerApplicableCondition,
+		    MILTER_TYPE_MANAGER_APPLICABLE_CONDITION_STAGE,
+		    "MILTER_MANAGER_APPLICABLE_CONDITION_");
+
     rb_define_method(rb_cMilterManagerApplicableCondition,
                      "initialize", initialize, 1);
     rb_define_method(rb_cMilterManagerApplicableCondition,
                      "merge", merge, 1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+		     "set_stopper", set_stopper, -1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+		     "have_stopper?", have_stopper, 1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+		     "n_stopper_calls", get_n_stopper_calls, 1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+		     "stopper_elapsed", get_stopper_elapsed, 1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+		     "reset_stopper_statistics", reset_stopper_statistics, 0);
 
     G_DEF_SETTERS(rb_cMilterManagerApplicableCondition);
 }
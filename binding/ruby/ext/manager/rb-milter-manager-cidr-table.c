@@ -0,0 +1,159 @@
+/* -*- c-file-style: "ruby" -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <rb-milter-core-private.h>
+#include "rb-milter-manager-private.h"
+
+#define SELF(self) ((MilterManagerCIDRTable *)DATA_PTR(self))
+
+static ID id_to_s;
+
+/*
+ * Values are kept in "@values" to be marked by GC. The
+ * table has their 1-origin index to distinguish the first
+ * value from "not found".
+ */
+static void
+rb_cidr_table_free (MilterManagerCIDRTable *table)
+{
+    if (table)
+	milter_manager_cidr_table_free(table);
+}
+
+static VALUE
+rb_cidr_table_allocate (VALUE klass)
+{
+    return Data_Wrap_Struct(klass, NULL, rb_cidr_table_free, NULL);
+}
+
+static VALUE
+rb_cidr_table_initialize (VALUE self)
+{
+    DATA_PTR(self) = milter_manager_cidr_table_new(NULL);
+    rb_iv_set(self, "@values", rb_ary_new());
+    return Qnil;
+}
+
+static VALUE
+rb_cidr_table_add (int argc, VALUE *argv, VALUE self)
+{
+    VALUE rb_network, rb_value, rb_values;
+    GError *error = NULL;
+
+    rb_scan_args(argc, argv, "11", &rb_network, &rb_value);
+    if (argc == 1)
+	rb_value = Qtrue;
+
+    rb_values = rb_iv_get(self, "@values");
+    if (!milter_manager_cidr_table_add(SELF(self),
+				       RVAL2CSTR(rb_network),
+				       GUINT_TO_POINTER(RARRAY_LEN(rb_values) + 1),
+				       &error))
+	RAISE_GERROR(error);
+    rb_ary_push(rb_values, rb_value);
+
+    return self;
+}
+
+/*
+ * Socket addresses are looked up by their "@address" string
+ * to avoid creating an IPAddr for each connection.
+ */
+static gpointer
+lookup (VALUE self, VALUE rb_address)
+{
+    if (NIL_P(rb_address))
+	return NULL;
+
+    if (RVAL2CBOOL(rb_obj_is_kind_of(rb_address,
+				     rb_cMilterSocketAddressIPv4)) ||
+	RVAL2CBOOL(rb_obj_is_kind_of(rb_address,
+				     rb_cMilterSocketAddressIPv6))) {
+	rb_address = rb_iv_get(rb_address, "@address");
+    } else if (RVAL2CBOOL(rb_obj_is_kind_of(rb_address,
+					    rb_cMilterSocketAddressUnix)) ||
+	       RVAL2CBOOL(rb_obj_is_kind_of(rb_address,
+					    rb_cMilterSocketAddressUnknown))) {
+	return NULL;
+    } else if (TYPE(rb_address) != T_STRING) {
+	rb_address = rb_funcall(rb_address, id_to_s, 0);
+    }
+
+    return milter_manager_cidr_table_lookup(SELF(self), RVAL2CSTR(rb_address));
+}
+
+static VALUE
+rb_cidr_table_find (VALUE self, VALUE rb_address)
+{
+    gpointer index;
+
+    index = lookup(self, rb_address);
+    if (!index)
+	return Qnil;
+
+    return rb_ary_entry(rb_iv_get(self, "@values"),
+			GPOINTER_TO_UINT(index) - 1);
+}
+
+static VALUE
+rb_cidr_table_include_p (VALUE self, VALUE rb_address)
+{
+    return CBOOL2RVAL(lookup(self, rb_address) != NULL);
+}
+
+static VALUE
+rb_cidr_table_size (VALUE self)
+{
+    return UINT2NUM(milter_manager_cidr_table_get_size(SELF(self)));
+}
+
+static VALUE
+rb_cidr_table_clear (VALUE self)
+{
+    milter_manager_cidr_table_clear(SELF(self));
+    rb_ary_clear(rb_iv_get(self, "@values"));
+    return self;
+}
+
+void
+Init_milter_manager_cidr_table (void)
+{
+    VALUE rb_cMilterManagerCIDRTable;
+
+    id_to_s = rb_intern("to_s");
+
+    rb_cMilterManagerCIDRTable =
+	rb_define_class_under(rb_mMilterManager, "CIDRTable", rb_cObject);
+    G_DEF_ERROR2(MILTER_MANAGER_CIDR_TABLE_ERROR,
+		 "CIDRTableError", rb_mMilterManager, rb_eMilterError);
+
+    rb_define_alloc_func(rb_cMilterManagerCIDRTable, rb_cidr_table_allocate);
+    rb_define_method(rb_cMilterManagerCIDRTable, "initialize",
+		     rb_cidr_table_initialize, 0);
+    rb_define_method(rb_cMilterManagerCIDRTable, "add",
+		     rb_cidr_table_add, -1);
+    rb_define_method(rb_cMilterManagerCIDRTable, "find",
+		     rb_cidr_table_find, 1);
+    rb_define_method(rb_cMilterManagerCIDRTable, "include?",
+		     rb_cidr_table_include_p, 1);
+    rb_define_method(rb_cMilterManagerCIDRTable, "size",
+		     rb_cidr_table_size, 0);
+    rb_define_method(rb_cMilterManagerCIDRTable, "clear",
+		     rb_cidr_table_clear, 0);
+}
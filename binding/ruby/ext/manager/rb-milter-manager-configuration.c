@@ -304,6 +304,7 @@ mark (gpointer data)
     if (!manager)
 	return;
 
+    milter_manager_lock_leaders(manager);
     for (node = milter_manager_get_leaders(manager);
 	 node;
 	 node = g_list_next(node)) {
@@ -317,6 +318,7 @@ mark (gpointer data)
 	g_list_foreach((GList *)milter_manager_children_get_children(children),
 		       (GFunc)rbgobj_gc_mark_instance, NULL);
     }
+    milter_manager_unlock_leaders(manager);
 }
 
 void
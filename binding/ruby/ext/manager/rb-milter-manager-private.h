@@ -24,6 +24,9 @@
 
 extern void Init_milter_manager (void);
 extern void Init_milter_manager_gstring (void);
+extern void Init_milter_manager_cidr_table (void);
+extern void Init_milter_manager_regexp_set (void);
+extern void Init_milter_manager_tcp_connection_table (void);
 extern void Init_milter_manager_configuration (void);
 extern void Init_milter_manager_child (void);
 extern void Init_milter_manager_applicable_condition (void);
@@ -0,0 +1,137 @@
+/* -*- c-file-style: "ruby" -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <rb-milter-core-private.h>
+#include "rb-milter-manager-private.h"
+
+#define SELF(self) ((MilterManagerRegexpSet *)DATA_PTR(self))
+
+/* Regexp::IGNORECASE, Regexp::EXTENDED and Regexp::MULTILINE */
+#define REGEXP_IGNORECASE 1
+#define REGEXP_EXTENDED   2
+#define REGEXP_MULTILINE  4
+
+static ID id_source;
+
+static void
+rb_regexp_set_free (MilterManagerRegexpSet *set)
+{
+    if (set)
+	milter_manager_regexp_set_free(set);
+}
+
+static VALUE
+rb_regexp_set_allocate (VALUE klass)
+{
+    return Data_Wrap_Struct(klass, NULL, rb_regexp_set_free, NULL);
+}
+
+static VALUE
+rb_regexp_set_initialize (VALUE self)
+{
+    DATA_PTR(self) = milter_manager_regexp_set_new();
+    return Qnil;
+}
+
+/*
+ * Ruby's "^" and "$" always match at line boundaries and
+ * Ruby's multiline option means "." matches a newline.
+ */
+static GRegexCompileFlags
+regexp_options_to_flags (int options)
+{
+    GRegexCompileFlags flags = G_REGEX_MULTILINE;
+
+    if (options & REGEXP_IGNORECASE)
+	flags |= G_REGEX_CASELESS;
+    if (options & REGEXP_EXTENDED)
+	flags |= G_REGEX_EXTENDED;
+    if (options & REGEXP_MULTILINE)
+	flags |= G_REGEX_DOTALL;
+
+    return flags;
+}
+
+static VALUE
+rb_regexp_set_add (VALUE self, VALUE rb_regexp)
+{
+    VALUE rb_pattern;
+    GRegexCompileFlags flags;
+    GError *error = NULL;
+
+    if (RVAL2CBOOL(rb_obj_is_kind_of(rb_regexp, rb_cRegexp))) {
+	rb_pattern = rb_funcall(rb_regexp, id_source, 0);
+	flags = regexp_options_to_flags(rb_reg_options(rb_regexp));
+    } else {
+	rb_pattern = rb_regexp;
+	flags = regexp_options_to_flags(0);
+    }
+
+    if (!milter_manager_regexp_set_add(SELF(self),
+				       RVAL2CSTR(rb_pattern),
+				       flags,
+				       &error))
+	RAISE_GERROR(error);
+
+    return UINT2NUM(milter_manager_regexp_set_get_size(SELF(self)) - 1);
+}
+
+static VALUE
+rb_regexp_set_match (VALUE self, VALUE rb_text)
+{
+    gint index;
+
+    if (NIL_P(rb_text))
+	return Qnil;
+
+    index = milter_manager_regexp_set_match(SELF(self), RVAL2CSTR(rb_text));
+    if (index < 0)
+	return Qnil;
+
+    return INT2NUM(index);
+}
+
+static VALUE
+rb_regexp_set_size (VALUE self)
+{
+    return UINT2NUM(milter_manager_regexp_set_get_size(SELF(self)));
+}
+
+void
+Init_milter_manager_regexp_set (void)
+{
+    VALUE rb_cMilterManagerRegexpSet;
+
+    id_source = rb_intern("source");
+
+    rb_cMilterManagerRegexpSet =
+	rb_define_class_under(rb_mMilterManager, "RegexpSet", rb_cObject);
+    G_DEF_ERROR2(MILTER_MANAGER_REGEXP_SET_ERROR,
+		 "RegexpSetError", rb_mMilterManager, rb_eMilterError);
+
+    rb_define_alloc_func(rb_cMilterManagerRegexpSet, rb_regexp_set_allocate);
+    rb_define_method(rb_cMilterManagerRegexpSet, "initialize",
+		     rb_regexp_set_initialize, 0);
+    rb_define_method(rb_cMilterManagerRegexpSet, "add",
+		     rb_regexp_set_add, 1);
+    rb_define_method(rb_cMilterManagerRegexpSet, "match",
+		     rb_regexp_set_match, 1);
+    rb_define_method(rb_cMilterManagerRegexpSet, "size",
+		     rb_regexp_set_size, 0);
+}
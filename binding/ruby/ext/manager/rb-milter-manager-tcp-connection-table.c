@@ -0,0 +1,157 @@
+/* -*- c-file-style: "ruby" -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+#include <arpa/inet.h>
+
+#include <rb-milter-core-private.h>
+#include "rb-milter-manager-private.h"
+
+#define SELF(self) ((MilterManagerTCPConnectionTable *)DATA_PTR(self))
+
+static void
+rb_tcp_connection_table_free (MilterManagerTCPConnectionTable *table)
+{
+    if (table)
+	milter_manager_tcp_connection_table_free(table);
+}
+
+static VALUE
+rb_tcp_connection_table_allocate (VALUE klass)
+{
+    return Data_Wrap_Struct(klass, NULL, rb_tcp_connection_table_free, NULL);
+}
+
+static VALUE
+rb_tcp_connection_table_initialize (VALUE self)
+{
+    DATA_PTR(self) = milter_manager_tcp_connection_table_new();
+    return Qnil;
+}
+
+static gboolean
+parse_address (const gchar *ip_address, gint port,
+	       MilterGenericSocketAddress *address)
+{
+    memset(address, 0, sizeof(*address));
+    if (inet_pton(AF_INET, ip_address,
+		  &(address->address.inet.sin_addr)) == 1) {
+	address->address.inet.sin_family = AF_INET;
+	address->address.inet.sin_port = htons(port);
+	return TRUE;
+    }
+    if (inet_pton(AF_INET6, ip_address,
+		  &(address->address.inet6.sin6_addr)) == 1) {
+	address->address.inet6.sin6_family = AF_INET6;
+	address->address.inet6.sin6_port = htons(port);
+	return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+ * Returns [STATE, LOCAL_IP_ADDRESS, LOCAL_PORT] of the
+ * connection from IP_ADDRESS:PORT or nil.
+ */
+static VALUE
+rb_tcp_connection_table_lookup (VALUE self, VALUE rb_ip_address, VALUE rb_port)
+{
+    MilterGenericSocketAddress remote_address, local_address;
+    MilterManagerTCPState state;
+    gchar local_ip_address[INET6_ADDRSTRLEN];
+    gint local_port;
+
+    if (!parse_address(RVAL2CSTR(rb_ip_address), NUM2INT(rb_port),
+		       &remote_address))
+	rb_raise(rb_eArgError, "invalid IP address: <%s>",
+		 RVAL2CSTR(rb_ip_address));
+
+    if (!milter_manager_tcp_connection_table_lookup(SELF(self),
+						    &(remote_address.address.base),
+						    &state,
+						    &local_address))
+	return Qnil;
+
+    if (local_address.address.base.sa_family == AF_INET6) {
+	inet_ntop(AF_INET6, &(local_address.address.inet6.sin6_addr),
+		  local_ip_address, sizeof(local_ip_address));
+	local_port = ntohs(local_address.address.inet6.sin6_port);
+    } else {
+	inet_ntop(AF_INET, &(local_address.address.inet.sin_addr),
+		  local_ip_address, sizeof(local_ip_address));
+	local_port = ntohs(local_address.address.inet.sin_port);
+    }
+
+    return rb_ary_new3(3,
+		       CSTR2RVAL(milter_manager_tcp_state_to_string(state)),
+		       CSTR2RVAL(local_ip_address),
+		       INT2NUM(local_port));
+}
+
+static VALUE
+rb_tcp_connection_table_available_p (VALUE self)
+{
+    return CBOOL2RVAL(milter_manager_tcp_connection_table_is_available(SELF(self)));
+}
+
+static VALUE
+rb_tcp_connection_table_get_cache_lifetime (VALUE self)
+{
+    return rb_float_new(milter_manager_tcp_connection_table_get_cache_lifetime(SELF(self)));
+}
+
+static VALUE
+rb_tcp_connection_table_set_cache_lifetime (VALUE self, VALUE rb_lifetime)
+{
+    milter_manager_tcp_connection_table_set_cache_lifetime(SELF(self),
+							   NUM2DBL(rb_lifetime));
+    return rb_lifetime;
+}
+
+static VALUE
+rb_tcp_connection_table_purge_cache (VALUE self)
+{
+    milter_manager_tcp_connection_table_purge_cache(SELF(self));
+    return self;
+}
+
+void
+Init_milter_manager_tcp_connection_table (void)
+{
+    VALUE rb_cMilterManagerTCPConnectionTable;
+
+    rb_cMilterManagerTCPConnectionTable =
+	rb_define_class_under(rb_mMilterManager, "TCPConnectionTable",
+			      rb_cObject);
+
+    rb_define_alloc_func(rb_cMilterManagerTCPConnectionTable,
+			 rb_tcp_connection_table_allocate);
+    rb_define_method(rb_cMilterManagerTCPConnectionTable, "initialize",
+		     rb_tcp_connection_table_initialize, 0);
+    rb_define_method(rb_cMilterManagerTCPConnectionTable, "lookup",
+		     rb_tcp_connection_table_lookup, 2);
+    rb_define_method(rb_cMilterManagerTCPConnectionTable, "available?",
+		     rb_tcp_connection_table_available_p, 0);
+    rb_define_method(rb_cMilterManagerTCPConnectionTable, "cache_lifetime",
+		     rb_tcp_connection_table_get_cache_lifetime, 0);
+    rb_define_method(rb_cMilterManagerTCPConnectionTable, "cache_lifetime=",
+		     rb_tcp_connection_table_set_cache_lifetime, 1);
+    rb_define_method(rb_cMilterManagerTCPConnectionTable, "purge_cache",
+		     rb_tcp_connection_table_purge_cache, 0);
+}
@@ -26,6 +26,9 @@ Init_milter_manager (void)
 {
     rb_mMilterManager = rb_define_module_under(rb_mMilter, "Manager");
     Init_milter_manager_gstring();
+    Init_milter_manager_cidr_table();
+    Init_milter_manager_regexp_set();
+    Init_milter_manager_tcp_connection_table();
     Init_milter_manager_configuration();
     Init_milter_manager_child();
     Init_milter_manager_applicable_condition();
@@ -288,7 +288,9 @@ module Milter
       def setup_signal_handler(client)
         # FIXME: This is just a workaround to handle signals within 0.5 seconds.
         # We should use more clever approach instead of this.
-        if client.event_loop_backend == Milter::ClientEventLoopBackend::LIBEV
+        case client.event_loop_backend
+        when Milter::ClientEventLoopBackend::LIBEV,
+             Milter::ClientEventLoopBackend::EPOLL
           client.event_loop.add_timeout(0.5) do
             true
           end
@@ -40,6 +40,7 @@ require 'milter/manager/redhat-detector'
 require 'milter/manager/freebsd-rc-detector'
 require 'milter/manager/pkgsrc-rc-detector'
 
+require 'milter/manager/regexp-set'
 require 'milter/manager/postfix-cidr-table'
 require 'milter/manager/postfix-regexp-table'
 
@@ -201,12 +202,15 @@ module Milter
         dump_item("manager.event_loop_backend",
                   c.event_loop_backend.nick.dump)
         dump_item("manager.n_workers", c.n_workers)
+        dump_item("manager.n_threads", c.n_threads)
         dump_item("manager.packet_buffer_size", c.default_packet_buffer_size)
         dump_item("manager.connection_check_interval",
                   c.connection_check_interval.inspect)
         dump_item("manager.chunk_size", c.chunk_size)
         dump_item("manager.max_pending_finished_sessions",
                   c.max_pending_finished_sessions)
+        dump_item("manager.max_pooled_sessions", c.max_pooled_sessions)
+        dump_item("manager.result_stream", c.result_stream_spec.inspect)
         @result << "\n"
       end
 
@@ -319,6 +323,7 @@ module Milter
         dump_egg_item(name, "enabled", egg.enabled?)
         dump_egg_item(name, "fallback_status", egg.fallback_status.nick.inspect)
         dump_egg_item(name, "evaluation_mode", egg.evaluation_mode?)
+        dump_egg_item(name, "parallel", egg.parallel?)
         dump_egg_applicable_conditions(egg)
         dump_egg_item(name, "command", egg.command.inspect)
         dump_egg_item(name, "command_options", egg.command_options.inspect)
@@ -327,6 +332,9 @@ module Milter
         dump_egg_item(name, "writing_timeout", egg.writing_timeout)
         dump_egg_item(name, "reading_timeout", egg.reading_timeout)
         dump_egg_item(name, "end_of_message_timeout", egg.end_of_message_timeout)
+        dump_egg_item(name, "connection_pool_size", egg.connection_pool_size)
+        dump_egg_item(name, "connection_pool_idle_timeout",
+                      egg.connection_pool_idle_timeout)
         @result << "end\n"
       end
     end
@@ -568,6 +576,17 @@ module Milter
                 if @egg_config.has_key?("evaluation_mode")
                   milter.evaluation_mode = @egg_config["evaluation_mode"]
                 end
+                if @egg_config.has_key?("parallel")
+                  milter.parallel = @egg_config["parallel"]
+                end
+                if @egg_config.has_key?("connection_pool_size")
+                  milter.connection_pool_size =
+                    Integer(@egg_config["connection_pool_size"])
+                end
+                if @egg_config.has_key?("connection_pool_idle_timeout")
+                  milter.connection_pool_idle_timeout =
+                    Float(@egg_config["connection_pool_idle_timeout"])
+                end
               end
               @egg_config = nil
             when "milter_applicable_condition"
@@ -576,6 +595,8 @@ module Milter
               @egg_config["enabled"] = text == "true"
             when "milter_evaluation_mode"
               @egg_config["evaluation_mode"] = text == "true"
+            when "milter_parallel"
+              @egg_config["parallel"] = text == "true"
             when /\Amilter_/
               @egg_config[$POSTMATCH] = text
             else
@@ -631,7 +652,10 @@ module Milter
               available_locals = ["name", "description",
                                   "enabled", "connection_spec",
                                   "command", "command_options",
-                                  "fallback_status", "evaluation_mode"]
+                                  "fallback_status", "evaluation_mode",
+                                  "parallel",
+                                  "connection_pool_size",
+                                  "connection_pool_idle_timeout"]
               case local
               when "applicable_conditions"
                 @egg_config["applicable_conditions"] = []
@@ -925,6 +949,14 @@ module Milter
             @configuration.n_workers = n_workers
           end
 
+          def n_threads
+            @configuration.n_threads
+          end
+
+          def n_threads=(n_threads)
+            @configuration.n_threads = n_threads
+          end
+
           def packet_buffer_size
             @configuration.default_packet_buffer_size
           end
@@ -941,6 +973,14 @@ module Milter
             @configuration.max_pending_finished_sessions = n_sessions
           end
 
+          def max_pooled_sessions
+            @configuration.max_pooled_sessions
+          end
+
+          def max_pooled_sessions=(n_sessions)
+            @configuration.max_pooled_sessions = n_sessions
+          end
+
           def maintained_hooks
             @configuration.maintained_hooks
           end
@@ -998,6 +1038,15 @@ module Milter
           @raw_configuration.connection_check_interval = interval
         end
 
+        def result_stream
+          @raw_configuration.result_stream_spec
+        end
+
+        def result_stream=(spec)
+          update_location("result_stream", spec.nil?)
+          @raw_configuration.result_stream_spec = spec
+        end
+
         def netstat_connection_checker
           @raw_configuration.netstat_connection_checker
         end
@@ -1197,6 +1246,21 @@ module Milter
         end
       end
 
+      class StopperDispatcher
+        def initialize(stoppers)
+          @stoppers = stoppers
+        end
+
+        def call(child, children, client_context, *args)
+          child_context = ChildContext.new(child, children, client_context)
+          @stoppers.any? do |stopper|
+            Milter::Callback.guard(false) do
+              stopper.call(child_context, *args)
+            end
+          end
+        end
+      end
+
       class ApplicableConditionConfigurationLoader
         def initialize(name, loader)
           @condition = ApplicableCondition.new(name)
@@ -1282,107 +1346,22 @@ module Milter
 
         private
         def setup_stoppers
-          return unless have_stopper?
-
-          @condition.signal_connect("attach-to") do |_, child, children, context|
-            unless @connect_stoppers.empty?
-              child.signal_connect("stop-on-connect") do |_child, host, address|
-                child_context = ChildContext.new(child, children, context)
-                @connect_stoppers.any? do |stopper|
-                  Milter::Callback.guard(false) do
-                    stopper.call(child_context, host, address)
-                  end
-                end
-              end
-            end
-
-            unless @helo_stoppers.empty?
-              child.signal_connect("stop-on-helo") do |_child, fqdn|
-                child_context = ChildContext.new(child, children, context)
-                @helo_stoppers.any? do |stopper|
-                  Milter::Callback.guard(false) do
-                    stopper.call(child_context, fqdn)
-                  end
-                end
-              end
-            end
-
-            unless @envelope_from_stoppers.empty?
-              child.signal_connect("stop-on-envelope-from") do |_child, from|
-                child_context = ChildContext.new(child, children, context)
-                @envelope_from_stoppers.any? do |stopper|
-                  Milter::Callback.guard(false) do
-                    stopper.call(child_context, from)
-                  end
-                end
-              end
-            end
-
-            unless @envelope_recipient_stoppers.empty?
-              child.signal_connect("stop-on-envelope-recipient") do |_child, recipient|
-                child_context = ChildContext.new(child, children, context)
-                @envelope_recipient_stoppers.any? do |stopper|
-                  Milter::Callback.guard(false) do
-                    stopper.call(child_context, recipient)
-                  end
-                end
-              end
-            end
-
-            unless @data_stoppers.empty?
-              child.signal_connect("stop-on-data") do |_child|
-                child_context = ChildContext.new(child, children, context)
-                @data_stoppers.any? do |stopper|
-                  Milter::Callback.guard(false) do
-                    stopper.call(child_context)
-                  end
-                end
-              end
-            end
-
-            unless @header_stoppers.empty?
-              child.signal_connect("stop-on-header") do |_child, name, value|
-                child_context = ChildContext.new(child, children, context)
-                @header_stoppers.any? do |stopper|
-                  Milter::Callback.guard(false) do
-                    stopper.call(child_context, name, value)
-                  end
-                end
-              end
-            end
-
-            unless @end_of_header_stoppers.empty?
-              child.signal_connect("stop-on-end-of-header") do |_child|
-                child_context = ChildContext.new(child, children, context)
-                @end_of_header_stoppers.any? do |stopper|
-                  Milter::Callback.guard(false) do
-                    stopper.call(child_context)
-                  end
-                end
-              end
-            end
-
-            unless @body_stoppers.empty?
-              child.signal_connect("stop-on-body") do |_child, chunk|
-                child_context = ChildContext.new(child, children, context)
-                @body_stoppers.any? do |stopper|
-                  Milter::Callback.guard(false) do
-                    stopper.call(child_context, name, chunk)
-                  end
-                end
-              end
-            end
-
-            unless @end_of_message_stoppers.empty?
-              child.signal_connect("stop-on-end-of-message") do |_child, chunk|
-                child_context = ChildContext.new(child, children, context)
-                @end_of_message_stoppers.any? do |stopper|
-                  Milter::Callback.guard(false) do
-                    stopper.call(child_context)
-                  end
-                end
-              end
-            end
+          [[ApplicableCondition::STAGE_CONNECT, @connect_stoppers],
+           [ApplicableCondition::STAGE_HELO, @helo_stoppers],
+           [ApplicableCondition::STAGE_ENVELOPE_FROM,
+            @envelope_from_stoppers],
+           [ApplicableCondition::STAGE_ENVELOPE_RECIPIENT,
+            @envelope_recipient_stoppers],
+           [ApplicableCondition::STAGE_DATA, @data_stoppers],
+           [ApplicableCondition::STAGE_HEADER, @header_stoppers],
+           [ApplicableCondition::STAGE_END_OF_HEADER,
+            @end_of_header_stoppers],
+           [ApplicableCondition::STAGE_BODY, @body_stoppers],
+           [ApplicableCondition::STAGE_END_OF_MESSAGE,
+            @end_of_message_stoppers],
+          ].each do |stage, stoppers|
+            next if stoppers.empty?
+            @condition.set_stopper(stage, StopperDispatcher.new(stoppers))
           end
         end
 
@@ -16,16 +16,15 @@
 module Milter::Manager
   class AddressMatcher
     def initialize
-      @local_addresses = []
-      @remote_addresses = []
+      @local_addresses = CIDRTable.new
+      @remote_addresses = CIDRTable.new
     end
 
     def local_address?(address)
       return false if unknown_address?(address)
-      ip_address = address.to_ip_address
-      return false if ip_address and custom_remote_address?(ip_address)
+      return false if custom_remote_address?(address)
       return true if address.local?
-      return true if ip_address and custom_local_address?(ip_address)
+      return true if custom_local_address?(address)
       false
     end
 
@@ -39,29 +38,26 @@ module Milter::Manager
     end
 
     def add_local_address(address)
-      @local_addresses << ensure_address(address)
+      @local_addresses.add(network_string(address))
     end
 
     def add_remote_address(address)
-      @remote_addresses << ensure_address(address)
+      @remote_addresses.add(network_string(address))
     end
 
     private
-    def custom_local_address?(ip_address)
-      @local_addresses.any? do |local_address|
-        local_address.include?(ip_address)
-      end
+    def custom_local_address?(address)
+      @local_addresses.include?(address)
     end
 
-    def custom_remote_address?(ip_address)
-      @remote_addresses.any? do |remote_address|
-        remote_address.include?(ip_address)
-      end
+    def custom_remote_address?(address)
+      @remote_addresses.include?(address)
     end
 
-    def ensure_address(address)
+    def network_string(address)
       address = IPAddr.new(address) unless address.is_a?(IPAddr)
-      address
+      mask = address.instance_variable_get(:@mask_addr)
+      "#{address}/#{mask.to_s(2).count('1')}"
     end
   end
 end
@@ -20,13 +20,18 @@ module Milter::Manager
     include Milter::MacroNameNormalizer
     include Milter::MacroPredicates
 
-    attr_reader :mail_transaction_shelf
-
     def initialize(child, children, client_context)
       @child = child
       @children = children
       @client_context = client_context
-      @mail_transaction_shelf = Milter::Client::MailTransactionShelf.new(client_context)
+      @mail_transaction_shelf = nil
+      @macros = nil
+      @child_contexts = nil
+    end
+
+    def mail_transaction_shelf
+      @mail_transaction_shelf ||=
+        Milter::Client::MailTransactionShelf.new(@client_context)
     end
 
     def name
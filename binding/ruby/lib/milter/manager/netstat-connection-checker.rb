@@ -32,7 +32,9 @@ module Milter::Manager
       @options = (options || {}).dup
       @database = nil
       @last_update = nil
-      detect_netstat_command
+      @tcp_connection_table = nil
+      detect_tcp_connection_table
+      detect_netstat_command if @tcp_connection_table.nil?
     end
 
     def connected?(context)
@@ -64,6 +66,7 @@ module Milter::Manager
 
     def database_lifetime=(lifetime)
       @options[:database_lifetime] = lifetime
+      @tcp_connection_table.cache_lifetime = lifetime if @tcp_connection_table
     end
 
     private
@@ -80,7 +83,7 @@ module Milter::Manager
     end
 
     def connection_info(address, options={})
-      return nil if @netstat_command.nil?
+      return nil if @tcp_connection_table.nil? and @netstat_command.nil?
       type = nil
       case address
       when Milter::SocketAddress::IPv4
@@ -99,6 +102,10 @@ module Milter::Manager
         return nil
       end
 
+      if @tcp_connection_table
+        return kernel_connection_info(type, address, options)
+      end
+
       tcp_address = "#{address.address}:#{address.port}"
       update_database
       info = @database[type][tcp_address]
@@ -110,6 +117,20 @@ module Milter::Manager
       info
     end
 
+    def kernel_connection_info(type, address, options)
+      result = @tcp_connection_table.lookup(address.address, address.port)
+      if result.nil? and options[:retry]
+        @tcp_connection_table.purge_cache
+        result = @tcp_connection_table.lookup(address.address, address.port)
+      end
+      return nil if result.nil?
+      state, local_ip_address, local_port = result
+      ConnectionInfo.new(type.to_s,
+                         local_ip_address, local_port.to_s,
+                         address.address, address.port.to_s,
+                         state)
+    end
+
     def purge_cache
       @database = nil
       @last_update = nil
@@ -159,6 +180,15 @@ module Milter::Manager
       [ip_address, port]
     end
 
+    def detect_tcp_connection_table
+      return unless Milter::Manager.const_defined?(:TCPConnectionTable)
+      table = TCPConnectionTable.new
+      return unless table.available?
+      table.cache_lifetime = database_lifetime
+      @tcp_connection_table = table
+      Milter::Logger.info("[netstat][detect] use kernel TCP connection table")
+    end
+
     def detect_netstat_command
       @netstat_command = nil
       commands = ["env LANG=C netstat -n -W 2>&1",
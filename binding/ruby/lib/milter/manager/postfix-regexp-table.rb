@@ -24,6 +24,7 @@ module Milter::Manager
 
     def initialize
       @table = []
+      @matcher = nil
     end
 
     def parse(io)
@@ -56,13 +57,35 @@ module Milter::Manager
       unless tables.empty?
         raise InvalidFormatError("endif isn't matched", io.path, io.lineno)
       end
+      @matcher = create_matcher
     end
 
     def find(text)
+      if @matcher
+        index = @matcher.match(text)
+        return nil if index.nil?
+        return find_action(@table[index..-1], text)
+      end
       find_action(@table, text)
-     end
+    end
 
     private
+    # The combined regexp set finds the first matched entry. It is
+    # used only when all entries are positive and all patterns are
+    # interpreted by the regexp set as Ruby does. Other tables are
+    # scanned linearly by Ruby's Regexp.
+    def create_matcher
+      return nil if @table.any? {|negative,| negative}
+      return nil unless @table.all? {|_, regexp,| RegexpSet.portable?(regexp)}
+      matcher = RegexpSet.new
+      @table.each do |negative, regexp,|
+        matcher.add(regexp)
+      end
+      matcher
+    rescue RegexpSetError
+      nil
+    end
+
     def create_regexp(pattern, flag, io, line, line_no)
       regexp_flag = Regexp::IGNORECASE
       if flag
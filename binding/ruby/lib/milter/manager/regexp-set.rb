@@ -0,0 +1,31 @@
+# Copyright (C) 2026  agent
+#
+# This library is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library.  If not, see <http://www.gnu.org/licenses/>.
+
+module Milter::Manager
+  class RegexpSet
+    # Escapes such as \h have different meanings between Ruby's
+    # Regexp and the regexp set. Patterns that use escapes other
+    # than the ones shared by both must be matched by Ruby.
+    PORTABLE_ESCAPE_LETTERS = "dDwWsSbBAzZntrfe"
+
+    class << self
+      def portable?(regexp)
+        regexp.source.scan(/\\(.)/m).all? do |letter,|
+          letter !~ /[a-zA-Z]/ or PORTABLE_ESCAPE_LETTERS.include?(letter)
+        end
+      end
+    end
+  end
+end
@@ -214,6 +214,9 @@ class TestConfigurationLoader < Test::Unit::TestCase
     @configuration.event_loop_backend = "libev"
     assert_equal(Milter::Client::EVENT_LOOP_BACKEND_LIBEV,
                  @loader.manager.event_loop_backend)
+    @loader.manager.event_loop_backend = "epoll"
+    assert_equal(Milter::Client::EVENT_LOOP_BACKEND_EPOLL,
+                 @configuration.event_loop_backend)
   end
 
   def test_manager_n_workers
@@ -224,6 +227,14 @@ class TestConfigurationLoader < Test::Unit::TestCase
     assert_equal(0, @configuration.n_workers)
   end
 
+  def test_manager_n_threads
+    assert_equal(0, @configuration.n_threads)
+    @loader.manager.n_threads = 4
+    assert_equal(4, @configuration.n_threads)
+    @loader.manager.n_threads = nil
+    assert_equal(0, @configuration.n_threads)
+  end
+
   def test_manager_packet_buffer_size
     assert_equal(0, @configuration.default_packet_buffer_size)
     @loader.manager.packet_buffer_size = 4096
@@ -253,6 +264,23 @@ class TestConfigurationLoader < Test::Unit::TestCase
     assert_equal(0, @configuration.max_pending_finished_sessions)
   end
 
+  def test_manager_max_pooled_sessions
+    assert_equal(0, @configuration.max_pooled_sessions)
+    @loader.manager.max_pooled_sessions = 29
+    assert_equal(29, @configuration.max_pooled_sessions)
+    @loader.manager.max_pooled_sessions = nil
+    assert_equal(0, @configuration.max_pooled_sessions)
+  end
+
+  def test_manager_result_stream
+    assert_nil(@configuration.result_stream_spec)
+    @loader.manager.result_stream = "unix:/var/run/milter-manager/results.sock"
+    assert_equal("unix:/var/run/milter-manager/results.sock",
+                 @configuration.result_stream_spec)
+    @loader.manager.result_stream = nil
+    assert_nil(@configuration.result_stream_spec)
+  end
+
   def test_database_type
     assert_equal(nil, @configuration.database.type)
     @loader.database.type = "mysql"
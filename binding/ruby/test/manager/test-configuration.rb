@@ -80,6 +80,12 @@ class TestConfiguration < Test::Unit::TestCase
     assert_equal(10, @configuration.n_workers)
   end
 
+  def test_n_threads
+    assert_equal(0, @configuration.n_threads)
+    @configuration.n_threads = 4
+    assert_equal(4, @configuration.n_threads)
+  end
+
   def test_default_packet_buffer_size
     assert_equal(0, @configuration.default_packet_buffer_size)
     @configuration.default_packet_buffer_size = 4096
@@ -92,6 +98,12 @@ class TestConfiguration < Test::Unit::TestCase
     assert_equal(29, @configuration.max_pending_finished_sessions)
   end
 
+  def test_max_pooled_sessions
+    assert_equal(0, @configuration.max_pooled_sessions)
+    @configuration.max_pooled_sessions = 29
+    assert_equal(29, @configuration.max_pooled_sessions)
+  end
+
   def test_package
     @configuration.package_platform = "pkgsrc"
     assert_equal("pkgsrc", @configuration.package_platform)
@@ -296,6 +308,8 @@ manager.event_loop_backend = "glib"
 # default
 manager.n_workers = 0
 # default
+manager.n_threads = 0
+# default
 manager.packet_buffer_size = 0
 # default
 manager.connection_check_interval = 0
@@ -303,6 +317,10 @@ manager.connection_check_interval = 0
 manager.chunk_size = 65535
 # default
 manager.max_pending_finished_sessions = 0
+# default
+manager.max_pooled_sessions = 0
+# default
+manager.result_stream = nil
 
 # default
 controller.connection_spec = nil
@@ -441,6 +459,8 @@ manager.event_loop_backend = "glib"
 # default
 manager.n_workers = 0
 # default
+manager.n_threads = 0
+# default
 manager.packet_buffer_size = 0
 # default
 manager.connection_check_interval = 0
@@ -448,6 +468,10 @@ manager.connection_check_interval = 0
 manager.chunk_size = 65535
 # default
 manager.max_pending_finished_sessions = 0
+# default
+manager.max_pooled_sessions = 0
+# default
+manager.result_stream = nil
 
 # #{__FILE__}:#{controller_connection_spec}
 controller.connection_spec = "inet:10025"
@@ -493,6 +517,8 @@ define_milter("milter1") do |milter|
   milter.fallback_status = "accept"
   # default
   milter.evaluation_mode = false
+  # default
+  milter.parallel = false
   milter.applicable_conditions = [
     # #{__FILE__}:#{milter1_lines[:applicable_condition_s25r]}
     "S25R",
@@ -511,6 +537,10 @@ define_milter("milter1") do |milter|
   milter.reading_timeout = 7.0
   # default
   milter.end_of_message_timeout = 297.0
+  # default
+  milter.connection_pool_size = 0
+  # default
+  milter.connection_pool_idle_timeout = 60.0
 end
 
 # #{__FILE__}:#{milter2_lines[:define]}
@@ -526,6 +556,8 @@ define_milter("milter2") do |milter|
   # #{__FILE__}:#{milter2_lines[:evaluation_mode]}
   milter.evaluation_mode = true
   # default
+  milter.parallel = false
+  # default
   milter.applicable_conditions = []
   # default
   milter.command = nil
@@ -541,6 +573,10 @@ define_milter("milter2") do |milter|
   milter.reading_timeout = 7.0
   # default
   milter.end_of_message_timeout = 297.0
+  # default
+  milter.connection_pool_size = 0
+  # default
+  milter.connection_pool_idle_timeout = 60.0
 end
 EOD
                  @configuration.dump)
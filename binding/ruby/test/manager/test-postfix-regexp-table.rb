@@ -31,6 +31,7 @@ class TestPostfixRegexpTable < Test::Unit::TestCase
 /^postmaster@/       OK
 EOC
     assert_equal("OK", @table.find("postmaster@example.com"))
+    assert_nil(@table.find("user@example.com"))
   end
 
   def test_negative_pattern
@@ -70,6 +71,16 @@ EOC
     assert_nil(@table.find("owner-outgoing@example.com"))
   end
 
+  def test_ruby_specific_escape
+    @table.parse(create_input(<<-EOC))
+/^\\h+@/              550 Hexadecimal local part rejected
+/@example\\.com$/     OK
+EOC
+    assert_equal("550 Hexadecimal local part rejected",
+                 @table.find("cafe@example.com"))
+    assert_equal("OK", @table.find("user@example.com"))
+  end
+
   def test_invalid_pattern
     message = nil
     begin
@@ -24,6 +24,8 @@ module MilterEventLoopTestUtils
       Milter::GLibEventLoop
     when "libev"
       Milter::LibevEventLoop
+    when "epoll"
+      Milter::EpollEventLoop
     else
       raise "unknown backend: #{backend.inspect}"
     end
@@ -36,6 +38,8 @@ module MilterEventLoopTestUtils
       Milter::GLibEventLoop.new
     when "libev"
       Milter::LibevEventLoop.default
+    when "epoll"
+      Milter::EpollEventLoop.default
     else
       raise "unknown backend: #{backend.inspect}"
     end
@@ -2050,18 +2050,16 @@ cb_timeout (gpointer data)
 }
 
 static gboolean
-write_packet_without_error_handling (MilterClientContext *context,
-                                     const gchar *packet, gsize packet_size,
-                                     GError **error)
+write_packet_vectors_without_error_handling (MilterClientContext *context,
+                                             const struct iovec *vectors,
+                                             guint n_vectors,
+                                             GError **error)
 {
     MilterClientContextPrivate *priv;
     MilterEventLoop *loop;
     gboolean success;
     GError *agent_error = NULL;
 
-    if (!packet)
-        return FALSE;
-
     priv = MILTER_CLIENT_CONTEXT_GET_PRIVATE(context);
 
     disable_timeout(context);
@@ -2070,9 +2068,9 @@ write_packet_without_error_handling (MilterClientContext *context,
                                                      priv->timeout,
                                                      cb_timeout,
                                                      context);
-    success = milter_agent_write_packet(MILTER_AGENT(context),
-                                        packet, packet_size,
-                                        &agent_error);
+    success = milter_agent_write_packet_vectors(MILTER_AGENT(context),
+                                                vectors, n_vectors,
+                                                &agent_error);
     if (agent_error) {
         milter_utils_set_error_with_sub_error(
             error,
@@ -2085,6 +2083,22 @@ write_packet_without_error_handling (MilterClientContext *context,
     return success;
 }
 
+static gboolean
+write_packet_without_error_handling (MilterClientContext *context,
+                                     const gchar *packet, gsize packet_size,
+                                     GError **error)
+{
+    struct iovec vector;
+
+    if (!packet)
+        return FALSE;
+
+    vector.iov_base = (gchar *)packet;
+    vector.iov_len = packet_size;
+    return write_packet_vectors_without_error_handling(context, &vector, 1,
+                                                       error);
+}
+
 static gboolean
 write_packet (MilterClientContext *context,
               const gchar *packet, gsize packet_size)
@@ -2176,17 +2190,66 @@ validate_action (const gchar *operation,
 }
 
 static gboolean
-write_packet_on_end_of_message (MilterClientContext *context,
-                                const gchar *packet, gsize packet_size)
+write_scattered_packet_on_end_of_message (MilterClientContext *context,
+                                          const gchar *packet,
+                                          gsize packet_size,
+                                          const gchar *trailer,
+                                          gsize trailer_size)
 {
     gboolean success = TRUE;
     MilterClientContextPrivate *priv;
 
+    priv = MILTER_CLIENT_CONTEXT_GET_PRIVATE(context);
+
+    /* The trailer is written from the caller's buffer when it
+     * would be flushed immediately anyway. */
+    if (trailer_size > 0 &&
+        priv->buffered_packets->len + packet_size + trailer_size >
+        priv->packet_buffer_size) {
+        struct iovec vectors[3];
+        guint n_vectors = 0;
+        GError *error = NULL;
+
+        milter_debug("[%u] [client][buffered-packets][write-scattered] "
+                     "<%" G_GSIZE_FORMAT ":%" G_GSIZE_FORMAT ">",
+                     milter_agent_get_tag(MILTER_AGENT(context)),
+                     priv->buffered_packets->len,
+                     packet_size + trailer_size);
+        if (priv->buffered_packets->len > 0) {
+            vectors[n_vectors].iov_base = priv->buffered_packets->str;
+            vectors[n_vectors].iov_len = priv->buffered_packets->len;
+            n_vectors++;
+        }
+        vectors[n_vectors].iov_base = (gchar *)packet;
+        vectors[n_vectors].iov_len = packet_size;
+        n_vectors++;
+        vectors[n_vectors].iov_base = (gchar *)trailer;
+        vectors[n_vectors].iov_len = trailer_size;
+        n_vectors++;
+
+        priv->buffering = FALSE;
+        success = write_packet_vectors_without_error_handling(context,
+                                                              vectors,
+                                                              n_vectors,
+                                                              &error);
+        g_string_truncate(priv->buffered_packets, 0);
+        if (!success) {
+            milter_error("[%u] [client][error][buffered-packets][write] %s",
+                         milter_agent_get_tag(MILTER_AGENT(context)),
+                         error->message);
+            milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(context),
+                                        error);
+            g_error_free(error);
+        }
+        return success;
+    }
+
     milter_debug("[%u] [client][buffered-packets][buffer]",
                  milter_agent_get_tag(MILTER_AGENT(context)));
 
-    priv = MILTER_CLIENT_CONTEXT_GET_PRIVATE(context);
     g_string_append_len(priv->buffered_packets, packet, packet_size);
+    if (trailer_size > 0)
+        g_string_append_len(priv->buffered_packets, trailer, trailer_size);
     priv->buffering = TRUE;
 
     if (priv->buffered_packets->len > priv->packet_buffer_size) {
@@ -2218,6 +2281,15 @@ write_packet_on_end_of_message (MilterClientContext *context,
     return success;
 }
 
+static gboolean
+write_packet_on_end_of_message (MilterClientContext *context,
+                                const gchar *packet, gsize packet_size)
+{
+    return write_scattered_packet_on_end_of_message(context,
+                                                    packet, packet_size,
+                                                    NULL, 0);
+}
+
 gboolean
 milter_client_context_add_header (MilterClientContext *context,
                                   const gchar *name, const gchar *value,
@@ -2587,15 +2659,19 @@ milter_client_context_replace_body (MilterClientContext *context,
         gsize offset;
 
         offset = body_size - rest_size;
-        milter_reply_encoder_encode_replace_body(reply_encoder,
-                                                 &packet, &packet_size,
-                                                 body + offset,
-                                                 rest_size,
-                                                 &packed_size);
+        milter_reply_encoder_encode_replace_body_scattered(reply_encoder,
+                                                           &packet,
+                                                           &packet_size,
+                                                           body + offset,
+                                                           rest_size,
+                                                           &packed_size);
         if (packed_size == 0)
             return FALSE;
 
-        if (!write_packet_on_end_of_message(context, packet, packet_size))
+        if (!write_scattered_packet_on_end_of_message(context,
+                                                      packet, packet_size,
+                                                      body + offset,
+                                                      packed_size))
             return FALSE;
     }
 
@@ -3572,6 +3648,17 @@ cb_decoder_quit (MilterDecoder *decoder, gpointer user_data)
     milter_agent_shutdown(MILTER_AGENT(context));
 }
 
+/*
+ * The connection isn't reused for the next session on the
+ * client side. It is closed as QUIT and the server
+ * connects again.
+ */
+static void
+cb_decoder_quit_new_connection (MilterDecoder *decoder, gpointer user_data)
+{
+    cb_decoder_quit(decoder, user_data);
+}
+
 static void
 cb_decoder_abort (MilterDecoder *decoder, gpointer user_data)
 {
@@ -3619,6 +3706,7 @@ decoder_new (MilterAgent *agent)
     CONNECT(body);
     CONNECT(end_of_message);
     CONNECT(quit);
+    CONNECT(quit_new_connection);
     CONNECT(abort);
 
 #undef CONNECT
@@ -17,6 +17,10 @@
  *
  */
 
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE /* for accept4() */
+#endif
+
 #ifdef HAVE_CONFIG_H
 #  include "../../config.h"
 #endif /* HAVE_CONFIG_H */
@@ -27,6 +31,10 @@
 #include <pwd.h>
 #include <grp.h>
 #include <fcntl.h>
+#include <sys/socket.h>
+#ifdef HAVE_SYS_EPOLL_H
+#  include <sys/epoll.h>
+#endif
 
 #include <errno.h>
 
@@ -54,7 +62,11 @@ enum
     PROP_SYSLOG_FACILITIY,
     PROP_START_SYSLOG,
     PROP_RUN_AS_DAEMON,
-    PROP_MAX_PENDING_FINISHED_SESSIONS
+    PROP_MAX_PENDING_FINISHED_SESSIONS,
+    PROP_MULTI_THREAD_MODE,
+    PROP_N_THREADS,
+    PROP_WORKER_SHARDING,
+    PROP_MAX_ACCEPTS_PER_WAKEUP
 };
 
 enum
@@ -84,10 +96,23 @@ struct _MilterClientPrivate
     MilterEventLoop *event_loop;
     guint accept_watch_id;
     guint accept_error_watch_id;
+    struct {
+        MilterEventLoop *loop;
+        GIOChannel *channel;
+        GIOFunc func;
+        gint priority;
+        guint resume_id;
+        volatile gint by_max_connections;
+        gint wakeup_fds[2];
+        GIOChannel *wakeup_channel;
+        guint wakeup_watch_id;
+        volatile gint wakeup_requested;
+    } accept_watch;
     gchar *connection_spec;
     GList *processing_data;
     guint n_processing_sessions;
     guint n_processed_sessions;
+    guint n_reported_sessions;
     guint maintenance_interval;
     guint timeout;
     GIOChannel *listen_channel;
@@ -103,13 +128,20 @@ struct _MilterClientPrivate
     guint suspend_time_on_unacceptable;
     guint max_connections;
     gboolean multi_thread_mode;
-    GThreadPool *worker_threads;
+    guint n_threads;
+    GPtrArray *threads;
+    guint max_accepts_per_wakeup;
+    guint next_thread_index;
     struct {
         GIOChannel *control;
         guint n_process;
         guint id;
         GArray *pids;
+        gboolean sharding;
+        gboolean reuse_port;
+        GIOChannel *exclusive_channel;
     } workers;
+    guint n_accepted_connections;
     struct sockaddr *address;
     socklen_t address_size;
     gchar *effective_user;
@@ -144,6 +176,15 @@ typedef struct _MilterClientProcessData
 } MilterClientProcessData;
 
 typedef gboolean (*AcceptConnectionFunction) (MilterClient *client, gint fd);
+typedef void (*ProcessClientChannelFunction) (MilterClient *client,
+                                              GIOChannel *channel,
+                                              MilterGenericSocketAddress *address,
+                                              socklen_t address_size);
+
+#define ACCEPT_RESUME_LOW_WATER_MARK(max_connections)   \
+    ((max_connections) - (max_connections) / 10)
+
+#define MULTI_THREAD_DRAIN_INTERVAL 0.01
 
 #define _milter_client_get_type milter_client_get_type
 MILTER_DEFINE_ERROR_EMITTABLE_TYPE(MilterClient, _milter_client, G_TYPE_OBJECT)
@@ -380,6 +421,41 @@ _milter_client_class_init (MilterClientClass *klass)
     g_object_class_install_property(gobject_class,
                                     PROP_MAX_PENDING_FINISHED_SESSIONS, spec);
 
+    spec = g_param_spec_boolean("multi-thread-mode",
+                                "Multi thread mode",
+                                "Whether processing sessions by multiple "
+                                "threads or not",
+                                FALSE,
+                                G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_MULTI_THREAD_MODE,
+                                    spec);
+
+    spec = g_param_spec_uint("n-threads",
+                             "Number of threads",
+                             "The number of threads that process sessions "
+                             "in multi thread mode",
+                             0, G_MAXUINT, 0,
+                             G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_N_THREADS, spec);
+
+    spec = g_param_spec_boolean("worker-sharding",
+                                "Worker sharding",
+                                "Whether each worker accepts connections "
+                                "by its own socket or not",
+                                FALSE,
+                                G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_WORKER_SHARDING, spec);
+
+    spec = g_param_spec_uint("max-accepts-per-wakeup",
+                             "Max accepts per wakeup",
+                             "The max number of connections accepted "
+                             "for a readiness of the listening socket",
+                             1, G_MAXUINT,
+                             MILTER_CLIENT_DEFAULT_MAX_ACCEPTS_PER_WAKEUP,
+                             G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_MAX_ACCEPTS_PER_WAKEUP,
+                                    spec);
+
     signals[CONNECTION_ESTABLISHED] =
         g_signal_new("connection-established",
                      MILTER_TYPE_CLIENT,
@@ -452,6 +528,20 @@ milter_client_create_event_loop (MilterClient *client, gboolean use_default_cont
     MilterEventLoop *loop = NULL;
 
     switch (milter_client_get_event_loop_backend(client)) {
+    case MILTER_CLIENT_EVENT_LOOP_BACKEND_EPOLL:
+#ifdef HAVE_EPOLL_EVENT_LOOP
+        milter_info("[cilent][event-loop][epoll]");
+        if (use_default_context) {
+            loop = milter_epoll_event_loop_default();
+        } else {
+            loop = milter_epoll_event_loop_new();
+        }
+        break;
+#else
+        milter_warning("[client][event-loop][epoll][unavailable] "
+                       "fallback to GLib");
+        /* fall through */
+#endif
     case MILTER_CLIENT_EVENT_LOOP_BACKEND_DEFAULT:
     case MILTER_CLIENT_EVENT_LOOP_BACKEND_GLIB:
         milter_info("[cilent][event-loop][glib]");
@@ -491,10 +581,22 @@ _milter_client_init (MilterClient *client)
 
     priv->accept_watch_id = 0;
     priv->accept_error_watch_id = 0;
+    priv->accept_watch.loop = NULL;
+    priv->accept_watch.channel = NULL;
+    priv->accept_watch.func = NULL;
+    priv->accept_watch.priority = G_PRIORITY_DEFAULT;
+    priv->accept_watch.resume_id = 0;
+    priv->accept_watch.by_max_connections = FALSE;
+    priv->accept_watch.wakeup_fds[0] = -1;
+    priv->accept_watch.wakeup_fds[1] = -1;
+    priv->accept_watch.wakeup_channel = NULL;
+    priv->accept_watch.wakeup_watch_id = 0;
+    priv->accept_watch.wakeup_requested = FALSE;
     priv->connection_spec = NULL;
     priv->processing_data = NULL;
     priv->n_processing_sessions = 0;
     priv->n_processed_sessions = 0;
+    priv->n_reported_sessions = 0;
     priv->maintenance_interval = 0;
     priv->timeout = 7210;
     priv->listen_channel = NULL;
@@ -511,11 +613,18 @@ _milter_client_init (MilterClient *client)
         MILTER_CLIENT_DEFAULT_SUSPEND_TIME_ON_UNACCEPTABLE;
     priv->max_connections = MILTER_CLIENT_DEFAULT_MAX_CONNECTIONS;
     priv->multi_thread_mode = FALSE;
-    priv->worker_threads = NULL;
+    priv->n_threads = 0;
+    priv->max_accepts_per_wakeup = MILTER_CLIENT_DEFAULT_MAX_ACCEPTS_PER_WAKEUP;
+    priv->threads = NULL;
+    priv->next_thread_index = 0;
     priv->workers.n_process = 0;
     priv->workers.id = 0;
     priv->workers.control = NULL;
     priv->workers.pids = NULL;
+    priv->workers.sharding = FALSE;
+    priv->workers.reuse_port = FALSE;
+    priv->workers.exclusive_channel = NULL;
+    priv->n_accepted_connections = 0;
     priv->address = NULL;
     priv->address_size = 0;
     priv->effective_user = NULL;
@@ -690,6 +799,10 @@ dispose_finished_data (MilterClient *client)
                       priv->n_processed_sessions,
                       n_finished_sessions,
                       priv->n_processing_sessions);
+    if (priv->workers.id > 0)
+        milter_statistics("[workers][%u][accepted] %u",
+                          priv->workers.id,
+                          priv->n_accepted_connections);
     if (milter_client_need_maintain(client, n_finished_sessions)) {
         g_signal_emit(client, signals[MAINTAIN], 0);
     }
@@ -705,6 +818,13 @@ watch_worker_process (GPid     pid,
 static void
 dispose_accept_watchers (MilterClientPrivate *priv)
 {
+    if (priv->accept_watch.resume_id > 0) {
+        milter_event_loop_remove(priv->accept_watch.loop,
+                                 priv->accept_watch.resume_id);
+        priv->accept_watch.resume_id = 0;
+    }
+    priv->accept_watch.loop = NULL;
+
     if (priv->accept_watch_id > 0) {
         if (priv->accept_loop) {
             milter_event_loop_remove(priv->accept_loop, priv->accept_watch_id);
@@ -800,11 +920,6 @@ dispose (GObject *object)
         priv->default_unix_socket_group = NULL;
     }
 
-    if (priv->worker_threads) {
-        g_thread_pool_free(priv->worker_threads, TRUE, FALSE);
-        priv->worker_threads = NULL;
-    }
-
     dispose_address(priv);
 
     if (priv->effective_user) {
@@ -898,6 +1013,19 @@ set_property (GObject      *object,
         milter_client_set_max_pending_finished_sessions(client,
                                                         g_value_get_uint(value));
         break;
+    case PROP_MULTI_THREAD_MODE:
+        milter_client_set_multi_thread_mode(client, g_value_get_boolean(value));
+        break;
+    case PROP_N_THREADS:
+        milter_client_set_n_threads(client, g_value_get_uint(value));
+        break;
+    case PROP_WORKER_SHARDING:
+        milter_client_set_worker_sharding(client, g_value_get_boolean(value));
+        break;
+    case PROP_MAX_ACCEPTS_PER_WAKEUP:
+        milter_client_set_max_accepts_per_wakeup(client,
+                                                 g_value_get_uint(value));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -962,6 +1090,19 @@ get_property (GObject    *object,
         g_value_set_uint(value,
                          milter_client_get_max_pending_finished_sessions(client));
         break;
+    case PROP_MULTI_THREAD_MODE:
+        g_value_set_boolean(value, milter_client_is_multi_thread_mode(client));
+        break;
+    case PROP_N_THREADS:
+        g_value_set_uint(value, milter_client_get_n_threads(client));
+        break;
+    case PROP_WORKER_SHARDING:
+        g_value_set_boolean(value, milter_client_is_worker_sharding(client));
+        break;
+    case PROP_MAX_ACCEPTS_PER_WAKEUP:
+        g_value_set_uint(value,
+                         milter_client_get_max_accepts_per_wakeup(client));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -1222,25 +1363,25 @@ milter_client_create_context (MilterClient *client)
 static gboolean
 milter_client_start_context (MilterClient *client,
                              MilterClientContext *context,
+                             MilterEventLoop *loop,
                              GIOChannel *channel,
                              MilterGenericSocketAddress *address,
                              GError **error)
 {
-    MilterClientPrivate *priv;
     MilterAgent *agent;
     MilterWriter *writer;
     MilterReader *reader;
 
     agent = MILTER_AGENT(context);
-    priv = MILTER_CLIENT_GET_PRIVATE(client);
 
-    milter_agent_set_event_loop(agent, priv->event_loop);
+    milter_agent_set_event_loop(agent, loop);
 
     writer = milter_writer_io_channel_new(channel);
+    milter_writer_set_use_writev(writer, TRUE);
     milter_agent_set_writer(agent, writer);
     g_object_unref(writer);
 
-    reader = milter_reader_io_channel_new(channel);
+    reader = milter_reader_socket_io_channel_new(channel);
     milter_agent_set_reader(agent, reader);
     g_object_unref(reader);
 
@@ -1287,7 +1428,8 @@ single_thread_client_channel_setup (MilterClient *client,
 
     priv->processing_data = g_list_prepend(priv->processing_data, data);
 
-    if (milter_client_start_context(client, context, channel, address, &error)) {
+    if (milter_client_start_context(client, context, priv->event_loop,
+                                    channel, address, &error)) {
         g_signal_emit(client, signals[CONNECTION_ESTABLISHED], 0, context);
     } else {
         milter_error("[%u] [client][single-thread][start][error] %s",
@@ -1335,65 +1477,165 @@ single_thread_process_client_channel (MilterClient *client, GIOChannel *channel,
                                     NULL);
 }
 
+static void
+watch_accept (MilterClient *client, MilterEventLoop *loop, gint priority,
+              GIOChannel *channel, GIOFunc accept_func)
+{
+    MilterClientPrivate *priv;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+
+    priv->accept_watch.loop = loop;
+    priv->accept_watch.channel = channel;
+    priv->accept_watch.func = accept_func;
+    priv->accept_watch.priority = priority;
+    priv->accept_watch_id =
+        milter_event_loop_watch_io_full(loop,
+                                        priority,
+                                        channel,
+                                        G_IO_IN | G_IO_PRI,
+                                        accept_func,
+                                        client,
+                                        NULL);
+}
+
+static void
+resume_accepting (MilterClient *client)
+{
+    MilterClientPrivate *priv;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+
+    if (priv->accept_watch.resume_id > 0) {
+        milter_event_loop_remove(priv->accept_watch.loop,
+                                 priv->accept_watch.resume_id);
+        priv->accept_watch.resume_id = 0;
+    }
+    g_atomic_int_set(&(priv->accept_watch.by_max_connections), FALSE);
+
+    if (priv->accept_watch_id > 0 || !priv->accept_watch.loop)
+        return;
+
+    milter_warning("[client][accept][resume] "
+                   "resume accepting connection: processing: %u",
+                   priv->n_processing_sessions);
+    watch_accept(client,
+                 priv->accept_watch.loop,
+                 priv->accept_watch.priority,
+                 priv->accept_watch.channel,
+                 priv->accept_watch.func);
+}
+
+static gboolean
+cb_resume_accepting (gpointer user_data)
+{
+    MilterClient *client = user_data;
+    MilterClientPrivate *priv;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    priv->accept_watch.resume_id = 0;
+    resume_accepting(client);
+
+    return FALSE;
+}
+
+/*
+ * We stop watching the listening socket instead of sleeping
+ * because sleeping also blocks sessions processed in the same
+ * event loop. Accepting is resumed after suspend_time seconds
+ * or, for max connections, when the number of processing
+ * sessions drops below the low-water mark.
+ */
+static void
+suspend_accepting (MilterClient *client, guint suspend_time,
+                   gboolean by_max_connections)
+{
+    MilterClientPrivate *priv;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+
+    if (priv->accept_watch_id == 0 || !priv->accept_watch.loop)
+        return;
+
+    milter_event_loop_remove(priv->accept_watch.loop, priv->accept_watch_id);
+    priv->accept_watch_id = 0;
+    g_atomic_int_set(&(priv->accept_watch.by_max_connections),
+                     by_max_connections);
+    priv->accept_watch.resume_id =
+        milter_event_loop_add_timeout(priv->accept_watch.loop,
+                                      suspend_time,
+                                      cb_resume_accepting,
+                                      client);
+}
+
 static gint
 accept_connection_fd (MilterClient *client, gint server_fd,
                       MilterGenericSocketAddress *address,
-                      socklen_t *address_size)
+                      socklen_t *address_size,
+                      gint *accept_errno)
 {
     MilterClientPrivate *priv;
     gint client_fd;
-    guint n_suspend, suspend_time, max_connections;
+    guint suspend_time, max_connections;
 
     priv = MILTER_CLIENT_GET_PRIVATE(client);
 
     suspend_time = milter_client_get_suspend_time_on_unacceptable(client);
     max_connections = milter_client_get_max_connections(client);
-    for (n_suspend = 0;
-         0 < max_connections && max_connections <= priv->n_processing_sessions;
-         n_suspend++) {
+    if (0 < max_connections && max_connections <= priv->n_processing_sessions) {
         milter_warning("[client][accept][suspend] "
                        "too many processing connection: %u, max: %u; "
-                       "suspend accepting connection in %d seconds: #%u",
+                       "suspend accepting connection in %d seconds",
                        priv->n_processing_sessions,
                        max_connections,
-                       suspend_time,
-                       n_suspend);
-        g_usleep(suspend_time * G_USEC_PER_SEC);
-        milter_warning("[client][accept][resume] "
-                       "resume accepting connection: #%u", n_suspend);
+                       suspend_time);
+        suspend_accepting(client, suspend_time, TRUE);
+        *accept_errno = EAGAIN;
+        return -1;
     }
 
     *address_size = sizeof(*address);
     memset(address, '\0', *address_size);
+#ifdef HAVE_ACCEPT4
+    client_fd = accept4(server_fd, (struct sockaddr *)(address), address_size,
+                        SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
     client_fd = accept(server_fd, (struct sockaddr *)(address), address_size);
+    if (client_fd != -1) {
+        fcntl(client_fd, F_SETFL, fcntl(client_fd, F_GETFL) | O_NONBLOCK);
+        fcntl(client_fd, F_SETFD, FD_CLOEXEC);
+    }
+#endif
     if (client_fd == -1) {
         GError *error = NULL;
 
-        if (errno == EAGAIN)
+        /* Logging and error handlers may overwrite errno. */
+        *accept_errno = errno;
+        if (*accept_errno == EAGAIN || *accept_errno == EWOULDBLOCK)
             return client_fd;
 
         g_set_error(&error,
                     MILTER_CONNECTION_ERROR,
                     MILTER_CONNECTION_ERROR_ACCEPT_FAILURE,
-                    "failed to accept(): %s", g_strerror(errno));
-        milter_error("[client][error][accept] %s", g_strerror(errno));
+                    "failed to accept(): %s", g_strerror(*accept_errno));
+        milter_error("[client][error][accept] %s", g_strerror(*accept_errno));
         milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(client),
                                     error);
         g_error_free(error);
 
-        if (errno == EMFILE) {
+        if (*accept_errno == EMFILE) {
             milter_warning("[client][accept][suspend] "
                            "too many file is opened. "
                            "suspend accepting connection in %d seconds",
                            suspend_time);
-            g_usleep(suspend_time * G_USEC_PER_SEC);
-            milter_warning("[client][accept][resume] "
-                           "resume accepting connection.");
+            suspend_accepting(client, suspend_time, FALSE);
+            *accept_errno = EAGAIN;
         }
 
         return client_fd;
     }
 
+    priv->n_accepted_connections++;
     milter_client_session_started(client);
     if (milter_need_debug_log()) {
         gchar *spec;
@@ -1415,55 +1657,188 @@ setup_client_channel(gint client_fd)
     return client_channel;
 }
 
+/* accept_connection_fd() returns non-blocking fd. */
+static GIOChannel *
+setup_accepted_channel (gint client_fd)
+{
+    GIOChannel *client_channel = g_io_channel_unix_new(client_fd);
+    g_io_channel_set_encoding(client_channel, NULL, NULL);
+    g_io_channel_set_close_on_unref(client_channel, TRUE);
+    return client_channel;
+}
+
+/*
+ * Accepts connections until the listening socket has no more
+ * pending connection or max-accepts-per-wakeup connections
+ * are accepted. It reduces round trips to the event loop on
+ * connection burst.
+ *
+ * Returns FALSE when accept() fails by an error other than
+ * EAGAIN.
+ */
 static gboolean
-accept_connection (MilterClient *client, gint server_fd,
-                   GIOChannel **client_channel,
-                   MilterGenericSocketAddress *address,
-                   socklen_t *address_size)
+accept_connections (MilterClient *client, gint server_fd,
+                    ProcessClientChannelFunction process_client_channel)
 {
-    gint client_fd;
+    guint i, max_accepts;
 
-    client_fd = accept_connection_fd(client, server_fd, address, address_size);
-    if (client_fd == -1)
-        return FALSE;
+    max_accepts = milter_client_get_max_accepts_per_wakeup(client);
+    for (i = 0; i < MAX(max_accepts, 1); i++) {
+        gint client_fd;
+        GIOChannel *client_channel;
+        MilterGenericSocketAddress address;
+        socklen_t address_size;
+        gint accept_errno = 0;
+
+        client_fd = accept_connection_fd(client, server_fd,
+                                         &address, &address_size,
+                                         &accept_errno);
+        if (client_fd == -1)
+            return accept_errno == EAGAIN || accept_errno == EWOULDBLOCK;
+
+        client_channel = setup_accepted_channel(client_fd);
+        process_client_channel(client, client_channel, &address, address_size);
+        g_io_channel_unref(client_channel);
+    }
+
+    return TRUE;
+}
 
-    *client_channel = setup_client_channel(client_fd);
+/*
+ * Sessions may be finished in threads other than the one
+ * that runs the accept loop. The accept loop is woken up to
+ * resume accepting. In multi thread mode, it also emits
+ * "sessions-finished" and "maintain" on the main thread.
+ */
+static void
+wakeup_accept_loop (MilterClient *client)
+{
+    MilterClientPrivate *priv;
+    gssize written_size;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+
+    if (priv->accept_watch.wakeup_fds[1] == -1)
+        return;
+    if (!g_atomic_int_compare_and_exchange(
+            &(priv->accept_watch.wakeup_requested), FALSE, TRUE))
+        return;
+
+    do {
+        written_size = write(priv->accept_watch.wakeup_fds[1], "", 1);
+    } while (written_size == -1 && errno == EINTR);
+}
+
+static gboolean
+accept_wakeup_watch_func (GIOChannel *channel,
+                          GIOCondition condition,
+                          gpointer data)
+{
+    MilterClient *client = data;
+    MilterClientPrivate *priv;
+    guint max_connections;
+    guint n_processed_sessions, n_finished_sessions;
+    gchar buffer[64];
+    gssize read_size;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+
+    do {
+        read_size = read(priv->accept_watch.wakeup_fds[0],
+                         buffer, sizeof(buffer));
+    } while (read_size > 0 || (read_size == -1 && errno == EINTR));
+    g_atomic_int_set(&(priv->accept_watch.wakeup_requested), FALSE);
+
+    max_connections = milter_client_get_max_connections(client);
+    if (priv->accept_watch.resume_id > 0 &&
+        g_atomic_int_get(&(priv->accept_watch.by_max_connections)) &&
+        g_atomic_int_get((gint *)&(priv->n_processing_sessions)) <
+        ACCEPT_RESUME_LOW_WATER_MARK(max_connections))
+        resume_accepting(client);
+
+    if (!priv->threads)
+        return TRUE;
+
+    n_processed_sessions =
+        g_atomic_int_get((gint *)&(priv->n_processed_sessions));
+    n_finished_sessions = n_processed_sessions - priv->n_reported_sessions;
+    priv->n_reported_sessions = n_processed_sessions;
+    if (n_finished_sessions > 0) {
+        g_signal_emit(client, signals[SESSIONS_FINISHED], 0,
+                      n_finished_sessions);
+        if (milter_client_need_maintain(client, n_finished_sessions))
+            g_signal_emit(client, signals[MAINTAIN], 0);
+    }
 
     return TRUE;
 }
 
 static gboolean
-single_thread_accept_connection (MilterClient *client, gint server_fd)
+watch_accept_wakeup (MilterClient *client, GError **error)
 {
-    gboolean accepted;
-    GIOChannel *client_channel;
-    MilterGenericSocketAddress address;
-    socklen_t address_size;
+    MilterClientPrivate *priv;
+    gint *fds;
 
-    accepted = accept_connection(client, server_fd, &client_channel,
-                                 &address, &address_size);
-    if (accepted) {
-        single_thread_process_client_channel(client, client_channel,
-                                             &address, address_size);
-        g_io_channel_unref(client_channel);
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    fds = priv->accept_watch.wakeup_fds;
+    if (pipe(fds) == -1) {
+        g_set_error(error,
+                    MILTER_CLIENT_ERROR,
+                    MILTER_CLIENT_ERROR_THREAD,
+                    "failed to create a wakeup pipe for accept loop: %s",
+                    g_strerror(errno));
+        fds[0] = -1;
+        fds[1] = -1;
+        return FALSE;
     }
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+    priv->accept_watch.wakeup_channel = g_io_channel_unix_new(fds[0]);
+    g_io_channel_set_encoding(priv->accept_watch.wakeup_channel, NULL, NULL);
+    priv->accept_watch.wakeup_watch_id =
+        milter_event_loop_watch_io(priv->accept_loop,
+                                   priv->accept_watch.wakeup_channel,
+                                   G_IO_IN | G_IO_PRI,
+                                   accept_wakeup_watch_func,
+                                   client);
 
     return TRUE;
 }
 
+static void
+unwatch_accept_wakeup (MilterClientPrivate *priv)
+{
+    if (priv->accept_watch.wakeup_watch_id > 0) {
+        milter_event_loop_remove(priv->accept_loop,
+                                 priv->accept_watch.wakeup_watch_id);
+        priv->accept_watch.wakeup_watch_id = 0;
+    }
+    if (priv->accept_watch.wakeup_channel) {
+        g_io_channel_unref(priv->accept_watch.wakeup_channel);
+        priv->accept_watch.wakeup_channel = NULL;
+    }
+    if (priv->accept_watch.wakeup_fds[0] != -1) {
+        close(priv->accept_watch.wakeup_fds[0]);
+        priv->accept_watch.wakeup_fds[0] = -1;
+    }
+    if (priv->accept_watch.wakeup_fds[1] != -1) {
+        close(priv->accept_watch.wakeup_fds[1]);
+        priv->accept_watch.wakeup_fds[1] = -1;
+    }
+    priv->accept_watch.wakeup_requested = FALSE;
+}
+
 static gboolean
 single_thread_accept_watch_func (GIOChannel *channel, GIOCondition condition,
                                  gpointer data)
 {
     MilterClient *client = data;
-    gboolean keep_callback = TRUE;
     gint fd;
 
     fd = g_io_channel_unix_get_fd(channel);
-    keep_callback = single_thread_accept_connection(client, fd);
-    if (!keep_callback)
-        milter_client_shutdown(client);
-    return keep_callback;
+    accept_connections(client, fd, single_thread_process_client_channel);
+    return TRUE;
 }
 
 static gboolean
@@ -1517,6 +1892,13 @@ single_thread_start_accept (MilterClient *client, GError **error)
     GError *local_error = NULL;
 
     priv = MILTER_CLIENT_GET_PRIVATE(client);
+    if (!watch_accept_wakeup(client, &local_error)) {
+        milter_error("[client][single-thread][accept][start][error] %s",
+                     local_error->message);
+        g_propagate_error(error, local_error);
+        return FALSE;
+    }
+
     thread = g_thread_try_new("single_thread_accept_thread",
                               single_thread_accept_thread,
                               client,
@@ -1525,6 +1907,7 @@ single_thread_start_accept (MilterClient *client, GError **error)
         milter_error("[client][single-thread][accept][start][error] %s",
                      local_error->message);
         g_propagate_error(error, local_error);
+        unwatch_accept_wakeup(priv);
         return FALSE;
     }
 
@@ -1542,177 +1925,516 @@ single_thread_start_accept (MilterClient *client, GError **error)
         milter_event_loop_run(loop);
     }
     g_thread_join(thread);
+    unwatch_accept_wakeup(priv);
 
     return TRUE;
 }
 
+/*
+ * Multi-thread mode runs long-lived event loops, one per
+ * thread. The accept loop hands an accepted channel to the
+ * least loaded thread through its pending queue and wakes
+ * the thread up by its wakeup pipe. A thread that finishes a
+ * session steals a pending channel from a busier thread.
+ */
+typedef struct _MilterClientThread
+{
+    MilterClient *client;
+    guint id;
+    GThread *thread;
+    MilterEventLoop *loop;
+    GAsyncQueue *pending_channels;
+    gint wakeup_fds[2];
+    GIOChannel *wakeup_channel;
+    guint wakeup_watch_id;
+    volatile gint n_sessions;
+    volatile gint quitting;
+    volatile gint finished;
+    GList *finished_data;
+    guint finisher_id;
+} MilterClientThread;
+
+typedef struct _MultiThreadProcessData
+{
+    MilterClientThread *thread;
+    MilterClientContext *context;
+    gulong finished_handler_id;
+} MultiThreadProcessData;
+
+static guint
+multi_thread_get_n_threads (MilterClient *client)
+{
+    guint n_threads;
+
+    n_threads = milter_client_get_n_threads(client);
+    if (n_threads == 0) {
+        glong n_processors;
+
+        n_processors = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = n_processors > 0 ? n_processors : 1;
+    }
+
+    return n_threads;
+}
+
 static void
-multi_thread_process_client_channel (MilterClient *client, GIOChannel *channel,
-                                     MilterGenericSocketAddress *address,
-                                     socklen_t address_size)
+multi_thread_wakeup (MilterClientThread *thread)
 {
-    MilterClientPrivate *priv;
+    gssize written_size;
+
+    do {
+        written_size = write(thread->wakeup_fds[1], "", 1);
+    } while (written_size == -1 && errno == EINTR);
+}
+
+static void
+multi_thread_quit_if_idle (MilterClientThread *thread)
+{
+    if (!g_atomic_int_get(&thread->quitting))
+        return;
+    if (g_atomic_int_get(&thread->n_sessions) > 0)
+        return;
+    if (g_async_queue_length(thread->pending_channels) > 0)
+        return;
+
+    milter_debug("[client][multi-thread][%u][quit]", thread->id);
+    milter_event_loop_quit(thread->loop);
+}
+
+static void
+multi_thread_process_data_free (MultiThreadProcessData *data)
+{
+    if (data->finished_handler_id > 0)
+        g_signal_handler_disconnect(data->context, data->finished_handler_id);
+    g_object_unref(data->context);
+    g_free(data);
+}
+
+static gboolean multi_thread_steal_pending_channel (MilterClientThread *thread);
+
+static gboolean
+multi_thread_finisher (gpointer user_data)
+{
+    MilterClientThread *thread = user_data;
+    GList *node;
+    guint n_finished_sessions = 0;
+
+    for (node = thread->finished_data; node; node = g_list_next(node)) {
+        MultiThreadProcessData *data = node->data;
+
+        milter_debug("[%u] [client][multi-thread][%u][finish]",
+                     milter_agent_get_tag(MILTER_AGENT(data->context)),
+                     thread->id);
+        multi_thread_process_data_free(data);
+        milter_client_session_finished(thread->client);
+        n_finished_sessions++;
+    }
+    g_list_free(thread->finished_data);
+    thread->finished_data = NULL;
+    thread->finisher_id = 0;
+    g_atomic_int_add(&thread->n_sessions, -(gint)n_finished_sessions);
+
+    while (multi_thread_steal_pending_channel(thread)) {
+    }
+    multi_thread_quit_if_idle(thread);
+
+    return FALSE;
+}
+
+static void
+multi_thread_cb_finished (MilterClientContext *context, gpointer user_data)
+{
+    MultiThreadProcessData *data = user_data;
+    MilterClientThread *thread = data->thread;
+
+    g_signal_handler_disconnect(data->context, data->finished_handler_id);
+    data->finished_handler_id = 0;
+
+    thread->finished_data = g_list_prepend(thread->finished_data, data);
+    if (thread->finisher_id == 0)
+        thread->finisher_id =
+            milter_event_loop_add_idle_full(thread->loop,
+                                            G_PRIORITY_DEFAULT,
+                                            multi_thread_finisher,
+                                            thread,
+                                            NULL);
+}
+
+static void
+multi_thread_client_channel_setup (MilterClientThread *thread,
+                                   ClientChannelSetupData *setup_data)
+{
+    MilterClient *client = thread->client;
+    MilterAgent *agent;
     MilterClientContext *context;
-    MilterClientProcessData *data;
+    MultiThreadProcessData *data;
     GError *error = NULL;
 
-    priv = MILTER_CLIENT_GET_PRIVATE(client);
-
     context = milter_client_create_context(client);
+    agent = MILTER_AGENT(context);
 
-    data = g_new(MilterClientProcessData, 1);
-    data->priv = priv;
-    data->client = client;
+    data = g_new(MultiThreadProcessData, 1);
+    data->thread = thread;
     data->context = context;
-    data->finished_handler_id = 0;
 
-    priv->processing_data = g_list_prepend(priv->processing_data, data);
-    if (milter_client_start_context(client, context, channel, address, &error)) {
-        g_thread_pool_push(priv->worker_threads, data, &error);
-        if (error) {
-            GError *client_error;
+    milter_debug("[%u] [client][multi-thread][%u][start]",
+                 milter_agent_get_tag(agent), thread->id);
 
-            client_error = g_error_new(MILTER_CLIENT_ERROR,
-                                       MILTER_CLIENT_ERROR_THREAD,
-                                       "failed to push a data to thread pool: %s",
-                                       error->message);
-            g_error_free(error);
-            milter_error("[%u] [client][multi-thread][error] %s",
-                         milter_agent_get_tag(MILTER_AGENT(context)),
-                         client_error->message);
-            milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(client),
-                                        client_error);
-            g_error_free(client_error);
-            milter_finished_emittable_emit(MILTER_FINISHED_EMITTABLE(context));
-        }
+    data->finished_handler_id =
+        g_signal_connect(context, "finished",
+                         G_CALLBACK(multi_thread_cb_finished), data);
+    g_atomic_int_inc(&thread->n_sessions);
+
+    if (milter_client_start_context(client, context, thread->loop,
+                                    setup_data->channel,
+                                    &(setup_data->address),
+                                    &error)) {
+        g_signal_emit(client, signals[CONNECTION_ESTABLISHED], 0, context);
     } else {
-        milter_error("[%u] [client][multi-thread][start][error] %s",
-                     milter_agent_get_tag(MILTER_AGENT(context)),
-                     error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(context), error);
+        milter_error("[%u] [client][multi-thread][%u][start][error] %s",
+                     milter_agent_get_tag(agent), thread->id, error->message);
+        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(agent), error);
         g_error_free(error);
         milter_finished_emittable_emit(MILTER_FINISHED_EMITTABLE(context));
     }
 
-    g_io_channel_unref(channel);
+    g_io_channel_unref(setup_data->channel);
+    g_free(setup_data);
 }
 
 static gboolean
-multi_thread_accept_connection (MilterClient *client, gint server_fd)
+multi_thread_steal_pending_channel (MilterClientThread *thread)
 {
-    gboolean accepted;
-    GIOChannel *client_channel;
-    MilterGenericSocketAddress address;
-    socklen_t address_size;
+    MilterClientPrivate *priv;
+    MilterClientThread *victim = NULL;
+    ClientChannelSetupData *setup_data;
+    gint n_sessions, max_n_pending_channels = 0;
+    guint i;
 
-    accepted = accept_connection(client, server_fd, &client_channel,
-                                 &address, &address_size);
-    if (accepted) {
-        multi_thread_process_client_channel(client, client_channel,
-                                            &address, address_size);
-        g_io_channel_unref(client_channel);
+    priv = MILTER_CLIENT_GET_PRIVATE(thread->client);
+
+    n_sessions = g_atomic_int_get(&thread->n_sessions);
+    for (i = 0; i < priv->threads->len; i++) {
+        MilterClientThread *other = g_ptr_array_index(priv->threads, i);
+        gint n_pending_channels;
+
+        if (other == thread)
+            continue;
+        if (g_atomic_int_get(&other->n_sessions) <= n_sessions)
+            continue;
+        n_pending_channels = g_async_queue_length(other->pending_channels);
+        if (n_pending_channels > max_n_pending_channels) {
+            victim = other;
+            max_n_pending_channels = n_pending_channels;
+        }
+    }
+    if (!victim)
+        return FALSE;
+
+    setup_data = g_async_queue_try_pop(victim->pending_channels);
+    if (!setup_data)
+        return FALSE;
+
+    milter_debug("[client][multi-thread][%u][steal] <%u>",
+                 thread->id, victim->id);
+    multi_thread_client_channel_setup(thread, setup_data);
+    return TRUE;
+}
+
+static gboolean
+multi_thread_wakeup_watch_func (GIOChannel *channel, GIOCondition condition,
+                                gpointer data)
+{
+    MilterClientThread *thread = data;
+    ClientChannelSetupData *setup_data;
+    gchar buffer[64];
+    gssize read_size;
+
+    do {
+        read_size = read(thread->wakeup_fds[0], buffer, sizeof(buffer));
+    } while (read_size > 0 || (read_size == -1 && errno == EINTR));
+
+    while ((setup_data = g_async_queue_try_pop(thread->pending_channels))) {
+        multi_thread_client_channel_setup(thread, setup_data);
     }
+    multi_thread_quit_if_idle(thread);
 
     return TRUE;
 }
 
+static void
+multi_thread_thread_free (MilterClientThread *thread)
+{
+    ClientChannelSetupData *setup_data;
+
+    while ((setup_data = g_async_queue_try_pop(thread->pending_channels))) {
+        g_io_channel_unref(setup_data->channel);
+        g_free(setup_data);
+        milter_client_session_finished(thread->client);
+    }
+    g_async_queue_unref(thread->pending_channels);
+
+    if (thread->finisher_id > 0)
+        milter_event_loop_remove(thread->loop, thread->finisher_id);
+    while (thread->finished_data) {
+        multi_thread_process_data_free(thread->finished_data->data);
+        milter_client_session_finished(thread->client);
+        thread->finished_data = g_list_delete_link(thread->finished_data,
+                                                   thread->finished_data);
+    }
+
+    if (thread->wakeup_watch_id > 0)
+        milter_event_loop_remove(thread->loop, thread->wakeup_watch_id);
+    if (thread->wakeup_channel)
+        g_io_channel_unref(thread->wakeup_channel);
+    if (thread->wakeup_fds[0] != -1)
+        close(thread->wakeup_fds[0]);
+    if (thread->wakeup_fds[1] != -1)
+        close(thread->wakeup_fds[1]);
+
+    g_object_unref(thread->loop);
+    g_free(thread);
+}
+
+static MilterClientThread *
+multi_thread_thread_new (MilterClient *client, guint id, GError **error)
+{
+    MilterClientThread *thread;
+
+    thread = g_new0(MilterClientThread, 1);
+    thread->client = client;
+    thread->id = id;
+    thread->loop = milter_client_create_event_loop(client, FALSE);
+    thread->pending_channels = g_async_queue_new();
+    thread->wakeup_fds[0] = -1;
+    thread->wakeup_fds[1] = -1;
+
+    if (pipe(thread->wakeup_fds) == -1) {
+        g_set_error(error,
+                    MILTER_CLIENT_ERROR,
+                    MILTER_CLIENT_ERROR_THREAD,
+                    "failed to create a wakeup pipe for thread <%u>: %s",
+                    id, g_strerror(errno));
+        multi_thread_thread_free(thread);
+        return NULL;
+    }
+    fcntl(thread->wakeup_fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(thread->wakeup_fds[1], F_SETFL, O_NONBLOCK);
+
+    thread->wakeup_channel = g_io_channel_unix_new(thread->wakeup_fds[0]);
+    g_io_channel_set_encoding(thread->wakeup_channel, NULL, NULL);
+    thread->wakeup_watch_id =
+        milter_event_loop_watch_io(thread->loop,
+                                   thread->wakeup_channel,
+                                   G_IO_IN | G_IO_PRI,
+                                   multi_thread_wakeup_watch_func,
+                                   thread);
+
+    return thread;
+}
+
+static gpointer
+multi_thread_thread_run (gpointer data)
+{
+    MilterClientThread *thread = data;
+
+    milter_debug("[client][multi-thread][%u][run]", thread->id);
+    milter_event_loop_run(thread->loop);
+    g_atomic_int_set(&thread->finished, TRUE);
+    milter_debug("[client][multi-thread][%u][finished]", thread->id);
+
+    return NULL;
+}
+
+static MilterClientThread *
+multi_thread_choose_thread (MilterClientPrivate *priv)
+{
+    MilterClientThread *chosen_thread = NULL;
+    gint min_load = G_MAXINT;
+    guint i, n_threads;
+
+    n_threads = priv->threads->len;
+    for (i = 0; i < n_threads; i++) {
+        MilterClientThread *thread;
+        gint load;
+
+        thread = g_ptr_array_index(priv->threads,
+                                   (priv->next_thread_index + i) % n_threads);
+        load = g_atomic_int_get(&thread->n_sessions) +
+            g_async_queue_length(thread->pending_channels);
+        if (load < min_load) {
+            chosen_thread = thread;
+            min_load = load;
+        }
+    }
+    priv->next_thread_index = (priv->next_thread_index + 1) % n_threads;
+
+    return chosen_thread;
+}
+
+static void
+multi_thread_process_client_channel (MilterClient *client, GIOChannel *channel,
+                                     MilterGenericSocketAddress *address,
+                                     socklen_t address_size)
+{
+    MilterClientPrivate *priv;
+    MilterClientThread *thread;
+    ClientChannelSetupData *data;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+
+    data = g_new(ClientChannelSetupData, 1);
+    data->client = client;
+    data->channel = g_io_channel_ref(channel);
+    memcpy(&(data->address), address, address_size);
+
+    thread = multi_thread_choose_thread(priv);
+    g_async_queue_push(thread->pending_channels, data);
+    multi_thread_wakeup(thread);
+}
+
 static gboolean
 multi_thread_accept_watch_func (GIOChannel *channel, GIOCondition condition,
                                 gpointer data)
 {
     MilterClient *client = data;
-    gboolean keep_callback = TRUE;
     gint fd;
 
     fd = g_io_channel_unix_get_fd(channel);
-    keep_callback = multi_thread_accept_connection(client, fd);
-    if (!keep_callback)
-        milter_client_shutdown(client);
-    return keep_callback;
+    accept_connections(client, fd, multi_thread_process_client_channel);
+    return TRUE;
+}
+
+static gboolean
+multi_thread_is_finished (MilterClientPrivate *priv)
+{
+    guint i;
+
+    for (i = 0; i < priv->threads->len; i++) {
+        MilterClientThread *thread = g_ptr_array_index(priv->threads, i);
+
+        if (!g_atomic_int_get(&thread->finished))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+multi_thread_cb_drain_timeout (gpointer user_data)
+{
+    return TRUE;
 }
 
+/*
+ * Finished sessions are reported on the accept loop. So
+ * the accept loop is kept iterating until all threads
+ * finish their sessions instead of blocking in
+ * g_thread_join().
+ */
 static void
-multi_thread_cb_finished (MilterClientContext *context, gpointer _data)
+multi_thread_drain_threads (MilterClientPrivate *priv)
 {
-    MilterClientProcessData *data = _data;
+    guint drain_timeout_id;
+
+    if (!priv->accept_loop)
+        return;
 
-    finish_processing(data);
+    drain_timeout_id =
+        milter_event_loop_add_timeout(priv->accept_loop,
+                                      MULTI_THREAD_DRAIN_INTERVAL,
+                                      multi_thread_cb_drain_timeout,
+                                      NULL);
+    while (!multi_thread_is_finished(priv)) {
+        milter_event_loop_iterate(priv->accept_loop, TRUE);
+    }
+    milter_event_loop_remove(priv->accept_loop, drain_timeout_id);
 }
 
 static void
-multi_thread_process_client_channel_thread (gpointer data_, gpointer user_data)
+multi_thread_stop_threads (MilterClientPrivate *priv)
 {
-    MilterAgent *agent;
-    MilterClientContext *context;
-    MilterClient *client = data_;
-    MilterClientProcessData *data = user_data;
-    MilterEventLoop *event_loop;
-    GError *error = NULL;
+    guint i;
 
-    event_loop = milter_client_create_event_loop(client, FALSE);
+    for (i = 0; i < priv->threads->len; i++) {
+        MilterClientThread *thread = g_ptr_array_index(priv->threads, i);
 
-    context = MILTER_CLIENT_CONTEXT(data->context);
-    agent = MILTER_AGENT(context);
-    milter_debug("[%u] [client][multi-thread][start]",
-                 milter_agent_get_tag(agent));
+        g_atomic_int_set(&thread->quitting, TRUE);
+        multi_thread_wakeup(thread);
+    }
 
-    data->finished_handler_id =
-        g_signal_connect(data->context, "finished",
-                         G_CALLBACK(multi_thread_cb_finished), data);
+    multi_thread_drain_threads(priv);
 
-    milter_agent_set_event_loop(agent, event_loop);
-    if (milter_agent_start(agent, &error)) {
-        g_signal_emit(client, signals[CONNECTION_ESTABLISHED], 0, context);
-        milter_event_loop_run(event_loop);
-    } else {
-        milter_error("[%u] [client][multi-thread][start][error] %s",
-                     milter_agent_get_tag(agent), error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(client),
-                                    error);
-        g_error_free(error);
-        milter_finished_emittable_emit(MILTER_FINISHED_EMITTABLE(context));
+    for (i = 0; i < priv->threads->len; i++) {
+        MilterClientThread *thread = g_ptr_array_index(priv->threads, i);
+
+        g_thread_join(thread->thread);
+        multi_thread_thread_free(thread);
     }
+    g_ptr_array_free(priv->threads, TRUE);
+    priv->threads = NULL;
 
-    g_object_unref(event_loop);
+    unwatch_accept_wakeup(priv);
 }
 
 static gboolean
 multi_thread_start_accept (MilterClient *client, GError **error)
 {
     MilterClientPrivate *priv;
-    gint max_threads = 10;
+    guint i, n_threads;
     GError *local_error = NULL;
 
     priv = MILTER_CLIENT_GET_PRIVATE(client);
-    priv->worker_threads =
-        g_thread_pool_new(multi_thread_process_client_channel_thread,
-                          client,
-                          max_threads,
-                          FALSE,
-                          &local_error);
-    if (!priv->worker_threads) {
-        GError *client_error;
-        client_error = g_error_new(MILTER_CLIENT_ERROR,
-                                   MILTER_CLIENT_ERROR_THREAD,
-                                   "failed to create a thread pool "
-                                   "for processing accepted connection: %s",
-                                   local_error->message);
-        g_error_free(local_error);
+
+    if (!watch_accept_wakeup(client, &local_error)) {
         milter_error("[client][multi-thread][accept][error] %s",
-                     client_error->message);
-        g_propagate_error(error, client_error);
+                     local_error->message);
+        g_propagate_error(error, local_error);
         return FALSE;
     }
 
+    n_threads = multi_thread_get_n_threads(client);
+    priv->threads = g_ptr_array_sized_new(n_threads);
+    priv->next_thread_index = 0;
+    priv->n_reported_sessions = priv->n_processed_sessions;
+    for (i = 0; i < n_threads; i++) {
+        MilterClientThread *thread;
+
+        thread = multi_thread_thread_new(client, i, &local_error);
+        if (thread) {
+            thread->thread = g_thread_try_new("multi_thread_thread_run",
+                                              multi_thread_thread_run,
+                                              thread,
+                                              &local_error);
+            if (!thread->thread)
+                multi_thread_thread_free(thread);
+        }
+        if (local_error) {
+            GError *client_error;
+
+            client_error = g_error_new(MILTER_CLIENT_ERROR,
+                                       MILTER_CLIENT_ERROR_THREAD,
+                                       "failed to create a thread "
+                                       "for processing accepted connection: %s",
+                                       local_error->message);
+            g_error_free(local_error);
+            milter_error("[client][multi-thread][accept][error] %s",
+                         client_error->message);
+            g_propagate_error(error, client_error);
+            multi_thread_stop_threads(priv);
+            return FALSE;
+        }
+        g_ptr_array_add(priv->threads, thread);
+    }
+
+    milter_info("[client][multi-thread][run] <%u>", n_threads);
     milter_event_loop_run(priv->accept_loop);
 
-    g_thread_pool_free(priv->worker_threads, TRUE, TRUE);
-    priv->worker_threads = NULL;
+    multi_thread_stop_threads(priv);
 
     return TRUE;
 }
 
-
 static GIOChannel *
 milter_client_listen_channel (MilterClient  *client, GError **error)
 {
@@ -1725,12 +2447,13 @@ milter_client_listen_channel (MilterClient  *client, GError **error)
     dispose_address(priv);
 
     connection_spec = milter_client_get_connection_spec(client);
-    channel = milter_connection_listen(connection_spec,
-                                       priv->listen_backlog,
-                                       &(priv->address),
-                                       &(priv->address_size),
-                                       priv->remove_unix_socket_on_create,
-                                       error);
+    channel = milter_connection_listen_full(connection_spec,
+                                            priv->listen_backlog,
+                                            &(priv->address),
+                                            &(priv->address_size),
+                                            priv->remove_unix_socket_on_create,
+                                            priv->workers.reuse_port,
+                                            error);
     if (priv->address_size > 0) {
         g_signal_emit(client, signals[LISTEN_STARTED], 0,
                       priv->address, priv->address_size);
@@ -2030,11 +2753,9 @@ milter_client_prepare (MilterClient *client, MilterEventLoop *loop,
         return FALSE;
     }
 
-    priv->accept_watch_id =
-        milter_event_loop_watch_io(loop,
-                                   priv->listening_channel,
-                                   G_IO_IN | G_IO_PRI,
-                                   accept_func, client);
+    g_io_channel_set_flags(priv->listening_channel, G_IO_FLAG_NONBLOCK, NULL);
+    watch_accept(client, loop, G_PRIORITY_DEFAULT,
+                 priv->listening_channel, accept_func);
     priv->accept_error_watch_id =
         milter_event_loop_watch_io(loop,
                                    priv->listening_channel,
@@ -2130,6 +2851,22 @@ worker_watch_master (GIOChannel   *source,
     return TRUE;
 }
 
+static gboolean
+is_inet_connection_spec (MilterClient *client)
+{
+    const gchar *connection_spec;
+    gint domain;
+
+    connection_spec = milter_client_get_connection_spec(client);
+    if (!connection_spec)
+        return FALSE;
+    if (!milter_connection_parse_spec(connection_spec, &domain,
+                                      NULL, NULL, NULL))
+        return FALSE;
+
+    return domain == PF_INET || domain == PF_INET6;
+}
+
 static gboolean
 client_run_workers (MilterClient *client, guint n_workers, GError **error)
 {
@@ -2141,7 +2878,10 @@ client_run_workers (MilterClient *client, guint n_workers, GError **error)
     priv = MILTER_CLIENT_GET_PRIVATE(client);
 
     loop = milter_client_get_event_loop(client);
-    if (!priv->listen_channel) {
+    priv->workers.reuse_port = FALSE;
+    if (!priv->listen_channel && milter_client_is_worker_sharding(client))
+        priv->workers.reuse_port = is_inet_connection_spec(client);
+    if (!priv->listen_channel && !priv->workers.reuse_port) {
         GError *local_error = NULL;
         if (!milter_client_listen(client, &local_error)) {
             milter_error("[client][workers][run][listen][error] %s",
@@ -2198,23 +2938,13 @@ client_run_workers (MilterClient *client, guint n_workers, GError **error)
     return TRUE;
 }
 
-static gboolean
-single_thread_single_loop_accept_connection (MilterClient *client,
-                                             gint server_fd)
+static void
+single_thread_single_loop_process_client_channel (MilterClient *client,
+                                                  GIOChannel *channel,
+                                                  MilterGenericSocketAddress *address,
+                                                  socklen_t address_size)
 {
-    gboolean accepted;
-    GIOChannel *client_channel;
-    MilterGenericSocketAddress address;
-    socklen_t address_size;
-
-    accepted = accept_connection(client, server_fd, &client_channel,
-                                 &address, &address_size);
-    if (accepted) {
-        single_thread_client_channel_setup(client, client_channel, &address);
-        g_io_channel_unref(client_channel);
-    }
-
-    return TRUE;
+    single_thread_client_channel_setup(client, channel, address);
 }
 
 static gboolean
@@ -2223,14 +2953,12 @@ single_thread_single_loop_accept_watch_func (GIOChannel *channel,
                                              gpointer data)
 {
     MilterClient *client = data;
-    gboolean keep_callback = TRUE;
     gint fd;
 
     fd = g_io_channel_unix_get_fd(channel);
-    keep_callback = single_thread_single_loop_accept_connection(client, fd);
-    if (!keep_callback)
-        milter_client_shutdown(client);
-    return keep_callback;
+    accept_connections(client, fd,
+                       single_thread_single_loop_process_client_channel);
+    return TRUE;
 }
 
 static gboolean
@@ -2270,7 +2998,13 @@ milter_client_run_loop (MilterClient *client, GError **error)
         g_signal_emit(client, signals[WORKERS_CREATED], 0, n_workers);
         success = run_master(client, error);
     } else if (priv->multi_thread_mode) {
-        priv->accept_loop = milter_client_create_event_loop(client, FALSE);
+        if (!priv->accept_loop) {
+            if (priv->event_loop)
+                priv->accept_loop = g_object_ref(priv->event_loop);
+            else
+                priv->accept_loop = milter_client_create_event_loop(client,
+                                                                    FALSE);
+        }
         if (!milter_client_prepare(client,
                                    priv->accept_loop,
                                    multi_thread_accept_watch_func,
@@ -2426,23 +3160,81 @@ worker_accept_watch_func (GIOChannel *channel, GIOCondition condition,
                           gpointer data)
 {
     MilterClient *client = data;
-    gint server_fd, client_fd;
-    MilterGenericSocketAddress address;
-    socklen_t address_size;
-    gboolean keep_callback = TRUE;
+    gint server_fd;
 
     server_fd = g_io_channel_unix_get_fd(channel);
-    client_fd = accept_connection_fd(client, server_fd, &address, &address_size);
-    if (client_fd == -1) {
-        keep_callback = errno == EAGAIN;
-    } else {
-        GIOChannel *client_channel;
-        client_channel = setup_client_channel(client_fd);
-        single_thread_process_client_channel(client, client_channel,
-                                             &address, (socklen_t)address_size);
-        g_io_channel_unref(client_channel);
+    return accept_connections(client, server_fd,
+                              single_thread_process_client_channel);
+}
+
+/*
+ * A listening socket shared by workers wakes up all workers
+ * on each connection. An epoll instance that watches the
+ * listening socket with EPOLLEXCLUSIVE is woken up
+ * exclusively and it is readable when the listening socket
+ * is readable. So each worker watches its own epoll instance
+ * instead of the listening socket.
+ */
+static GIOChannel *
+worker_create_exclusive_channel (MilterClient *client)
+{
+#if defined(HAVE_SYS_EPOLL_H) && defined(EPOLLEXCLUSIVE)
+    MilterClientPrivate *priv;
+    struct epoll_event event;
+    gint epoll_fd;
+    GIOChannel *channel;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+
+    epoll_fd = epoll_create(1);
+    if (epoll_fd == -1) {
+        milter_warning("[client][worker][%u][exclusive][error] "
+                       "failed to epoll_create(): %s",
+                       priv->workers.id, g_strerror(errno));
+        return NULL;
     }
-    return keep_callback;
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLEXCLUSIVE;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD,
+                  g_io_channel_unix_get_fd(priv->listening_channel),
+                  &event) == -1) {
+        milter_warning("[client][worker][%u][exclusive][error] "
+                       "failed to epoll_ctl(EPOLLEXCLUSIVE): %s",
+                       priv->workers.id, g_strerror(errno));
+        close(epoll_fd);
+        return NULL;
+    }
+
+    channel = g_io_channel_unix_new(epoll_fd);
+    g_io_channel_set_close_on_unref(channel, TRUE);
+    milter_debug("[client][worker][%u][exclusive] %d",
+                 priv->workers.id, epoll_fd);
+    return channel;
+#else
+    milter_debug("[client][worker][exclusive][unsupported]");
+    return NULL;
+#endif
+}
+
+static gboolean
+worker_exclusive_accept_watch_func (GIOChannel *channel,
+                                    GIOCondition condition,
+                                    gpointer data)
+{
+    MilterClient *client = data;
+    MilterClientPrivate *priv;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+#if defined(HAVE_SYS_EPOLL_H) && defined(EPOLLEXCLUSIVE)
+    {
+        struct epoll_event event;
+
+        epoll_wait(g_io_channel_unix_get_fd(channel), &event, 1, 0);
+    }
+#endif
+
+    return worker_accept_watch_func(priv->listening_channel, condition, data);
 }
 
 static gboolean
@@ -2465,6 +3257,17 @@ run_worker (MilterClient *client, GError **error)
         return FALSE;
     }
 
+    if (!priv->listen_channel && priv->workers.reuse_port) {
+        if (!milter_client_listen(client, &local_error)) {
+            milter_error("[client][worker][run][listen][reuse-port][error] %s",
+                         local_error->message);
+            g_propagate_error(error, local_error);
+            return FALSE;
+        }
+        milter_debug("[client][worker][%u][listen][reuse-port]",
+                     priv->workers.id);
+    }
+
     if (!priv->listen_channel) {
         local_error = g_error_new(MILTER_CLIENT_ERROR,
                                   MILTER_CLIENT_ERROR_NOT_LISTENED_YET,
@@ -2483,14 +3286,18 @@ run_worker (MilterClient *client, GError **error)
 
     priv->quitting = FALSE;
     loop = milter_client_get_event_loop(client);
-    priv->accept_watch_id =
-        milter_event_loop_watch_io_full(loop,
-                                        G_PRIORITY_HIGH,
-                                        priv->listening_channel,
-                                        G_IO_IN | G_IO_PRI,
-                                        worker_accept_watch_func,
-                                        client,
-                                        NULL);
+    if (milter_client_is_worker_sharding(client) && !priv->workers.reuse_port)
+        priv->workers.exclusive_channel =
+            worker_create_exclusive_channel(client);
+    if (priv->workers.exclusive_channel) {
+        watch_accept(client, loop, G_PRIORITY_HIGH,
+                     priv->workers.exclusive_channel,
+                     worker_exclusive_accept_watch_func);
+    } else {
+        watch_accept(client, loop, G_PRIORITY_HIGH,
+                     priv->listening_channel,
+                     worker_accept_watch_func);
+    }
     priv->accept_error_watch_id =
         milter_event_loop_watch_io_full(loop,
                                         G_PRIORITY_HIGH,
@@ -2522,12 +3329,16 @@ milter_client_shutdown (MilterClient *client)
             g_io_channel_unref(priv->workers.control);
             priv->workers.control = NULL;
         }
+        if (priv->workers.exclusive_channel) {
+            g_io_channel_unref(priv->workers.exclusive_channel);
+            priv->workers.exclusive_channel = NULL;
+        }
         if (priv->listening_channel) {
             g_io_channel_unref(priv->listening_channel);
             priv->listening_channel = NULL;
         }
 
-        if (priv->n_processing_sessions == 0)
+        if (priv->event_loop && priv->n_processing_sessions == 0)
             milter_event_loop_quit(priv->event_loop);
     }
     g_mutex_unlock(priv->quit_mutex);
@@ -2859,7 +3670,7 @@ milter_client_session_started (MilterClient *client)
     MilterClientPrivate *priv;
 
     priv = MILTER_CLIENT_GET_PRIVATE(client);
-    priv->n_processing_sessions++;
+    g_atomic_int_inc((gint *)&(priv->n_processing_sessions));
 }
 
 void
@@ -2868,8 +3679,30 @@ milter_client_session_finished (MilterClient *client)
     MilterClientPrivate *priv;
 
     priv = MILTER_CLIENT_GET_PRIVATE(client);
-    priv->n_processing_sessions--;
-    priv->n_processed_sessions++;
+    g_atomic_int_add((gint *)&(priv->n_processing_sessions), -1);
+    g_atomic_int_inc((gint *)&(priv->n_processed_sessions));
+
+    if (priv->threads) {
+        wakeup_accept_loop(client);
+        return;
+    }
+
+    if (priv->accept_watch.loop != priv->event_loop) {
+        if (g_atomic_int_get(&(priv->accept_watch.by_max_connections)))
+            wakeup_accept_loop(client);
+        return;
+    }
+
+    if (priv->accept_watch.resume_id > 0 &&
+        priv->accept_watch.by_max_connections &&
+        priv->accept_watch.loop == priv->event_loop) {
+        guint max_connections;
+
+        max_connections = milter_client_get_max_connections(client);
+        if (priv->n_processing_sessions <
+            ACCEPT_RESUME_LOW_WATER_MARK(max_connections))
+            resume_accepting(client);
+    }
 }
 
 guint
@@ -2986,11 +3819,7 @@ milter_client_get_event_loop (MilterClient *client)
 
     priv = MILTER_CLIENT_GET_PRIVATE(client);
 
-    if (priv->multi_thread_mode) {
-        return NULL;
-    } else {
-        return priv->event_loop;
-    }
+    return priv->event_loop;
 }
 
 void
@@ -3294,6 +4123,62 @@ milter_client_set_max_pending_finished_sessions (MilterClient  *client,
     klass->set_max_pending_finished_sessions(client, n_sessions);
 }
 
+gboolean
+milter_client_is_multi_thread_mode (MilterClient *client)
+{
+    return MILTER_CLIENT_GET_PRIVATE(client)->multi_thread_mode;
+}
+
+void
+milter_client_set_multi_thread_mode (MilterClient *client,
+                                     gboolean multi_thread_mode)
+{
+    MILTER_CLIENT_GET_PRIVATE(client)->multi_thread_mode = multi_thread_mode;
+}
+
+guint
+milter_client_get_n_threads (MilterClient *client)
+{
+    return MILTER_CLIENT_GET_PRIVATE(client)->n_threads;
+}
+
+void
+milter_client_set_n_threads (MilterClient *client, guint n_threads)
+{
+    MILTER_CLIENT_GET_PRIVATE(client)->n_threads = n_threads;
+}
+
+gboolean
+milter_client_is_worker_sharding (MilterClient *client)
+{
+    return MILTER_CLIENT_GET_PRIVATE(client)->workers.sharding;
+}
+
+void
+milter_client_set_worker_sharding (MilterClient *client, gboolean sharding)
+{
+    MILTER_CLIENT_GET_PRIVATE(client)->workers.sharding = sharding;
+}
+
+guint
+milter_client_get_n_accepted_connections (MilterClient *client)
+{
+    return MILTER_CLIENT_GET_PRIVATE(client)->n_accepted_connections;
+}
+
+guint
+milter_client_get_max_accepts_per_wakeup (MilterClient *client)
+{
+    return MILTER_CLIENT_GET_PRIVATE(client)->max_accepts_per_wakeup;
+}
+
+void
+milter_client_set_max_accepts_per_wakeup (MilterClient *client,
+                                          guint max_accepts)
+{
+    MILTER_CLIENT_GET_PRIVATE(client)->max_accepts_per_wakeup = max_accepts;
+}
+
 static GArray *
 get_worker_pids (MilterClient *client)
 {
@@ -57,6 +57,16 @@ G_BEGIN_DECLS
  */
 #define MILTER_CLIENT_DEFAULT_MAX_CONNECTIONS 0
 
+/**
+ * MILTER_CLIENT_DEFAULT_MAX_ACCEPTS_PER_WAKEUP:
+ *
+ * The default max number of connections accepted for a
+ * readiness of the listening socket. See
+ * milter_client_get_max_accepts_per_wakeup() for more
+ * details.
+ */
+#define MILTER_CLIENT_DEFAULT_MAX_ACCEPTS_PER_WAKEUP 16
+
 /**
  * MILTER_CLIENT_MAX_N_WORKERS:
  *
@@ -82,12 +92,15 @@ G_BEGIN_DECLS
  * MilterClientEventLoopBackend:
  * @MILTER_CLIENT_EVENT_LOOP_BACKEND_GLIB: Let main loop use GLib.
  * @MILTER_CLIENT_EVENT_LOOP_BACKEND_LIBEV: Let main loop use libev.
+ * @MILTER_CLIENT_EVENT_LOOP_BACKEND_EPOLL: Let main loop use epoll
+ * directly. GLib is used on platforms that don't have epoll.
  */
 typedef enum
 {
     MILTER_CLIENT_EVENT_LOOP_BACKEND_DEFAULT,
     MILTER_CLIENT_EVENT_LOOP_BACKEND_GLIB,
-    MILTER_CLIENT_EVENT_LOOP_BACKEND_LIBEV
+    MILTER_CLIENT_EVENT_LOOP_BACKEND_LIBEV,
+    MILTER_CLIENT_EVENT_LOOP_BACKEND_EPOLL
 } MilterClientEventLoopBackend;
 
 /**
@@ -846,7 +859,10 @@ gboolean             milter_client_get_syslog_enabled(MilterClient  *client);
  * milter_client_get_event_loop:
  * @client: a %MilterClient.
  *
- * Gets the %MilterEventLoop for processing requests.
+ * Gets the %MilterEventLoop for processing requests. In
+ * multi thread mode, sessions are processed by per-thread
+ * event loops and the returned %MilterEventLoop is used for
+ * accepting connections.
  *
  * Returns: the %MilterEventLoop for processing requests.
  */
@@ -1049,6 +1065,132 @@ void                 milter_client_set_max_pending_finished_sessions
 
 GArray              *milter_client_get_worker_pids   (MilterClient  *client);
 
+/**
+ * milter_client_is_multi_thread_mode:
+ * @client: a %MilterClient.
+ *
+ * Gets whether sessions are processed by multiple threads.
+ *
+ * Returns: %TRUE if multi thread mode is enabled, %FALSE
+ * otherwise.
+ */
+gboolean             milter_client_is_multi_thread_mode
+                                                     (MilterClient  *client);
+
+/**
+ * milter_client_set_multi_thread_mode:
+ * @client: a %MilterClient.
+ * @multi_thread_mode: %TRUE if sessions are processed by
+ *                     multiple threads.
+ *
+ * Sets whether sessions are processed by multiple
+ * threads. In multi thread mode, each thread runs its own
+ * event loop and processes many sessions concurrently. An
+ * accepted connection is passed to the least loaded thread
+ * and a thread that has free capacity takes over
+ * connections waiting in other threads.
+ *
+ * Note that callbacks of %MilterClientContext are called in
+ * the thread that processes the session.
+ */
+void                 milter_client_set_multi_thread_mode
+                                                     (MilterClient  *client,
+                                                      gboolean       multi_thread_mode);
+
+/**
+ * milter_client_get_n_threads:
+ * @client: a %MilterClient.
+ *
+ * Gets the number of threads in multi thread mode.
+ *
+ * Returns: the number of threads in multi thread mode.
+ */
+guint                milter_client_get_n_threads     (MilterClient  *client);
+
+/**
+ * milter_client_set_n_threads:
+ * @client: a %MilterClient.
+ * @n_threads: the number of threads.
+ *
+ * Sets the number of threads in multi thread mode. 0 means
+ * the number of online processors.
+ */
+void                 milter_client_set_n_threads     (MilterClient  *client,
+                                                      guint          n_threads);
+
+/**
+ * milter_client_is_worker_sharding:
+ * @client: a %MilterClient.
+ *
+ * Gets whether each worker process accepts connections by
+ * its own socket.
+ *
+ * Returns: %TRUE if worker sharding is enabled, %FALSE
+ * otherwise.
+ */
+gboolean             milter_client_is_worker_sharding
+                                                     (MilterClient  *client);
+
+/**
+ * milter_client_set_worker_sharding:
+ * @client: a %MilterClient.
+ * @sharding: %TRUE if each worker accepts connections by its
+ *            own socket.
+ *
+ * Sets whether each worker process accepts connections by
+ * its own socket. For inet and inet6 connection specs, each
+ * worker listens on its own SO_REUSEPORT socket and the
+ * kernel distributes connections across workers. For unix
+ * connection spec, workers share the listening socket but
+ * only one worker is woken up for a connection by
+ * EPOLLEXCLUSIVE where it is available.
+ *
+ * It is used only when the number of workers is larger than 0.
+ */
+void                 milter_client_set_worker_sharding
+                                                     (MilterClient  *client,
+                                                      gboolean       sharding);
+
+/**
+ * milter_client_get_n_accepted_connections:
+ * @client: a %MilterClient.
+ *
+ * Gets the number of connections accepted by @client. In a
+ * worker process, it is the number of connections accepted
+ * by the worker.
+ *
+ * Returns: the number of accepted connections.
+ */
+guint                milter_client_get_n_accepted_connections
+                                                     (MilterClient  *client);
+
+/**
+ * milter_client_get_max_accepts_per_wakeup:
+ * @client: a %MilterClient.
+ *
+ * Gets the max number of connections accepted for a
+ * readiness of the listening socket. Pending connections
+ * are accepted until the listening socket has no more
+ * connection or this number of connections are accepted.
+ *
+ * Returns: the max number of accepts per wakeup.
+ */
+guint                milter_client_get_max_accepts_per_wakeup
+                                                     (MilterClient  *client);
+
+/**
+ * milter_client_set_max_accepts_per_wakeup:
+ * @client: a %MilterClient.
+ * @max_accepts: the max number of accepts per wakeup.
+ *
+ * Sets the max number of connections accepted for a
+ * readiness of the listening socket. 0 is treated as 1.
+ * (default: %MILTER_CLIENT_DEFAULT_MAX_ACCEPTS_PER_WAKEUP)
+ */
+void                 milter_client_set_max_accepts_per_wakeup
+                                                     (MilterClient  *client,
+                                                      guint          max_accepts);
+
 G_END_DECLS
 
 #endif /* __MILTER_CLIENT_CLIENT_H__ */
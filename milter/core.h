@@ -38,6 +38,8 @@
 #include <milter/core/milter-agent.h>
 #include <milter/core/milter-protocol-agent.h>
 #include <milter/core/milter-macros-requests.h>
+#include <milter/core/milter-macro-snapshot.h>
+#include <milter/core/milter-command-packet.h>
 #include <milter/core/milter-headers.h>
 #include <milter/core/milter-logger.h>
 #include <milter/core/milter-syslog-logger.h>
@@ -49,6 +51,7 @@
 #include <milter/core/milter-event-loop.h>
 #include <milter/core/milter-glib-event-loop.h>
 #include <milter/core/milter-libev-event-loop.h>
+#include <milter/core/milter-epoll-event-loop.h>
 #include <milter/core/milter-enum-types.h>
 
 G_BEGIN_DECLS
@@ -373,32 +373,31 @@ finished (MilterFinishedEmittable *emittable)
         milter_writer_shutdown(priv->writer);
 }
 
+/*
+ * The reader decodes read data by our decoder directly
+ * instead of emitting "flow" signal. It is called only on
+ * decode error.
+ */
 static void
-cb_reader_flow (MilterReader *reader,
-                const gchar *data, gsize data_size,
-                gpointer user_data)
+cb_reader_decode_error (MilterReader *reader,
+                        GError *decoder_error,
+                        gpointer user_data)
 {
     MilterAgentPrivate *priv;
-    GError *decoder_error = NULL;
+    GError *error = NULL;
 
     priv = MILTER_AGENT_GET_PRIVATE(user_data);
 
-    milter_decoder_decode(priv->decoder, data, data_size, &decoder_error);
-
-    if (decoder_error) {
-        GError *error = NULL;
-
-        milter_utils_set_error_with_sub_error(&error,
-                                              MILTER_AGENT_ERROR,
-                                              MILTER_AGENT_ERROR_DECODE_ERROR,
-                                              decoder_error,
-                                              "Decode error");
-        milter_error("[%u] [agent][error][decode] %s",
-                     priv->tag, error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(user_data),
-                                    error);
-        g_error_free(error);
-    }
+    milter_utils_set_error_with_sub_error(&error,
+                                          MILTER_AGENT_ERROR,
+                                          MILTER_AGENT_ERROR_DECODE_ERROR,
+                                          g_error_copy(decoder_error),
+                                          "Decode error");
+    milter_error("[%u] [agent][error][decode] %s",
+                 priv->tag, error->message);
+    milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(user_data),
+                                error);
+    g_error_free(error);
 }
 
 static void
@@ -447,11 +446,11 @@ milter_agent_set_reader (MilterAgent *agent, MilterReader *reader)
                                              G_CALLBACK(cb_reader_ ## name), \
                                              agent)
 
-        DISCONNECT(flow);
         DISCONNECT(error);
         DISCONNECT(finished);
 #undef DISCONNECT
 
+        milter_reader_set_decoder(priv->reader, NULL, NULL, NULL);
         g_object_unref(priv->reader);
     }
 
@@ -462,11 +461,13 @@ milter_agent_set_reader (MilterAgent *agent, MilterReader *reader)
 #define CONNECT(name)                                                   \
         g_signal_connect(priv->reader, #name, G_CALLBACK(cb_reader_ ## name), \
                          agent)
-        CONNECT(flow);
         CONNECT(error);
         CONNECT(finished);
 #undef CONNECT
 
+        milter_reader_set_decoder(priv->reader, priv->decoder,
+                                  cb_reader_decode_error, agent);
+
         milter_reader_set_tag(priv->reader, priv->tag);
     }
 }
@@ -542,6 +543,29 @@ milter_agent_write_packet (MilterAgent *agent,
     return success;
 }
 
+gboolean
+milter_agent_write_packet_vectors (MilterAgent *agent,
+                                   const struct iovec *vectors,
+                                   guint n_vectors,
+                                   GError **error)
+{
+    MilterAgentPrivate *priv;
+    gboolean success;
+
+    priv = MILTER_AGENT_GET_PRIVATE(agent);
+
+    if (!priv->writer)
+        return TRUE;
+
+    success = milter_writer_write_vectors(priv->writer, vectors, n_vectors,
+                                          error);
+    if (success) {
+        success = milter_agent_flush(agent, error);
+    }
+
+    return success;
+}
+
 gboolean
 milter_agent_flush (MilterAgent *agent, GError **error)
 {
@@ -670,6 +694,12 @@ milter_agent_shutdown (MilterAgent *agent)
     priv->shutting_down = FALSE;
 }
 
+gboolean
+milter_agent_is_finished (MilterAgent *agent)
+{
+    return MILTER_AGENT_GET_PRIVATE(agent)->finished;
+}
+
 guint
 milter_agent_get_tag (MilterAgent *agent)
 {
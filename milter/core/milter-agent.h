@@ -85,12 +85,18 @@ gboolean             milter_agent_write_packet      (MilterAgent *agent,
                                                      const char *packet,
                                                      gsize packet_size,
                                                      GError **error);
+gboolean             milter_agent_write_packet_vectors
+                                                    (MilterAgent *agent,
+                                                     const struct iovec *vectors,
+                                                     guint n_vectors,
+                                                     GError **error);
 gboolean             milter_agent_flush             (MilterAgent *agent,
                                                      GError **error);
 
 gboolean             milter_agent_start             (MilterAgent *agent,
                                                      GError     **error);
 void                 milter_agent_shutdown          (MilterAgent *agent);
+gboolean             milter_agent_is_finished       (MilterAgent *agent);
 
 guint                milter_agent_get_tag           (MilterAgent *agent);
 void                 milter_agent_set_tag           (MilterAgent *agent,
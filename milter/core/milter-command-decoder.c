@@ -52,6 +52,7 @@ enum
     ABORT,
     QUIT,
     UNKNOWN,
+    QUIT_NEW_CONNECTION,
     LAST_SIGNAL
 };
 
@@ -225,6 +226,16 @@ milter_command_decoder_class_init (MilterCommandDecoderClass *klass)
                      NULL, NULL,
                      g_cclosure_marshal_VOID__STRING,
                      G_TYPE_NONE, 1, G_TYPE_STRING);
+
+    signals[QUIT_NEW_CONNECTION] =
+        g_signal_new("quit-new-connection",
+                     G_TYPE_FROM_CLASS(klass),
+                     G_SIGNAL_RUN_LAST,
+                     G_STRUCT_OFFSET(MilterCommandDecoderClass,
+                                     quit_new_connection),
+                     NULL, NULL,
+                     g_cclosure_marshal_VOID__VOID,
+                     G_TYPE_NONE, 0);
 }
 
 static void
@@ -873,6 +884,29 @@ decode_quit (MilterDecoder *decoder, GError **error)
     return TRUE;
 }
 
+static gboolean
+decode_quit_new_connection (MilterDecoder *decoder, GError **error)
+{
+    const gchar *buffer;
+    gint32 command_length;
+
+    command_length = milter_decoder_get_command_length(decoder);
+    buffer = milter_decoder_get_buffer(decoder);
+
+    if (!milter_decoder_check_command_length(
+            buffer + 1, command_length - 1, 0,
+            MILTER_DECODER_COMPARE_EXACT, error,
+            "QUIT NEW CONNECTION command"))
+        return FALSE;
+
+    milter_debug("[%u] [command-decoder][quit-new-connection]",
+                 milter_decoder_get_tag(decoder));
+
+    g_signal_emit(decoder, signals[QUIT_NEW_CONNECTION], 0);
+
+    return TRUE;
+}
+
 static gboolean
 decode_unknown (MilterDecoder *decoder, GError **error)
 {
@@ -981,6 +1015,9 @@ decode (MilterDecoder *decoder, GError **error)
     case MILTER_COMMAND_QUIT:
         success = decode_quit(decoder, error);
         break;
+    case MILTER_COMMAND_QUIT_NEW_CONNECTION:
+        success = decode_quit_new_connection(decoder, error);
+        break;
     case MILTER_COMMAND_UNKNOWN:
         success = decode_unknown(decoder, error);
         break;
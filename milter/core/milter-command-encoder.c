@@ -369,6 +369,38 @@ milter_command_encoder_encode_body (MilterCommandEncoder *encoder,
         *packed_size = packed_chunk_size;
 }
 
+/*
+ * Encodes only the command length and the command byte of a BODY
+ * packet. The first "packed_size" bytes of "chunk" follow the header
+ * as is, so that callers can write them without copying.
+ */
+void
+milter_command_encoder_encode_body_scattered (MilterCommandEncoder *encoder,
+                                              const gchar **header,
+                                              gsize *header_size,
+                                              const gchar *chunk, gsize size,
+                                              gsize *packed_size)
+{
+    MilterEncoder *base_encoder;
+    GString *buffer;
+    gsize packed_chunk_size;
+
+    base_encoder = MILTER_ENCODER(encoder);
+    milter_encoder_clear_buffer(base_encoder);
+    buffer = milter_encoder_get_buffer(base_encoder);
+
+    g_string_append_c(buffer, MILTER_COMMAND_BODY);
+    if (size > MILTER_CHUNK_SIZE)
+        packed_chunk_size = MILTER_CHUNK_SIZE;
+    else
+        packed_chunk_size = size;
+    milter_encoder_pack_scattered(base_encoder, header, header_size,
+                                  packed_chunk_size);
+
+    if (packed_size)
+        *packed_size = packed_chunk_size;
+}
+
 void
 milter_command_encoder_encode_end_of_message (MilterCommandEncoder *encoder,
                                               const gchar **packet,
@@ -420,6 +452,22 @@ milter_command_encoder_encode_quit (MilterCommandEncoder *encoder,
     milter_encoder_pack(base_encoder, packet, packet_size);
 }
 
+void
+milter_command_encoder_encode_quit_new_connection (MilterCommandEncoder *encoder,
+                                                   const gchar **packet,
+                                                   gsize *packet_size)
+{
+    MilterEncoder *base_encoder;
+    GString *buffer;
+
+    base_encoder = MILTER_ENCODER(encoder);
+    milter_encoder_clear_buffer(base_encoder);
+    buffer = milter_encoder_get_buffer(base_encoder);
+
+    g_string_append_c(buffer, MILTER_COMMAND_QUIT_NEW_CONNECTION);
+    milter_encoder_pack(base_encoder, packet, packet_size);
+}
+
 void
 milter_command_encoder_encode_unknown (MilterCommandEncoder *encoder,
                                        const gchar **packet,
@@ -110,6 +110,13 @@ void             milter_command_encoder_encode_body
                                              const gchar          *chunk,
                                              gsize                 size,
                                              gsize                *packed_size);
+void             milter_command_encoder_encode_body_scattered
+                                            (MilterCommandEncoder *encoder,
+                                             const gchar         **header,
+                                             gsize                *header_size,
+                                             const gchar          *chunk,
+                                             gsize                 size,
+                                             gsize                *packed_size);
 void             milter_command_encoder_encode_end_of_message
                                             (MilterCommandEncoder *encoder,
                                              const gchar         **packet,
@@ -124,6 +131,10 @@ void             milter_command_encoder_encode_quit
                                             (MilterCommandEncoder *encoder,
                                              const gchar         **packet,
                                              gsize                *packet_size);
+void             milter_command_encoder_encode_quit_new_connection
+                                            (MilterCommandEncoder *encoder,
+                                             const gchar         **packet,
+                                             gsize                *packet_size);
 void             milter_command_encoder_encode_unknown
                                             (MilterCommandEncoder *encoder,
                                              const gchar         **packet,
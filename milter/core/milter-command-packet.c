@@ -0,0 +1,87 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#  include "../../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "milter-command-packet.h"
+
+struct _MilterCommandPacket
+{
+    volatile gint ref_count;
+    MilterCommand command;
+    gsize size;
+    gchar *data;
+};
+
+MilterCommandPacket *
+milter_command_packet_new (MilterCommand command,
+                           const gchar *packet, gsize packet_size)
+{
+    MilterCommandPacket *command_packet;
+
+    command_packet = g_new(MilterCommandPacket, 1);
+    command_packet->ref_count = 1;
+    command_packet->command = command;
+    command_packet->size = packet_size;
+    command_packet->data = g_memdup(packet, packet_size);
+
+    return command_packet;
+}
+
+MilterCommandPacket *
+milter_command_packet_ref (MilterCommandPacket *packet)
+{
+    g_atomic_int_inc(&(packet->ref_count));
+    return packet;
+}
+
+void
+milter_command_packet_unref (MilterCommandPacket *packet)
+{
+    if (!g_atomic_int_dec_and_test(&(packet->ref_count)))
+        return;
+
+    g_free(packet->data);
+    g_free(packet);
+}
+
+MilterCommand
+milter_command_packet_get_command (MilterCommandPacket *packet)
+{
+    return packet->command;
+}
+
+const gchar *
+milter_command_packet_get_data (MilterCommandPacket *packet)
+{
+    return packet->data;
+}
+
+gsize
+milter_command_packet_get_size (MilterCommandPacket *packet)
+{
+    return packet->size;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -0,0 +1,55 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_COMMAND_PACKET_H__
+#define __MILTER_COMMAND_PACKET_H__
+
+#include <glib.h>
+
+#include <milter/core/milter-protocol.h>
+
+G_BEGIN_DECLS
+
+/*
+ * An immutable, reference counted encoded command
+ * packet. It is encoded once and written to all protocol
+ * agents that send the same command.
+ */
+typedef struct _MilterCommandPacket MilterCommandPacket;
+
+MilterCommandPacket *milter_command_packet_new    (MilterCommand        command,
+                                                   const gchar         *packet,
+                                                   gsize                packet_size);
+MilterCommandPacket *milter_command_packet_ref    (MilterCommandPacket *packet);
+void                 milter_command_packet_unref  (MilterCommandPacket *packet);
+
+MilterCommand        milter_command_packet_get_command
+                                                  (MilterCommandPacket *packet);
+const gchar         *milter_command_packet_get_data
+                                                  (MilterCommandPacket *packet);
+gsize                milter_command_packet_get_size
+                                                  (MilterCommandPacket *packet);
+
+G_END_DECLS
+
+#endif /* __MILTER_COMMAND_PACKET_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -332,6 +332,21 @@ milter_connection_listen (const gchar *spec, gint backlog,
                           struct sockaddr **address, socklen_t *address_size,
                           gboolean remove_unix_socket,
                           GError **error)
+{
+    return milter_connection_listen_full(spec, backlog,
+                                         address, address_size,
+                                         remove_unix_socket,
+                                         FALSE,
+                                         error);
+}
+
+GIOChannel *
+milter_connection_listen_full (const gchar *spec, gint backlog,
+                               struct sockaddr **address,
+                               socklen_t *address_size,
+                               gboolean remove_unix_socket,
+                               gboolean reuse_port,
+                               GError **error)
 {
     GIOChannel *socket_channel;
     gint fd;
@@ -386,6 +401,41 @@ milter_connection_listen (const gchar *spec, gint backlog,
         return NULL;
     }
 
+    if (reuse_port) {
+#ifdef SO_REUSEPORT
+        if (local_address->sa_family == AF_UNIX) {
+            g_set_error(error,
+                        MILTER_CONNECTION_ERROR,
+                        MILTER_CONNECTION_ERROR_SET_SOCKET_OPTION_FAILURE,
+                        "SO_REUSEPORT isn't available for UNIX domain socket: "
+                        "%s",
+                        spec);
+            g_free(local_address);
+            close(fd);
+            return NULL;
+        }
+        if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT,
+                       &reuse_port, sizeof(reuse_port)) == -1) {
+            g_set_error(error,
+                        MILTER_CONNECTION_ERROR,
+                        MILTER_CONNECTION_ERROR_SET_SOCKET_OPTION_FAILURE,
+                        "failed to setsockopt(SO_REUSEPORT): %s: %s",
+                        spec, g_strerror(errno));
+            g_free(local_address);
+            close(fd);
+            return NULL;
+        }
+#else
+        g_set_error(error,
+                    MILTER_CONNECTION_ERROR,
+                    MILTER_CONNECTION_ERROR_SET_SOCKET_OPTION_FAILURE,
+                    "SO_REUSEPORT isn't supported: %s", spec);
+        g_free(local_address);
+        close(fd);
+        return NULL;
+#endif
+    }
+
     if (bind(fd, local_address, local_address_size) == -1) {
         g_set_error(error,
                     MILTER_CONNECTION_ERROR,
@@ -72,6 +72,13 @@ GIOChannel      *milter_connection_listen      (const gchar      *spec,
                                                 socklen_t        *address_size,
                                                 gboolean          remove_unix_socket,
                                                 GError          **error);
+GIOChannel      *milter_connection_listen_full (const gchar      *spec,
+                                                gint              backlog,
+                                                struct sockaddr **address,
+                                                socklen_t        *address_size,
+                                                gboolean          remove_unix_socket,
+                                                gboolean          reuse_port,
+                                                GError          **error);
 gchar           *milter_connection_address_to_spec
                                                (const struct sockaddr *address);
 
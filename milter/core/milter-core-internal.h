@@ -26,8 +26,12 @@ G_BEGIN_DECLS
 
 void milter_logger_internal_init     (void);
 void milter_logger_internal_quit     (void);
+gboolean milter_logger_internal_write_async (MilterLogger *logger,
+                                             gint          syslog_priority,
+                                             gchar        *line);
 void milter_agent_internal_init      (void);
 void milter_agent_internal_quit      (void);
+void milter_event_loop_internal_stop_timer_wheel (MilterEventLoop *loop);
 
 G_END_DECLS
 
@@ -36,6 +36,7 @@
 #include "milter-marshalers.h"
 
 #define COMMAND_LENGTH_BYTES (sizeof(guint32))
+#define INITIAL_BUFFER_SIZE 4096
 
 #define MILTER_DECODER_GET_PRIVATE(obj)                 \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                 \
@@ -46,7 +47,10 @@ typedef struct _MilterDecoderPrivate	MilterDecoderPrivate;
 struct _MilterDecoderPrivate
 {
     gint state;
-    GString *buffer;
+    gchar *buffer;
+    gsize buffer_size;
+    gsize read_offset;
+    gsize write_offset;
     gint32 command_length;
     guint tag;
 };
@@ -121,7 +125,10 @@ milter_decoder_init (MilterDecoder *decoder)
     MilterDecoderPrivate *priv = MILTER_DECODER_GET_PRIVATE(decoder);
 
     priv->state = IN_START;
-    priv->buffer = g_string_new(NULL);
+    priv->buffer = NULL;
+    priv->buffer_size = 0;
+    priv->read_offset = 0;
+    priv->write_offset = 0;
     priv->tag = 0;
 }
 
@@ -132,9 +139,12 @@ dispose (GObject *object)
 
     priv = MILTER_DECODER_GET_PRIVATE(object);
     if (priv->buffer) {
-        g_string_free(priv->buffer, TRUE);
+        g_free(priv->buffer);
         priv->buffer = NULL;
     }
+    priv->buffer_size = 0;
+    priv->read_offset = 0;
+    priv->write_offset = 0;
 
     G_OBJECT_CLASS(milter_decoder_parent_class)->dispose(object);
 }
@@ -347,9 +357,57 @@ milter_decoder_decode_header_content (const gchar *buffer, gint length,
     return TRUE;
 }
 
-gboolean
-milter_decoder_decode (MilterDecoder *decoder, const gchar *chunk, gsize size,
-                       GError **error)
+#define BUFFERED_SIZE(priv) ((priv)->write_offset - (priv)->read_offset)
+#define BUFFERED_DATA(priv) ((priv)->buffer + (priv)->read_offset)
+
+/*
+ * Ensure that at least "size" bytes can be appended after
+ * the write cursor. Consumed bytes before the read cursor are
+ * reclaimed only here, so each received byte is moved at most
+ * once while it waits for the rest of its command. One extra
+ * byte is always kept for the terminating NUL.
+ */
+static void
+reserve_buffer (MilterDecoderPrivate *priv, gsize size)
+{
+    gsize buffered_size;
+    gsize required_size;
+
+    buffered_size = BUFFERED_SIZE(priv);
+    required_size = buffered_size + size + 1;
+
+    if (priv->read_offset > 0 &&
+        priv->write_offset + size + 1 > priv->buffer_size) {
+        if (buffered_size > 0)
+            memmove(priv->buffer, BUFFERED_DATA(priv), buffered_size);
+        priv->read_offset = 0;
+        priv->write_offset = buffered_size;
+        priv->buffer[priv->write_offset] = '\0';
+    }
+
+    if (required_size > priv->buffer_size) {
+        gsize new_size;
+
+        new_size = MAX(priv->buffer_size, INITIAL_BUFFER_SIZE);
+        while (new_size < required_size)
+            new_size *= 2;
+        priv->buffer = g_realloc(priv->buffer, new_size);
+        priv->buffer_size = new_size;
+    }
+}
+
+static void
+consume_buffer (MilterDecoderPrivate *priv, gsize size)
+{
+    priv->read_offset += size;
+    if (priv->read_offset == priv->write_offset) {
+        priv->read_offset = 0;
+        priv->write_offset = 0;
+    }
+}
+
+static gboolean
+process_buffer (MilterDecoder *decoder, GError **error)
 {
     MilterDecoderPrivate *priv;
     gboolean loop = TRUE;
@@ -357,58 +415,48 @@ milter_decoder_decode (MilterDecoder *decoder, const gchar *chunk, gsize size,
 
     priv = MILTER_DECODER_GET_PRIVATE(decoder);
 
-    g_return_val_if_fail(priv->state != MILTER_DECODER_ERROR, FALSE);
-
-    if (size == 0)
-        return TRUE;
-
-    milter_trace("[%u] [decoder][decode] "
-                 "<%" G_GSIZE_FORMAT "> "
-                 "(%" G_GSIZE_FORMAT ")",
-                 priv->tag, size,
-                 priv->buffer->len);
-    g_string_append_len(priv->buffer, chunk, size);
     while (loop) {
         switch (priv->state) {
         case IN_START:
             milter_trace("[%u] [decoder][decode][start]", priv->tag);
-            if (priv->buffer->len == 0) {
+            if (BUFFERED_SIZE(priv) == 0) {
                 loop = FALSE;
             } else {
                 priv->state = IN_COMMAND_LENGTH;
             }
             break;
         case IN_COMMAND_LENGTH:
-            if (priv->buffer->len < COMMAND_LENGTH_BYTES) {
+            if (BUFFERED_SIZE(priv) < COMMAND_LENGTH_BYTES) {
                 milter_trace("[%u] [decoder][decode][length][need-more]",
                              priv->tag);
                 loop = FALSE;
             } else {
                 memcpy(&priv->command_length,
-                       priv->buffer->str,
+                       BUFFERED_DATA(priv),
                        COMMAND_LENGTH_BYTES);
                 priv->command_length = g_ntohl(priv->command_length);
                 milter_trace("[%u] [decoder][decode][length] <%d>",
                              priv->tag, priv->command_length);
-                g_string_erase(priv->buffer, 0, COMMAND_LENGTH_BYTES);
+                consume_buffer(priv, COMMAND_LENGTH_BYTES);
                 priv->state = IN_COMMAND_CONTENT;
             }
             break;
         case IN_COMMAND_CONTENT:
-            if (priv->buffer->len < priv->command_length) {
+            if (BUFFERED_SIZE(priv) < priv->command_length) {
                 milter_trace("[%u] [decoder][decode][content][need-more] "
                              "<%" G_GSIZE_FORMAT ">/<%d>",
                              priv->tag,
-                             priv->buffer->len, priv->command_length);
+                             BUFFERED_SIZE(priv), priv->command_length);
                 loop = FALSE;
             } else {
                 milter_trace("[%u] [decoder][decode][content][fill] "
                              "<%d> (%" G_GSIZE_FORMAT ")",
-                             priv->tag, priv->command_length, priv->buffer->len);
+                             priv->tag, priv->command_length,
+                             BUFFERED_SIZE(priv));
                 g_signal_emit(decoder, signals[DECODE], 0, error, &success);
                 if (success) {
                     priv->state = IN_START;
-                    g_string_erase(priv->buffer, 0, priv->command_length);
+                    consume_buffer(priv, priv->command_length);
                 } else {
                     priv->state = IN_ERROR;
                     loop = FALSE;
@@ -418,7 +466,8 @@ milter_decoder_decode (MilterDecoder *decoder, const gchar *chunk, gsize size,
         case IN_ERROR:
             milter_error("[%u] [decoder][decode][error] "
                          "<%d> (%" G_GSIZE_FORMAT ")",
-                         priv->tag, priv->command_length, priv->buffer->len);
+                         priv->tag, priv->command_length,
+                         BUFFERED_SIZE(priv));
             loop = FALSE;
             break;
         }
@@ -427,6 +476,68 @@ milter_decoder_decode (MilterDecoder *decoder, const gchar *chunk, gsize size,
     return success;
 }
 
+gboolean
+milter_decoder_decode (MilterDecoder *decoder, const gchar *chunk, gsize size,
+                       GError **error)
+{
+    MilterDecoderPrivate *priv;
+
+    priv = MILTER_DECODER_GET_PRIVATE(decoder);
+
+    g_return_val_if_fail(priv->state != MILTER_DECODER_ERROR, FALSE);
+
+    if (size == 0)
+        return TRUE;
+
+    milter_trace("[%u] [decoder][decode] "
+                 "<%" G_GSIZE_FORMAT "> "
+                 "(%" G_GSIZE_FORMAT ")",
+                 priv->tag, size,
+                 BUFFERED_SIZE(priv));
+    reserve_buffer(priv, size);
+    memcpy(priv->buffer + priv->write_offset, chunk, size);
+    priv->write_offset += size;
+    priv->buffer[priv->write_offset] = '\0';
+
+    return process_buffer(decoder, error);
+}
+
+gchar *
+milter_decoder_reserve_buffer (MilterDecoder *decoder, gsize size)
+{
+    MilterDecoderPrivate *priv;
+
+    priv = MILTER_DECODER_GET_PRIVATE(decoder);
+    reserve_buffer(priv, size);
+
+    return priv->buffer + priv->write_offset;
+}
+
+gboolean
+milter_decoder_decode_reserved_buffer (MilterDecoder *decoder, gsize size,
+                                       GError **error)
+{
+    MilterDecoderPrivate *priv;
+
+    priv = MILTER_DECODER_GET_PRIVATE(decoder);
+
+    g_return_val_if_fail(priv->state != IN_ERROR, FALSE);
+    g_return_val_if_fail(priv->write_offset + size < priv->buffer_size, FALSE);
+
+    if (size == 0)
+        return TRUE;
+
+    milter_trace("[%u] [decoder][decode][reserved] "
+                 "<%" G_GSIZE_FORMAT "> "
+                 "(%" G_GSIZE_FORMAT ")",
+                 priv->tag, size,
+                 BUFFERED_SIZE(priv));
+    priv->write_offset += size;
+    priv->buffer[priv->write_offset] = '\0';
+
+    return process_buffer(decoder, error);
+}
+
 static void
 set_unexpected_end_error (GError **error, MilterDecoderPrivate *priv,
                           gsize required_length, const gchar *decoding_target)
@@ -435,8 +546,8 @@ set_unexpected_end_error (GError **error, MilterDecoderPrivate *priv,
 
     message = g_string_new("stream is ended unexpectedly: ");
     append_need_more_bytes_for_decoding_message(message,
-                                                priv->buffer->str,
-                                                priv->buffer->len,
+                                                BUFFERED_DATA(priv),
+                                                BUFFERED_SIZE(priv),
                                                 required_length,
                                                 decoding_target);
     g_set_error(error,
@@ -478,7 +589,18 @@ milter_decoder_end_decode (MilterDecoder *decoder, GError **error)
 const gchar *
 milter_decoder_get_buffer (MilterDecoder *decoder)
 {
-    return MILTER_DECODER_GET_PRIVATE(decoder)->buffer->str;
+    MilterDecoderPrivate *priv;
+
+    priv = MILTER_DECODER_GET_PRIVATE(decoder);
+    if (!priv->buffer)
+        return "";
+    return BUFFERED_DATA(priv);
+}
+
+gsize
+milter_decoder_get_buffered_size (MilterDecoder *decoder)
+{
+    return BUFFERED_SIZE(MILTER_DECODER_GET_PRIVATE(decoder));
 }
 
 gint32
@@ -79,7 +79,14 @@ gboolean         milter_decoder_decode            (MilterDecoder   *decoder,
                                                    GError         **error);
 gboolean         milter_decoder_end_decode        (MilterDecoder   *decoder,
                                                    GError         **error);
+gchar           *milter_decoder_reserve_buffer    (MilterDecoder   *decoder,
+                                                   gsize            size);
+gboolean         milter_decoder_decode_reserved_buffer
+                                                  (MilterDecoder   *decoder,
+                                                   gsize            size,
+                                                   GError         **error);
 const gchar     *milter_decoder_get_buffer        (MilterDecoder   *decoder);
+gsize            milter_decoder_get_buffered_size (MilterDecoder   *decoder);
 gint32           milter_decoder_get_command_length(MilterDecoder   *decoder);
 
 /* utility functions */
@@ -42,6 +42,8 @@
                                  MILTER_TYPE_ENCODER,   \
                                  MilterEncoderPrivate))
 
+#define COMMAND_LENGTH_BYTES (sizeof(guint32))
+
 typedef struct _MilterEncoderPrivate	MilterEncoderPrivate;
 struct _MilterEncoderPrivate
 {
@@ -97,6 +99,8 @@ milter_encoder_init (MilterEncoder *encoder)
     priv = MILTER_ENCODER_GET_PRIVATE(encoder);
     priv->buffer = g_string_new(NULL);
     priv->tag = 0;
+
+    milter_encoder_clear_buffer(encoder);
 }
 
 static void
@@ -160,6 +164,11 @@ milter_encoder_get_buffer (MilterEncoder *encoder)
     return MILTER_ENCODER_GET_PRIVATE(encoder)->buffer;
 }
 
+/*
+ * The buffer always starts with room for the command length so that
+ * milter_encoder_pack() can fill it in place instead of shifting the
+ * whole packet.
+ */
 void
 milter_encoder_clear_buffer (MilterEncoder *encoder)
 {
@@ -167,6 +176,17 @@ milter_encoder_clear_buffer (MilterEncoder *encoder)
 
     priv = MILTER_ENCODER_GET_PRIVATE(encoder);
     g_string_truncate(priv->buffer, 0);
+    g_string_append_len(priv->buffer, "\0\0\0\0", COMMAND_LENGTH_BYTES);
+}
+
+static void
+fill_command_length (MilterEncoderPrivate *priv, gsize trailer_size)
+{
+    guint32 content_size;
+
+    content_size = g_htonl(priv->buffer->len - COMMAND_LENGTH_BYTES +
+                           trailer_size);
+    memcpy(priv->buffer->str, &content_size, COMMAND_LENGTH_BYTES);
 }
 
 void
@@ -174,24 +194,35 @@ milter_encoder_pack (MilterEncoder *encoder, const gchar **packet,
                      gsize *packet_size)
 {
     MilterEncoderPrivate *priv;
-    guint32 content_size;
-    gchar content_string[sizeof(guint32)];
 
     priv = MILTER_ENCODER_GET_PRIVATE(encoder);
-    content_size = g_htonl(priv->buffer->len);
-    memcpy(content_string, &content_size, sizeof(content_size));
-    g_string_prepend_len(priv->buffer, content_string, sizeof(content_size));
+    fill_command_length(priv, 0);
 
     *packet = priv->buffer->str;
     *packet_size = priv->buffer->len;
 }
 
+void
+milter_encoder_pack_scattered (MilterEncoder *encoder,
+                               const gchar **header, gsize *header_size,
+                               gsize trailer_size)
+{
+    MilterEncoderPrivate *priv;
+
+    priv = MILTER_ENCODER_GET_PRIVATE(encoder);
+    fill_command_length(priv, trailer_size);
+
+    *header = priv->buffer->str;
+    *header_size = priv->buffer->len;
+}
+
 void
 milter_encoder_encode_negotiate (MilterEncoder *encoder, MilterOption *option)
 {
     MilterEncoderPrivate *priv;
 
     priv = MILTER_ENCODER_GET_PRIVATE(encoder);
+    milter_encoder_clear_buffer(encoder);
     g_string_append_c(priv->buffer, MILTER_COMMAND_NEGOTIATE);
     if (option) {
         guint32 version, action, step;
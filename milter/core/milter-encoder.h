@@ -60,6 +60,10 @@ void             milter_encoder_clear_buffer   (MilterEncoder     *encoder);
 void             milter_encoder_pack           (MilterEncoder     *encoder,
                                                 const gchar      **packet,
                                                 gsize             *packet_size);
+void             milter_encoder_pack_scattered (MilterEncoder     *encoder,
+                                                const gchar      **header,
+                                                gsize             *header_size,
+                                                gsize              trailer_size);
 void             milter_encoder_encode_negotiate
                                                (MilterEncoder    *encoder,
                                                 MilterOption     *option);
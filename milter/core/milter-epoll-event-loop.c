@@ -0,0 +1,1459 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "milter-epoll-event-loop.h"
+#include "milter-logger.h"
+#include "milter-core-internal.h"
+
+#define MILTER_EPOLL_EVENT_LOOP_GET_PRIVATE(obj)                \
+    (G_TYPE_INSTANCE_GET_PRIVATE((obj),                         \
+                                 MILTER_TYPE_EPOLL_EVENT_LOOP,  \
+                                 MilterEpollEventLoopPrivate))
+
+G_DEFINE_TYPE(MilterEpollEventLoop, milter_epoll_event_loop, MILTER_TYPE_EVENT_LOOP)
+
+#define N_WATCHERS_PER_SLAB   64
+#define WATCHER_INDEX_BITS    20
+#define WATCHER_INDEX_MASK    ((1 << WATCHER_INDEX_BITS) - 1)
+#define WATCHER_GENERATION_MASK                 \
+    ((1 << (32 - WATCHER_INDEX_BITS)) - 1)
+#define MAX_N_EVENTS          64
+#define INVALID_HEAP_INDEX    G_MAXUINT
+
+typedef enum {
+    WATCHER_FD,
+    WATCHER_CHILD,
+    WATCHER_TIMEOUT,
+    WATCHER_IDLE
+} WatcherType;
+
+/*
+ * All watcher types share one structure so that they can
+ * be allocated from the same slabs. A watcher is linked
+ * into the list of its file descriptor, the child list or
+ * the idle list, or is in the timeout heap. The ID encodes
+ * the index in the slabs and a generation that detects
+ * stale IDs of reused watchers.
+ */
+typedef struct _Watcher Watcher;
+struct _Watcher
+{
+    guint id;
+    guint index;
+    guint generation;
+    WatcherType type;
+    gboolean active;
+    Watcher *previous;
+    Watcher *next;
+    Watcher *free_next;
+    GDestroyNotify notify;
+    gpointer user_data;
+    union {
+        struct {
+            gint fd;
+            GIOCondition condition;
+            GIOChannel *channel;
+            GIOFunc channel_function;
+            MilterEpollEventLoopFDFunc fd_function;
+        } fd;
+        struct {
+            GPid pid;
+            GChildWatchFunc function;
+        } child;
+        struct {
+            gint64 expire_time;
+            gint64 interval;
+            guint heap_index;
+            GSourceFunc function;
+        } timeout;
+        struct {
+            GSourceFunc function;
+        } idle;
+    } data;
+};
+
+typedef struct _WatcherList WatcherList;
+struct _WatcherList
+{
+    Watcher *head;
+    Watcher *tail;
+};
+
+/*
+ * Watchers of a file descriptor share one epoll
+ * registration. The serial is stored in the registration
+ * to ignore events that were collected before the file
+ * descriptor is re-registered.
+ */
+typedef struct _FDEntry FDEntry;
+struct _FDEntry
+{
+    WatcherList watchers;
+    gboolean registered;
+    gboolean edge_triggered;
+    guint32 events;
+    guint32 serial;
+};
+
+typedef struct _MilterEpollEventLoopPrivate MilterEpollEventLoopPrivate;
+struct _MilterEpollEventLoopPrivate
+{
+    gint epoll_fd;
+    gint wakeup_fd;
+    guint fork_generation;
+
+    Watcher **slabs;
+    guint n_slabs;
+    Watcher *free_watchers;
+    Watcher *zombie_watchers;
+    guint n_dispatching;
+    guint n_called;
+
+    FDEntry *fd_entries;
+    guint n_fd_entries;
+
+    Watcher **timeouts;
+    guint n_timeouts;
+    guint n_allocated_timeouts;
+
+    WatcherList idles;
+    guint n_active_idles;
+
+    WatcherList children;
+    gboolean child_fd_registered;
+    gboolean need_child_check;
+    gint child_signal_generation;
+};
+
+static MilterEventLoop *default_event_loop = NULL;
+
+static volatile guint fork_generation = 0;
+
+G_LOCK_DEFINE_STATIC(child_handler);
+static gboolean child_handler_installed = FALSE;
+static gint child_event_fd = -1;
+static volatile sig_atomic_t child_signal_generation = 0;
+static struct sigaction previous_child_action;
+
+static void     dispose          (GObject         *object);
+
+static gboolean iterate          (MilterEventLoop *loop,
+                                  gboolean         may_block);
+static void     quit             (MilterEventLoop *loop);
+
+static guint    watch_io_full    (MilterEventLoop *loop,
+                                  gint             priority,
+                                  GIOChannel      *channel,
+                                  GIOCondition     condition,
+                                  GIOFunc          function,
+                                  gpointer         data,
+                                  GDestroyNotify   notify);
+
+static guint    watch_child_full (MilterEventLoop *loop,
+                                  gint             priority,
+                                  GPid             pid,
+                                  GChildWatchFunc  function,
+                                  gpointer         data,
+                                  GDestroyNotify   notify);
+
+static guint    add_timeout_full (MilterEventLoop *loop,
+                                  gint             priority,
+                                  gdouble          interval_in_seconds,
+                                  GSourceFunc      function,
+                                  gpointer         data,
+                                  GDestroyNotify   notify);
+
+static guint    add_idle_full    (MilterEventLoop *loop,
+                                  gint             priority,
+                                  GSourceFunc      function,
+                                  gpointer         data,
+                                  GDestroyNotify   notify);
+
+static gboolean remove           (MilterEventLoop *loop,
+                                  guint            id);
+static gboolean suspend          (MilterEventLoop *loop,
+                                  guint            id);
+static gboolean resume           (MilterEventLoop *loop,
+                                  guint            id);
+
+static void
+cb_fork_child (void)
+{
+    fork_generation++;
+}
+
+static void
+milter_epoll_event_loop_class_init (MilterEpollEventLoopClass *klass)
+{
+    GObjectClass *gobject_class;
+
+    gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->dispose      = dispose;
+
+    klass->parent_class.iterate = iterate;
+    klass->parent_class.quit = quit;
+    klass->parent_class.watch_io_full = watch_io_full;
+    klass->parent_class.watch_child_full = watch_child_full;
+    klass->parent_class.add_timeout_full = add_timeout_full;
+    klass->parent_class.add_idle_full = add_idle_full;
+    klass->parent_class.remove = remove;
+    klass->parent_class.suspend = suspend;
+    klass->parent_class.resume = resume;
+
+    pthread_atfork(NULL, NULL, cb_fork_child);
+
+    g_type_class_add_private(gobject_class, sizeof(MilterEpollEventLoopPrivate));
+}
+
+static gboolean
+setup_epoll (MilterEpollEventLoopPrivate *priv)
+{
+    struct epoll_event event;
+
+    priv->fork_generation = fork_generation;
+
+    priv->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (priv->epoll_fd == -1) {
+        milter_error("[epoll-event-loop][create][error] %s",
+                     g_strerror(errno));
+        return FALSE;
+    }
+
+    priv->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (priv->wakeup_fd == -1) {
+        milter_error("[epoll-event-loop][create][wakeup][error] %s",
+                     g_strerror(errno));
+        return FALSE;
+    }
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u64 = (guint32)(priv->wakeup_fd);
+    if (epoll_ctl(priv->epoll_fd, EPOLL_CTL_ADD, priv->wakeup_fd, &event) == -1) {
+        milter_error("[epoll-event-loop][create][wakeup][error] %s",
+                     g_strerror(errno));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void
+dispose_epoll (MilterEpollEventLoopPrivate *priv)
+{
+    if (priv->wakeup_fd != -1) {
+        close(priv->wakeup_fd);
+        priv->wakeup_fd = -1;
+    }
+
+    if (priv->epoll_fd != -1) {
+        close(priv->epoll_fd);
+        priv->epoll_fd = -1;
+    }
+}
+
+static void
+milter_epoll_event_loop_init (MilterEpollEventLoop *loop)
+{
+    MilterEpollEventLoopPrivate *priv;
+
+    priv = MILTER_EPOLL_EVENT_LOOP_GET_PRIVATE(loop);
+    priv->epoll_fd = -1;
+    priv->wakeup_fd = -1;
+
+    priv->slabs = NULL;
+    priv->n_slabs = 0;
+    priv->free_watchers = NULL;
+    priv->zombie_watchers = NULL;
+    priv->n_dispatching = 0;
+    priv->n_called = 0;
+
+    priv->fd_entries = NULL;
+    priv->n_fd_entries = 0;
+
+    priv->timeouts = NULL;
+    priv->n_timeouts = 0;
+    priv->n_allocated_timeouts = 0;
+
+    priv->idles.head = NULL;
+    priv->idles.tail = NULL;
+    priv->n_active_idles = 0;
+
+    priv->children.head = NULL;
+    priv->children.tail = NULL;
+    priv->child_fd_registered = FALSE;
+    priv->need_child_check = FALSE;
+    priv->child_signal_generation = child_signal_generation;
+
+    if (!setup_epoll(priv))
+        dispose_epoll(priv);
+}
+
+static void remove_watcher (MilterEpollEventLoop *loop, Watcher *watcher);
+
+static void
+dispose (GObject *object)
+{
+    MilterEpollEventLoop *loop;
+    MilterEpollEventLoopPrivate *priv;
+    guint i, j;
+
+    if (default_event_loop == MILTER_EVENT_LOOP(object)) {
+        default_event_loop = NULL;
+    }
+
+    milter_event_loop_internal_stop_timer_wheel(MILTER_EVENT_LOOP(object));
+
+    loop = MILTER_EPOLL_EVENT_LOOP(object);
+    priv = MILTER_EPOLL_EVENT_LOOP_GET_PRIVATE(loop);
+
+    for (i = 0; i < priv->n_slabs; i++) {
+        for (j = 0; j < N_WATCHERS_PER_SLAB; j++) {
+            Watcher *watcher = &(priv->slabs[i][j]);
+            if (watcher->id != 0)
+                remove_watcher(loop, watcher);
+        }
+    }
+
+    if (priv->slabs) {
+        for (i = 0; i < priv->n_slabs; i++) {
+            g_free(priv->slabs[i]);
+        }
+        g_free(priv->slabs);
+        priv->slabs = NULL;
+        priv->n_slabs = 0;
+        priv->free_watchers = NULL;
+        priv->zombie_watchers = NULL;
+    }
+
+    if (priv->fd_entries) {
+        g_free(priv->fd_entries);
+        priv->fd_entries = NULL;
+        priv->n_fd_entries = 0;
+    }
+
+    if (priv->timeouts) {
+        g_free(priv->timeouts);
+        priv->timeouts = NULL;
+        priv->n_timeouts = 0;
+        priv->n_allocated_timeouts = 0;
+    }
+
+    dispose_epoll(priv);
+
+    G_OBJECT_CLASS(milter_epoll_event_loop_parent_class)->dispose(object);
+}
+
+MilterEventLoop *
+milter_epoll_event_loop_default (void)
+{
+    if (!default_event_loop) {
+        default_event_loop = g_object_new(MILTER_TYPE_EPOLL_EVENT_LOOP, NULL);
+    } else {
+        g_object_ref(default_event_loop);
+    }
+
+    return default_event_loop;
+}
+
+MilterEventLoop *
+milter_epoll_event_loop_new (void)
+{
+    return g_object_new(MILTER_TYPE_EPOLL_EVENT_LOOP, NULL);
+}
+
+static gint64
+get_current_time (void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (gint64)(now.tv_sec) * G_USEC_PER_SEC + now.tv_nsec / 1000;
+}
+
+static void
+watcher_list_append (WatcherList *list, Watcher *watcher)
+{
+    watcher->previous = list->tail;
+    watcher->next = NULL;
+    if (list->tail)
+        list->tail->next = watcher;
+    else
+        list->head = watcher;
+    list->tail = watcher;
+}
+
+/*
+ * The removed watcher keeps its next pointer. A running
+ * dispatch that has already saved the watcher as the next
+ * one can continue from it because removed watchers aren't
+ * reused until the outermost dispatch is finished.
+ */
+static void
+watcher_list_remove (WatcherList *list, Watcher *watcher)
+{
+    if (watcher->previous)
+        watcher->previous->next = watcher->next;
+    else
+        list->head = watcher->next;
+    if (watcher->next)
+        watcher->next->previous = watcher->previous;
+    else
+        list->tail = watcher->previous;
+    watcher->previous = NULL;
+}
+
+static Watcher *
+watcher_new (MilterEpollEventLoopPrivate *priv, WatcherType type,
+             gpointer user_data, GDestroyNotify notify)
+{
+    Watcher *watcher;
+
+    if (!priv->free_watchers) {
+        Watcher *slab;
+        gint i;
+
+        if ((priv->n_slabs + 1) * N_WATCHERS_PER_SLAB > WATCHER_INDEX_MASK) {
+            milter_error("[epoll-event-loop][watcher][error] "
+                         "too many watchers: <%u>",
+                         priv->n_slabs * N_WATCHERS_PER_SLAB);
+            return NULL;
+        }
+
+        slab = g_new0(Watcher, N_WATCHERS_PER_SLAB);
+        for (i = N_WATCHERS_PER_SLAB - 1; i >= 0; i--) {
+            slab[i].index = priv->n_slabs * N_WATCHERS_PER_SLAB + i;
+            slab[i].free_next = priv->free_watchers;
+            priv->free_watchers = &(slab[i]);
+        }
+        priv->slabs = g_renew(Watcher *, priv->slabs, priv->n_slabs + 1);
+        priv->slabs[priv->n_slabs] = slab;
+        priv->n_slabs++;
+    }
+
+    watcher = priv->free_watchers;
+    priv->free_watchers = watcher->free_next;
+
+    watcher->generation = (watcher->generation + 1) & WATCHER_GENERATION_MASK;
+    watcher->id =
+        (watcher->generation << WATCHER_INDEX_BITS) | (watcher->index + 1);
+    watcher->type = type;
+    watcher->active = TRUE;
+    watcher->previous = NULL;
+    watcher->next = NULL;
+    watcher->free_next = NULL;
+    watcher->notify = notify;
+    watcher->user_data = user_data;
+    memset(&(watcher->data), 0, sizeof(watcher->data));
+
+    return watcher;
+}
+
+static Watcher *
+lookup_watcher (MilterEpollEventLoopPrivate *priv, guint id)
+{
+    Watcher *watcher;
+    guint index;
+
+    if ((id & WATCHER_INDEX_MASK) == 0)
+        return NULL;
+
+    index = (id & WATCHER_INDEX_MASK) - 1;
+    if (index >= priv->n_slabs * N_WATCHERS_PER_SLAB)
+        return NULL;
+
+    watcher = &(priv->slabs[index / N_WATCHERS_PER_SLAB]
+                           [index % N_WATCHERS_PER_SLAB]);
+    if (watcher->id != id)
+        return NULL;
+
+    return watcher;
+}
+
+static void
+release_zombie_watchers (MilterEpollEventLoopPrivate *priv)
+{
+    while (priv->zombie_watchers) {
+        Watcher *watcher = priv->zombie_watchers;
+
+        priv->zombie_watchers = watcher->free_next;
+        watcher->next = NULL;
+        watcher->free_next = priv->free_watchers;
+        priv->free_watchers = watcher;
+    }
+}
+
+static guint32
+epoll_events_from_condition (GIOCondition condition)
+{
+    guint32 events = 0;
+
+    if (condition & G_IO_IN)
+        events |= EPOLLIN;
+    if (condition & G_IO_PRI)
+        events |= EPOLLPRI;
+    if (condition & G_IO_OUT)
+        events |= EPOLLOUT;
+
+    return events;
+}
+
+static GIOCondition
+condition_from_epoll_events (guint32 events)
+{
+    GIOCondition condition = 0;
+
+    if (events & EPOLLIN)
+        condition |= G_IO_IN;
+    if (events & EPOLLPRI)
+        condition |= G_IO_PRI;
+    if (events & EPOLLOUT)
+        condition |= G_IO_OUT;
+    if (events & EPOLLERR)
+        condition |= G_IO_ERR;
+    if (events & EPOLLHUP)
+        condition |= G_IO_HUP;
+
+    return condition;
+}
+
+static void
+ensure_fd_entry (MilterEpollEventLoopPrivate *priv, gint fd)
+{
+    guint n_fd_entries;
+
+    if ((guint)fd < priv->n_fd_entries)
+        return;
+
+    n_fd_entries = MAX(priv->n_fd_entries * 2, 64);
+    while (n_fd_entries <= (guint)fd) {
+        n_fd_entries *= 2;
+    }
+    priv->fd_entries = g_renew(FDEntry, priv->fd_entries, n_fd_entries);
+    memset(priv->fd_entries + priv->n_fd_entries,
+           0,
+           sizeof(FDEntry) * (n_fd_entries - priv->n_fd_entries));
+    priv->n_fd_entries = n_fd_entries;
+}
+
+static gboolean
+update_fd_registration (MilterEpollEventLoopPrivate *priv, gint fd)
+{
+    FDEntry *entry;
+    Watcher *watcher;
+    struct epoll_event event;
+    guint32 events = 0;
+    gboolean active = FALSE;
+    gint operation;
+
+    entry = &(priv->fd_entries[fd]);
+    for (watcher = entry->watchers.head; watcher; watcher = watcher->next) {
+        if (!watcher->active)
+            continue;
+        active = TRUE;
+        events |= epoll_events_from_condition(watcher->data.fd.condition);
+    }
+
+    if (!active) {
+        if (entry->registered) {
+            epoll_ctl(priv->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+            entry->registered = FALSE;
+            entry->events = 0;
+        }
+        return TRUE;
+    }
+
+    if (entry->edge_triggered)
+        events |= EPOLLET;
+    if (entry->registered && entry->events == events)
+        return TRUE;
+
+    if (entry->registered) {
+        operation = EPOLL_CTL_MOD;
+    } else {
+        operation = EPOLL_CTL_ADD;
+        entry->serial++;
+        if (entry->serial == 0)
+            entry->serial++;
+    }
+
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.u64 = ((guint64)(entry->serial) << 32) | (guint32)fd;
+    if (epoll_ctl(priv->epoll_fd, operation, fd, &event) == -1) {
+        /* The file descriptor may be closed and reopened
+         * without removing its watchers. */
+        if (operation == EPOLL_CTL_MOD && errno == ENOENT)
+            operation = EPOLL_CTL_ADD;
+        else if (operation == EPOLL_CTL_ADD && errno == EEXIST)
+            operation = EPOLL_CTL_MOD;
+        else
+            operation = -1;
+        if (operation == -1 ||
+            epoll_ctl(priv->epoll_fd, operation, fd, &event) == -1) {
+            milter_error("[epoll-event-loop][watch][error] <%d>: %s",
+                         fd, g_strerror(errno));
+            return FALSE;
+        }
+    }
+
+    entry->registered = TRUE;
+    entry->events = events;
+
+    return TRUE;
+}
+
+static void
+timeout_heap_set (MilterEpollEventLoopPrivate *priv,
+                  guint index, Watcher *watcher)
+{
+    priv->timeouts[index] = watcher;
+    watcher->data.timeout.heap_index = index;
+}
+
+static void
+timeout_heap_sift_up (MilterEpollEventLoopPrivate *priv, guint index)
+{
+    Watcher *watcher;
+
+    watcher = priv->timeouts[index];
+    while (index > 0) {
+        guint parent = (index - 1) / 2;
+
+        if (priv->timeouts[parent]->data.timeout.expire_time <=
+            watcher->data.timeout.expire_time)
+            break;
+        timeout_heap_set(priv, index, priv->timeouts[parent]);
+        index = parent;
+    }
+    timeout_heap_set(priv, index, watcher);
+}
+
+static void
+timeout_heap_sift_down (MilterEpollEventLoopPrivate *priv, guint index)
+{
+    Watcher *watcher;
+
+    watcher = priv->timeouts[index];
+    while (TRUE) {
+        guint child = index * 2 + 1;
+
+        if (child >= priv->n_timeouts)
+            break;
+        if (child + 1 < priv->n_timeouts &&
+            priv->timeouts[child + 1]->data.timeout.expire_time <
+            priv->timeouts[child]->data.timeout.expire_time)
+            child++;
+        if (watcher->data.timeout.expire_time <=
+            priv->timeouts[child]->data.timeout.expire_time)
+            break;
+        timeout_heap_set(priv, index, priv->timeouts[child]);
+        index = child;
+    }
+    timeout_heap_set(priv, index, watcher);
+}
+
+static void
+timeout_heap_push (MilterEpollEventLoopPrivate *priv, Watcher *watcher)
+{
+    if (priv->n_timeouts == priv->n_allocated_timeouts) {
+        priv->n_allocated_timeouts = MAX(priv->n_allocated_timeouts * 2, 16);
+        priv->timeouts = g_renew(Watcher *,
+                                 priv->timeouts,
+                                 priv->n_allocated_timeouts);
+    }
+    priv->timeouts[priv->n_timeouts] = watcher;
+    priv->n_timeouts++;
+    timeout_heap_sift_up(priv, priv->n_timeouts - 1);
+}
+
+static void
+timeout_heap_remove (MilterEpollEventLoopPrivate *priv, Watcher *watcher)
+{
+    guint index;
+
+    index = watcher->data.timeout.heap_index;
+    if (index == INVALID_HEAP_INDEX)
+        return;
+
+    watcher->data.timeout.heap_index = INVALID_HEAP_INDEX;
+    priv->n_timeouts--;
+    if (index == priv->n_timeouts)
+        return;
+
+    timeout_heap_set(priv, index, priv->timeouts[priv->n_timeouts]);
+    if (index > 0 &&
+        priv->timeouts[(index - 1) / 2]->data.timeout.expire_time >
+        priv->timeouts[index]->data.timeout.expire_time) {
+        timeout_heap_sift_up(priv, index);
+    } else {
+        timeout_heap_sift_down(priv, index);
+    }
+}
+
+static void
+schedule_timeout (MilterEpollEventLoopPrivate *priv, Watcher *watcher,
+                  gint64 now)
+{
+    watcher->data.timeout.expire_time = now + watcher->data.timeout.interval;
+    timeout_heap_push(priv, watcher);
+}
+
+static void
+remove_watcher (MilterEpollEventLoop *loop, Watcher *watcher)
+{
+    MilterEpollEventLoopPrivate *priv;
+    GDestroyNotify notify;
+    gpointer user_data;
+
+    priv = MILTER_EPOLL_EVENT_LOOP_GET_PRIVATE(loop);
+
+    switch (watcher->type) {
+    case WATCHER_FD:
+    {
+        FDEntry *entry;
+
+        entry = &(priv->fd_entries[watcher->data.fd.fd]);
+        watcher_list_remove(&(entry->watchers), watcher);
+        update_fd_registration(priv, watcher->data.fd.fd);
+        if (watcher->data.fd.channel) {
+            g_io_channel_unref(watcher->data.fd.channel);
+            watcher->data.fd.channel = NULL;
+        }
+        break;
+    }
+    case WATCHER_CHILD:
+        watcher_list_remove(&(priv->children), watcher);
+        break;
+    case WATCHER_TIMEOUT:
+        timeout_heap_remove(priv, watcher);
+        break;
+    case WATCHER_IDLE:
+        watcher_list_remove(&(priv->idles), watcher);
+        if (watcher->active)
+            priv->n_active_idles--;
+        break;
+    }
+
+    notify = watcher->notify;
+    user_data = watcher->user_data;
+    watcher->id = 0;
+    watcher->active = FALSE;
+    watcher->notify = NULL;
+    watcher->user_data = NULL;
+
+    if (priv->n_dispatching > 0) {
+        watcher->free_next = priv->zombie_watchers;
+        priv->zombie_watchers = watcher;
+    } else {
+        watcher->next = NULL;
+        watcher->free_next = priv->free_watchers;
+        priv->free_watchers = watcher;
+    }
+
+    if (notify)
+        notify(user_data);
+}
+
+static gboolean
+register_child_event_fd (MilterEpollEventLoopPrivate *priv)
+{
+    struct epoll_event event;
+
+    if (priv->child_fd_registered)
+        return TRUE;
+
+    /* Nobody reads the shared event file descriptor. Each
+     * write by the SIGCHLD handler wakes up every loop in
+     * edge triggered mode. */
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLET;
+    event.data.u64 = (guint32)child_event_fd;
+    if (epoll_ctl(priv->epoll_fd, EPOLL_CTL_ADD, child_event_fd, &event) == -1) {
+        milter_error("[epoll-event-loop][watch][child][error] %s",
+                     g_strerror(errno));
+        return FALSE;
+    }
+    priv->child_fd_registered = TRUE;
+
+    return TRUE;
+}
+
+static void
+reset_after_fork (MilterEpollEventLoopPrivate *priv)
+{
+    guint fd;
+
+    /* An epoll instance is shared with the parent process
+     * after fork(). Changes to it affect watchers of the
+     * parent process. */
+    dispose_epoll(priv);
+    if (!setup_epoll(priv)) {
+        dispose_epoll(priv);
+        return;
+    }
+
+    for (fd = 0; fd < priv->n_fd_entries; fd++) {
+        FDEntry *entry = &(priv->fd_entries[fd]);
+
+        if (!entry->registered)
+            continue;
+        entry->registered = FALSE;
+        entry->events = 0;
+        update_fd_registration(priv, fd);
+    }
+
+    if (priv->child_fd_registered) {
+        priv->child_fd_registered = FALSE;
+        register_child_event_fd(priv);
+    }
+}
+
+static MilterEpollEventLoopPrivate *
+get_private (MilterEventLoop *loop)
+{
+    MilterEpollEventLoopPrivate *priv;
+
+    priv = MILTER_EPOLL_EVENT_LOOP_GET_PRIVATE(loop);
+    if (priv->fork_generation != fork_generation)
+        reset_after_fork(priv);
+
+    return priv;
+}
+
+/*
+ * Child watches use a process wide SIGCHLD handler that
+ * chains to the handler installed before it. This can't be
+ * mixed with a GLib child watch (g_child_watch_add()) that
+ * is added later: GLib replaces the handler without chaining
+ * to ours and exited children are never reported. The
+ * handler is checked whenever a child watch is added and is
+ * installed again, chaining to the new one, if it has been
+ * replaced.
+ */
+static void
+cb_child_signal (int signal_number, siginfo_t *info, void *context)
+{
+    int saved_errno;
+    guint64 value = 1;
+    ssize_t written_size;
+
+    saved_errno = errno;
+    child_signal_generation++;
+    written_size = write(child_event_fd, &value, sizeof(value));
+    (void)written_size;
+    errno = saved_errno;
+
+    if (previous_child_action.sa_flags & SA_SIGINFO) {
+        if (previous_child_action.sa_sigaction)
+            previous_child_action.sa_sigaction(signal_number, info, context);
+    } else {
+        if (previous_child_action.sa_handler != SIG_DFL &&
+            previous_child_action.sa_handler != SIG_IGN)
+            previous_child_action.sa_handler(signal_number);
+    }
+}
+
+/* child_handler must be locked. */
+static void
+check_child_handler (void)
+{
+    struct sigaction current_action, saved_action, action;
+
+    if (sigaction(SIGCHLD, NULL, &current_action) == -1)
+        return;
+    if ((current_action.sa_flags & SA_SIGINFO) &&
+        current_action.sa_sigaction == cb_child_signal)
+        return;
+
+    milter_warning("[epoll-event-loop][watch][child][overwritten] "
+                   "SIGCHLD handler is replaced by others. "
+                   "Don't mix with GLib's child watch");
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = cb_child_signal;
+    action.sa_flags = SA_SIGINFO | SA_RESTART | SA_NOCLDSTOP;
+    sigemptyset(&(action.sa_mask));
+    /* The new handler is chained before ours is installed
+     * again so that no SIGCHLD is lost for it. */
+    saved_action = previous_child_action;
+    previous_child_action = current_action;
+    if (sigaction(SIGCHLD, &action, NULL) == -1) {
+        milter_error("[epoll-event-loop][watch][child][reinstall][error] %s",
+                     g_strerror(errno));
+        previous_child_action = saved_action;
+    }
+}
+
+static gboolean
+install_child_handler (void)
+{
+    gboolean installed;
+
+    G_LOCK(child_handler);
+    if (child_handler_installed) {
+        check_child_handler();
+    } else {
+        child_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (child_event_fd == -1) {
+            milter_error("[epoll-event-loop][watch][child][error] %s",
+                         g_strerror(errno));
+        } else {
+            struct sigaction action;
+
+            memset(&action, 0, sizeof(action));
+            action.sa_sigaction = cb_child_signal;
+            action.sa_flags = SA_SIGINFO | SA_RESTART | SA_NOCLDSTOP;
+            sigemptyset(&(action.sa_mask));
+            if (sigaction(SIGCHLD, &action, &previous_child_action) == 0) {
+                child_handler_installed = TRUE;
+            } else {
+                milter_error("[epoll-event-loop][watch][child][error] %s",
+                             g_strerror(errno));
+                close(child_event_fd);
+                child_event_fd = -1;
+            }
+        }
+    }
+    installed = child_handler_installed;
+    G_UNLOCK(child_handler);
+
+    return installed;
+}
+
+static void
+dispatch_fd (MilterEpollEventLoop *loop, gint fd, guint32 serial,
+             guint32 events)
+{
+    MilterEpollEventLoopPrivate *priv;
+    Watcher *watcher, *next;
+    GIOCondition condition;
+
+    priv = MILTER_EPOLL_EVENT_LOOP_GET_PRIVATE(loop);
+    if ((guint)fd >= priv->n_fd_entries)
+        return;
+    if (priv->fd_entries[fd].serial != serial)
+        return;
+
+    condition = condition_from_epoll_events(events);
+    for (watcher = priv->fd_entries[fd].watchers.head;
+         watcher;
+         watcher = next) {
+        GIOCondition matched_condition;
+        guint id;
+        gboolean keep;
+
+        next = watcher->next;
+        if (watcher->id == 0 || !watcher->active)
+            continue;
+        matched_condition = condition & watcher->data.fd.condition;
+        if (matched_condition == 0)
+            continue;
+
+        id = watcher->id;
+        priv->n_called++;
+        if (watcher->data.fd.channel) {
+            keep = watcher->data.fd.channel_function(watcher->data.fd.channel,
+                                                     matched_condition,
+                                                     watcher->user_data);
+        } else {
+            keep = watcher->data.fd.fd_function(fd,
+                                                matched_condition,
+                                                watcher->user_data);
+        }
+        if (!keep && watcher->id == id)
+            remove_watcher(loop, watcher);
+    }
+}
+
+static void
+dispatch_children (MilterEpollEventLoop *loop)
+{
+    MilterEpollEventLoopPrivate *priv;
+    Watcher *watcher, *next;
+
+    priv = MILTER_EPOLL_EVENT_LOOP_GET_PRIVATE(loop);
+    priv->need_child_check = FALSE;
+    priv->child_signal_generation = child_signal_generation;
+
+    for (watcher = priv->children.head; watcher; watcher = next) {
+        GPid pid;
+        gint status;
+        guint id;
+
+        next = watcher->next;
+        if (watcher->id == 0 || !watcher->active)
+            continue;
+
+        pid = waitpid(watcher->data.child.pid, &status, WNOHANG);
+        if (pid <= 0)
+            continue;
+
+        id = watcher->id;
+        priv->n_called++;
+        watcher->data.child.function(pid, status, watcher->user_data);
+        if (watcher->id == id)
+            remove_watcher(loop, watcher);
+    }
+}
+
+static void
+dispatch_timeouts (MilterEpollEventLoop *loop)
+{
+    MilterEpollEventLoopPrivate *priv;
+    gint64 now;
+    guint n_timeouts;
+
+    priv = MILTER_EPOLL_EVENT_LOOP_GET_PRIVATE(loop);
+    if (priv->n_timeouts == 0)
+        return;
+
+    now = get_current_time();
+    /* A timeout that is re-scheduled with 0 interval is
+     * dispatched at the next iteration. */
+    n_timeouts = priv->n_timeouts;
+    while (n_timeouts > 0 &&
+           priv->n_timeouts > 0 &&
+           priv->timeouts[0]->data.timeout.expire_time <= now) {
+        Watcher *watcher;
+        guint id;
+        gboolean keep;
+
+        n_timeouts--;
+        watcher = priv->timeouts[0];
+        timeout_heap_remove(priv, watcher);
+
+        id = watcher->id;
+        priv->n_called++;
+        keep = watcher->data.timeout.function(watcher->user_data);
+        if (watcher->id != id)
+            continue;
+        if (!keep) {
+            remove_watcher(loop, watcher);
+        } else if (watcher->active &&
+                   watcher->data.timeout.heap_index == INVALID_HEAP_INDEX) {
+            schedule_timeout(priv, watcher, now);
+        }
+    }
+}
+
+static void
+dispatch_idles (MilterEpollEventLoop *loop)
+{
+    MilterEpollEventLoopPrivate *priv;
+    Watcher *watcher, *next, *last;
+
+    priv = MILTER_EPOLL_EVENT_LOOP_GET_PRIVATE(loop);
+
+    /* Idles added while dispatching are dispatched at the
+     * next iteration. */
+    last = priv->idles.tail;
+    for (watcher = priv->idles.head; watcher; watcher = next) {
+        next = watcher->next;
+        if (watcher->id != 0 && watcher->active) {
+            guint id;
+
+            id = watcher->id;
+            priv->n_called++;
+            if (!watcher->data.idle.function(watcher->user_data) &&
+                watcher->id == id)
+                remove_watcher(loop, watcher);
+        }
+        if (watcher == last)
+            break;
+    }
+}
+
+static gint
+compute_timeout (MilterEpollEventLoopPrivate *priv, gboolean may_block)
+{
+    gint64 rest;
+
+    if (!may_block || priv->n_active_idles > 0 || priv->need_child_check)
+        return 0;
+
+    if (priv->n_timeouts == 0)
+        return -1;
+
+    rest = priv->timeouts[0]->data.timeout.expire_time - get_current_time();
+    if (rest <= 0)
+        return 0;
+
+    rest = (rest + 999) / 1000;
+    if (rest > G_MAXINT)
+        return G_MAXINT;
+
+    return rest;
+}
+
+static gboolean
+iterate (MilterEventLoop *loop, gboolean may_block)
+{
+    MilterEpollEventLoop *epoll_loop;
+    MilterEpollEventLoopPrivate *priv;
+    struct epoll_event events[MAX_N_EVENTS];
+    gint i, n_events;
+
+    epoll_loop = MILTER_EPOLL_EVENT_LOOP(loop);
+    priv = get_private(loop);
+    if (priv->epoll_fd == -1)
+        return FALSE;
+
+    priv->n_called = 0;
+    priv->n_dispatching++;
+
+    n_events = epoll_wait(priv->epoll_fd, events, MAX_N_EVENTS,
+                          compute_timeout(priv, may_block));
+    if (n_events == -1 && errno != EINTR) {
+        milter_error("[epoll-event-loop][wait][error] %s", g_strerror(errno));
+    }
+    for (i = 0; i < n_events; i++) {
+        gint fd;
+        guint32 serial;
+
+        fd = (gint)(events[i].data.u64 & G_MAXUINT32);
+        serial = (guint32)(events[i].data.u64 >> 32);
+        if (serial == 0) {
+            if (fd == priv->wakeup_fd) {
+                guint64 value;
+                ssize_t read_size;
+
+                read_size = read(priv->wakeup_fd, &value, sizeof(value));
+                (void)read_size;
+            }
+            continue;
+        }
+        dispatch_fd(epoll_loop, fd, serial, events[i].events);
+    }
+
+    if (priv->need_child_check ||
+        priv->child_signal_generation != child_signal_generation)
+        dispatch_children(epoll_loop);
+
+    dispatch_timeouts(epoll_loop);
+
+    if (priv->n_called == 0 && priv->n_active_idles > 0)
+        dispatch_idles(epoll_loop);
+
+    priv->n_dispatching--;
+    if (priv->n_dispatching == 0)
+        release_zombie_watchers(priv);
+
+    return priv->n_called > 0;
+}
+
+static void
+quit (MilterEventLoop *loop)
+{
+    MilterEpollEventLoopPrivate *priv;
+    guint64 value = 1;
+    ssize_t written_size;
+
+    priv = get_private(loop);
+    if (priv->wakeup_fd == -1)
+        return;
+
+    written_size = write(priv->wakeup_fd, &value, sizeof(value));
+    (void)written_size;
+}
+
+static guint
+add_fd_watcher (MilterEventLoop *loop,
+                gint fd,
+                GIOCondition condition,
+                gboolean edge_triggered,
+                GIOChannel *channel,
+                GIOFunc channel_function,
+                MilterEpollEventLoopFDFunc fd_function,
+                gpointer user_data,
+                GDestroyNotify notify)
+{
+    MilterEpollEventLoopPrivate *priv;
+    FDEntry *entry;
+    Watcher *watcher;
+
+    if (fd < 0)
+        return 0;
+
+    priv = get_private(loop);
+    if (priv->epoll_fd == -1)
+        return 0;
+
+    ensure_fd_entry(priv, fd);
+    entry = &(priv->fd_entries[fd]);
+    if (!entry->watchers.head) {
+        entry->edge_triggered = edge_triggered;
+    } else if (entry->edge_triggered != edge_triggered) {
+        milter_error("[epoll-event-loop][watch][error] <%d>: "
+                     "can't mix edge triggered and level triggered watchers",
+                     fd);
+        return 0;
+    }
+
+    watcher = watcher_new(priv, WATCHER_FD, user_data, notify);
+    if (!watcher)
+        return 0;
+    watcher->data.fd.fd = fd;
+    watcher->data.fd.condition = condition;
+    watcher->data.fd.channel_function = channel_function;
+    watcher->data.fd.fd_function = fd_function;
+    watcher_list_append(&(entry->watchers), watcher);
+
+    /* The file descriptor may be a reopened one that isn't
+     * registered to the epoll instance any more. */
+    entry->events = 0;
+    if (!update_fd_registration(priv, fd)) {
+        watcher->notify = NULL;
+        remove_watcher(MILTER_EPOLL_EVENT_LOOP(loop), watcher);
+        return 0;
+    }
+
+    if (channel) {
+        watcher->data.fd.channel = channel;
+        g_io_channel_ref(channel);
+    }
+
+    return watcher->id;
+}
+
+static guint
+watch_io_full (MilterEventLoop *loop,
+               gint             priority,
+               GIOChannel      *channel,
+               GIOCondition     condition,
+               GIOFunc          function,
+               gpointer         user_data,
+               GDestroyNotify   notify)
+{
+    return add_fd_watcher(loop,
+                          g_io_channel_unix_get_fd(channel),
+                          condition,
+                          FALSE,
+                          channel,
+                          function,
+                          NULL,
+                          user_data,
+                          notify);
+}
+
+guint
+milter_epoll_event_loop_watch_fd (MilterEventLoop *loop,
+                                  gint             fd,
+                                  GIOCondition     condition,
+                                  gboolean         edge_triggered,
+                                  MilterEpollEventLoopFDFunc function,
+                                  gpointer         data,
+                                  GDestroyNotify   notify)
+{
+    g_return_val_if_fail(MILTER_IS_EPOLL_EVENT_LOOP(loop), 0);
+
+    return add_fd_watcher(loop,
+                          fd,
+                          condition,
+                          edge_triggered,
+                          NULL,
+                          NULL,
+                          function,
+                          data,
+                          notify);
+}
+
+static guint
+watch_child_full (MilterEventLoop *loop,
+                  gint             priority,
+                  GPid             pid,
+                  GChildWatchFunc  function,
+                  gpointer         data,
+                  GDestroyNotify   notify)
+{
+    MilterEpollEventLoopPrivate *priv;
+    Watcher *watcher;
+
+    priv = get_private(loop);
+    if (priv->epoll_fd == -1)
+        return 0;
+
+    if (!install_child_handler())
+        return 0;
+    if (!register_child_event_fd(priv))
+        return 0;
+
+    watcher = watcher_new(priv, WATCHER_CHILD, data, notify);
+    if (!watcher)
+        return 0;
+    watcher->data.child.pid = pid;
+    watcher->data.child.function = function;
+    watcher_list_append(&(priv->children), watcher);
+
+    /* The child may have exited before it is watched. */
+    priv->need_child_check = TRUE;
+
+    return watcher->id;
+}
+
+static guint
+add_timeout_full (MilterEventLoop *loop,
+                  gint             priority,
+                  gdouble          interval_in_seconds,
+                  GSourceFunc      function,
+                  gpointer         data,
+                  GDestroyNotify   notify)
+{
+    MilterEpollEventLoopPrivate *priv;
+    Watcher *watcher;
+
+    if (interval_in_seconds < 0)
+        return 0;
+
+    priv = get_private(loop);
+
+    watcher = watcher_new(priv, WATCHER_TIMEOUT, data, notify);
+    if (!watcher)
+        return 0;
+    watcher->data.timeout.interval = interval_in_seconds * G_USEC_PER_SEC;
+    watcher->data.timeout.heap_index = INVALID_HEAP_INDEX;
+    watcher->data.timeout.function = function;
+    schedule_timeout(priv, watcher, get_current_time());
+
+    return watcher->id;
+}
+
+static guint
+add_idle_full (MilterEventLoop *loop,
+               gint             priority,
+               GSourceFunc      function,
+               gpointer         data,
+               GDestroyNotify   notify)
+{
+    MilterEpollEventLoopPrivate *priv;
+    Watcher *watcher;
+
+    priv = get_private(loop);
+
+    watcher = watcher_new(priv, WATCHER_IDLE, data, notify);
+    if (!watcher)
+        return 0;
+    watcher->data.idle.function = function;
+    watcher_list_append(&(priv->idles), watcher);
+    priv->n_active_idles++;
+
+    return watcher->id;
+}
+
+static gboolean
+remove (MilterEventLoop *loop,
+        guint            id)
+{
+    MilterEpollEventLoopPrivate *priv;
+    Watcher *watcher;
+
+    priv = get_private(loop);
+    watcher = lookup_watcher(priv, id);
+    if (!watcher)
+        return FALSE;
+
+    remove_watcher(MILTER_EPOLL_EVENT_LOOP(loop), watcher);
+    return TRUE;
+}
+
+static gboolean
+suspend (MilterEventLoop *loop,
+         guint            id)
+{
+    MilterEpollEventLoopPrivate *priv;
+    Watcher *watcher;
+
+    priv = get_private(loop);
+    watcher = lookup_watcher(priv, id);
+    if (!watcher)
+        return FALSE;
+
+    if (!watcher->active)
+        return TRUE;
+
+    watcher->active = FALSE;
+    switch (watcher->type) {
+    case WATCHER_FD:
+        update_fd_registration(priv, watcher->data.fd.fd);
+        break;
+    case WATCHER_CHILD:
+        break;
+    case WATCHER_TIMEOUT:
+        timeout_heap_remove(priv, watcher);
+        break;
+    case WATCHER_IDLE:
+        priv->n_active_idles--;
+        break;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+resume (MilterEventLoop *loop,
+        guint            id)
+{
+    MilterEpollEventLoopPrivate *priv;
+    Watcher *watcher;
+
+    priv = get_private(loop);
+    watcher = lookup_watcher(priv, id);
+    if (!watcher)
+        return FALSE;
+
+    if (watcher->active)
+        return TRUE;
+
+    watcher->active = TRUE;
+    switch (watcher->type) {
+    case WATCHER_FD:
+        update_fd_registration(priv, watcher->data.fd.fd);
+        break;
+    case WATCHER_CHILD:
+        priv->need_child_check = TRUE;
+        break;
+    case WATCHER_TIMEOUT:
+        schedule_timeout(priv, watcher, get_current_time());
+        break;
+    case WATCHER_IDLE:
+        priv->n_active_idles++;
+        break;
+    }
+
+    return TRUE;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
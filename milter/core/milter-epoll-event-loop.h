@@ -0,0 +1,79 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_EPOLL_EVENT_LOOP_H__
+#define __MILTER_EPOLL_EVENT_LOOP_H__
+
+#include <milter/core/milter-event-loop.h>
+
+G_BEGIN_DECLS
+
+#define MILTER_TYPE_EPOLL_EVENT_LOOP            (milter_epoll_event_loop_get_type())
+#define MILTER_EPOLL_EVENT_LOOP(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), MILTER_TYPE_EPOLL_EVENT_LOOP, MilterEpollEventLoop))
+#define MILTER_EPOLL_EVENT_LOOP_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass), MILTER_TYPE_EPOLL_EVENT_LOOP, MilterEpollEventLoopClass))
+#define MILTER_IS_EPOLL_EVENT_LOOP(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj), MILTER_TYPE_EPOLL_EVENT_LOOP))
+#define MILTER_IS_EPOLL_EVENT_LOOP_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), MILTER_TYPE_EPOLL_EVENT_LOOP))
+#define MILTER_EPOLL_EVENT_LOOP_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj), MILTER_TYPE_EPOLL_EVENT_LOOP, MilterEpollEventLoopClass))
+
+/*
+ * An event loop built directly on epoll(7) and
+ * eventfd(2). Watchers are allocated from slabs and an ID
+ * is resolved to its watcher without any hash table. File
+ * descriptors can be watched directly without GIOChannel
+ * by milter_epoll_event_loop_watch_fd(). It is available
+ * only when HAVE_EPOLL_EVENT_LOOP is defined.
+ */
+typedef struct _MilterEpollEventLoop         MilterEpollEventLoop;
+typedef struct _MilterEpollEventLoopClass    MilterEpollEventLoopClass;
+
+struct _MilterEpollEventLoop
+{
+    MilterEventLoop object;
+};
+
+struct _MilterEpollEventLoopClass
+{
+    MilterEventLoopClass parent_class;
+};
+
+typedef gboolean (*MilterEpollEventLoopFDFunc) (gint         fd,
+                                                GIOCondition condition,
+                                                gpointer     user_data);
+
+GType                milter_epoll_event_loop_get_type     (void) G_GNUC_CONST;
+
+MilterEventLoop     *milter_epoll_event_loop_default      (void);
+
+MilterEventLoop     *milter_epoll_event_loop_new          (void);
+
+guint                milter_epoll_event_loop_watch_fd     (MilterEventLoop *loop,
+                                                           gint             fd,
+                                                           GIOCondition     condition,
+                                                           gboolean         edge_triggered,
+                                                           MilterEpollEventLoopFDFunc function,
+                                                           gpointer         data,
+                                                           GDestroyNotify   notify);
+
+G_END_DECLS
+
+#endif /* __MILTER_EPOLL_EVENT_LOOP_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
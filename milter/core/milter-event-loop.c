@@ -22,8 +22,11 @@
 #  include "../../config.h"
 #endif /* HAVE_CONFIG_H */
 
+#include <string.h>
+
 #include "milter-event-loop.h"
 #include "milter-logger.h"
+#include "milter-core-internal.h"
 
 #define MILTER_EVENT_LOOP_GET_PRIVATE(obj)              \
   (G_TYPE_INSTANCE_GET_PRIVATE((obj),                   \
@@ -32,6 +35,14 @@
 
 G_DEFINE_ABSTRACT_TYPE(MilterEventLoop, milter_event_loop, G_TYPE_OBJECT)
 
+#define TIMER_WHEEL_RESOLUTION  0.1
+#define TIMER_WHEEL_BITS        8
+#define TIMER_WHEEL_SIZE        (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK        (TIMER_WHEEL_SIZE - 1)
+#define TIMER_WHEEL_LEVEL2_BITS 6
+#define TIMER_WHEEL_LEVEL2_SIZE (1 << TIMER_WHEEL_LEVEL2_BITS)
+#define TIMER_WHEEL_LEVEL2_MASK (TIMER_WHEEL_LEVEL2_SIZE - 1)
+
 typedef struct _MilterEventLoopPrivate	MilterEventLoopPrivate;
 struct _MilterEventLoopPrivate
 {
@@ -40,6 +51,16 @@ struct _MilterEventLoopPrivate
     gpointer custom_iterate_user_data;
     GDestroyNotify custom_iterate_destroy;
     guint depth;
+
+    MilterEventLoopTimer *timer_wheel[TIMER_WHEEL_SIZE];
+    MilterEventLoopTimer *timer_wheel_level2[TIMER_WHEEL_LEVEL2_SIZE];
+    guint64 timer_wheel_tick;
+    guint n_armed_timers;
+    guint timer_wheel_ticker_id;
+    guint64 timer_wheel_ticker_tick;
+    gboolean timer_wheel_advancing;
+    GTimer *timer_wheel_clock;
+    gdouble timer_wheel_clock_offset;
 };
 
 enum
@@ -77,6 +98,8 @@ milter_event_loop_class_init (MilterEventLoopClass *klass)
     klass->add_timeout_full = NULL;
     klass->add_idle_full = NULL;
     klass->remove = NULL;
+    klass->suspend = NULL;
+    klass->resume = NULL;
 
     spec = g_param_spec_pointer("custom-run",
                                 "Custom run",
@@ -97,6 +120,16 @@ milter_event_loop_init (MilterEventLoop *loop)
     priv->custom_iterate = NULL;
     priv->custom_iterate_user_data = NULL;
     priv->custom_iterate_destroy = NULL;
+
+    memset(priv->timer_wheel, 0, sizeof(priv->timer_wheel));
+    memset(priv->timer_wheel_level2, 0, sizeof(priv->timer_wheel_level2));
+    priv->timer_wheel_tick = 0;
+    priv->n_armed_timers = 0;
+    priv->timer_wheel_ticker_id = 0;
+    priv->timer_wheel_ticker_tick = 0;
+    priv->timer_wheel_advancing = FALSE;
+    priv->timer_wheel_clock = g_timer_new();
+    priv->timer_wheel_clock_offset = 0.0;
 }
 
 static void
@@ -114,6 +147,55 @@ dispose_custom_iterate (MilterEventLoopPrivate *priv)
     priv->custom_iterate_destroy   = NULL;
 }
 
+static void
+timer_unlink (MilterEventLoopTimer *timer)
+{
+    *timer->previous_next = timer->next;
+    if (timer->next)
+        timer->next->previous_next = timer->previous_next;
+    timer->next = NULL;
+    timer->previous_next = NULL;
+}
+
+static void
+timer_link (MilterEventLoopTimer **slot, MilterEventLoopTimer *timer)
+{
+    timer->next = *slot;
+    if (timer->next)
+        timer->next->previous_next = &(timer->next);
+    *slot = timer;
+    timer->previous_next = slot;
+}
+
+static void
+timer_list_unlink_all (MilterEventLoopTimer **slot)
+{
+    while (*slot)
+        timer_unlink(*slot);
+}
+
+static void
+dispose_timer_wheel (MilterEventLoopPrivate *priv)
+{
+    gint i;
+
+    for (i = 0; i < TIMER_WHEEL_SIZE; i++)
+        timer_list_unlink_all(&(priv->timer_wheel[i]));
+    for (i = 0; i < TIMER_WHEEL_LEVEL2_SIZE; i++)
+        timer_list_unlink_all(&(priv->timer_wheel_level2[i]));
+    priv->n_armed_timers = 0;
+    /* The ticker has been removed by
+     * milter_event_loop_internal_stop_timer_wheel() in
+     * subclass's dispose because the backend can't remove it
+     * after that. */
+    priv->timer_wheel_ticker_id = 0;
+
+    if (priv->timer_wheel_clock) {
+        g_timer_destroy(priv->timer_wheel_clock);
+        priv->timer_wheel_clock = NULL;
+    }
+}
+
 static void
 dispose (GObject *object)
 {
@@ -123,6 +205,7 @@ dispose (GObject *object)
 
     priv = MILTER_EVENT_LOOP_GET_PRIVATE(object);
     dispose_custom_iterate(priv);
+    dispose_timer_wheel(priv);
 
     G_OBJECT_CLASS(milter_event_loop_parent_class)->dispose(object);
 }
@@ -437,6 +520,315 @@ milter_event_loop_remove (MilterEventLoop *loop, guint tag)
     return loop_class->remove(loop, tag);
 }
 
+/*
+ * Suspended watchers keep their ID and can be resumed without
+ * allocating a new watcher. Backends that can't do it return FALSE
+ * and callers should fall back to remove and re-add.
+ */
+gboolean
+milter_event_loop_suspend (MilterEventLoop *loop, guint id)
+{
+    MilterEventLoopClass *loop_class;
+
+    g_return_val_if_fail(loop != NULL, FALSE);
+
+    loop_class = MILTER_EVENT_LOOP_GET_CLASS(loop);
+    if (!loop_class->suspend)
+        return FALSE;
+    return loop_class->suspend(loop, id);
+}
+
+gboolean
+milter_event_loop_resume (MilterEventLoop *loop, guint id)
+{
+    MilterEventLoopClass *loop_class;
+
+    g_return_val_if_fail(loop != NULL, FALSE);
+
+    loop_class = MILTER_EVENT_LOOP_GET_CLASS(loop);
+    if (!loop_class->resume)
+        return FALSE;
+    return loop_class->resume(loop, id);
+}
+
+void
+milter_event_loop_timer_init (MilterEventLoopTimer *timer)
+{
+    timer->next = NULL;
+    timer->previous_next = NULL;
+    timer->expire_tick = 0;
+    timer->interval_ticks = 0;
+    timer->function = NULL;
+    timer->data = NULL;
+    timer->loop = NULL;
+}
+
+gboolean
+milter_event_loop_timer_is_armed (MilterEventLoopTimer *timer)
+{
+    return timer->previous_next != NULL;
+}
+
+static gdouble
+timer_wheel_clock (MilterEventLoopPrivate *priv)
+{
+    return g_timer_elapsed(priv->timer_wheel_clock, NULL) +
+        priv->timer_wheel_clock_offset;
+}
+
+static guint64
+timer_wheel_current_tick (MilterEventLoopPrivate *priv)
+{
+    return (guint64)(timer_wheel_clock(priv) / TIMER_WHEEL_RESOLUTION);
+}
+
+static void
+timer_wheel_insert (MilterEventLoopPrivate *priv, MilterEventLoopTimer *timer)
+{
+    guint64 current_tick, level2_distance;
+
+    current_tick = priv->timer_wheel_tick;
+    if (timer->expire_tick < current_tick)
+        timer->expire_tick = current_tick;
+
+    if (timer->expire_tick - current_tick < TIMER_WHEEL_SIZE) {
+        timer_link(&(priv->timer_wheel[timer->expire_tick & TIMER_WHEEL_MASK]),
+                   timer);
+        return;
+    }
+
+    level2_distance =
+        (timer->expire_tick >> TIMER_WHEEL_BITS) -
+        (current_tick >> TIMER_WHEEL_BITS);
+    if (level2_distance < TIMER_WHEEL_LEVEL2_SIZE) {
+        timer_link(&(priv->timer_wheel_level2[(timer->expire_tick >>
+                                               TIMER_WHEEL_BITS) &
+                                              TIMER_WHEEL_LEVEL2_MASK]),
+                   timer);
+    } else {
+        /* Too far: park in the last level2 slot. It is
+         * inserted again when the slot is cascaded. */
+        timer_link(&(priv->timer_wheel_level2[((current_tick >>
+                                                TIMER_WHEEL_BITS) +
+                                               TIMER_WHEEL_LEVEL2_MASK) &
+                                              TIMER_WHEEL_LEVEL2_MASK]),
+                   timer);
+    }
+}
+
+static void
+timer_wheel_cascade (MilterEventLoopPrivate *priv)
+{
+    MilterEventLoopTimer *pending;
+    guint index;
+
+    index = (priv->timer_wheel_tick >> TIMER_WHEEL_BITS) &
+        TIMER_WHEEL_LEVEL2_MASK;
+    pending = priv->timer_wheel_level2[index];
+    priv->timer_wheel_level2[index] = NULL;
+    if (pending)
+        pending->previous_next = &pending;
+
+    while (pending) {
+        MilterEventLoopTimer *timer = pending;
+        timer_unlink(timer);
+        timer_wheel_insert(priv, timer);
+    }
+}
+
+static void
+timer_wheel_expire (MilterEventLoopPrivate *priv)
+{
+    MilterEventLoopTimer *pending;
+    guint index;
+
+    index = priv->timer_wheel_tick & TIMER_WHEEL_MASK;
+    pending = priv->timer_wheel[index];
+    priv->timer_wheel[index] = NULL;
+    if (pending)
+        pending->previous_next = &pending;
+
+    while (pending) {
+        MilterEventLoopTimer *timer = pending;
+
+        timer_unlink(timer);
+        priv->n_armed_timers--;
+        if (timer->function(timer->data) &&
+            !milter_event_loop_timer_is_armed(timer)) {
+            timer->expire_tick = priv->timer_wheel_tick + timer->interval_ticks;
+            timer_wheel_insert(priv, timer);
+            priv->n_armed_timers++;
+        }
+    }
+}
+
+/*
+ * Returns the first tick that has something to do: a
+ * non-empty slot or a cascade of level2 timers. Timers far
+ * away wake the ticker only once per level1 round.
+ */
+static guint64
+timer_wheel_next_tick (MilterEventLoopPrivate *priv)
+{
+    guint64 tick;
+
+    for (tick = priv->timer_wheel_tick + 1; ; tick++) {
+        if ((tick & TIMER_WHEEL_MASK) == 0)
+            break;
+        if (priv->timer_wheel[tick & TIMER_WHEEL_MASK])
+            break;
+    }
+    return tick;
+}
+
+static gboolean cb_timer_wheel_tick (gpointer user_data);
+
+static void
+timer_wheel_schedule_ticker (MilterEventLoop *loop,
+                             MilterEventLoopPrivate *priv)
+{
+    gdouble interval;
+
+    if (priv->timer_wheel_ticker_id > 0) {
+        milter_event_loop_remove(loop, priv->timer_wheel_ticker_id);
+        priv->timer_wheel_ticker_id = 0;
+    }
+
+    if (priv->n_armed_timers == 0)
+        return;
+
+    priv->timer_wheel_ticker_tick = timer_wheel_next_tick(priv);
+    interval = priv->timer_wheel_ticker_tick * TIMER_WHEEL_RESOLUTION -
+        timer_wheel_clock(priv);
+    if (interval < 0)
+        interval = 0;
+    /* The loop isn't referenced to avoid a reference cycle.
+     * The ticker is removed when the loop is disposed. */
+    priv->timer_wheel_ticker_id =
+        milter_event_loop_add_timeout_full(loop,
+                                           G_PRIORITY_DEFAULT,
+                                           interval,
+                                           cb_timer_wheel_tick,
+                                           loop,
+                                           NULL);
+}
+
+static gboolean
+cb_timer_wheel_tick (gpointer user_data)
+{
+    MilterEventLoop *loop = user_data;
+    MilterEventLoopPrivate *priv;
+    guint64 current_tick;
+
+    priv = MILTER_EVENT_LOOP_GET_PRIVATE(loop);
+    priv->timer_wheel_ticker_id = 0;
+    if (priv->timer_wheel_advancing)
+        return FALSE;
+
+    priv->timer_wheel_advancing = TRUE;
+    current_tick = timer_wheel_current_tick(priv);
+    while (priv->n_armed_timers > 0 &&
+           priv->timer_wheel_tick < current_tick) {
+        priv->timer_wheel_tick++;
+        if ((priv->timer_wheel_tick & TIMER_WHEEL_MASK) == 0)
+            timer_wheel_cascade(priv);
+        timer_wheel_expire(priv);
+    }
+    priv->timer_wheel_advancing = FALSE;
+
+    timer_wheel_schedule_ticker(loop, priv);
+
+    return FALSE;
+}
+
+void
+milter_event_loop_arm_timer (MilterEventLoop      *loop,
+                             MilterEventLoopTimer *timer,
+                             gdouble               interval_in_seconds,
+                             GSourceFunc           function,
+                             gpointer              data)
+{
+    MilterEventLoopPrivate *priv;
+    gdouble interval_ticks;
+
+    g_return_if_fail(loop != NULL);
+
+    if (milter_event_loop_timer_is_armed(timer)) {
+        timer_unlink(timer);
+        MILTER_EVENT_LOOP_GET_PRIVATE(timer->loop)->n_armed_timers--;
+    }
+
+    priv = MILTER_EVENT_LOOP_GET_PRIVATE(loop);
+
+    if (priv->n_armed_timers == 0 && !priv->timer_wheel_advancing)
+        priv->timer_wheel_tick = timer_wheel_current_tick(priv);
+
+    interval_ticks = interval_in_seconds / TIMER_WHEEL_RESOLUTION;
+    if (interval_ticks < 1)
+        timer->interval_ticks = 1;
+    else if (interval_ticks > G_MAXUINT)
+        timer->interval_ticks = G_MAXUINT;
+    else
+        timer->interval_ticks = (guint)(interval_ticks + 0.999);
+    timer->function = function;
+    timer->data = data;
+    timer->loop = loop;
+    timer->expire_tick = timer_wheel_current_tick(priv) + timer->interval_ticks;
+    timer_wheel_insert(priv, timer);
+    priv->n_armed_timers++;
+
+    /* The ticker is scheduled again after advancing. */
+    if (priv->timer_wheel_advancing)
+        return;
+    if (priv->timer_wheel_ticker_id == 0 ||
+        timer->expire_tick < priv->timer_wheel_ticker_tick)
+        timer_wheel_schedule_ticker(loop, priv);
+}
+
+void
+milter_event_loop_disarm_timer (MilterEventLoop      *loop,
+                                MilterEventLoopTimer *timer)
+{
+    MilterEventLoopPrivate *priv;
+
+    g_return_if_fail(loop != NULL);
+
+    if (!milter_event_loop_timer_is_armed(timer))
+        return;
+
+    /* The timer belongs to the loop that armed it even if the
+     * caller's loop has been changed since then. */
+    priv = MILTER_EVENT_LOOP_GET_PRIVATE(timer->loop);
+    timer_unlink(timer);
+    priv->n_armed_timers--;
+}
+
+void
+milter_event_loop_advance_timer_clock (MilterEventLoop *loop,
+                                       gdouble          seconds)
+{
+    MilterEventLoopPrivate *priv;
+
+    g_return_if_fail(loop != NULL);
+
+    priv = MILTER_EVENT_LOOP_GET_PRIVATE(loop);
+    priv->timer_wheel_clock_offset += seconds;
+    if (!priv->timer_wheel_advancing)
+        timer_wheel_schedule_ticker(loop, priv);
+}
+
+void
+milter_event_loop_internal_stop_timer_wheel (MilterEventLoop *loop)
+{
+    MilterEventLoopPrivate *priv;
+
+    priv = MILTER_EVENT_LOOP_GET_PRIVATE(loop);
+    if (priv->timer_wheel_ticker_id > 0) {
+        milter_event_loop_remove(loop, priv->timer_wheel_ticker_id);
+        priv->timer_wheel_ticker_id = 0;
+    }
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
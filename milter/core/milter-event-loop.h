@@ -41,6 +41,7 @@ typedef enum
 
 typedef struct _MilterEventLoop         MilterEventLoop;
 typedef struct _MilterEventLoopClass    MilterEventLoopClass;
+typedef struct _MilterEventLoopTimer    MilterEventLoopTimer;
 
 struct _MilterEventLoop
 {
@@ -81,6 +82,27 @@ struct _MilterEventLoopClass
                                   GDestroyNotify   notify);
     gboolean (*remove)           (MilterEventLoop *loop,
                                   guint            id);
+    gboolean (*suspend)          (MilterEventLoop *loop,
+                                  guint            id);
+    gboolean (*resume)           (MilterEventLoop *loop,
+                                  guint            id);
+};
+
+/*
+ * A timer node of the coarse timer wheel of an event loop.
+ * It is embedded in its owner and can be armed, re-armed
+ * and disarmed in O(1) without any allocation. Fields are
+ * private.
+ */
+struct _MilterEventLoopTimer
+{
+    MilterEventLoopTimer *next;
+    MilterEventLoopTimer **previous_next;
+    guint64 expire_tick;
+    guint interval_ticks;
+    GSourceFunc function;
+    gpointer data;
+    MilterEventLoop *loop;
 };
 
 typedef void        (*MilterEventLoopCustomRunFunc)      (MilterEventLoop *loop);
@@ -163,6 +185,36 @@ guint                milter_event_loop_add_idle_full     (MilterEventLoop *loop,
 
 gboolean             milter_event_loop_remove            (MilterEventLoop *loop,
                                                           guint            id);
+gboolean             milter_event_loop_suspend           (MilterEventLoop *loop,
+                                                          guint            id);
+gboolean             milter_event_loop_resume            (MilterEventLoop *loop,
+                                                          guint            id);
+
+void                 milter_event_loop_timer_init        (MilterEventLoopTimer *timer);
+gboolean             milter_event_loop_timer_is_armed    (MilterEventLoopTimer *timer);
+void                 milter_event_loop_arm_timer         (MilterEventLoop *loop,
+                                                          MilterEventLoopTimer *timer,
+                                                          gdouble          interval_in_seconds,
+                                                          GSourceFunc      function,
+                                                          gpointer         data);
+void                 milter_event_loop_disarm_timer      (MilterEventLoop *loop,
+                                                          MilterEventLoopTimer *timer);
+
+/*
+ * milter_event_loop_advance_timer_clock:
+ * @loop: a %MilterEventLoop.
+ * @seconds: seconds to advance the clock of the timer wheel.
+ *
+ * Advances the clock used by the timer wheel of @loop
+ * without waiting. Armed timers whose expire time is
+ * passed are fired on the next tick.
+ *
+ * <note>This is for testing. Don't use it directly for
+ * normal use.</note>
+ */
+void                 milter_event_loop_advance_timer_clock
+                                                         (MilterEventLoop *loop,
+                                                          gdouble          seconds);
 
 G_END_DECLS
 
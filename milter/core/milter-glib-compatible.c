@@ -39,8 +39,42 @@ milter_glib_compatible_mutex_free(GMutex *mutex)
     g_mutex_clear(mutex);
     g_free(mutex);
 }
+
+GCond *
+milter_glib_compatible_cond_new(void)
+{
+    GCond *cond;
+    cond = g_new(GCond, 1);
+    g_cond_init(cond);
+    return cond;
+}
+
+void
+milter_glib_compatible_cond_free(GCond *cond)
+{
+    g_cond_clear(cond);
+    g_free(cond);
+}
 #endif
 
+gboolean
+milter_glib_compatible_cond_wait_seconds(GCond *cond, GMutex *mutex,
+                                         guint seconds)
+{
+#if GLIB_CHECK_VERSION(2, 32, 0)
+    gint64 end_time;
+
+    end_time = g_get_monotonic_time() + seconds * G_TIME_SPAN_SECOND;
+    return g_cond_wait_until(cond, mutex, end_time);
+#else
+    GTimeVal end_time;
+
+    g_get_current_time(&end_time);
+    end_time.tv_sec += seconds;
+    return g_cond_timed_wait(cond, mutex, &end_time);
+#endif
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -25,12 +25,20 @@
 #if GLIB_CHECK_VERSION(2, 32, 0)
 #  define g_mutex_new()             milter_glib_compatible_mutex_new()
 #  define g_mutex_free(mutex)       milter_glib_compatible_mutex_free(mutex)
+#  define g_cond_new()              milter_glib_compatible_cond_new()
+#  define g_cond_free(cond)         milter_glib_compatible_cond_free(cond)
 
 GMutex *milter_glib_compatible_mutex_new (void);
 void    milter_glib_compatible_mutex_free(GMutex *mutex);
+GCond  *milter_glib_compatible_cond_new  (void);
+void    milter_glib_compatible_cond_free (GCond *cond);
 #else
 #  define g_thread_try_new(name, func, data, error) \
     g_thread_create((func), (data), TRUE, (error))
 #endif
 
+gboolean milter_glib_compatible_cond_wait_seconds (GCond  *cond,
+                                                   GMutex *mutex,
+                                                   guint   seconds);
+
 #endif
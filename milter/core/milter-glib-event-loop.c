@@ -23,6 +23,7 @@
 #endif /* HAVE_CONFIG_H */
 
 #include "milter-glib-event-loop.h"
+#include "milter-core-internal.h"
 
 #define MILTER_GLIB_EVENT_LOOP_GET_PRIVATE(obj)                 \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                         \
@@ -158,6 +159,8 @@ dispose (GObject *object)
 {
     MilterGLibEventLoopPrivate *priv;
 
+    milter_event_loop_internal_stop_timer_wheel(MILTER_EVENT_LOOP(object));
+
     priv = MILTER_GLIB_EVENT_LOOP_GET_PRIVATE(object);
 
     if (priv->loop) {
@@ -21,6 +21,8 @@
 #  include "../../config.h"
 #endif /* HAVE_CONFIG_H */
 
+#include <string.h>
+
 #include "milter-headers.h"
 #include "milter-utils.h"
 
@@ -29,9 +31,20 @@
                                  MILTER_TYPE_HEADERS,     \
                                  MilterHeadersPrivate))
 
+/*
+ * Headers are stored in an array for positional access. Headers
+ * that have the same name case-insensitively are also grouped by
+ * name_table for by-name access. name_table is rebuilt lazily
+ * after insertion to or removal from the middle of the array
+ * because it shifts positions of the following headers.
+ * Appending, the most frequent case, updates it incrementally.
+ */
 typedef struct _MilterHeadersPrivate MilterHeadersPrivate;
 struct _MilterHeadersPrivate
 {
+    GPtrArray *headers;
+    GHashTable *name_table;
+    gboolean name_table_dirty;
     GList *header_list;
 };
 
@@ -77,9 +90,23 @@ milter_headers_init (MilterHeaders *headers)
     MilterHeadersPrivate *priv;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
+    priv->headers = g_ptr_array_new();
+    priv->name_table = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                             g_free,
+                                             (GDestroyNotify)g_ptr_array_unref);
+    priv->name_table_dirty = FALSE;
     priv->header_list = NULL;
 }
 
+static void
+clear_header_list (MilterHeadersPrivate *priv)
+{
+    if (priv->header_list) {
+        g_list_free(priv->header_list);
+        priv->header_list = NULL;
+    }
+}
+
 static void
 dispose (GObject *object)
 {
@@ -87,10 +114,17 @@ dispose (GObject *object)
 
     priv = MILTER_HEADERS_GET_PRIVATE(object);
 
-    if (priv->header_list) {
-        g_list_foreach(priv->header_list, (GFunc)milter_header_free, NULL);
-        g_list_free(priv->header_list);
-        priv->header_list = NULL;
+    clear_header_list(priv);
+
+    if (priv->name_table) {
+        g_hash_table_unref(priv->name_table);
+        priv->name_table = NULL;
+    }
+
+    if (priv->headers) {
+        g_ptr_array_foreach(priv->headers, (GFunc)milter_header_free, NULL);
+        g_ptr_array_free(priv->headers, TRUE);
+        priv->headers = NULL;
     }
 
     G_OBJECT_CLASS(milter_headers_parent_class)->dispose(object);
@@ -132,14 +166,14 @@ MilterHeaders *
 milter_headers_copy (MilterHeaders *headers)
 {
     MilterHeaders *copied_headers;
-    GList *node;
     MilterHeadersPrivate *priv;
+    guint i;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
 
     copied_headers = milter_headers_new();
-    for (node = priv->header_list; node; node = g_list_next(node)) {
-        MilterHeader *header = node->data;
+    for (i = 0; i < priv->headers->len; i++) {
+        MilterHeader *header = g_ptr_array_index(priv->headers, i);
 
         milter_headers_append_header(copied_headers, header->name, header->value);
     }
@@ -150,7 +184,20 @@ milter_headers_copy (MilterHeaders *headers)
 const GList *
 milter_headers_get_list (MilterHeaders *headers)
 {
-    return MILTER_HEADERS_GET_PRIVATE(headers)->header_list;
+    MilterHeadersPrivate *priv;
+
+    priv = MILTER_HEADERS_GET_PRIVATE(headers);
+    if (!priv->header_list) {
+        guint i;
+
+        for (i = priv->headers->len; i > 0; i--) {
+            priv->header_list =
+                g_list_prepend(priv->header_list,
+                               g_ptr_array_index(priv->headers, i - 1));
+        }
+    }
+
+    return priv->header_list;
 }
 
 static gboolean
@@ -165,44 +212,121 @@ string_equal (const gchar *string1, const gchar *string2)
     return milter_utils_strcmp0(string1, string2) == 0;
 }
 
+static gchar *
+name_table_key (const gchar *name)
+{
+    return g_ascii_strdown(name ? name : "", -1);
+}
+
+static void
+name_table_add (MilterHeadersPrivate *priv, MilterHeader *header)
+{
+    GPtrArray *same_name_headers;
+    gchar *key;
+
+    key = name_table_key(header->name);
+    same_name_headers = g_hash_table_lookup(priv->name_table, key);
+    if (same_name_headers) {
+        g_free(key);
+    } else {
+        same_name_headers = g_ptr_array_new();
+        g_hash_table_insert(priv->name_table, key, same_name_headers);
+    }
+    g_ptr_array_add(same_name_headers, header);
+}
+
+static void
+invalidate (MilterHeadersPrivate *priv)
+{
+    priv->name_table_dirty = TRUE;
+    clear_header_list(priv);
+}
+
+/*
+ * Returns headers that have the same name as "name"
+ * case-insensitively in appearance order.
+ */
+static GPtrArray *
+lookup_same_name_headers (MilterHeadersPrivate *priv, const gchar *name)
+{
+    GPtrArray *same_name_headers;
+    gchar *key;
+
+    if (priv->name_table_dirty) {
+        guint i;
+
+        g_hash_table_remove_all(priv->name_table);
+        for (i = 0; i < priv->headers->len; i++) {
+            name_table_add(priv, g_ptr_array_index(priv->headers, i));
+        }
+        priv->name_table_dirty = FALSE;
+    }
+
+    key = name_table_key(name);
+    same_name_headers = g_hash_table_lookup(priv->name_table, key);
+    g_free(key);
+
+    return same_name_headers;
+}
+
 MilterHeader *
 milter_headers_find (MilterHeaders *headers,
                      MilterHeader *header)
 {
     MilterHeadersPrivate *priv;
-    GList *found_node;
+    GPtrArray *same_name_headers;
+    guint i;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
-    found_node = g_list_find_custom(priv->header_list,
-                                    header,
-                                    (GCompareFunc)milter_header_compare);
-    if (!found_node)
+    same_name_headers = lookup_same_name_headers(priv, header->name);
+    if (!same_name_headers)
         return NULL;
-    return (MilterHeader *)(found_node->data);
+
+    for (i = 0; i < same_name_headers->len; i++) {
+        MilterHeader *same_name_header;
+
+        same_name_header = g_ptr_array_index(same_name_headers, i);
+        if (milter_header_compare(same_name_header, header) == 0)
+            return same_name_header;
+    }
+
+    return NULL;
 }
 
-static gint
-milter_header_name_compare (MilterHeader *header1,
-                            const gchar *name)
+static MilterHeader *
+milter_headers_lookup_by_name_with_index (MilterHeaders *headers,
+                                          const gchar *name,
+                                          guint index)
 {
-    return milter_utils_strcmp0(header1->name, name);
+    MilterHeadersPrivate *priv;
+    GPtrArray *same_name_headers;
+    guint i, found_count = 0;
+
+    priv = MILTER_HEADERS_GET_PRIVATE(headers);
+    same_name_headers = lookup_same_name_headers(priv, name);
+    if (!same_name_headers)
+        return NULL;
+
+    for (i = 0; i < same_name_headers->len; i++) {
+        MilterHeader *header = g_ptr_array_index(same_name_headers, i);
+
+        if (!string_equal(header->name, name))
+            continue;
+
+        found_count++;
+
+        if (found_count == index)
+            return header;
+    }
+
+    return NULL;
 }
 
 MilterHeader *
 milter_headers_lookup_by_name (MilterHeaders *headers,
                                const gchar *name)
 {
-    MilterHeadersPrivate *priv;
-    GList *found_node;
-
-    priv = MILTER_HEADERS_GET_PRIVATE(headers);
-
-    found_node = g_list_find_custom(priv->header_list,
-                                    name,
-                                    (GCompareFunc)milter_header_name_compare);
-    if (!found_node)
-        return NULL;
-    return (MilterHeader*)found_node->data;
+    return milter_headers_lookup_by_name_with_index(headers, name, 1);
 }
 
 MilterHeader *
@@ -210,17 +334,15 @@ milter_headers_get_nth_header (MilterHeaders *headers,
                                guint index)
 {
     MilterHeadersPrivate *priv;
-    gpointer nth_data;
 
     if (index < 1)
         return NULL;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
-    nth_data = g_list_nth_data(priv->header_list, index - 1);
-    if (!nth_data)
+    if (index > priv->headers->len)
         return NULL;
 
-    return (MilterHeader*)nth_data;
+    return g_ptr_array_index(priv->headers, index - 1);
 }
 
 gint
@@ -228,13 +350,16 @@ milter_headers_index_in_same_header_name (MilterHeaders *headers,
                                           MilterHeader *target)
 {
     MilterHeadersPrivate *priv;
-    GList *node;
-    guint found_count = 0;
+    GPtrArray *same_name_headers;
+    guint i, found_count = 0;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
+    same_name_headers = lookup_same_name_headers(priv, target->name);
+    if (!same_name_headers)
+        return -1;
 
-    for (node = priv->header_list; node; node = g_list_next(node)) {
-        MilterHeader *header = node->data;
+    for (i = 0; i < same_name_headers->len; i++) {
+        MilterHeader *header = g_ptr_array_index(same_name_headers, i);
 
         if (!string_equal(header->name, target->name))
             continue;
@@ -247,51 +372,76 @@ milter_headers_index_in_same_header_name (MilterHeaders *headers,
     return -1;
 }
 
+static void
+remove_header (MilterHeadersPrivate *priv, MilterHeader *header)
+{
+    g_ptr_array_remove(priv->headers, header);
+    milter_header_free(header);
+    invalidate(priv);
+}
+
 gboolean
 milter_headers_remove (MilterHeaders *headers,
                        MilterHeader *header)
 {
-    MilterHeadersPrivate *priv;
     MilterHeader *found_header;
 
-    priv = MILTER_HEADERS_GET_PRIVATE(headers);
-
     found_header = milter_headers_find(headers, header);
     if (!found_header)
         return FALSE;
 
-    priv->header_list = g_list_remove(priv->header_list, found_header);
-    milter_header_free(found_header);
+    remove_header(MILTER_HEADERS_GET_PRIVATE(headers), found_header);
 
     return TRUE;
 }
 
+static void
+insert_header (MilterHeadersPrivate *priv, guint position, MilterHeader *header)
+{
+    GPtrArray *array = priv->headers;
+
+    if (position >= array->len) {
+        g_ptr_array_add(array, header);
+        if (!priv->name_table_dirty)
+            name_table_add(priv, header);
+        clear_header_list(priv);
+        return;
+    }
+
+    g_ptr_array_add(array, NULL);
+    memmove(array->pdata + position + 1,
+            array->pdata + position,
+            sizeof(gpointer) * (array->len - position - 1));
+    array->pdata[position] = header;
+    invalidate(priv);
+}
+
 gboolean
 milter_headers_add_header (MilterHeaders *headers,
                            const gchar *name,
                            const gchar *value)
 {
     MilterHeadersPrivate *priv;
-    GList *node, *same_name_header = NULL;
+    GPtrArray *same_name_headers;
+    guint position;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
 
-    for (node = priv->header_list; node; node = g_list_next(node)) {
-        MilterHeader *header = node->data;
-        if (g_ascii_strcasecmp(header->name, name) == 0) {
-            same_name_header = node;
-            break;
+    position = priv->headers->len;
+    same_name_headers = lookup_same_name_headers(priv, name);
+    if (same_name_headers && same_name_headers->len > 0) {
+        MilterHeader *same_name_header;
+        guint i;
+
+        same_name_header = g_ptr_array_index(same_name_headers, 0);
+        for (i = 0; i < priv->headers->len; i++) {
+            if (g_ptr_array_index(priv->headers, i) == same_name_header) {
+                position = i;
+                break;
+            }
         }
     }
-
-    if (same_name_header) {
-        priv->header_list = g_list_insert_before(priv->header_list,
-                                                 same_name_header,
-                                                 milter_header_new(name, value));
-    } else {
-        priv->header_list = g_list_append(priv->header_list,
-                                          milter_header_new(name, value));
-    }
+    insert_header(priv, position, milter_header_new(name, value));
 
     return TRUE;
 }
@@ -304,8 +454,7 @@ milter_headers_append_header (MilterHeaders *headers,
     MilterHeadersPrivate *priv;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
-    priv->header_list = g_list_append(priv->header_list,
-                                      milter_header_new(name, value));
+    insert_header(priv, priv->headers->len, milter_header_new(name, value));
 
     return TRUE;
 }
@@ -319,40 +468,11 @@ milter_headers_insert_header (MilterHeaders *headers,
     MilterHeadersPrivate *priv;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
-
-    priv->header_list = g_list_insert(priv->header_list,
-                                      milter_header_new(name, value),
-                                      position);
+    insert_header(priv, position, milter_header_new(name, value));
 
     return TRUE;
 }
 
-static MilterHeader *
-milter_headers_lookup_by_name_with_index (MilterHeaders *headers,
-                                          const gchar *name,
-                                          guint index)
-{
-    MilterHeadersPrivate *priv;
-    GList *node;
-    guint found_count = 0;
-
-    priv = MILTER_HEADERS_GET_PRIVATE(headers);
-
-    for (node = priv->header_list; node; node = g_list_next(node)) {
-        MilterHeader *header = node->data;
-
-        if (!string_equal(header->name, name))
-            continue;
-
-        found_count++;
-
-        if (found_count == index)
-            return header;
-    }
-
-    return NULL;
-}
-
 gboolean
 milter_headers_change_header (MilterHeaders *headers,
                               const gchar *name,
@@ -365,10 +485,11 @@ milter_headers_change_header (MilterHeaders *headers,
         return milter_headers_delete_header(headers, name, index);
 
     header = milter_headers_lookup_by_name_with_index(headers, name, index);
-    if (header)
+    if (header) {
         milter_header_change_value(header, value);
-    else
+    } else {
         milter_headers_add_header(headers, name, value);
+    }
 
     return TRUE;
 }
@@ -379,26 +500,42 @@ milter_headers_delete_header (MilterHeaders *headers,
                               guint index)
 {
     MilterHeader *header;
-    MilterHeadersPrivate *priv;
 
     header = milter_headers_lookup_by_name_with_index(headers, name, index);
     if (!header)
         return FALSE;
 
-    priv = MILTER_HEADERS_GET_PRIVATE(headers);
-    priv->header_list = g_list_remove(priv->header_list, header);
-    milter_header_free(header);
+    remove_header(MILTER_HEADERS_GET_PRIVATE(headers), header);
 
     return TRUE;
 }
 
 guint
 milter_headers_length (MilterHeaders *headers)
+{
+    return MILTER_HEADERS_GET_PRIVATE(headers)->headers->len;
+}
+
+void
+milter_headers_iter_init (MilterHeadersIter *iter, MilterHeaders *headers)
+{
+    iter->headers = headers;
+    iter->position = 0;
+}
+
+gboolean
+milter_headers_iter_next (MilterHeadersIter *iter, MilterHeader **header)
 {
     MilterHeadersPrivate *priv;
 
-    priv = MILTER_HEADERS_GET_PRIVATE(headers);
-    return g_list_length(priv->header_list);
+    priv = MILTER_HEADERS_GET_PRIVATE(iter->headers);
+    if (iter->position >= priv->headers->len)
+        return FALSE;
+
+    *header = g_ptr_array_index(priv->headers, iter->position);
+    iter->position++;
+
+    return TRUE;
 }
 
 MilterHeader *
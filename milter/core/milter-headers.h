@@ -52,6 +52,7 @@ void          milter_header_inspect
 
 typedef struct _MilterHeaders         MilterHeaders;
 typedef struct _MilterHeadersClass    MilterHeadersClass;
+typedef struct _MilterHeadersIter     MilterHeadersIter;
 
 struct _MilterHeaders
 {
@@ -63,6 +64,12 @@ struct _MilterHeadersClass
     GObjectClass parent_class;
 };
 
+struct _MilterHeadersIter
+{
+    MilterHeaders *headers;
+    guint position;
+};
+
 GType          milter_headers_get_type    (void) G_GNUC_CONST;
 
 MilterHeaders *milter_headers_new         (void);
@@ -105,6 +112,11 @@ gint           milter_headers_index_in_same_header_name
                                           (MilterHeaders *headers,
                                            MilterHeader *header);
 
+void           milter_headers_iter_init   (MilterHeadersIter *iter,
+                                           MilterHeaders *headers);
+gboolean       milter_headers_iter_next   (MilterHeadersIter *iter,
+                                           MilterHeader **header);
+
 G_END_DECLS
 
 #endif /* __MILTER_HEADERS_H__ */
@@ -24,6 +24,7 @@
 
 #include "milter-libev-event-loop.h"
 #include "milter-logger.h"
+#include "milter-core-internal.h"
 #include <math.h>
 #include <ev.h>
 
@@ -104,6 +105,10 @@ static guint    add_idle_full    (MilterEventLoop *loop,
 
 static gboolean remove           (MilterEventLoop *loop,
                                   guint            id);
+static gboolean suspend          (MilterEventLoop *loop,
+                                  guint            id);
+static gboolean resume           (MilterEventLoop *loop,
+                                  guint            id);
 
 static void
 milter_libev_event_loop_class_init (MilterLibevEventLoopClass *klass)
@@ -124,6 +129,8 @@ milter_libev_event_loop_class_init (MilterLibevEventLoopClass *klass)
     klass->parent_class.add_timeout_full = add_timeout_full;
     klass->parent_class.add_idle_full = add_idle_full;
     klass->parent_class.remove = remove;
+    klass->parent_class.suspend = suspend;
+    klass->parent_class.resume = resume;
 
     spec = g_param_spec_pointer("ev-loop",
                                 "EV loop",
@@ -207,6 +214,8 @@ dispose (GObject *object)
         default_event_loop = NULL;
     }
 
+    milter_event_loop_internal_stop_timer_wheel(MILTER_EVENT_LOOP(object));
+
     priv = MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(object);
 
     if (priv->watchers) {
@@ -284,10 +293,12 @@ milter_libev_event_loop_new (void)
                         NULL);
 }
 
+#define WATCHER_START_FUNC(func)         ((WatcherStartFunc)(func))
 #define WATCHER_STOP_FUNC(func)          ((WatcherStopFunc)(func))
 #define WATCHER_DESTROY_FUNC(func)       ((WatcherDestroyFunc)(func))
 #define WATCHER_PRIVATE(object)          ((WatcherPrivate *)(object))
 
+typedef void (*WatcherStartFunc) (ev_loop *loop, ev_watcher *watcher);
 typedef void (*WatcherStopFunc) (ev_loop *loop, ev_watcher *watcher);
 typedef void (*WatcherDestroyFunc) (ev_watcher *watcher);
 
@@ -296,6 +307,7 @@ struct _WatcherPrivate
 {
     MilterLibevEventLoop *loop;
     guint id;
+    WatcherStartFunc start_func;
     WatcherStopFunc stop_func;
     WatcherDestroyFunc destroy_func;
     GDestroyNotify notify;
@@ -304,7 +316,8 @@ struct _WatcherPrivate
 
 static guint
 add_watcher (MilterLibevEventLoop *loop, ev_watcher *watcher,
-             WatcherStopFunc stop_func, WatcherDestroyFunc destroy_func,
+             WatcherStartFunc start_func, WatcherStopFunc stop_func,
+             WatcherDestroyFunc destroy_func,
              GDestroyNotify notify, gpointer user_data)
 {
     MilterLibevEventLoopPrivate *priv;
@@ -329,6 +342,7 @@ add_watcher (MilterLibevEventLoop *loop, ev_watcher *watcher,
     watcher_priv = watcher->data;
     watcher_priv->loop = loop;
     watcher_priv->id = priv->id;
+    watcher_priv->start_func = start_func;
     watcher_priv->stop_func = stop_func;
     watcher_priv->destroy_func = destroy_func;
     watcher_priv->notify = notify;
@@ -495,6 +509,7 @@ watch_io_full (MilterEventLoop *loop,
     watcher->data = watcher_priv;
     id = add_watcher(MILTER_LIBEV_EVENT_LOOP(loop),
                       (ev_watcher *)watcher,
+                      WATCHER_START_FUNC(ev_io_start),
                       WATCHER_STOP_FUNC(ev_io_stop),
                       io_watcher_destroy,
                       notify, user_data);
@@ -553,6 +568,7 @@ watch_child_full (MilterEventLoop *loop,
     watcher->data = watcher_priv;
     id = add_watcher(MILTER_LIBEV_EVENT_LOOP(loop),
                       (ev_watcher *)watcher,
+                      WATCHER_START_FUNC(ev_child_start),
                       WATCHER_STOP_FUNC(ev_child_stop),
                       NULL,
                       notify, data);
@@ -612,6 +628,7 @@ add_timeout_full (MilterEventLoop *loop,
     watcher->data = watcher_priv;
     id = add_watcher(MILTER_LIBEV_EVENT_LOOP(loop),
                       (ev_watcher *)watcher,
+                      WATCHER_START_FUNC(ev_timer_start),
                       WATCHER_STOP_FUNC(ev_timer_stop),
                       NULL,
                       notify, data);
@@ -669,6 +686,7 @@ add_idle_full (MilterEventLoop *loop,
     watcher->data = watcher_priv;
     id = add_watcher(MILTER_LIBEV_EVENT_LOOP(loop),
                       (ev_watcher *)watcher,
+                      WATCHER_START_FUNC(ev_idle_start),
                       WATCHER_STOP_FUNC(ev_idle_stop),
                       NULL,
                       notify, data);
@@ -686,6 +704,49 @@ remove (MilterEventLoop *loop,
     return remove_watcher(MILTER_LIBEV_EVENT_LOOP(loop), id);
 }
 
+static ev_watcher *
+lookup_watcher (MilterLibevEventLoop *loop, guint id)
+{
+    MilterLibevEventLoopPrivate *priv;
+
+    priv = MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(loop);
+    return g_hash_table_lookup(priv->watchers, GUINT_TO_POINTER(id));
+}
+
+static gboolean
+suspend (MilterEventLoop *loop,
+         guint            id)
+{
+    ev_watcher *watcher;
+    WatcherPrivate *watcher_priv;
+
+    watcher = lookup_watcher(MILTER_LIBEV_EVENT_LOOP(loop), id);
+    if (!watcher)
+        return FALSE;
+
+    watcher_priv = watcher->data;
+    watcher_priv->stop_func(MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(loop)->ev_loop,
+                            watcher);
+    return TRUE;
+}
+
+static gboolean
+resume (MilterEventLoop *loop,
+        guint            id)
+{
+    ev_watcher *watcher;
+    WatcherPrivate *watcher_priv;
+
+    watcher = lookup_watcher(MILTER_LIBEV_EVENT_LOOP(loop), id);
+    if (!watcher)
+        return FALSE;
+
+    watcher_priv = watcher->data;
+    watcher_priv->start_func(MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(loop)->ev_loop,
+                             watcher);
+    return TRUE;
+}
+
 static void
 cb_release (ev_loop *ev_loop)
 {
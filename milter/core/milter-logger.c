@@ -26,11 +26,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <syslog.h>
+#ifdef HAVE_PTHREAD_ATFORK
+#  include <pthread.h>
+#endif
 
 #include <glib.h>
 
 #include "milter-logger.h"
 #include "milter-core-internal.h"
+#include "milter-glib-compatible.h"
 #include "milter-utils.h"
 #include "milter-marshalers.h"
 #include "milter-enum-types.h"
@@ -75,6 +80,11 @@ struct _MilterLoggerPrivate
     MilterLogLevelFlags interesting_level;
     gchar *path;
     FILE *output;
+    MilterLogColorize colorize;
+    gboolean use_color;
+    GFlagsClass *level_flags_class;
+    gboolean async;
+    volatile gint reopen_requested;
 };
 
 enum
@@ -96,6 +106,69 @@ static gint signals[LAST_SIGNAL] = {0};
 
 static MilterLogger *singleton_milter_logger = NULL;
 
+typedef enum
+{
+    MILTER_DEBUG_NONE,
+    MILTER_DEBUG_FATAL_WARNINGS,
+    MILTER_DEBUG_FATAL_CRITICALS
+} MilterDebugMode;
+
+static MilterDebugMode milter_debug_mode = MILTER_DEBUG_NONE;
+
+#define ASYNC_RING_SIZE 1024 /* must be a power of 2 */
+#define ASYNC_WRITER_WAIT_SECONDS 1
+#define NO_SYSLOG_PRIORITY -1
+#define URGENT_LEVEL (MILTER_LOG_LEVEL_CRITICAL | MILTER_LOG_LEVEL_ERROR)
+
+typedef struct _AsyncEntry AsyncEntry;
+struct _AsyncEntry
+{
+    MilterLogger *logger;
+    gint syslog_priority;
+    guint sequence;
+    gchar *line;
+};
+
+/*
+ * Each thread that logs in asynchronous mode has its own
+ * ring. Only the thread advances "head" and only a drainer
+ * that holds async_mutex advances "tail" so that logging
+ * doesn't need a lock. A ring is kept after its thread is
+ * finished because threads are long-lived. Entries are
+ * stamped with a process wide sequence number so that a
+ * drainer can write entries in different rings in the
+ * logged order.
+ */
+typedef struct _AsyncRing AsyncRing;
+struct _AsyncRing
+{
+    AsyncEntry entries[ASYNC_RING_SIZE];
+    volatile gint head;
+    volatile gint tail;
+    guint drain_head;
+    AsyncRing *next;
+};
+
+static GMutex *async_mutex = NULL;
+static GCond *async_cond = NULL;
+static GThread *async_thread = NULL;
+static volatile gint async_running = FALSE;
+static volatile gint async_sleeping = FALSE;
+static gboolean async_quitting = FALSE;
+static volatile gint async_sequence = 0;
+#ifdef HAVE_PTHREAD_ATFORK
+static gboolean async_fork_handlers_registered = FALSE;
+#endif
+static AsyncRing *async_rings = NULL;
+static GList *async_loggers = NULL;
+#if GLIB_CHECK_VERSION(2, 32, 0)
+static GPrivate async_ring_key = G_PRIVATE_INIT(NULL);
+#  define ASYNC_RING_KEY (&async_ring_key)
+#else
+static GPrivate *async_ring_key = NULL;
+#  define ASYNC_RING_KEY (async_ring_key)
+#endif
+
 G_DEFINE_TYPE(MilterLogger, milter_logger, G_TYPE_OBJECT);
 
 static void dispose        (GObject         *object);
@@ -108,10 +181,79 @@ static void get_property   (GObject         *object,
                             GValue          *value,
                             GParamSpec      *pspec);
 
+static void
+resolve_milter_debug_mode (void)
+{
+    const gchar *milter_debug;
+
+    milter_debug_mode = MILTER_DEBUG_NONE;
+
+    milter_debug = g_getenv("MILTER_DEBUG");
+    if (!milter_debug)
+        return;
+
+    if (strcmp(milter_debug, "fatal-warnings") == 0 ||
+        strcmp(milter_debug, "fatal_warnings") == 0) {
+        milter_debug_mode = MILTER_DEBUG_FATAL_WARNINGS;
+    } else if (strcmp(milter_debug, "fatal-criticals") == 0 ||
+               strcmp(milter_debug, "fatal_criticals") == 0) {
+        milter_debug_mode = MILTER_DEBUG_FATAL_CRITICALS;
+    }
+}
+
+static guint drain_async_rings (void);
+
+#ifdef HAVE_PTHREAD_ATFORK
+/*
+ * The writer thread isn't inherited by a forked child.
+ * Buffered lines are written before fork() so that they
+ * aren't written twice, and the child starts its own
+ * writer on demand.
+ */
+static void
+async_prepare_fork (void)
+{
+    g_mutex_lock(async_mutex);
+    drain_async_rings();
+}
+
+static void
+async_parent_after_fork (void)
+{
+    g_mutex_unlock(async_mutex);
+}
+
+static void
+async_child_after_fork (void)
+{
+    async_thread = NULL;
+    g_atomic_int_set(&async_running, FALSE);
+    g_atomic_int_set(&async_sleeping, FALSE);
+    g_mutex_unlock(async_mutex);
+}
+#endif
+
+static void
+init_async_writer (void)
+{
+    if (async_mutex)
+        return;
+
+    async_mutex = g_mutex_new();
+    async_cond = g_cond_new();
+#if !GLIB_CHECK_VERSION(2, 32, 0)
+    async_ring_key = g_private_new(NULL);
+#endif
+}
+
 void
 milter_logger_internal_init (void)
 {
     GError *error = NULL;
+    const gchar *async_env;
+
+    resolve_milter_debug_mode();
+    init_async_writer();
 
     singleton_milter_logger = milter_logger_new();
     milter_logger_connect_default_handler(singleton_milter_logger);
@@ -139,6 +281,9 @@ milter_logger_internal_init (void)
         g_error_free(error);
         error = NULL;
     }
+    async_env = g_getenv("MILTER_LOG_ASYNC");
+    if (async_env && g_str_equal(async_env, "yes"))
+        milter_logger_set_async(singleton_milter_logger, TRUE);
 }
 
 void
@@ -205,10 +350,37 @@ milter_logger_class_init (MilterLoggerClass *klass)
     g_type_class_add_private(gobject_class, sizeof(MilterLoggerPrivate));
 }
 
+static void
+resolve_colorize (MilterLoggerPrivate *priv)
+{
+    switch (priv->colorize) {
+    case MILTER_LOG_COLORIZE_CONSOLE:
+        priv->use_color = TRUE;
+        break;
+    case MILTER_LOG_COLORIZE_NONE:
+        priv->use_color = FALSE;
+        break;
+    default:
+    {
+        int output_fileno;
+
+        if (priv->output) {
+            output_fileno = fileno(priv->output);
+        } else {
+            output_fileno = STDOUT_FILENO;
+        }
+        priv->use_color = isatty(output_fileno) &&
+            milter_utils_guess_console_color_usability();
+        break;
+    }
+    }
+}
+
 static void
 milter_logger_init (MilterLogger *logger)
 {
     MilterLoggerPrivate *priv;
+    const gchar *colorize_type;
 
     priv = MILTER_LOGGER_GET_PRIVATE(logger);
     priv->target_level = MILTER_LOG_LEVEL_DEFAULT;
@@ -220,6 +392,18 @@ milter_logger_init (MilterLogger *logger)
                         GUINT_TO_POINTER(priv->interesting_level));
     priv->path = NULL;
     priv->output = NULL;
+
+    priv->colorize = MILTER_LOG_COLORIZE_DEFAULT;
+    colorize_type = g_getenv("MILTER_LOG_COLORIZE");
+    if (colorize_type)
+        priv->colorize = milter_utils_enum_from_string(MILTER_TYPE_LOG_COLORIZE,
+                                                       colorize_type,
+                                                       NULL);
+    resolve_colorize(priv);
+
+    priv->level_flags_class = g_type_class_ref(MILTER_TYPE_LOG_LEVEL_FLAGS);
+    priv->async = FALSE;
+    priv->reopen_requested = FALSE;
 }
 
 static void
@@ -240,6 +424,8 @@ dispose (GObject *object)
 
     priv = MILTER_LOGGER_GET_PRIVATE(object);
 
+    milter_logger_set_async(MILTER_LOGGER(object), FALSE);
+
     if (priv->interesting_levels) {
         g_hash_table_unref(priv->interesting_levels);
         priv->interesting_levels = NULL;
@@ -247,6 +433,11 @@ dispose (GObject *object)
 
     dispose_path(priv);
 
+    if (priv->level_flags_class) {
+        g_type_class_unref(priv->level_flags_class);
+        priv->level_flags_class = NULL;
+    }
+
     G_OBJECT_CLASS(milter_logger_parent_class)->dispose(object);
 }
 
@@ -406,63 +597,338 @@ static void
 log_message (MilterLoggerPrivate *priv, GString *log,
              MilterLogLevelFlags level, const gchar *message)
 {
-    const gchar *colorize_type;
-    MilterLogColorize colorize = MILTER_LOG_COLORIZE_DEFAULT;
+    if (priv->use_color)
+        log_message_colorize_console(log, level, message);
+    else
+        g_string_append(log, message);
+}
 
-    colorize_type = g_getenv("MILTER_LOG_COLORIZE");
-    if (colorize_type)
-        colorize = milter_utils_enum_from_string(MILTER_TYPE_LOG_COLORIZE,
-                                                 colorize_type,
-                                                 NULL);
+static void
+abort_with_flush (void)
+{
+    if (singleton_milter_logger)
+        milter_logger_flush(singleton_milter_logger);
+    abort();
+}
 
-    if (colorize == MILTER_LOG_COLORIZE_DEFAULT) {
-        int output_fileno;
+static inline void
+check_milter_debug (MilterLogLevelFlags level)
+{
+    if (milter_debug_mode == MILTER_DEBUG_NONE)
+        return;
 
-        if (priv->output) {
-            output_fileno = fileno(priv->output);
-        } else {
-            output_fileno = STDOUT_FILENO;
-        }
-        if (isatty(output_fileno) &&
-            milter_utils_guess_console_color_usability()) {
-            colorize = MILTER_LOG_COLORIZE_CONSOLE;
-        } else {
-            colorize = MILTER_LOG_COLORIZE_NONE;
+    if (MILTER_LOG_LEVEL_CRITICAL <= level &&
+        level <= MILTER_LOG_LEVEL_WARNING) {
+        if (milter_debug_mode == MILTER_DEBUG_FATAL_WARNINGS)
+            abort_with_flush();
+
+        if (level == MILTER_LOG_LEVEL_CRITICAL &&
+            milter_debug_mode == MILTER_DEBUG_FATAL_CRITICALS)
+            abort_with_flush();
+    }
+}
+
+static void
+write_async_entry (AsyncEntry *entry)
+{
+    MilterLoggerPrivate *priv;
+
+    priv = MILTER_LOGGER_GET_PRIVATE(entry->logger);
+    if (entry->syslog_priority != NO_SYSLOG_PRIORITY) {
+        syslog(entry->syslog_priority, "%s", entry->line);
+    } else if (priv->output) {
+        fputs(entry->line, priv->output);
+    } else {
+        g_print("%s", entry->line);
+    }
+    g_free(entry->line);
+    entry->line = NULL;
+    entry->logger = NULL;
+}
+
+static void
+flush_async_outputs (void)
+{
+    GList *node;
+
+    for (node = async_loggers; node; node = g_list_next(node)) {
+        MilterLoggerPrivate *priv;
+
+        priv = MILTER_LOGGER_GET_PRIVATE(node->data);
+        if (priv->output)
+            fflush(priv->output);
+    }
+}
+
+/*
+ * async_mutex must be locked. Entries that are pushed while
+ * draining are left for the next drain so that draining
+ * always finishes.
+ */
+static guint
+drain_async_rings (void)
+{
+    AsyncRing *ring;
+    guint n_entries = 0;
+
+    for (ring = async_rings; ring; ring = ring->next) {
+        ring->drain_head = (guint)g_atomic_int_get(&(ring->head));
+    }
+
+    while (TRUE) {
+        AsyncRing *oldest_ring = NULL;
+        AsyncEntry *oldest_entry = NULL;
+        guint tail;
+
+        for (ring = async_rings; ring; ring = ring->next) {
+            AsyncEntry *entry;
+
+            tail = (guint)ring->tail;
+            if (tail == ring->drain_head)
+                continue;
+            entry = &(ring->entries[tail % ASYNC_RING_SIZE]);
+            if (!oldest_entry ||
+                (gint)(entry->sequence - oldest_entry->sequence) < 0) {
+                oldest_ring = ring;
+                oldest_entry = entry;
+            }
         }
+        if (!oldest_ring)
+            break;
+
+        write_async_entry(oldest_entry);
+        tail = (guint)oldest_ring->tail + 1;
+        g_atomic_int_set(&(oldest_ring->tail), (gint)tail);
+        n_entries++;
     }
 
-    switch (colorize) {
-      case MILTER_LOG_COLORIZE_CONSOLE:
-        log_message_colorize_console(log, level, message);
-        break;
-      default:
-        g_string_append(log, message);
-        break;
+    if (n_entries > 0)
+        flush_async_outputs();
+
+    return n_entries;
+}
+
+static gboolean
+have_async_entries (void)
+{
+    AsyncRing *ring;
+
+    for (ring = async_rings; ring; ring = ring->next) {
+        if (g_atomic_int_get(&(ring->head)) != ring->tail)
+            return TRUE;
     }
+
+    return FALSE;
 }
 
-static inline void
-check_milter_debug (MilterLogLevelFlags level)
+static gboolean reopen_output (MilterLoggerPrivate *priv, GError **error);
+
+/* async_mutex must be locked. */
+static GList *
+reopen_requested_outputs (void)
 {
-    if (MILTER_LOG_LEVEL_CRITICAL <= level &&
-        level <= MILTER_LOG_LEVEL_WARNING) {
-        const gchar *milter_debug;
+    GList *node, *errors = NULL;
+
+    for (node = async_loggers; node; node = g_list_next(node)) {
+        MilterLoggerPrivate *priv;
+        GError *error = NULL;
+
+        priv = MILTER_LOGGER_GET_PRIVATE(node->data);
+        if (!g_atomic_int_get(&(priv->reopen_requested)))
+            continue;
+        g_atomic_int_set(&(priv->reopen_requested), FALSE);
+        if (!reopen_output(priv, &error))
+            errors = g_list_prepend(errors, error);
+    }
 
-        milter_debug = g_getenv("MILTER_DEBUG");
-        if (!milter_debug)
-            return;
+    return errors;
+}
+
+static AsyncRing *
+get_async_ring (void)
+{
+    AsyncRing *ring;
+
+    ring = g_private_get(ASYNC_RING_KEY);
+    if (ring)
+        return ring;
+
+    ring = g_new0(AsyncRing, 1);
+    g_mutex_lock(async_mutex);
+    ring->next = async_rings;
+    async_rings = ring;
+    g_mutex_unlock(async_mutex);
+    g_private_set(ASYNC_RING_KEY, ring);
+
+    return ring;
+}
 
-        if (strcmp(milter_debug, "fatal-warnings") == 0 ||
-            strcmp(milter_debug, "fatal_warnings") == 0) {
-            abort();
+static gpointer
+async_writer_run (gpointer data)
+{
+    /* Registered before locking because a reopen error is
+     * logged by this thread. */
+    get_async_ring();
+
+    g_mutex_lock(async_mutex);
+    while (TRUE) {
+        GList *errors, *node;
+
+        drain_async_rings();
+
+        errors = reopen_requested_outputs();
+        if (errors) {
+            g_mutex_unlock(async_mutex);
+            for (node = errors; node; node = g_list_next(node)) {
+                GError *error = node->data;
+                INTERNAL_LOG(MILTER_LOG_LEVEL_WARNING,
+                             "[logger][reopen][open][warning] %s",
+                             error->message);
+                g_error_free(error);
+            }
+            g_list_free(errors);
+            g_mutex_lock(async_mutex);
+            continue;
         }
 
-        if (level == MILTER_LOG_LEVEL_CRITICAL &&
-            (strcmp(milter_debug, "fatal-criticals") == 0 ||
-             strcmp(milter_debug, "fatal_criticals") == 0)) {
-            abort();
+        if (async_quitting)
+            break;
+
+        g_atomic_int_set(&async_sleeping, TRUE);
+        if (!have_async_entries())
+            milter_glib_compatible_cond_wait_seconds(async_cond,
+                                                     async_mutex,
+                                                     ASYNC_WRITER_WAIT_SECONDS);
+        g_atomic_int_set(&async_sleeping, FALSE);
+    }
+    g_mutex_unlock(async_mutex);
+
+    return NULL;
+}
+
+static gboolean
+ensure_async_writer (void)
+{
+    GError *error = NULL;
+    gboolean running;
+
+    if (g_atomic_int_get(&async_running))
+        return TRUE;
+
+    g_mutex_lock(async_mutex);
+    if (!async_running) {
+        async_quitting = FALSE;
+        async_thread = g_thread_try_new("milter_logger_async_writer",
+                                        async_writer_run,
+                                        NULL,
+                                        &error);
+        if (async_thread)
+            g_atomic_int_set(&async_running, TRUE);
+#ifdef HAVE_PTHREAD_ATFORK
+        /* Handlers can't be unregistered. They are registered
+         * only when the writer is used at least once. */
+        if (async_thread && !async_fork_handlers_registered) {
+            pthread_atfork(async_prepare_fork,
+                           async_parent_after_fork,
+                           async_child_after_fork);
+            async_fork_handlers_registered = TRUE;
         }
+#endif
     }
+    running = async_running;
+    g_mutex_unlock(async_mutex);
+
+    if (error) {
+        g_printerr("[logger][async][writer][start][error] %s\n",
+                   error->message);
+        g_error_free(error);
+    }
+
+    return running;
+}
+
+static void
+stop_async_writer (void)
+{
+    GThread *thread = NULL;
+
+    g_mutex_lock(async_mutex);
+    if (async_running) {
+        thread = async_thread;
+        async_quitting = TRUE;
+        g_cond_signal(async_cond);
+    }
+    g_mutex_unlock(async_mutex);
+
+    if (thread)
+        g_thread_join(thread);
+
+    g_mutex_lock(async_mutex);
+    async_thread = NULL;
+    g_atomic_int_set(&async_running, FALSE);
+    g_mutex_unlock(async_mutex);
+}
+
+static void
+wake_async_writer (void)
+{
+    g_mutex_lock(async_mutex);
+    g_cond_signal(async_cond);
+    g_mutex_unlock(async_mutex);
+}
+
+static void
+push_async_entry (MilterLogger *logger, gint syslog_priority, gchar *line)
+{
+    AsyncRing *ring;
+    AsyncEntry *entry;
+    guint head;
+
+    if (!ensure_async_writer()) {
+        AsyncEntry sync_entry;
+
+        sync_entry.logger = logger;
+        sync_entry.syslog_priority = syslog_priority;
+        sync_entry.line = line;
+        g_mutex_lock(async_mutex);
+        write_async_entry(&sync_entry);
+        flush_async_outputs();
+        g_mutex_unlock(async_mutex);
+        return;
+    }
+
+    ring = get_async_ring();
+    head = (guint)ring->head;
+    while (head - (guint)g_atomic_int_get(&(ring->tail)) >= ASYNC_RING_SIZE) {
+        wake_async_writer();
+        g_thread_yield();
+    }
+
+    entry = &(ring->entries[head % ASYNC_RING_SIZE]);
+    entry->logger = logger;
+    entry->syslog_priority = syslog_priority;
+#if GLIB_CHECK_VERSION(2, 30, 0)
+    entry->sequence = (guint)g_atomic_int_add(&async_sequence, 1);
+#else
+    entry->sequence = (guint)g_atomic_int_exchange_and_add(&async_sequence, 1);
+#endif
+    entry->line = line;
+    g_atomic_int_set(&(ring->head), (gint)(head + 1));
+
+    if (g_atomic_int_get(&async_sleeping))
+        wake_async_writer();
+}
+
+gboolean
+milter_logger_internal_write_async (MilterLogger *logger,
+                                    gint syslog_priority,
+                                    gchar *line)
+{
+    if (!MILTER_LOGGER_GET_PRIVATE(logger)->async)
+        return FALSE;
+
+    push_async_entry(logger, syslog_priority, line);
+    return TRUE;
 }
 
 void
@@ -492,19 +958,15 @@ milter_logger_default_log_handler (MilterLogger *logger, const gchar *domain,
         target_item = DEFAULT_ITEM;
 
     if (target_item & MILTER_LOG_ITEM_LEVEL) {
-        GFlagsClass *flags_class;
-
-        flags_class = g_type_class_ref(MILTER_TYPE_LOG_LEVEL_FLAGS);
-        if (flags_class) {
-            if (level & flags_class->mask) {
-                guint i;
-                for (i = 0; i < flags_class->n_values; i++) {
-                    GFlagsValue *value = flags_class->values + i;
-                    if (level & value->value)
-                        g_string_append_printf(log, "[%s]", value->value_nick);
-                }
+        GFlagsClass *flags_class = priv->level_flags_class;
+
+        if (level & flags_class->mask) {
+            guint i;
+            for (i = 0; i < flags_class->n_values; i++) {
+                GFlagsValue *value = flags_class->values + i;
+                if (level & value->value)
+                    g_string_append_printf(log, "[%s]", value->value_nick);
             }
-            g_type_class_unref(flags_class);
         }
     }
 
@@ -544,6 +1006,12 @@ milter_logger_default_log_handler (MilterLogger *logger, const gchar *domain,
 
     log_message(priv, log, level, message);
     g_string_append(log, "\n");
+    if (priv->async) {
+        push_async_entry(logger, NO_SYSLOG_PRIORITY, g_string_free(log, FALSE));
+        if (level & URGENT_LEVEL)
+            milter_logger_flush(logger);
+        return;
+    }
     if (priv->output) {
         fputs(log->str, priv->output);
         fflush(priv->output);
@@ -597,28 +1065,129 @@ milter_logger_log_va_list (MilterLogger *logger,
     g_free(message);
 }
 
+static gboolean
+reopen_output (MilterLoggerPrivate *priv, GError **error)
+{
+    gboolean success = TRUE;
+
+    if (!priv->path)
+        return TRUE;
+
+    fclose(priv->output);
+    priv->output = fopen(priv->path, "a");
+    if (!priv->output) {
+        g_set_error(error,
+                    G_FILE_ERROR,
+                    g_file_error_from_errno(errno),
+                    "<%s>: %s",
+                    priv->path, g_strerror(errno));
+        g_free(priv->path);
+        priv->path = NULL;
+        success = FALSE;
+    }
+    resolve_colorize(priv);
+
+    return success;
+}
+
+/*
+ * In asynchronous mode, this only requests the writer
+ * thread to write buffered lines and reopen the output. It
+ * can be called from a signal handler.
+ */
 void
 milter_logger_reopen (MilterLogger *logger)
 {
     MilterLoggerPrivate *priv;
+    GError *error = NULL;
 
     priv = MILTER_LOGGER_GET_PRIVATE(logger);
 
     if (!priv->path)
         return;
 
+    if (priv->async) {
+        g_atomic_int_set(&(priv->reopen_requested), TRUE);
+        return;
+    }
+
     milter_info("[logger][reopen][close]");
-    fclose(priv->output);
-    priv->output = fopen(priv->path, "a");
-    if (!priv->output) {
-        milter_warning("[logger][reopen][open][warning] <%s>: %s",
-                       priv->path, g_strerror(errno));
-        g_free(priv->path);
-        priv->path = NULL;
+    if (!reopen_output(priv, &error)) {
+        milter_warning("[logger][reopen][open][warning] %s", error->message);
+        g_error_free(error);
     }
     milter_info("[logger][reopen][open]");
 }
 
+/*
+ * Log lines are formatted by the logging thread and written
+ * by a writer thread in asynchronous mode. Critical and
+ * error lines are written before returning.
+ */
+void
+milter_logger_set_async (MilterLogger *logger, gboolean async)
+{
+    MilterLoggerPrivate *priv;
+
+    priv = MILTER_LOGGER_GET_PRIVATE(logger);
+    if (priv->async == async)
+        return;
+
+#ifndef HAVE_PTHREAD_ATFORK
+    if (async) {
+        INTERNAL_LOG(MILTER_LOG_LEVEL_WARNING,
+                     "[logger][async][unavailable] "
+                     "pthread_atfork() is required");
+        return;
+    }
+#endif
+
+    init_async_writer();
+    if (async) {
+        g_mutex_lock(async_mutex);
+        async_loggers = g_list_prepend(async_loggers, logger);
+        g_mutex_unlock(async_mutex);
+        priv->async = TRUE;
+    } else {
+        gboolean last_logger;
+
+        priv->async = FALSE;
+        g_mutex_lock(async_mutex);
+        drain_async_rings();
+        async_loggers = g_list_remove(async_loggers, logger);
+        last_logger = (async_loggers == NULL);
+        g_mutex_unlock(async_mutex);
+        if (last_logger)
+            stop_async_writer();
+
+        if (g_atomic_int_get(&(priv->reopen_requested))) {
+            g_atomic_int_set(&(priv->reopen_requested), FALSE);
+            milter_logger_reopen(logger);
+        }
+    }
+}
+
+gboolean
+milter_logger_is_async (MilterLogger *logger)
+{
+    return MILTER_LOGGER_GET_PRIVATE(logger)->async;
+}
+
+void
+milter_logger_flush (MilterLogger *logger)
+{
+    MilterLoggerPrivate *priv;
+
+    priv = MILTER_LOGGER_GET_PRIVATE(logger);
+    if (priv->async) {
+        g_mutex_lock(async_mutex);
+        drain_async_rings();
+        g_mutex_unlock(async_mutex);
+    } else if (priv->output) {
+        fflush(priv->output);
+    }
+}
+
 MilterLogLevelFlags
 milter_logger_get_target_level (MilterLogger *logger)
 {
@@ -749,23 +1318,22 @@ milter_logger_get_path (MilterLogger *logger)
     return MILTER_LOGGER_GET_PRIVATE(logger)->path;
 }
 
-gboolean
-milter_logger_set_path (MilterLogger *logger, const gchar *path, GError **error)
+static gboolean
+open_path (MilterLoggerPrivate *priv, const gchar *path, GError **error)
 {
-    MilterLoggerPrivate *priv;
-
-    priv = MILTER_LOGGER_GET_PRIVATE(logger);
-
     dispose_path(priv);
 
     if (path && strcmp(path, "-") == 0)
         path = NULL;
-    if (!path)
+    if (!path) {
+        resolve_colorize(priv);
         return TRUE;
+    }
 
     priv->output = fopen(path, "a");
     if (priv->output) {
         priv->path = g_strdup(path);
+        resolve_colorize(priv);
         return TRUE;
     } else {
         g_set_error(error,
@@ -773,10 +1341,30 @@ milter_logger_set_path (MilterLogger *logger, const gchar *path, GError **error)
                     g_file_error_from_errno(errno),
                     "failed to set log output path: <%s>: %s",
                     path, g_strerror(errno));
+        resolve_colorize(priv);
         return FALSE;
     }
 }
 
+gboolean
+milter_logger_set_path (MilterLogger *logger, const gchar *path, GError **error)
+{
+    MilterLoggerPrivate *priv;
+    gboolean success;
+
+    priv = MILTER_LOGGER_GET_PRIVATE(logger);
+
+    if (!priv->async)
+        return open_path(priv, path, error);
+
+    g_mutex_lock(async_mutex);
+    drain_async_rings();
+    success = open_path(priv, path, error);
+    g_mutex_unlock(async_mutex);
+
+    return success;
+}
+
 void
 milter_logger_connect_default_handler (MilterLogger *logger)
 {
@@ -210,6 +210,10 @@ void             milter_logger_log_va_list    (MilterLogger        *logger,
                                                va_list              args);
 
 void             milter_logger_reopen         (MilterLogger        *logger);
+void             milter_logger_set_async      (MilterLogger        *logger,
+                                               gboolean             async);
+gboolean         milter_logger_is_async       (MilterLogger        *logger);
+void             milter_logger_flush          (MilterLogger        *logger);
 
 MilterLogLevelFlags
                  milter_logger_get_target_level
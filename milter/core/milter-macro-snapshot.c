@@ -0,0 +1,166 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <string.h>
+
+#include "milter-macro-snapshot.h"
+
+struct _MilterMacroSnapshot
+{
+    volatile gint ref_count;
+    MilterCommand command;
+    GHashTable *macros;
+    GString *packet;
+};
+
+G_LOCK_DEFINE_STATIC(bracketed_names);
+static GHashTable *bracketed_names = NULL;
+
+const gchar *
+milter_macro_snapshot_intern_name (const gchar *name)
+{
+    return g_intern_string(name);
+}
+
+/*
+ * Returns the interned "{NAME}" for NAME. It returns NULL
+ * when NAME is empty or already bracketed. Single
+ * character names such as "i" are also bracketed because
+ * libmilter users commonly ask them as "{i}".
+ */
+const gchar *
+milter_macro_snapshot_intern_bracketed_name (const gchar *name)
+{
+    const gchar *interned_name, *bracketed_name;
+
+    if (name[0] == '\0' || name[0] == '{')
+        return NULL;
+
+    interned_name = g_intern_string(name);
+
+    G_LOCK(bracketed_names);
+    if (!bracketed_names)
+        bracketed_names = g_hash_table_new(g_direct_hash, g_direct_equal);
+    bracketed_name = g_hash_table_lookup(bracketed_names, interned_name);
+    if (!bracketed_name) {
+        gchar *new_name;
+
+        new_name = g_strconcat("{", name, "}", NULL);
+        bracketed_name = g_intern_string(new_name);
+        g_free(new_name);
+        g_hash_table_insert(bracketed_names,
+                            (gpointer)interned_name,
+                            (gpointer)bracketed_name);
+    }
+    G_UNLOCK(bracketed_names);
+
+    return bracketed_name;
+}
+
+static void
+cb_copy_macro (gpointer key, gpointer value, gpointer user_data)
+{
+    GHashTable *macros = user_data;
+
+    if (!value)
+        return;
+
+    g_hash_table_replace(macros,
+                         (gpointer)milter_macro_snapshot_intern_name(key),
+                         g_strdup(value));
+}
+
+MilterMacroSnapshot *
+milter_macro_snapshot_new (MilterCommand command, GHashTable *macros)
+{
+    MilterMacroSnapshot *snapshot;
+
+    snapshot = g_new(MilterMacroSnapshot, 1);
+    snapshot->ref_count = 1;
+    snapshot->command = command;
+    snapshot->macros = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                             NULL, g_free);
+    if (macros)
+        g_hash_table_foreach(macros, cb_copy_macro, snapshot->macros);
+    snapshot->packet = NULL;
+
+    return snapshot;
+}
+
+MilterMacroSnapshot *
+milter_macro_snapshot_ref (MilterMacroSnapshot *snapshot)
+{
+    g_atomic_int_inc(&(snapshot->ref_count));
+    return snapshot;
+}
+
+void
+milter_macro_snapshot_unref (MilterMacroSnapshot *snapshot)
+{
+    if (!g_atomic_int_dec_and_test(&(snapshot->ref_count)))
+        return;
+
+    g_hash_table_unref(snapshot->macros);
+    if (snapshot->packet)
+        g_string_free(snapshot->packet, TRUE);
+    g_free(snapshot);
+}
+
+MilterCommand
+milter_macro_snapshot_get_command (MilterMacroSnapshot *snapshot)
+{
+    return snapshot->command;
+}
+
+GHashTable *
+milter_macro_snapshot_get_macros (MilterMacroSnapshot *snapshot)
+{
+    return snapshot->macros;
+}
+
+void
+milter_macro_snapshot_encode (MilterMacroSnapshot  *snapshot,
+                              MilterCommandEncoder *encoder,
+                              const gchar         **packet,
+                              gsize                *packet_size)
+{
+    if (!snapshot->packet) {
+        const gchar *encoded_packet;
+        gsize encoded_packet_size;
+
+        milter_command_encoder_encode_define_macro(encoder,
+                                                   &encoded_packet,
+                                                   &encoded_packet_size,
+                                                   snapshot->command,
+                                                   snapshot->macros);
+        snapshot->packet = g_string_new_len(encoded_packet,
+                                            encoded_packet_size);
+    }
+
+    *packet = snapshot->packet->str;
+    *packet_size = snapshot->packet->len;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
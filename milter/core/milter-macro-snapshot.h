@@ -0,0 +1,64 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MACRO_SNAPSHOT_H__
+#define __MILTER_MACRO_SNAPSHOT_H__
+
+#include <glib.h>
+
+#include <milter/core/milter-protocol.h>
+#include <milter/core/milter-command-encoder.h>
+
+G_BEGIN_DECLS
+
+/*
+ * An immutable, reference counted set of macros of a
+ * stage. It is shared by all protocol agents that receive
+ * the same macros. Macro names are interned. The encoded
+ * DEFINE_MACRO packet is cached so that it is encoded only
+ * once for all receivers.
+ */
+typedef struct _MilterMacroSnapshot MilterMacroSnapshot;
+
+MilterMacroSnapshot *milter_macro_snapshot_new    (MilterCommand        command,
+                                                   GHashTable          *macros);
+MilterMacroSnapshot *milter_macro_snapshot_ref    (MilterMacroSnapshot *snapshot);
+void                 milter_macro_snapshot_unref  (MilterMacroSnapshot *snapshot);
+
+MilterCommand        milter_macro_snapshot_get_command
+                                                  (MilterMacroSnapshot *snapshot);
+GHashTable          *milter_macro_snapshot_get_macros
+                                                  (MilterMacroSnapshot *snapshot);
+void                 milter_macro_snapshot_encode (MilterMacroSnapshot  *snapshot,
+                                                   MilterCommandEncoder *encoder,
+                                                   const gchar         **packet,
+                                                   gsize                *packet_size);
+
+const gchar         *milter_macro_snapshot_intern_name
+                                                  (const gchar         *name);
+const gchar         *milter_macro_snapshot_intern_bracketed_name
+                                                  (const gchar         *name);
+
+G_END_DECLS
+
+#endif /* __MILTER_MACRO_SNAPSHOT_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -25,6 +25,7 @@
 #include <stdlib.h>
 
 #include "milter-protocol-agent.h"
+#include "milter-macro-snapshot.h"
 #include "milter-marshalers.h"
 #include "milter-enum-types.h"
 #include "milter-utils.h"
@@ -39,7 +40,9 @@ typedef struct _MilterProtocolAgentPrivate	MilterProtocolAgentPrivate;
 struct _MilterProtocolAgentPrivate
 {
     GHashTable *macros;
+    GHashTable *macro_snapshots;
     GHashTable *available_macros;
+    GHashTable *available_bracketed_macros;
     MilterCommand macro_context;
     MilterMacrosRequests *macros_requests;
 };
@@ -109,7 +112,12 @@ milter_protocol_agent_init (MilterProtocolAgent *agent)
     priv->macros = g_hash_table_new_full(g_direct_hash, g_direct_equal,
                                          NULL,
                                          (GDestroyNotify)g_hash_table_unref);
+    priv->macro_snapshots =
+        g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                              NULL,
+                              (GDestroyNotify)milter_macro_snapshot_unref);
     priv->available_macros = NULL;
+    priv->available_bracketed_macros = NULL;
     priv->macro_context = MILTER_COMMAND_UNKNOWN;
     priv->macros_requests = NULL;
 }
@@ -121,6 +129,18 @@ clear_available_macros (MilterProtocolAgentPrivate *priv)
         g_hash_table_unref(priv->available_macros);
         priv->available_macros = NULL;
     }
+
+    if (priv->available_bracketed_macros) {
+        g_hash_table_unref(priv->available_bracketed_macros);
+        priv->available_bracketed_macros = NULL;
+    }
+}
+
+static void
+remove_macros (MilterProtocolAgentPrivate *priv, MilterCommand macro_context)
+{
+    g_hash_table_remove(priv->macro_snapshots, GINT_TO_POINTER(macro_context));
+    g_hash_table_remove(priv->macros, GINT_TO_POINTER(macro_context));
 }
 
 static void
@@ -130,12 +150,17 @@ dispose (GObject *object)
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(object);
 
+    clear_available_macros(priv);
+
     if (priv->macros) {
         g_hash_table_unref(priv->macros);
         priv->macros = NULL;
     }
 
-    clear_available_macros(priv);
+    if (priv->macro_snapshots) {
+        g_hash_table_unref(priv->macro_snapshots);
+        priv->macro_snapshots = NULL;
+    }
 
     if (priv->macros_requests) {
         g_object_unref(priv->macros_requests);
@@ -192,14 +217,11 @@ milter_protocol_agent_get_macro (MilterProtocolAgent *agent, const gchar *name)
 
     available_macros = milter_protocol_agent_get_available_macros(agent);
     value = g_hash_table_lookup(available_macros, name);
-    if (!value) {
-        gchar *unbracket_name = NULL;
+    if (!value && name[0] == '{') {
+        MilterProtocolAgentPrivate *priv;
 
-        if (g_str_has_prefix(name, "{") && g_str_has_suffix(name, "}")) {
-            unbracket_name = g_strndup(name + 1, strlen(name) - 2);
-            value = g_hash_table_lookup(available_macros, unbracket_name);
-            g_free(unbracket_name);
-        }
+        priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
+        value = g_hash_table_lookup(priv->available_bracketed_macros, name);
     }
 
     return value;
@@ -215,8 +237,11 @@ milter_protocol_agent_get_available_macros (MilterProtocolAgent *agent)
     if (priv->available_macros)
         return priv->available_macros;
 
-    priv->available_macros = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                                   g_free, g_free);
+    /* Keys and values are owned by the per stage macros. They
+     * are cleared when any per stage macros are changed. */
+    priv->available_macros = g_hash_table_new(g_str_hash, g_str_equal);
+    priv->available_bracketed_macros = g_hash_table_new(g_str_hash,
+                                                        g_str_equal);
     for (i = 0; macro_search_order[i] != 0; i++) {
         GHashTable *macros;
         MilterCommand context;
@@ -224,9 +249,23 @@ milter_protocol_agent_get_available_macros (MilterProtocolAgent *agent)
         context = macro_search_order[i];
 
         macros = g_hash_table_lookup(priv->macros, GINT_TO_POINTER(context));
-        if (macros)
-            milter_utils_merge_hash_string_string(priv->available_macros,
-                                                  macros);
+        if (macros) {
+            GHashTableIter iter;
+            gpointer key, value;
+
+            g_hash_table_iter_init(&iter, macros);
+            while (g_hash_table_iter_next(&iter, &key, &value)) {
+                const gchar *bracketed_name;
+
+                g_hash_table_replace(priv->available_macros, key, value);
+                bracketed_name =
+                    milter_macro_snapshot_intern_bracketed_name(key);
+                if (bracketed_name)
+                    g_hash_table_replace(priv->available_bracketed_macros,
+                                         (gpointer)bracketed_name,
+                                         value);
+            }
+        }
         if (context == priv->macro_context)
             break;
     }
@@ -252,8 +291,8 @@ milter_protocol_agent_clear_macros (MilterProtocolAgent *agent,
     MilterProtocolAgentPrivate *priv;
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
-    g_hash_table_remove(priv->macros, GINT_TO_POINTER(macro_context));
     clear_available_macros(priv);
+    remove_macros(priv, macro_context);
 }
 
 void
@@ -262,9 +301,9 @@ milter_protocol_agent_clear_message_related_macros (MilterProtocolAgent *agent)
     MilterProtocolAgentPrivate *priv;
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
+    clear_available_macros(priv);
 #define CLEAR_MACRO(command)                                            \
-    g_hash_table_remove(priv->macros,                                   \
-                        GINT_TO_POINTER(MILTER_COMMAND_ ## command))
+    remove_macros(priv, MILTER_COMMAND_ ## command)
 
     CLEAR_MACRO(ENVELOPE_FROM);
     CLEAR_MACRO(ENVELOPE_RECIPIENT);
@@ -275,7 +314,6 @@ milter_protocol_agent_clear_message_related_macros (MilterProtocolAgent *agent)
     CLEAR_MACRO(END_OF_MESSAGE);
 
 #undef CLEAR_MACRO
-    clear_available_macros(priv);
 }
 
 static void
@@ -294,7 +332,20 @@ ensure_macros (MilterProtocolAgentPrivate *priv, MilterCommand macro_context)
     GHashTable *macros;
 
     macros = g_hash_table_lookup(priv->macros, GINT_TO_POINTER(macro_context));
-    if (!macros) {
+    if (macros &&
+        g_hash_table_lookup(priv->macro_snapshots,
+                            GINT_TO_POINTER(macro_context))) {
+        GHashTable *shared_macros = macros;
+
+        clear_available_macros(priv);
+        macros = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                       g_free, g_free);
+        milter_utils_merge_hash_string_string(macros, shared_macros);
+        remove_macros(priv, macro_context);
+        g_hash_table_insert(priv->macros,
+                            GINT_TO_POINTER(macro_context),
+                            macros);
+    } else if (!macros) {
         macros = g_hash_table_new_full(g_str_hash, g_str_equal,
                                        g_free, g_free);
         g_hash_table_insert(priv->macros,
@@ -326,6 +377,7 @@ milter_protocol_agent_set_macros_valist (MilterProtocolAgent *agent,
     MilterProtocolAgentPrivate *priv;
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
+    clear_available_macros(priv);
     macros = ensure_macros(priv, macro_context);
     name = macro_name;
     while (name) {
@@ -372,13 +424,46 @@ milter_protocol_agent_set_macros_hash_table (MilterProtocolAgent *agent,
     GHashTable *new_macros;
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
+    clear_available_macros(priv);
     new_macros = g_hash_table_new_full(g_str_hash, g_str_equal,
                                        g_free, g_free);
+    remove_macros(priv, macro_context);
     g_hash_table_insert(priv->macros,
                         GINT_TO_POINTER(macro_context),
                         new_macros);
     g_hash_table_foreach(macros, cb_copy_macro, new_macros);
+}
+
+void
+milter_protocol_agent_set_macro_snapshot (MilterProtocolAgent *agent,
+                                          MilterMacroSnapshot *snapshot)
+{
+    MilterProtocolAgentPrivate *priv;
+    MilterCommand macro_context;
+    GHashTable *macros;
+
+    priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
     clear_available_macros(priv);
+    macro_context = milter_macro_snapshot_get_command(snapshot);
+    macros = milter_macro_snapshot_get_macros(snapshot);
+    remove_macros(priv, macro_context);
+    g_hash_table_insert(priv->macros,
+                        GINT_TO_POINTER(macro_context),
+                        g_hash_table_ref(macros));
+    g_hash_table_insert(priv->macro_snapshots,
+                        GINT_TO_POINTER(macro_context),
+                        milter_macro_snapshot_ref(snapshot));
+}
+
+MilterMacroSnapshot *
+milter_protocol_agent_get_macro_snapshot (MilterProtocolAgent *agent,
+                                          MilterCommand macro_context)
+{
+    MilterProtocolAgentPrivate *priv;
+
+    priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
+    return g_hash_table_lookup(priv->macro_snapshots,
+                               GINT_TO_POINTER(macro_context));
 }
 
 void
@@ -392,9 +477,9 @@ milter_protocol_agent_set_macro (MilterProtocolAgent *agent,
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
 
+    clear_available_macros(priv);
     macros = ensure_macros(priv, macro_context);
     update_macro(macros, macro_name, macro_value);
-    clear_available_macros(priv);
 }
 
 void
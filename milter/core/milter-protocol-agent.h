@@ -24,6 +24,7 @@
 
 #include <milter/core/milter-agent.h>
 #include <milter/core/milter-macros-requests.h>
+#include <milter/core/milter-macro-snapshot.h>
 
 G_BEGIN_DECLS
 
@@ -61,6 +62,12 @@ void                 milter_protocol_agent_set_macros_hash_table
                                                     (MilterProtocolAgent *agent,
                                                      MilterCommand  macro_context,
                                                      GHashTable    *macros);
+void                 milter_protocol_agent_set_macro_snapshot
+                                                    (MilterProtocolAgent *agent,
+                                                     MilterMacroSnapshot *snapshot);
+MilterMacroSnapshot *milter_protocol_agent_get_macro_snapshot
+                                                    (MilterProtocolAgent *agent,
+                                                     MilterCommand  macro_context);
 void                 milter_protocol_agent_set_macro(MilterProtocolAgent *agent,
                                                      MilterCommand  macro_context,
                                                      const gchar   *macro_name,
@@ -23,6 +23,9 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
 
 #include <glib.h>
 
@@ -46,6 +49,10 @@ struct _MilterReaderPrivate
     gboolean processing;
     gboolean shutdown_requested;
     guint tag;
+    gboolean socket;
+    MilterDecoder *decoder;
+    MilterReaderDecodeErrorFunction decode_error_func;
+    gpointer decode_error_user_data;
 };
 
 enum
@@ -129,9 +136,70 @@ milter_reader_init (MilterReader *reader)
     priv->processing = FALSE;
     priv->shutdown_requested = FALSE;
     priv->tag = 0;
+    priv->socket = FALSE;
+    priv->decoder = NULL;
+    priv->decode_error_func = NULL;
+    priv->decode_error_user_data = NULL;
 }
 
 #define BUFFER_SIZE 4096
+
+static void
+emit_io_error (MilterReader *reader, GError *io_error)
+{
+    MilterReaderPrivate *priv;
+    GError *error = NULL;
+
+    priv = MILTER_READER_GET_PRIVATE(reader);
+    priv->shutdown_requested = TRUE;
+
+    milter_utils_set_error_with_sub_error(&error,
+                                          MILTER_READER_ERROR,
+                                          MILTER_READER_ERROR_IO_ERROR,
+                                          io_error,
+                                          "I/O error");
+    milter_error("[%u] [reader][error][read] %s",
+                 priv->tag, error->message);
+    milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(reader),
+                                error);
+    g_error_free(error);
+}
+
+static void
+decode (MilterReader *reader, const gchar *chunk, gsize size,
+        gboolean reserved)
+{
+    MilterReaderPrivate *priv;
+    MilterDecoder *decoder;
+    GError *error = NULL;
+
+    priv = MILTER_READER_GET_PRIVATE(reader);
+
+    if (g_signal_has_handler_pending(reader, signals[FLOW], 0, TRUE))
+        g_signal_emit(reader, signals[FLOW], 0, chunk, size);
+
+    /* decoder may be detached by "flow" handlers and callbacks
+     * of the decoder. */
+    if (!priv->decoder) {
+        milter_debug("[%u] [reader][decode][detached] <%" G_GSIZE_FORMAT ">",
+                     priv->tag, size);
+        return;
+    }
+    decoder = g_object_ref(priv->decoder);
+    if (reserved)
+        milter_decoder_decode_reserved_buffer(decoder, size, &error);
+    else
+        milter_decoder_decode(decoder, chunk, size, &error);
+    g_object_unref(decoder);
+
+    if (error) {
+        if (priv->decode_error_func)
+            priv->decode_error_func(reader, error,
+                                    priv->decode_error_user_data);
+        g_error_free(error);
+    }
+}
+
 static gboolean
 read_from_channel (MilterReader *reader, GIOChannel *channel)
 {
@@ -152,20 +220,7 @@ read_from_channel (MilterReader *reader, GIOChannel *channel)
         eof = TRUE;
     }
     if (io_error) {
-        GError *error = NULL;
-
-        priv->shutdown_requested = TRUE;
-
-        milter_utils_set_error_with_sub_error(&error,
-                                              MILTER_READER_ERROR,
-                                              MILTER_READER_ERROR_IO_ERROR,
-                                              io_error,
-                                              "I/O error");
-        milter_error("[%u] [reader][error][read] %s",
-                     priv->tag, error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(reader),
-                                    error);
-        g_error_free(error);
+        emit_io_error(reader, io_error);
         error_occurred = TRUE;
     }
 
@@ -177,12 +232,61 @@ read_from_channel (MilterReader *reader, GIOChannel *channel)
                          priv->tag, length,
                          (condition & G_IO_IN) ? "contain" : "empty");
         }
-        g_signal_emit(reader, signals[FLOW], 0, stream, length);
+        if (priv->decoder)
+            decode(reader, stream, length, FALSE);
+        else
+            g_signal_emit(reader, signals[FLOW], 0, stream, length);
     }
 
     return !error_occurred && !eof;
 }
 
+/*
+ * Fast path for socket: read data into the decoder's
+ * buffer directly. It doesn't use GIOChannel's buffer and
+ * doesn't copy read data.
+ */
+static gboolean
+read_from_socket (MilterReader *reader, GIOChannel *channel)
+{
+    MilterReaderPrivate *priv;
+    gchar *buffer;
+    gssize length;
+
+    priv = MILTER_READER_GET_PRIVATE(reader);
+
+    buffer = milter_decoder_reserve_buffer(priv->decoder, BUFFER_SIZE);
+    do {
+        length = recv(g_io_channel_unix_get_fd(channel),
+                      buffer, BUFFER_SIZE, 0);
+    } while (length == -1 && errno == EINTR);
+
+    if (length == 0) {
+        milter_trace("[%u] [reader][eof]", priv->tag);
+        return FALSE;
+    }
+
+    if (length == -1) {
+        GError *io_error = NULL;
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return TRUE;
+
+        g_set_error(&io_error,
+                    G_IO_CHANNEL_ERROR,
+                    g_io_channel_error_from_errno(errno),
+                    "%s", g_strerror(errno));
+        emit_io_error(reader, io_error);
+        return FALSE;
+    }
+
+    milter_trace("[%d] [reader][read][socket] <%" G_GSSIZE_FORMAT ">",
+                 priv->tag, length);
+    decode(reader, buffer, length, TRUE);
+
+    return TRUE;
+}
+
 static void
 clear_watch_id (MilterReaderPrivate *priv)
 {
@@ -226,7 +330,11 @@ read_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
 
     if (!priv->shutdown_requested) {
         milter_trace("[%d] [reader][callback][read][reading] ...", priv->tag);
-        keep_callback = read_from_channel(reader, channel);
+        if (priv->socket && priv->decoder) {
+            keep_callback = read_from_socket(reader, channel);
+        } else {
+            keep_callback = read_from_channel(reader, channel);
+        }
         while (keep_callback &&
                g_io_channel_get_buffered(priv->io_channel) &&
                (g_io_channel_get_buffer_condition(priv->io_channel) & G_IO_IN)) {
@@ -361,6 +469,11 @@ dispose (GObject *object)
         priv->io_channel = NULL;
     }
 
+    if (priv->decoder) {
+        g_object_unref(priv->decoder);
+        priv->decoder = NULL;
+    }
+
     G_OBJECT_CLASS(milter_reader_parent_class)->dispose(object);
 }
 
@@ -424,6 +537,36 @@ milter_reader_io_channel_new (GIOChannel *channel)
                         NULL);
 }
 
+MilterReader *
+milter_reader_socket_io_channel_new (GIOChannel *channel)
+{
+    MilterReader *reader;
+
+    reader = milter_reader_io_channel_new(channel);
+    MILTER_READER_GET_PRIVATE(reader)->socket = TRUE;
+
+    return reader;
+}
+
+void
+milter_reader_set_decoder (MilterReader *reader,
+                           MilterDecoder *decoder,
+                           MilterReaderDecodeErrorFunction decode_error_func,
+                           gpointer user_data)
+{
+    MilterReaderPrivate *priv;
+
+    priv = MILTER_READER_GET_PRIVATE(reader);
+
+    if (decoder)
+        g_object_ref(decoder);
+    if (priv->decoder)
+        g_object_unref(priv->decoder);
+    priv->decoder = decoder;
+    priv->decode_error_func = decode_error_func;
+    priv->decode_error_user_data = user_data;
+}
+
 void
 milter_reader_start (MilterReader *reader, MilterEventLoop *loop)
 {
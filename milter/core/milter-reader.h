@@ -27,6 +27,7 @@
 #include <milter/core/milter-error-emittable.h>
 #include <milter/core/milter-finished-emittable.h>
 #include <milter/core/milter-event-loop.h>
+#include <milter/core/milter-decoder.h>
 
 G_BEGIN_DECLS
 
@@ -48,6 +49,10 @@ typedef enum
 typedef struct _MilterReader         MilterReader;
 typedef struct _MilterReaderClass    MilterReaderClass;
 
+typedef void (*MilterReaderDecodeErrorFunction) (MilterReader *reader,
+                                                 GError       *error,
+                                                 gpointer      user_data);
+
 struct _MilterReader
 {
     GObject object;
@@ -67,6 +72,14 @@ GQuark           milter_reader_error_quark    (void);
 GType            milter_reader_get_type       (void) G_GNUC_CONST;
 
 MilterReader    *milter_reader_io_channel_new (GIOChannel       *channel);
+MilterReader    *milter_reader_socket_io_channel_new
+                                              (GIOChannel       *channel);
+
+void             milter_reader_set_decoder    (MilterReader     *reader,
+                                               MilterDecoder    *decoder,
+                                               MilterReaderDecodeErrorFunction
+                                                                 decode_error_func,
+                                               gpointer          user_data);
 
 void             milter_reader_start          (MilterReader     *reader,
                                                MilterEventLoop  *loop);
@@ -448,6 +448,37 @@ milter_reply_encoder_encode_replace_body (MilterReplyEncoder *encoder,
     milter_encoder_pack(base_encoder, packet, packet_size);
 }
 
+void
+milter_reply_encoder_encode_replace_body_scattered (MilterReplyEncoder *encoder,
+                                                    const gchar **header,
+                                                    gsize *header_size,
+                                                    const gchar *body,
+                                                    gsize body_size,
+                                                    gsize *packed_size)
+{
+    MilterEncoder *base_encoder;
+    GString *buffer;
+
+    if (body_size <= 0 || (body == NULL && body_size > 0)) {
+        *header = NULL;
+        *header_size = 0;
+        *packed_size = 0;
+        return;
+    }
+
+    base_encoder = MILTER_ENCODER(encoder);
+    milter_encoder_clear_buffer(base_encoder);
+    buffer = milter_encoder_get_buffer(base_encoder);
+
+    g_string_append_c(buffer, MILTER_REPLY_REPLACE_BODY);
+    if (body_size > MILTER_CHUNK_SIZE)
+        *packed_size = MILTER_CHUNK_SIZE;
+    else
+        *packed_size = body_size;
+    milter_encoder_pack_scattered(base_encoder, header, header_size,
+                                  *packed_size);
+}
+
 void
 milter_reply_encoder_encode_progress (MilterReplyEncoder *encoder,
                                       const gchar **packet,
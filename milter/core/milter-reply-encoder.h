@@ -137,6 +137,13 @@ void             milter_reply_encoder_encode_replace_body
                                                 const gchar        *body,
                                                 gsize               body_size,
                                                 gsize              *packed_size);
+void             milter_reply_encoder_encode_replace_body_scattered
+                                               (MilterReplyEncoder *encoder,
+                                                const gchar       **header,
+                                                gsize              *header_size,
+                                                const gchar        *body,
+                                                gsize               body_size,
+                                                gsize              *packed_size);
 void             milter_reply_encoder_encode_progress
                                                (MilterReplyEncoder *encoder,
                                                 const gchar       **packet,
@@ -24,6 +24,7 @@
 #include <syslog.h>
 
 #include "milter-syslog-logger.h"
+#include "milter-core-internal.h"
 
 #define INTERESTING_LEVEL_KEY "syslog"
 
@@ -137,6 +138,7 @@ cb_log (MilterLogger *logger, const gchar *domain,
 {
     MilterSyslogLoggerPrivate *priv = user_data;
     GString *log;
+    gchar *line;
     gint syslog_level;
     MilterLogLevelFlags target_level;
 
@@ -155,9 +157,11 @@ cb_log (MilterLogger *logger, const gchar *domain,
     g_string_append(log, message);
 
     syslog_level = milter_log_level_to_syslog_level(level);
-    syslog(syslog_level, "%s", log->str);
-
-    g_string_free(log, TRUE);
+    line = g_string_free(log, FALSE);
+    if (!milter_logger_internal_write_async(logger, syslog_level, line)) {
+        syslog(syslog_level, "%s", line);
+        g_free(line);
+    }
 }
 
 static gint
@@ -293,6 +297,10 @@ dispose (GObject *object)
 
     priv = MILTER_SYSLOG_LOGGER_GET_PRIVATE(object);
 
+    /* openlog() doesn't copy the identity. */
+    if (priv->logger)
+        milter_logger_flush(priv->logger);
+
     if (priv->identity) {
         g_free(priv->identity);
         priv->identity = NULL;
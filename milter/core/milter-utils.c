@@ -921,6 +921,43 @@ milter_utils_parse_file_mode (const gchar *string,
     return success;
 }
 
+static void
+disconnect_signal_handlers_by_type (gpointer instance, GType type)
+{
+    guint *signal_ids;
+    guint i, n_signal_ids;
+
+    signal_ids = g_signal_list_ids(type, &n_signal_ids);
+    for (i = 0; i < n_signal_ids; i++) {
+        g_signal_handlers_disconnect_matched(instance,
+                                             G_SIGNAL_MATCH_ID,
+                                             signal_ids[i],
+                                             0, NULL, NULL, NULL);
+    }
+    g_free(signal_ids);
+}
+
+void
+milter_utils_disconnect_all_signal_handlers (gpointer instance)
+{
+    GType type;
+
+    for (type = G_TYPE_FROM_INSTANCE(instance);
+         type != 0;
+         type = g_type_parent(type)) {
+        GType *interfaces;
+        guint i, n_interfaces;
+
+        disconnect_signal_handlers_by_type(instance, type);
+
+        interfaces = g_type_interfaces(type, &n_interfaces);
+        for (i = 0; i < n_interfaces; i++) {
+            disconnect_signal_handlers_by_type(instance, interfaces[i]);
+        }
+        g_free(interfaces);
+    }
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
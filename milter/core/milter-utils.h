@@ -159,6 +159,9 @@ gboolean         milter_utils_parse_file_mode(const gchar  *string,
                                               guint        *mode,
                                               gchar       **error_message);
 
+void             milter_utils_disconnect_all_signal_handlers
+                                             (gpointer instance);
+
 typedef enum {
     MILTER_UTILS_READ_PIPE,
     MILTER_UTILS_WRITE_PIPE
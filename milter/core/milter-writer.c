@@ -23,6 +23,10 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/uio.h>
 
 #include <glib.h>
 
@@ -35,6 +39,16 @@
                                  MILTER_TYPE_WRITER,    \
                                  MilterWriterPrivate))
 
+#define MAX_IO_VECTORS 64
+
+typedef struct _WriteChunk WriteChunk;
+struct _WriteChunk
+{
+    gsize size;
+    gsize offset;
+    gchar data[1];
+};
+
 typedef struct _MilterWriterPrivate	MilterWriterPrivate;
 struct _MilterWriterPrivate
 {
@@ -47,6 +61,10 @@ struct _MilterWriterPrivate
     guint flush_watch_id;
     guint error_watch_id;
     guint tag;
+    gboolean use_writev;
+    GQueue *chunks;
+    gsize n_queued_bytes;
+    gboolean write_watch_suspended;
 };
 
 enum
@@ -140,6 +158,29 @@ milter_writer_init (MilterWriter *writer)
     priv->flush_watch_id = 0;
     priv->error_watch_id = 0;
     priv->tag = 0;
+    priv->use_writev = FALSE;
+    priv->chunks = g_queue_new();
+    priv->n_queued_bytes = 0;
+    priv->write_watch_suspended = FALSE;
+}
+
+static WriteChunk *
+write_chunk_new (const gchar *data, gsize size)
+{
+    WriteChunk *chunk;
+
+    chunk = g_malloc(G_STRUCT_OFFSET(WriteChunk, data) + size);
+    chunk->size = size;
+    chunk->offset = 0;
+    memcpy(chunk->data, data, size);
+
+    return chunk;
+}
+
+static void
+write_chunk_free (gpointer data, gpointer user_data)
+{
+    g_free(data);
 }
 
 static void
@@ -149,6 +190,7 @@ clear_write_watch_id (MilterWriterPrivate *priv)
         milter_event_loop_remove(priv->loop, priv->write_watch_id);
         priv->write_watch_id = 0;
     }
+    priv->write_watch_suspended = FALSE;
 }
 
 static void
@@ -203,6 +245,18 @@ dispose (GObject *object)
         priv->buffer = NULL;
     }
 
+    if (priv->chunks) {
+        if (priv->n_queued_bytes > 0) {
+            milter_debug("[%u] [writer][dispose][chunks][unwritten] "
+                         "<%" G_GSIZE_FORMAT ">",
+                         priv->tag, priv->n_queued_bytes);
+        }
+        g_queue_foreach(priv->chunks, write_chunk_free, NULL);
+        g_queue_free(priv->chunks);
+        priv->chunks = NULL;
+        priv->n_queued_bytes = 0;
+    }
+
     G_OBJECT_CLASS(milter_writer_parent_class)->dispose(object);
 }
 
@@ -423,14 +477,267 @@ write_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
     return keep_callback;
 }
 
-gboolean
-milter_writer_write (MilterWriter *writer, const gchar *chunk, gsize chunk_size,
-                     GError **error)
+static void
+set_errno_error (GError **error, gint error_number, const gchar *message)
+{
+    GError *sub_error;
+
+    sub_error = g_error_new(G_IO_CHANNEL_ERROR,
+                            g_io_channel_error_from_errno(error_number),
+                            "%s", g_strerror(error_number));
+    milter_utils_set_error_with_sub_error(error,
+                                          MILTER_WRITER_ERROR,
+                                          MILTER_WRITER_ERROR_IO_ERROR,
+                                          sub_error,
+                                          "%s", message);
+}
+
+static void
+consume_written_size (MilterWriter *writer, gsize written_size)
+{
+    MilterWriterPrivate *priv;
+
+    priv = MILTER_WRITER_GET_PRIVATE(writer);
+
+    priv->n_queued_bytes -= written_size;
+    while (written_size > 0) {
+        WriteChunk *chunk;
+        gsize rest_size;
+
+        chunk = g_queue_peek_head(priv->chunks);
+        rest_size = chunk->size - chunk->offset;
+        if (written_size < rest_size) {
+            chunk->offset += written_size;
+            break;
+        }
+        written_size -= rest_size;
+        g_queue_pop_head(priv->chunks);
+        g_free(chunk);
+    }
+}
+
+/*
+ * Writes queued chunks with writev() until the socket would block
+ * or the queue is drained. Returns FALSE only on a real I/O error.
+ */
+static gboolean
+write_queued_chunks (MilterWriter *writer, GError **error)
+{
+    MilterWriterPrivate *priv;
+    gint fd;
+
+    priv = MILTER_WRITER_GET_PRIVATE(writer);
+    fd = g_io_channel_unix_get_fd(priv->io_channel);
+
+    while (priv->n_queued_bytes > 0) {
+        struct iovec vectors[MAX_IO_VECTORS];
+        GList *node;
+        gint n_vectors = 0;
+        gssize written_size;
+
+        for (node = g_queue_peek_head_link(priv->chunks);
+             node && n_vectors < MAX_IO_VECTORS;
+             node = g_list_next(node)) {
+            WriteChunk *chunk = node->data;
+
+            vectors[n_vectors].iov_base = chunk->data + chunk->offset;
+            vectors[n_vectors].iov_len = chunk->size - chunk->offset;
+            n_vectors++;
+        }
+
+        priv->writing = TRUE;
+        do {
+            written_size = writev(fd, vectors, n_vectors);
+        } while (written_size == -1 && errno == EINTR);
+        priv->writing = FALSE;
+
+        if (written_size == -1) {
+            gint write_errno = errno;
+
+            if (write_errno == EAGAIN || write_errno == EWOULDBLOCK) {
+                milter_trace("[%u] [writer][writev][again] "
+                             "rest: <%" G_GSIZE_FORMAT ">",
+                             priv->tag, priv->n_queued_bytes);
+                break;
+            }
+            set_errno_error(error, write_errno, "failed to write");
+            return FALSE;
+        }
+
+        consume_written_size(writer, written_size);
+        milter_trace("[%u] [writer][writev][wrote] "
+                     "written: <%" G_GSSIZE_FORMAT "> "
+                     "rest: <%" G_GSIZE_FORMAT ">",
+                     priv->tag, written_size, priv->n_queued_bytes);
+
+        if (priv->flush_point > 0) {
+            if (priv->flush_point <= (gsize)written_size) {
+                priv->flush_point = 0;
+                g_signal_emit(writer, signals[FLUSHED], 0);
+            } else {
+                priv->flush_point -= written_size;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+static void
+emit_write_error (MilterWriter *writer, GError *error)
+{
+    MilterWriterPrivate *priv;
+
+    priv = MILTER_WRITER_GET_PRIVATE(writer);
+    milter_error("[%u] [writer][writev][error] %s",
+                 priv->tag, error->message);
+    milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(writer), error);
+}
+
+static gboolean
+writev_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
+{
+    MilterWriter *writer = data;
+    MilterWriterPrivate *priv;
+    GError *error = NULL;
+
+    priv = MILTER_WRITER_GET_PRIVATE(writer);
+
+    milter_trace("[%u] [writer][writev-callback] [%u] "
+                 "queued: <%" G_GSIZE_FORMAT ">",
+                 priv->tag, priv->write_watch_id, priv->n_queued_bytes);
+
+    if (!write_queued_chunks(writer, &error)) {
+        emit_write_error(writer, error);
+        g_error_free(error);
+        priv->write_watch_id = 0;
+        priv->write_watch_suspended = FALSE;
+        return FALSE;
+    }
+
+    if (priv->n_queued_bytes > 0)
+        return TRUE;
+
+    if (milter_event_loop_suspend(priv->loop, priv->write_watch_id)) {
+        milter_trace("[%u] [writer][writev-callback][suspend] [%u]",
+                     priv->tag, priv->write_watch_id);
+        priv->write_watch_suspended = TRUE;
+        return TRUE;
+    }
+
+    milter_trace("[%u] [writer][writev-callback][finish] [%u]",
+                 priv->tag, priv->write_watch_id);
+    priv->write_watch_id = 0;
+    return FALSE;
+}
+
+static void
+arm_writev_watch (MilterWriter *writer)
 {
     MilterWriterPrivate *priv;
 
     priv = MILTER_WRITER_GET_PRIVATE(writer);
 
+    if (priv->write_watch_id == 0) {
+        priv->write_watch_id =
+            milter_event_loop_watch_io(priv->loop,
+                                       priv->io_channel,
+                                       G_IO_OUT,
+                                       writev_watch_func, writer);
+        priv->write_watch_suspended = FALSE;
+        milter_trace("[%u] [writer][writev-callback][registered] [%u]",
+                     priv->tag, priv->write_watch_id);
+    } else if (priv->write_watch_suspended) {
+        milter_event_loop_resume(priv->loop, priv->write_watch_id);
+        priv->write_watch_suspended = FALSE;
+        milter_trace("[%u] [writer][writev-callback][resume] [%u]",
+                     priv->tag, priv->write_watch_id);
+    }
+}
+
+static gboolean
+writev_vectors (MilterWriter *writer,
+                const struct iovec *vectors, guint n_vectors, gsize total_size,
+                GError **error)
+{
+    MilterWriterPrivate *priv;
+    gsize written_size = 0;
+    guint i;
+
+    priv = MILTER_WRITER_GET_PRIVATE(writer);
+
+    if (priv->n_queued_bytes == 0) {
+        gssize size;
+        gint fd;
+
+        fd = g_io_channel_unix_get_fd(priv->io_channel);
+        do {
+            size = writev(fd, vectors, n_vectors);
+        } while (size == -1 && errno == EINTR);
+
+        if (size == -1) {
+            gint write_errno = errno;
+
+            if (write_errno != EAGAIN && write_errno != EWOULDBLOCK) {
+                milter_error("[%u] [writer][write][error] %s",
+                             priv->tag, g_strerror(write_errno));
+                set_errno_error(error, write_errno, "failed to write");
+                return FALSE;
+            }
+        } else {
+            written_size = size;
+        }
+        milter_trace("[%u] [writer][write][immediate] "
+                     "written: <%" G_GSIZE_FORMAT "/%" G_GSIZE_FORMAT ">",
+                     priv->tag, written_size, total_size);
+        if (written_size == total_size)
+            return TRUE;
+    }
+
+    for (i = 0; i < n_vectors; i++) {
+        const gchar *data = vectors[i].iov_base;
+        gsize size = vectors[i].iov_len;
+
+        if (written_size >= size) {
+            written_size -= size;
+            continue;
+        }
+        g_queue_push_tail(priv->chunks,
+                          write_chunk_new(data + written_size,
+                                          size - written_size));
+        priv->n_queued_bytes += size - written_size;
+        written_size = 0;
+    }
+    arm_writev_watch(writer);
+
+    return TRUE;
+}
+
+static void
+append_to_buffer (MilterWriter *writer, const gchar *chunk, gsize chunk_size)
+{
+    MilterWriterPrivate *priv;
+
+    priv = MILTER_WRITER_GET_PRIVATE(writer);
+
+    g_string_append_len(priv->buffer, chunk, chunk_size);
+    if (priv->write_watch_id == 0) {
+        priv->write_watch_id =
+            milter_event_loop_watch_io(priv->loop,
+                                       priv->io_channel,
+                                       G_IO_OUT,
+                                       write_watch_func, writer);
+        milter_trace("[%u] [writer][write-callback][registered] [%u]",
+                     priv->tag, priv->write_watch_id);
+    } else {
+        milter_trace("[%u] [writer][write-callback][register][reuse] [%u]",
+                     priv->tag, priv->write_watch_id);
+    }
+}
+
+static gboolean
+validate_writable (MilterWriterPrivate *priv, GError **error)
+{
     if (!priv->io_channel) {
         const gchar *message = "no write channel";
         g_set_error(error,
@@ -451,6 +758,20 @@ milter_writer_write (MilterWriter *writer, const gchar *chunk, gsize chunk_size,
         return FALSE;
     }
 
+    return TRUE;
+}
+
+gboolean
+milter_writer_write (MilterWriter *writer, const gchar *chunk, gsize chunk_size,
+                     GError **error)
+{
+    MilterWriterPrivate *priv;
+
+    priv = MILTER_WRITER_GET_PRIVATE(writer);
+
+    if (!validate_writable(priv, error))
+        return FALSE;
+
     if (chunk_size == 0) {
         milter_debug("[%u] [writer][write][empty] "
                      "ignore empty chunk write request",
@@ -458,18 +779,49 @@ milter_writer_write (MilterWriter *writer, const gchar *chunk, gsize chunk_size,
         return TRUE;
     }
 
-    g_string_append_len(priv->buffer, chunk, chunk_size);
-    if (priv->write_watch_id == 0) {
-        priv->write_watch_id =
-            milter_event_loop_watch_io(priv->loop,
-                                       priv->io_channel,
-                                       G_IO_OUT,
-                                       write_watch_func, writer);
-        milter_trace("[%u] [writer][write-callback][registered] [%u]",
-                     priv->tag, priv->write_watch_id);
-    } else {
-        milter_trace("[%u] [writer][write-callback][register][reuse] [%u]",
-                     priv->tag, priv->write_watch_id);
+    if (priv->use_writev) {
+        struct iovec vector;
+
+        vector.iov_base = (gchar *)chunk;
+        vector.iov_len = chunk_size;
+        return writev_vectors(writer, &vector, 1, chunk_size, error);
+    }
+
+    append_to_buffer(writer, chunk, chunk_size);
+
+    return TRUE;
+}
+
+gboolean
+milter_writer_write_vectors (MilterWriter *writer,
+                             const struct iovec *vectors, guint n_vectors,
+                             GError **error)
+{
+    MilterWriterPrivate *priv;
+    gsize total_size = 0;
+    guint i;
+
+    priv = MILTER_WRITER_GET_PRIVATE(writer);
+
+    if (!validate_writable(priv, error))
+        return FALSE;
+
+    for (i = 0; i < n_vectors; i++) {
+        total_size += vectors[i].iov_len;
+    }
+    if (total_size == 0) {
+        milter_debug("[%u] [writer][write-vectors][empty] "
+                     "ignore empty chunks write request",
+                     priv->tag);
+        return TRUE;
+    }
+
+    if (priv->use_writev)
+        return writev_vectors(writer, vectors, n_vectors, total_size, error);
+
+    for (i = 0; i < n_vectors; i++) {
+        if (vectors[i].iov_len > 0)
+            append_to_buffer(writer, vectors[i].iov_base, vectors[i].iov_len);
     }
 
     return TRUE;
@@ -502,7 +854,21 @@ milter_writer_flush (MilterWriter *writer, GError **error)
         return FALSE;
     }
 
-    if (priv->write_watch_id > 0) {
+    if (priv->use_writev) {
+        if (priv->n_queued_bytes > 0) {
+            priv->flush_point = priv->n_queued_bytes;
+            milter_trace("[%u] [writer][flush][flush-point][set] [%u] "
+                         "<%" G_GSIZE_FORMAT ">",
+                         priv->tag,
+                         priv->write_watch_id,
+                         priv->flush_point);
+        } else {
+            /* Emit "flushed" from the event loop like the buffered
+             * mode. Emitting it here means the caller receives it
+             * before it returns from writing. */
+            request_flush(writer);
+        }
+    } else if (priv->write_watch_id > 0) {
         priv->flush_point = priv->buffer->len;
         milter_trace("[%u] [writer][flush][flush-point][set] [%u] "
                      "<%" G_GSIZE_FORMAT ">",
@@ -592,6 +958,31 @@ milter_writer_is_watching (MilterWriter *writer)
     return MILTER_WRITER_GET_PRIVATE(writer)->error_watch_id > 0;
 }
 
+static void
+flush_chunks_on_shutdown (MilterWriter *writer)
+{
+    MilterWriterPrivate *priv;
+    GError *error = NULL;
+
+    priv = MILTER_WRITER_GET_PRIVATE(writer);
+
+    milter_trace("[%u] [writer][shutdown][flush-chunks] "
+                 "<%" G_GSIZE_FORMAT ">",
+                 priv->tag, priv->n_queued_bytes);
+
+    if (priv->n_queued_bytes == 0 || priv->writing)
+        return;
+
+    if (!write_queued_chunks(writer, &error)) {
+        emit_write_error(writer, error);
+        g_error_free(error);
+    } else if (priv->n_queued_bytes > 0) {
+        milter_trace("[%u] [writer][shutdown][flush-chunks][unwritten] "
+                     "rest: <%" G_GSIZE_FORMAT ">",
+                     priv->tag, priv->n_queued_bytes);
+    }
+}
+
 static void
 flush_buffer_on_shutdown (MilterWriter *writer)
 {
@@ -688,13 +1079,42 @@ milter_writer_shutdown (MilterWriter *writer)
     clear_watch_id(priv);
 
     if (priv->io_channel) {
-        flush_buffer_on_shutdown(writer);
+        if (priv->use_writev)
+            flush_chunks_on_shutdown(writer);
+        else
+            flush_buffer_on_shutdown(writer);
         milter_trace("[%u] [writer][shutdown][unref]", priv->tag);
         g_io_channel_unref(priv->io_channel);
         priv->io_channel = NULL;
     }
 }
 
+void
+milter_writer_set_use_writev (MilterWriter *writer, gboolean use_writev)
+{
+    MilterWriterPrivate *priv;
+
+    priv = MILTER_WRITER_GET_PRIVATE(writer);
+    if (priv->use_writev == use_writev)
+        return;
+
+    if (priv->buffer->len > 0 || priv->n_queued_bytes > 0) {
+        milter_error("[%u] [writer][use-writev][error] "
+                     "can't change write mode with unwritten data",
+                     priv->tag);
+        return;
+    }
+
+    clear_write_watch_id(priv);
+    priv->use_writev = use_writev;
+}
+
+gboolean
+milter_writer_get_use_writev (MilterWriter *writer)
+{
+    return MILTER_WRITER_GET_PRIVATE(writer)->use_writev;
+}
+
 guint
 milter_writer_get_tag (MilterWriter *writer)
 {
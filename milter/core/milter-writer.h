@@ -20,6 +20,9 @@
 #ifndef __MILTER_WRITER_H__
 #define __MILTER_WRITER_H__
 
+#include <sys/types.h>
+#include <sys/uio.h>
+
 #include <glib-object.h>
 
 #include <milter/core/milter-protocol.h>
@@ -69,6 +72,10 @@ gboolean         milter_writer_write          (MilterWriter     *writer,
                                                const gchar      *chunk,
                                                gsize             chunk_size,
                                                GError          **error);
+gboolean         milter_writer_write_vectors  (MilterWriter     *writer,
+                                               const struct iovec *vectors,
+                                               guint             n_vectors,
+                                               GError          **error);
 gboolean         milter_writer_flush          (MilterWriter     *writer,
                                                GError          **error);
 
@@ -77,6 +84,10 @@ void             milter_writer_start          (MilterWriter     *writer,
 gboolean         milter_writer_is_watching    (MilterWriter     *writer);
 void             milter_writer_shutdown       (MilterWriter     *writer);
 
+void             milter_writer_set_use_writev (MilterWriter     *writer,
+                                               gboolean          use_writev);
+gboolean         milter_writer_get_use_writev (MilterWriter     *writer);
+
 guint            milter_writer_get_tag        (MilterWriter     *writer);
 void             milter_writer_set_tag        (MilterWriter     *writer,
                                                guint             tag);
@@ -25,6 +25,13 @@
 #include <milter/manager/milter-manager-child.h>
 #include <milter/manager/milter-manager-children.h>
 #include <milter/manager/milter-manager-egg.h>
+#include <milter/manager/milter-manager-connection-pool.h>
+#include <milter/manager/milter-manager-body-spool.h>
+#include <milter/manager/milter-manager-cidr-table.h>
+#include <milter/manager/milter-manager-regexp-set.h>
+#include <milter/manager/milter-manager-tcp-connection-table.h>
+#include <milter/manager/milter-manager-statistics.h>
+#include <milter/manager/milter-manager-result-stream.h>
 #include <milter/manager/milter-manager-control-command-decoder.h>
 #include <milter/manager/milter-manager-control-reply-decoder.h>
 #include <milter/manager/milter-manager-control-command-encoder.h>
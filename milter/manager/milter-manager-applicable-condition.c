@@ -21,6 +21,8 @@
 #  include "../../config.h"
 #endif /* HAVE_CONFIG_H */
 
+#include <string.h>
+
 #include "milter-manager-applicable-condition.h"
 #include "milter-manager-enum-types.h"
 #include <milter/core/milter-marshalers.h>
@@ -30,12 +32,25 @@
                                  MILTER_TYPE_MANAGER_APPLICABLE_CONDITION, \
                                  MilterManagerApplicableConditionPrivate))
 
+typedef struct _Stopper Stopper;
+struct _Stopper
+{
+    MilterManagerApplicableConditionStopperFunc func;
+    gpointer user_data;
+    GDestroyNotify destroy;
+    guint n_calls;
+    gdouble elapsed;
+};
+
 typedef struct _MilterManagerApplicableConditionPrivate MilterManagerApplicableConditionPrivate;
 struct _MilterManagerApplicableConditionPrivate
 {
     gchar *name;
     gchar *description;
     gchar *data;
+    Stopper stoppers[MILTER_MANAGER_APPLICABLE_CONDITION_N_STAGES];
+    guint n_stoppers;
+    GTimer *stopper_timer;
 };
 
 enum
@@ -67,6 +82,10 @@ static void get_property   (GObject         *object,
                             guint            prop_id,
                             GValue          *value,
                             GParamSpec      *pspec);
+static void attach_to      (MilterManagerApplicableCondition *condition,
+                            MilterManagerChild               *child,
+                            MilterManagerChildren            *children,
+                            MilterClientContext              *context);
 
 static void
 milter_manager_applicable_condition_class_init (MilterManagerApplicableConditionClass *klass)
@@ -80,6 +99,8 @@ milter_manager_applicable_condition_class_init (MilterManagerApplicableCondition
     gobject_class->set_property = set_property;
     gobject_class->get_property = get_property;
 
+    klass->attach_to = attach_to;
+
     spec = g_param_spec_string("name",
                                "Name",
                                "The name of the applicable condition",
@@ -127,6 +148,19 @@ milter_manager_applicable_condition_init (MilterManagerApplicableCondition *appl
     priv->name = NULL;
     priv->description = NULL;
     priv->data = NULL;
+    memset(priv->stoppers, 0, sizeof(priv->stoppers));
+    priv->n_stoppers = 0;
+    priv->stopper_timer = NULL;
+}
+
+static void
+stopper_clear (Stopper *stopper)
+{
+    if (stopper->destroy)
+        stopper->destroy(stopper->user_data);
+    stopper->func = NULL;
+    stopper->user_data = NULL;
+    stopper->destroy = NULL;
 }
 
 static void
@@ -151,6 +185,20 @@ dispose (GObject *object)
         priv->data = NULL;
     }
 
+    if (priv->n_stoppers > 0) {
+        guint i;
+
+        for (i = 0; i < MILTER_MANAGER_APPLICABLE_CONDITION_N_STAGES; i++) {
+            stopper_clear(&(priv->stoppers[i]));
+        }
+        priv->n_stoppers = 0;
+    }
+
+    if (priv->stopper_timer) {
+        g_timer_destroy(priv->stopper_timer);
+        priv->stopper_timer = NULL;
+    }
+
     G_OBJECT_CLASS(milter_manager_applicable_condition_parent_class)->dispose(object);
 }
 
@@ -285,6 +333,28 @@ milter_manager_applicable_condition_merge (MilterManagerApplicableCondition *con
         milter_manager_applicable_condition_set_data(condition, data);
 }
 
+/*
+ * Stoppers are resolved once per configuration load. The
+ * child calls them from its class handlers of the
+ * "stop-on-*" signals, so no signal handler is connected
+ * per session.
+ */
+static void
+attach_to (MilterManagerApplicableCondition *condition,
+           MilterManagerChild               *child,
+           MilterManagerChildren            *children,
+           MilterClientContext              *context)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    if (priv->n_stoppers == 0)
+        return;
+
+    milter_manager_child_attach_applicable_condition(child, condition,
+                                                     children, context);
+}
+
 void
 milter_manager_applicable_condition_attach_to (MilterManagerApplicableCondition *condition,
                                                MilterManagerChild               *child,
@@ -294,6 +364,125 @@ milter_manager_applicable_condition_attach_to (MilterManagerApplicableCondition
     g_signal_emit(condition, signals[ATTACH_TO], 0, child, children, context);
 }
 
+void
+milter_manager_applicable_condition_set_stopper (MilterManagerApplicableCondition *condition,
+                                                 MilterManagerApplicableConditionStage stage,
+                                                 MilterManagerApplicableConditionStopperFunc stopper,
+                                                 gpointer user_data,
+                                                 GDestroyNotify destroy)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+    Stopper *target;
+
+    g_return_if_fail(stage < MILTER_MANAGER_APPLICABLE_CONDITION_N_STAGES);
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    target = &(priv->stoppers[stage]);
+    if (target->func)
+        priv->n_stoppers--;
+    stopper_clear(target);
+
+    target->func = stopper;
+    target->user_data = user_data;
+    target->destroy = destroy;
+    if (target->func)
+        priv->n_stoppers++;
+}
+
+gboolean
+milter_manager_applicable_condition_has_stopper (MilterManagerApplicableCondition *condition,
+                                                 MilterManagerApplicableConditionStage stage)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+
+    g_return_val_if_fail(stage < MILTER_MANAGER_APPLICABLE_CONDITION_N_STAGES,
+                         FALSE);
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    return priv->stoppers[stage].func != NULL;
+}
+
+gboolean
+milter_manager_applicable_condition_stop (MilterManagerApplicableCondition *condition,
+                                          MilterManagerApplicableConditionStage stage,
+                                          MilterManagerChild *child,
+                                          MilterManagerChildren *children,
+                                          MilterClientContext *context,
+                                          guint n_arguments,
+                                          const GValue *arguments)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+    Stopper *stopper;
+    gboolean stop;
+    gdouble elapsed;
+
+    g_return_val_if_fail(stage < MILTER_MANAGER_APPLICABLE_CONDITION_N_STAGES,
+                         FALSE);
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    stopper = &(priv->stoppers[stage]);
+    if (!stopper->func)
+        return FALSE;
+
+    if (priv->stopper_timer)
+        g_timer_start(priv->stopper_timer);
+    else
+        priv->stopper_timer = g_timer_new();
+    stop = stopper->func(condition, stage, child, children, context,
+                         n_arguments, arguments, stopper->user_data);
+    elapsed = g_timer_elapsed(priv->stopper_timer, NULL);
+
+    stopper->n_calls++;
+    stopper->elapsed += elapsed;
+    if (milter_need_debug_log()) {
+        gchar *stage_name;
+
+        stage_name = milter_utils_get_enum_nick_name(
+            MILTER_TYPE_MANAGER_APPLICABLE_CONDITION_STAGE, stage);
+        milter_debug("[applicable-condition][stop][%s][%s][%g] stop=<%s>",
+                     MILTER_LOG_NULL_SAFE_STRING(priv->name),
+                     stage_name,
+                     elapsed,
+                     stop ? "true" : "false");
+        g_free(stage_name);
+    }
+
+    return stop;
+}
+
+guint
+milter_manager_applicable_condition_get_n_stopper_calls (MilterManagerApplicableCondition *condition,
+                                                         MilterManagerApplicableConditionStage stage)
+{
+    g_return_val_if_fail(stage < MILTER_MANAGER_APPLICABLE_CONDITION_N_STAGES,
+                         0);
+
+    return MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition)->stoppers[stage].n_calls;
+}
+
+gdouble
+milter_manager_applicable_condition_get_stopper_elapsed (MilterManagerApplicableCondition *condition,
+                                                         MilterManagerApplicableConditionStage stage)
+{
+    g_return_val_if_fail(stage < MILTER_MANAGER_APPLICABLE_CONDITION_N_STAGES,
+                         0.0);
+
+    return MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition)->stoppers[stage].elapsed;
+}
+
+void
+milter_manager_applicable_condition_reset_stopper_statistics (MilterManagerApplicableCondition *condition)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+    guint i;
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    for (i = 0; i < MILTER_MANAGER_APPLICABLE_CONDITION_N_STAGES; i++) {
+        priv->stoppers[i].n_calls = 0;
+        priv->stoppers[i].elapsed = 0.0;
+    }
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -39,6 +39,36 @@ G_BEGIN_DECLS
 
 typedef struct _MilterManagerApplicableConditionClass    MilterManagerApplicableConditionClass;
 
+typedef enum
+{
+    MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_CONNECT,
+    MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_HELO,
+    MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_ENVELOPE_FROM,
+    MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_ENVELOPE_RECIPIENT,
+    MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_DATA,
+    MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_HEADER,
+    MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_END_OF_HEADER,
+    MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_BODY,
+    MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_END_OF_MESSAGE
+} MilterManagerApplicableConditionStage;
+
+#define MILTER_MANAGER_APPLICABLE_CONDITION_N_STAGES    \
+    (MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_END_OF_MESSAGE + 1)
+
+/*
+ * "arguments" are the arguments of the child's
+ * "stop-on-*" signal for "stage" without the child itself.
+ */
+typedef gboolean (*MilterManagerApplicableConditionStopperFunc)
+                                   (MilterManagerApplicableCondition      *condition,
+                                    MilterManagerApplicableConditionStage  stage,
+                                    MilterManagerChild                    *child,
+                                    MilterManagerChildren                 *children,
+                                    MilterClientContext                   *context,
+                                    guint                                  n_arguments,
+                                    const GValue                          *arguments,
+                                    gpointer                               user_data);
+
 struct _MilterManagerApplicableCondition
 {
     GObject object;
@@ -85,6 +115,33 @@ void         milter_manager_applicable_condition_attach_to
                                     MilterManagerChildren            *children,
                                     MilterClientContext              *context);
 
+void         milter_manager_applicable_condition_set_stopper
+                                   (MilterManagerApplicableCondition *condition,
+                                    MilterManagerApplicableConditionStage stage,
+                                    MilterManagerApplicableConditionStopperFunc stopper,
+                                    gpointer                          user_data,
+                                    GDestroyNotify                    destroy);
+gboolean     milter_manager_applicable_condition_has_stopper
+                                   (MilterManagerApplicableCondition *condition,
+                                    MilterManagerApplicableConditionStage stage);
+gboolean     milter_manager_applicable_condition_stop
+                                   (MilterManagerApplicableCondition *condition,
+                                    MilterManagerApplicableConditionStage stage,
+                                    MilterManagerChild               *child,
+                                    MilterManagerChildren            *children,
+                                    MilterClientContext              *context,
+                                    guint                             n_arguments,
+                                    const GValue                     *arguments);
+
+guint        milter_manager_applicable_condition_get_n_stopper_calls
+                                   (MilterManagerApplicableCondition *condition,
+                                    MilterManagerApplicableConditionStage stage);
+gdouble      milter_manager_applicable_condition_get_stopper_elapsed
+                                   (MilterManagerApplicableCondition *condition,
+                                    MilterManagerApplicableConditionStage stage);
+void         milter_manager_applicable_condition_reset_stopper_statistics
+                                   (MilterManagerApplicableCondition *condition);
+
 G_END_DECLS
 
 #endif /* __MILTER_MANAGER_APPLICABLE_CONDITION_H__ */
@@ -0,0 +1,310 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE /* for memfd_create() */
+#endif
+
+#ifdef HAVE_CONFIG_H
+#  include "../../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+
+#include <glib/gstdio.h>
+
+#include <milter/core.h>
+#include "milter-manager-body-spool.h"
+#include "milter-manager-statistics.h"
+
+#define MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(obj)                      \
+    (G_TYPE_INSTANCE_GET_PRIVATE((obj),                                 \
+                                 MILTER_TYPE_MANAGER_BODY_SPOOL,        \
+                                 MilterManagerBodySpoolPrivate))
+
+#define MIN_MEMORY_SIZE 4096
+
+/*
+ * A message body is written once and children read slices
+ * of it directly so that each child doesn't need its own
+ * copy or read. A body smaller than
+ * MILTER_MANAGER_BODY_SPOOL_MEMORY_SIZE is kept in a heap
+ * buffer because most bodies are small. A larger body is
+ * moved into a file that is mapped into memory. The file is
+ * a memfd if available, an unlinked temporary file
+ * otherwise. The spooled body is always followed by a NUL
+ * byte so that the data can't be read past the buffer even
+ * if it is treated as a string.
+ */
+typedef struct _MilterManagerBodySpoolPrivate MilterManagerBodySpoolPrivate;
+struct _MilterManagerBodySpoolPrivate
+{
+    gint fd;
+    gchar *data;
+    gsize size;
+    gsize capacity;
+};
+
+G_DEFINE_TYPE(MilterManagerBodySpool, milter_manager_body_spool, G_TYPE_OBJECT)
+
+static void dispose        (GObject         *object);
+static void finalize       (GObject         *object);
+
+static void
+milter_manager_body_spool_class_init (MilterManagerBodySpoolClass *klass)
+{
+    GObjectClass *gobject_class;
+
+    gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->dispose      = dispose;
+    gobject_class->finalize     = finalize;
+
+    g_type_class_add_private(gobject_class,
+                             sizeof(MilterManagerBodySpoolPrivate));
+}
+
+static void
+milter_manager_body_spool_init (MilterManagerBodySpool *spool)
+{
+    MilterManagerBodySpoolPrivate *priv;
+
+    priv = MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(spool);
+    priv->fd = -1;
+    priv->data = NULL;
+    priv->size = 0;
+    priv->capacity = 0;
+
+    milter_manager_statistics_body_spool_resize(1, 0, 0);
+}
+
+static void
+dispose (GObject *object)
+{
+    MilterManagerBodySpoolPrivate *priv;
+
+    priv = MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(object);
+
+    if (priv->data) {
+        if (priv->fd == -1)
+            g_free(priv->data);
+        else
+            munmap(priv->data, priv->capacity);
+        priv->data = NULL;
+    }
+    milter_manager_statistics_body_spool_resize(0,
+                                                -(gssize)priv->size,
+                                                -(gssize)priv->capacity);
+    priv->size = 0;
+    priv->capacity = 0;
+
+    if (priv->fd != -1) {
+        close(priv->fd);
+        priv->fd = -1;
+    }
+
+    G_OBJECT_CLASS(milter_manager_body_spool_parent_class)->dispose(object);
+}
+
+static void
+finalize (GObject *object)
+{
+    milter_manager_statistics_body_spool_resize(-1, 0, 0);
+
+    G_OBJECT_CLASS(milter_manager_body_spool_parent_class)->finalize(object);
+}
+
+MilterManagerBodySpool *
+milter_manager_body_spool_new (void)
+{
+    return g_object_new(MILTER_TYPE_MANAGER_BODY_SPOOL, NULL);
+}
+
+static void
+set_errno_error (GError **error, const gchar *context)
+{
+    gint saved_errno = errno;
+
+    g_set_error(error,
+                G_FILE_ERROR,
+                g_file_error_from_errno(saved_errno),
+                "failed to %s body spool: %s",
+                context, g_strerror(saved_errno));
+}
+
+static gboolean
+open_spool (MilterManagerBodySpoolPrivate *priv, GError **error)
+{
+    gchar *path = NULL;
+
+#ifdef HAVE_MEMFD_CREATE
+    priv->fd = memfd_create("milter-manager-body", MFD_CLOEXEC);
+    if (priv->fd != -1)
+        return TRUE;
+    milter_debug("[body-spool][memfd][fallback] %s", g_strerror(errno));
+#endif
+
+    priv->fd = g_file_open_tmp(NULL, &path, error);
+    if (priv->fd == -1)
+        return FALSE;
+    g_unlink(path);
+    g_free(path);
+
+    return TRUE;
+}
+
+static void
+reserve_memory (MilterManagerBodySpoolPrivate *priv, gsize needed_size)
+{
+    gsize new_capacity;
+
+    new_capacity = MAX(priv->capacity, MIN_MEMORY_SIZE);
+    while (new_capacity < needed_size)
+        new_capacity *= 2;
+    new_capacity = MIN(new_capacity, MILTER_MANAGER_BODY_SPOOL_MEMORY_SIZE);
+
+    priv->data = g_realloc(priv->data, new_capacity);
+    milter_manager_statistics_body_spool_resize(0, 0,
+                                                new_capacity - priv->capacity);
+    priv->capacity = new_capacity;
+}
+
+static gboolean
+reserve (MilterManagerBodySpoolPrivate *priv, gsize size, GError **error)
+{
+    gsize needed_size, new_capacity;
+    gchar *data;
+
+    needed_size = priv->size + size + 1;
+    if (needed_size <= priv->capacity)
+        return TRUE;
+
+    if (priv->fd == -1 &&
+        needed_size <= MILTER_MANAGER_BODY_SPOOL_MEMORY_SIZE) {
+        reserve_memory(priv, needed_size);
+        return TRUE;
+    }
+
+    new_capacity = needed_size + MILTER_MANAGER_BODY_SPOOL_EXTENT_SIZE - 1;
+    new_capacity -= new_capacity % MILTER_MANAGER_BODY_SPOOL_EXTENT_SIZE;
+
+    if (priv->fd == -1) {
+        if (!open_spool(priv, error))
+            return FALSE;
+        if (ftruncate(priv->fd, new_capacity) == -1) {
+            set_errno_error(error, "extend");
+            close(priv->fd);
+            priv->fd = -1;
+            return FALSE;
+        }
+        data = mmap(NULL, new_capacity, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    priv->fd, 0);
+        if (data == MAP_FAILED) {
+            set_errno_error(error, "map");
+            close(priv->fd);
+            priv->fd = -1;
+            return FALSE;
+        }
+        /* The body in the heap buffer is moved only once. */
+        if (priv->data) {
+            memcpy(data, priv->data, priv->size);
+            g_free(priv->data);
+        }
+        milter_manager_statistics_body_spool_resize(
+            0, 0, (gssize)new_capacity - (gssize)priv->capacity);
+        priv->data = data;
+        priv->capacity = new_capacity;
+        return TRUE;
+    }
+
+    if (ftruncate(priv->fd, new_capacity) == -1) {
+        set_errno_error(error, "extend");
+        return FALSE;
+    }
+
+    /* The old mapping is dropped without copying: the new
+     * one maps the same file so the written body is kept. */
+    if (priv->data) {
+        munmap(priv->data, priv->capacity);
+        milter_manager_statistics_body_spool_resize(0, 0,
+                                                    -(gssize)priv->capacity);
+        priv->data = NULL;
+        priv->capacity = 0;
+    }
+    data = mmap(NULL, new_capacity, PROT_READ | PROT_WRITE, MAP_SHARED,
+                priv->fd, 0);
+    if (data == MAP_FAILED) {
+        set_errno_error(error, "map");
+        return FALSE;
+    }
+    priv->data = data;
+    priv->capacity = new_capacity;
+    milter_manager_statistics_body_spool_resize(0, 0, new_capacity);
+
+    return TRUE;
+}
+
+gboolean
+milter_manager_body_spool_append (MilterManagerBodySpool *spool,
+                                  const gchar *chunk,
+                                  gsize size,
+                                  GError **error)
+{
+    MilterManagerBodySpoolPrivate *priv;
+
+    if (!chunk || size == 0)
+        return TRUE;
+
+    priv = MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(spool);
+    if (!reserve(priv, size, error))
+        return FALSE;
+
+    memcpy(priv->data + priv->size, chunk, size);
+    priv->size += size;
+    priv->data[priv->size] = '\0';
+    milter_manager_statistics_body_spool_resize(0, size, 0);
+
+    return TRUE;
+}
+
+const gchar *
+milter_manager_body_spool_get_data (MilterManagerBodySpool *spool)
+{
+    return MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(spool)->data;
+}
+
+gsize
+milter_manager_body_spool_get_size (MilterManagerBodySpool *spool)
+{
+    return MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(spool)->size;
+}
+
+gsize
+milter_manager_body_spool_get_capacity (MilterManagerBodySpool *spool)
+{
+    return MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(spool)->capacity;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
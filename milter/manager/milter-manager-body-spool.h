@@ -0,0 +1,75 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MANAGER_BODY_SPOOL_H__
+#define __MILTER_MANAGER_BODY_SPOOL_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define MILTER_MANAGER_BODY_SPOOL_EXTENT_SIZE 1048576 /* 1Mbyte */
+#define MILTER_MANAGER_BODY_SPOOL_MEMORY_SIZE 65536 /* 64Kbyte */
+
+#define MILTER_TYPE_MANAGER_BODY_SPOOL            (milter_manager_body_spool_get_type())
+#define MILTER_MANAGER_BODY_SPOOL(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), MILTER_TYPE_MANAGER_BODY_SPOOL, MilterManagerBodySpool))
+#define MILTER_MANAGER_BODY_SPOOL_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass), MILTER_TYPE_MANAGER_BODY_SPOOL, MilterManagerBodySpoolClass))
+#define MILTER_MANAGER_IS_BODY_SPOOL(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj), MILTER_TYPE_MANAGER_BODY_SPOOL))
+#define MILTER_MANAGER_IS_BODY_SPOOL_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), MILTER_TYPE_MANAGER_BODY_SPOOL))
+#define MILTER_MANAGER_BODY_SPOOL_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj), MILTER_TYPE_MANAGER_BODY_SPOOL, MilterManagerBodySpoolClass))
+
+typedef struct _MilterManagerBodySpool         MilterManagerBodySpool;
+typedef struct _MilterManagerBodySpoolClass    MilterManagerBodySpoolClass;
+
+struct _MilterManagerBodySpool
+{
+    GObject object;
+};
+
+struct _MilterManagerBodySpoolClass
+{
+    GObjectClass parent_class;
+};
+
+GType                   milter_manager_body_spool_get_type (void) G_GNUC_CONST;
+
+MilterManagerBodySpool *milter_manager_body_spool_new
+                                        (void);
+
+gboolean                milter_manager_body_spool_append
+                                        (MilterManagerBodySpool *spool,
+                                         const gchar *chunk,
+                                         gsize size,
+                                         GError **error);
+/* The returned data is valid until the next append and is
+ * NUL-terminated. */
+const gchar            *milter_manager_body_spool_get_data
+                                        (MilterManagerBodySpool *spool);
+gsize                   milter_manager_body_spool_get_size
+                                        (MilterManagerBodySpool *spool);
+gsize                   milter_manager_body_spool_get_capacity
+                                        (MilterManagerBodySpool *spool);
+
+G_END_DECLS
+
+#endif /* __MILTER_MANAGER_BODY_SPOOL_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -28,6 +28,7 @@
 #include <string.h>
 #include <errno.h>
 #include "milter-manager-child.h"
+#include "milter-manager-applicable-condition.h"
 
 #define MILTER_MANAGER_CHILD_GET_PRIVATE(obj)                    \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                          \
@@ -44,6 +45,29 @@ struct _MilterManagerChildPrivate
     gboolean search_path;
     MilterStatus fallback_status;
     gboolean evaluation_mode;
+    gboolean parallel;
+    GList *applicable_conditions;
+    MilterManagerChildren *children;
+    MilterClientContext *client_context;
+};
+
+static const struct {
+    const gchar *signal_name;
+    MilterManagerApplicableConditionStage stage;
+} stop_signals[] = {
+    {"stop-on-connect", MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_CONNECT},
+    {"stop-on-helo", MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_HELO},
+    {"stop-on-envelope-from",
+     MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_ENVELOPE_FROM},
+    {"stop-on-envelope-recipient",
+     MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_ENVELOPE_RECIPIENT},
+    {"stop-on-data", MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_DATA},
+    {"stop-on-header", MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_HEADER},
+    {"stop-on-end-of-header",
+     MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_END_OF_HEADER},
+    {"stop-on-body", MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_BODY},
+    {"stop-on-end-of-message",
+     MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_END_OF_MESSAGE}
 };
 
 enum
@@ -55,7 +79,8 @@ enum
     PROP_WORKING_DIRECTORY,
     PROP_SEARCH_PATH,
     PROP_FALLBACK_STATUS,
-    PROP_REPUTATION_MODE
+    PROP_REPUTATION_MODE,
+    PROP_PARALLEL
 };
 
 MILTER_DEFINE_ERROR_EMITTABLE_TYPE(MilterManagerChild,
@@ -71,12 +96,19 @@ static void get_property   (GObject         *object,
                             guint            prop_id,
                             GValue          *value,
                             GParamSpec      *pspec);
+static void marshal_stop   (GClosure        *closure,
+                            GValue          *return_value,
+                            guint            n_param_values,
+                            const GValue    *param_values,
+                            gpointer         invocation_hint,
+                            gpointer         marshal_data);
 
 static void
 milter_manager_child_class_init (MilterManagerChildClass *klass)
 {
     GObjectClass *gobject_class;
     GParamSpec *spec;
+    guint i;
 
     gobject_class = G_OBJECT_CLASS(klass);
 
@@ -135,6 +167,28 @@ milter_manager_child_class_init (MilterManagerChildClass *klass)
                                 G_PARAM_READWRITE);
     g_object_class_install_property(gobject_class, PROP_REPUTATION_MODE, spec);
 
+    spec = g_param_spec_boolean("parallel",
+                                "Parallel",
+                                "Whether the child is evaluated in parallel "
+                                "with other children or not",
+                                FALSE,
+                                G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_PARALLEL, spec);
+
+    for (i = 0; i < G_N_ELEMENTS(stop_signals); i++) {
+        GClosure *closure;
+        guint signal_id;
+
+        signal_id = g_signal_lookup(stop_signals[i].signal_name,
+                                    MILTER_TYPE_SERVER_CONTEXT);
+        closure = g_closure_new_simple(sizeof(GClosure),
+                                       GUINT_TO_POINTER(stop_signals[i].stage));
+        g_closure_set_marshal(closure, marshal_stop);
+        g_signal_override_class_closure(signal_id,
+                                        MILTER_TYPE_MANAGER_CHILD,
+                                        closure);
+    }
+
     g_type_class_add_private(gobject_class,
                              sizeof(MilterManagerChildPrivate));
 }
@@ -152,6 +206,23 @@ milter_manager_child_init (MilterManagerChild *milter)
     priv->search_path = TRUE;
     priv->fallback_status = MILTER_STATUS_ACCEPT;
     priv->evaluation_mode = FALSE;
+    priv->parallel = FALSE;
+    priv->applicable_conditions = NULL;
+    priv->children = NULL;
+    priv->client_context = NULL;
+}
+
+static void
+set_weak_object (GObject **slot, GObject *object)
+{
+    if (*slot == object)
+        return;
+
+    if (*slot)
+        g_object_remove_weak_pointer(*slot, (gpointer *)slot);
+    *slot = object;
+    if (*slot)
+        g_object_add_weak_pointer(*slot, (gpointer *)slot);
 }
 
 static void
@@ -181,6 +252,15 @@ dispose (GObject *object)
         priv->command_options = NULL;
     }
 
+    if (priv->applicable_conditions) {
+        g_list_foreach(priv->applicable_conditions, (GFunc)g_object_unref, NULL);
+        g_list_free(priv->applicable_conditions);
+        priv->applicable_conditions = NULL;
+    }
+
+    set_weak_object((GObject **)&(priv->children), NULL);
+    set_weak_object((GObject **)&(priv->client_context), NULL);
+
     G_OBJECT_CLASS(milter_manager_child_parent_class)->dispose(object);
 }
 
@@ -223,6 +303,9 @@ set_property (GObject      *object,
     case PROP_REPUTATION_MODE:
         priv->evaluation_mode = g_value_get_boolean(value);
         break;
+    case PROP_PARALLEL:
+        priv->parallel = g_value_get_boolean(value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -260,6 +343,9 @@ get_property (GObject    *object,
     case PROP_REPUTATION_MODE:
         g_value_set_boolean(value, priv->evaluation_mode);
         break;
+    case PROP_PARALLEL:
+        g_value_set_boolean(value, priv->parallel);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -332,6 +418,80 @@ milter_manager_child_is_evaluation_mode (MilterManagerChild *milter)
     return MILTER_MANAGER_CHILD_GET_PRIVATE(milter)->evaluation_mode;
 }
 
+void
+milter_manager_child_set_parallel (MilterManagerChild *milter,
+                                   gboolean parallel)
+{
+    MILTER_MANAGER_CHILD_GET_PRIVATE(milter)->parallel = parallel;
+}
+
+gboolean
+milter_manager_child_is_parallel (MilterManagerChild *milter)
+{
+    return MILTER_MANAGER_CHILD_GET_PRIVATE(milter)->parallel;
+}
+
+void
+milter_manager_child_attach_applicable_condition (MilterManagerChild *milter,
+                                                  MilterManagerApplicableCondition *condition,
+                                                  MilterManagerChildren *children,
+                                                  MilterClientContext *context)
+{
+    MilterManagerChildPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILD_GET_PRIVATE(milter);
+    g_object_ref(condition);
+    priv->applicable_conditions =
+        g_list_append(priv->applicable_conditions, condition);
+    set_weak_object((GObject **)&(priv->children), G_OBJECT(children));
+    set_weak_object((GObject **)&(priv->client_context), G_OBJECT(context));
+}
+
+/*
+ * The class handler of all "stop-on-*" signals. It asks
+ * attached applicable conditions in order and stops at
+ * the first one that says stop.
+ */
+static void
+marshal_stop (GClosure     *closure,
+              GValue       *return_value,
+              guint         n_param_values,
+              const GValue *param_values,
+              gpointer      invocation_hint,
+              gpointer      marshal_data)
+{
+    MilterManagerChild *milter;
+    MilterManagerChildPrivate *priv;
+    MilterManagerApplicableConditionStage stage;
+    GList *node;
+    gboolean stop = FALSE;
+
+    milter = MILTER_MANAGER_CHILD(g_value_get_object(&param_values[0]));
+    priv = MILTER_MANAGER_CHILD_GET_PRIVATE(milter);
+    stage = GPOINTER_TO_UINT(closure->data);
+
+    for (node = priv->applicable_conditions;
+         node && !stop;
+         node = g_list_next(node)) {
+        MilterManagerApplicableCondition *condition = node->data;
+
+        stop = milter_manager_applicable_condition_stop(condition,
+                                                        stage,
+                                                        milter,
+                                                        priv->children,
+                                                        priv->client_context,
+                                                        n_param_values - 1,
+                                                        param_values + 1);
+    }
+
+    if (stop) {
+        if (return_value)
+            g_value_set_boolean(return_value, TRUE);
+    } else {
+        g_signal_chain_from_overridden(param_values, return_value);
+    }
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
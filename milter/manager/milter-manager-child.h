@@ -26,6 +26,8 @@
 #include <glib-object.h>
 
 #include <milter/server.h>
+#include <milter/client.h>
+#include <milter/manager/milter-manager-objects.h>
 
 G_BEGIN_DECLS
 
@@ -82,6 +84,16 @@ void                  milter_manager_child_set_evaluation_mode
                                                         gboolean evaluation_mode);
 gboolean              milter_manager_child_is_evaluation_mode
                                                        (MilterManagerChild *milter);
+void                  milter_manager_child_set_parallel
+                                                       (MilterManagerChild *milter,
+                                                        gboolean parallel);
+gboolean              milter_manager_child_is_parallel
+                                                       (MilterManagerChild *milter);
+void                  milter_manager_child_attach_applicable_condition
+                                                       (MilterManagerChild *milter,
+                                                        MilterManagerApplicableCondition *condition,
+                                                        MilterManagerChildren *children,
+                                                        MilterClientContext *context);
 
 #endif /* __MILTER_MANAGER_CHILD_H__ */
 
@@ -23,12 +23,16 @@
 
 #include "milter-manager-children.h"
 
-#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
 #include "milter-manager-configuration.h"
 #include "milter/core.h"
 #include "milter-manager-launch-command-encoder.h"
-
-#define MAX_ON_MEMORY_BODY_SIZE 5242880 /* 5Mbyte */
+#include "milter-manager-body-spool.h"
+#include "milter-manager-statistics.h"
+#include "milter-manager-result-stream.h"
 
 #define MAX_SUPPORTED_MILTER_PROTOCOL_VERSION 6
 
@@ -86,9 +90,7 @@ struct _MilterManagerChildrenPrivate
     MilterHeaders *original_headers;
     MilterHeaders *headers;
     gint processing_header_index;
-    GString *body;
-    GIOChannel *body_file;
-    gchar *body_file_name;
+    MilterManagerBodySpool *body;
     gchar *end_of_message_chunk;
     gsize end_of_message_size;
     guint sending_body;
@@ -109,6 +111,65 @@ struct _MilterManagerChildrenPrivate
     MilterEventLoop *event_loop;
 
     guint lazy_reply_negotiate_id;
+
+    MilterOption *negotiate_option;
+    GList *reused_connections;
+    guint reuse_connections_id;
+
+    GHashTable *parallel_children;
+    MilterHeaders *parallel_headers;
+    MilterManagerBodySpool *parallel_body;
+
+    MilterEncoder *command_encoder;
+    GHashTable *header_packets;
+};
+
+/*
+ * A child in parallel mode doesn't join the command waiting
+ * child queue. It receives the message from the snapshot
+ * taken at end-of-message concurrently with other children.
+ */
+typedef struct _ParallelChild ParallelChild;
+struct _ParallelChild
+{
+    GList *commands;
+    gint header_index;
+    gsize body_offset;
+};
+
+/*
+ * Header packets are sent to children one by one. They
+ * are cached per header for the current message so that
+ * each header is encoded only once. The second packet is
+ * for children that need the leading space of the value
+ * removed.
+ */
+typedef struct _HeaderPackets HeaderPackets;
+struct _HeaderPackets
+{
+    gchar *name;
+    gchar *value;
+    MilterCommandPacket *packets[2];
+};
+
+typedef struct _ReusedConnection ReusedConnection;
+struct _ReusedConnection
+{
+    MilterManagerChild *child;
+    GIOChannel *channel;
+    MilterOption *reply_option;
+    MilterMacrosRequests *macros_requests;
+};
+
+typedef struct _PendingPooledConnection PendingPooledConnection;
+struct _PendingPooledConnection
+{
+    MilterManagerConnectionPool *pool;
+    MilterEventLoop *loop;
+    MilterServerContext *context;
+    MilterOption *option;
+    gulong state_transited_signal_id;
+    gulong error_signal_id;
 };
 
 typedef struct _NegotiateData NegotiateData;
@@ -201,6 +262,24 @@ static MilterStatus send_next_command
 static MilterStatus send_first_command_to_next_child
                            (MilterManagerChildren *children,
                             MilterServerContext *context);
+static gboolean is_parallel_child
+                           (MilterManagerChildren *children,
+                            MilterServerContext *context);
+static void send_next_command_to_parallel_child
+                           (MilterManagerChildren *children,
+                            MilterServerContext *context);
+static void skip_body_of_parallel_child
+                           (MilterManagerChildren *children,
+                            MilterServerContext *context);
+static gboolean finish_parallel_child
+                           (MilterManagerChildren *children,
+                            MilterServerContext *context,
+                            MilterStatus status);
+static void end_message_by_child
+                           (MilterManagerChildren *children,
+                            MilterServerContext *context,
+                            MilterServerContextState state,
+                            MilterStatus status);
 
 static NegotiateData *negotiate_data_new  (MilterManagerChildren *children,
                                            MilterManagerChild *child,
@@ -251,6 +330,41 @@ milter_manager_children_class_init (MilterManagerChildrenClass *klass)
                              sizeof(MilterManagerChildrenPrivate));
 }
 
+static void
+parallel_child_free (ParallelChild *parallel_child)
+{
+    g_list_free(parallel_child->commands);
+    g_free(parallel_child);
+}
+
+static HeaderPackets *
+header_packets_new (MilterHeader *header)
+{
+    HeaderPackets *header_packets;
+
+    header_packets = g_new(HeaderPackets, 1);
+    header_packets->name = g_strdup(header->name);
+    header_packets->value = g_strdup(header->value);
+    header_packets->packets[0] = NULL;
+    header_packets->packets[1] = NULL;
+
+    return header_packets;
+}
+
+static void
+header_packets_free (HeaderPackets *header_packets)
+{
+    gint i;
+
+    for (i = 0; i < 2; i++) {
+        if (header_packets->packets[i])
+            milter_command_packet_unref(header_packets->packets[i]);
+    }
+    g_free(header_packets->name);
+    g_free(header_packets->value);
+    g_free(header_packets);
+}
+
 static void
 milter_manager_children_init (MilterManagerChildren *milter)
 {
@@ -281,8 +395,6 @@ milter_manager_children_init (MilterManagerChildren *milter)
     priv->headers = NULL;
     priv->processing_header_index = 0;
     priv->body = NULL;
-    priv->body_file = NULL;
-    priv->body_file_name = NULL;
     priv->end_of_message_chunk = NULL;
     priv->end_of_message_size = 0;
     priv->sending_body = FALSE;
@@ -312,6 +424,21 @@ milter_manager_children_init (MilterManagerChildren *milter)
     priv->event_loop = NULL;
 
     priv->lazy_reply_negotiate_id = 0;
+
+    priv->negotiate_option = NULL;
+    priv->reused_connections = NULL;
+    priv->reuse_connections_id = 0;
+
+    priv->parallel_children =
+        g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                              NULL, (GDestroyNotify)parallel_child_free);
+    priv->parallel_headers = NULL;
+    priv->parallel_body = NULL;
+
+    priv->command_encoder = milter_command_encoder_new();
+    priv->header_packets =
+        g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                              NULL, (GDestroyNotify)header_packets_free);
 }
 
 static void
@@ -325,6 +452,34 @@ dispose_lazy_reply_negotiate_id (MilterManagerChildrenPrivate *priv)
     priv->lazy_reply_negotiate_id = 0;
 }
 
+static void
+reused_connection_free (ReusedConnection *connection)
+{
+    g_object_unref(connection->child);
+    g_io_channel_unref(connection->channel);
+    g_object_unref(connection->reply_option);
+    if (connection->macros_requests)
+        g_object_unref(connection->macros_requests);
+    g_free(connection);
+}
+
+static void
+dispose_reused_connections (MilterManagerChildrenPrivate *priv)
+{
+    if (priv->reuse_connections_id > 0) {
+        milter_event_loop_remove(priv->event_loop,
+                                 priv->reuse_connections_id);
+        priv->reuse_connections_id = 0;
+    }
+
+    if (priv->reused_connections) {
+        g_list_foreach(priv->reused_connections,
+                       (GFunc)reused_connection_free, NULL);
+        g_list_free(priv->reused_connections);
+        priv->reused_connections = NULL;
+    }
+}
+
 static PendingMessageRequest *
 pending_message_request_new (MilterCommand command)
 {
@@ -417,20 +572,9 @@ dispose_body_related_data (MilterManagerChildrenPrivate *priv)
     priv->emitted_reply_for_message_oriented_command = FALSE;
 
     if (priv->body) {
-        g_string_free(priv->body, TRUE);
+        g_object_unref(priv->body);
         priv->body = NULL;
     }
-
-    if (priv->body_file) {
-        g_io_channel_unref(priv->body_file);
-        priv->body_file = NULL;
-    }
-
-    if (priv->body_file_name) {
-        g_unlink(priv->body_file_name);
-        g_free(priv->body_file_name);
-        priv->body_file_name = NULL;
-    }
 }
 
 static void
@@ -449,10 +593,28 @@ dispose_reply_related_data (MilterManagerChildrenPrivate *priv)
     }
 }
 
+static void
+dispose_parallel_children (MilterManagerChildrenPrivate *priv)
+{
+    if (priv->parallel_children)
+        g_hash_table_remove_all(priv->parallel_children);
+
+    if (priv->parallel_headers) {
+        g_object_unref(priv->parallel_headers);
+        priv->parallel_headers = NULL;
+    }
+
+    if (priv->parallel_body) {
+        g_object_unref(priv->parallel_body);
+        priv->parallel_body = NULL;
+    }
+}
+
 static void
 dispose_message_related_data (MilterManagerChildrenPrivate *priv)
 {
     dispose_pending_message_request(priv);
+    dispose_parallel_children(priv);
 
     if (priv->command_waiting_child_queue) {
         g_list_free(priv->command_waiting_child_queue);
@@ -474,6 +636,9 @@ dispose_message_related_data (MilterManagerChildrenPrivate *priv)
         priv->headers = NULL;
     }
 
+    if (priv->header_packets)
+        g_hash_table_remove_all(priv->header_packets);
+
     dispose_body_related_data(priv);
 
     if (priv->end_of_message_chunk) {
@@ -517,6 +682,7 @@ dispose (GObject *object)
     milter_debug("[%u] [children][dispose]", priv->tag);
 
     dispose_lazy_reply_negotiate_id(priv);
+    dispose_reused_connections(priv);
 
     if (priv->reply_queue) {
         g_queue_free(priv->reply_queue);
@@ -553,6 +719,11 @@ dispose (GObject *object)
         priv->option = NULL;
     }
 
+    if (priv->negotiate_option) {
+        g_object_unref(priv->negotiate_option);
+        priv->negotiate_option = NULL;
+    }
+
     if (priv->reply_statuses) {
         g_hash_table_unref(priv->reply_statuses);
         priv->reply_statuses = NULL;
@@ -561,6 +732,21 @@ dispose (GObject *object)
     dispose_reply_related_data(priv);
     dispose_message_related_data(priv);
 
+    if (priv->parallel_children) {
+        g_hash_table_unref(priv->parallel_children);
+        priv->parallel_children = NULL;
+    }
+
+    if (priv->header_packets) {
+        g_hash_table_unref(priv->header_packets);
+        priv->header_packets = NULL;
+    }
+
+    if (priv->command_encoder) {
+        g_object_unref(priv->command_encoder);
+        priv->command_encoder = NULL;
+    }
+
     milter_manager_children_set_launcher_channel(MILTER_MANAGER_CHILDREN(object),
                                                  NULL, NULL);
 
@@ -657,6 +843,114 @@ milter_manager_children_new (MilterManagerConfiguration *configuration,
                         NULL);
 }
 
+/*
+ * Releases everything that belongs to the finished session
+ * but keeps the queue and hash tables so that a recycled
+ * leader can use @children for the next session without
+ * constructing a new object.
+ */
+void
+milter_manager_children_reset (MilterManagerChildren *children)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    milter_debug("[%u] [children][reset]", priv->tag);
+
+    milter_utils_disconnect_all_signal_handlers(children);
+
+    dispose_lazy_reply_negotiate_id(priv);
+    dispose_reused_connections(priv);
+
+    g_queue_clear(priv->reply_queue);
+    g_hash_table_remove_all(priv->try_negotiate_ids);
+
+    dispose_smtp_client_address(priv);
+
+    if (priv->configuration) {
+        g_object_unref(priv->configuration);
+        priv->configuration = NULL;
+    }
+
+    if (priv->milters) {
+        g_list_foreach(priv->milters,
+                       (GFunc)teardown_server_context_signals, children);
+        g_list_foreach(priv->milters, (GFunc)g_object_unref, NULL);
+        g_list_free(priv->milters);
+        priv->milters = NULL;
+    }
+
+    g_object_unref(priv->macros_requests);
+    priv->macros_requests = milter_macros_requests_new();
+
+    if (priv->option) {
+        g_object_unref(priv->option);
+        priv->option = NULL;
+    }
+
+    if (priv->negotiate_option) {
+        g_object_unref(priv->negotiate_option);
+        priv->negotiate_option = NULL;
+    }
+
+    g_hash_table_remove_all(priv->reply_statuses);
+
+    dispose_reply_related_data(priv);
+    dispose_message_related_data(priv);
+
+    milter_manager_children_set_launcher_channel(children, NULL, NULL);
+
+    priv->initial_yes_steps = MILTER_STEP_NONE;
+    priv->requested_yes_steps = MILTER_STEP_NONE;
+    priv->negotiated = FALSE;
+    priv->all_expired_as_fallback_on_negotiated = FALSE;
+    priv->processing_header_index = 0;
+    priv->end_of_message_size = 0;
+    priv->sending_body = FALSE;
+    priv->sent_body_offset = 0;
+    priv->replaced_body = FALSE;
+    priv->replaced_body_for_each_child = FALSE;
+    priv->state = MILTER_SERVER_CONTEXT_STATE_START;
+    priv->processing_state = MILTER_SERVER_CONTEXT_STATE_START;
+    priv->retry_connect_time = 5.0;
+    priv->finished = FALSE;
+    priv->emitted_reply_for_message_oriented_command = FALSE;
+    priv->tag = 0;
+}
+
+/*
+ * Prepares @children that was released by
+ * milter_manager_children_reset() for a new session. The
+ * configuration and the event loop can't be changed by
+ * properties because they are construct only.
+ */
+void
+milter_manager_children_reuse (MilterManagerChildren *children,
+                               MilterManagerConfiguration *configuration,
+                               MilterEventLoop *event_loop)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (priv->configuration != configuration) {
+        if (priv->configuration)
+            g_object_unref(priv->configuration);
+        priv->configuration = configuration;
+        if (priv->configuration)
+            g_object_ref(priv->configuration);
+    }
+
+    if (priv->event_loop != event_loop) {
+        if (priv->event_loop)
+            g_object_unref(priv->event_loop);
+        priv->event_loop = event_loop;
+        if (priv->event_loop)
+            g_object_ref(priv->event_loop);
+    }
+}
+
 void
 milter_manager_children_add_child (MilterManagerChildren *children,
                                    MilterManagerChild *child)
@@ -684,6 +978,12 @@ milter_manager_children_get_children (MilterManagerChildren *children)
     return MILTER_MANAGER_CHILDREN_GET_PRIVATE(children)->milters;
 }
 
+MilterManagerConfiguration *
+milter_manager_children_get_configuration (MilterManagerChildren *children)
+{
+    return MILTER_MANAGER_CHILDREN_GET_PRIVATE(children)->configuration;
+}
+
 void
 milter_manager_children_foreach (MilterManagerChildren *children,
                                  GFunc func, gpointer user_data)
@@ -802,6 +1102,8 @@ cb_ready (MilterServerContext *context, gpointer user_data)
                  milter_agent_get_tag(MILTER_AGENT(context)),
                  milter_server_context_get_name(context));
 
+    milter_manager_statistics_child_connected(
+        milter_server_context_get_name(context));
     setup_server_context_signals(negotiate_data->children, context);
     milter_server_context_negotiate(context, negotiate_data->option);
     g_hash_table_remove(priv->try_negotiate_ids, negotiate_data);
@@ -854,6 +1156,16 @@ report_result (MilterManagerChildren *children,
     const gchar *child_name;
     guint tag;
 
+    milter_manager_statistics_child_replied(
+        milter_server_context_get_name(context),
+        milter_server_context_get_status(context));
+    milter_manager_result_stream_emit_child(
+        milter_agent_get_tag(MILTER_AGENT(context)),
+        milter_server_context_get_name(context),
+        milter_server_context_get_last_state(context),
+        milter_server_context_get_status(context),
+        milter_server_context_get_elapsed(context));
+
     if (!(milter_need_log(MILTER_LOG_LEVEL_DEBUG |
                           MILTER_LOG_LEVEL_STATISTICS)))
         return;
@@ -963,6 +1275,9 @@ milter_manager_children_is_waiting_reply (MilterManagerChildren *children)
     case MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER:
     case MILTER_SERVER_CONTEXT_STATE_BODY:
     case MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE:
+        if (priv->parallel_children &&
+            g_hash_table_size(priv->parallel_children) > 0)
+            return TRUE;
         current_child = get_first_child_in_command_waiting_child_queue(children);
         if (!current_child)
             return FALSE;
@@ -1079,85 +1394,30 @@ remove_child_from_queue (MilterManagerChildren *children,
 }
 
 static gboolean
-emit_replace_body_signal_file (MilterManagerChildren *children)
-{
-    MilterManagerChildrenPrivate *priv;
-    GError *error = NULL;
-    GIOStatus status = G_IO_STATUS_NORMAL;
-    gsize chunk_size;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-
-    g_io_channel_seek_position(priv->body_file, 0, G_SEEK_SET, &error);
-    if (error) {
-        milter_error("[%u] [children][error][body][read][seek] %s",
-                     priv->tag, error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children),
-                                    error);
-        g_error_free(error);
-
-        return FALSE;
-    }
-
-    chunk_size =
-        milter_manager_configuration_get_chunk_size(priv->configuration);
-    while (status == G_IO_STATUS_NORMAL) {
-        gchar buffer[MILTER_CHUNK_SIZE + 1];
-        gsize read_size;
-
-        status = g_io_channel_read_chars(priv->body_file,
-                                         buffer, chunk_size,
-                                         &read_size, &error);
-
-        if (status == G_IO_STATUS_NORMAL)
-            g_signal_emit_by_name(children, "replace-body", buffer, read_size);
-    }
-
-    if (error) {
-        milter_error("[%u] [children][error][body][read] %s",
-                     priv->tag, error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children),
-                                    error);
-        g_error_free(error);
-
-        return FALSE;
-    }
-
-    return TRUE;
-}
-
-static gboolean
-emit_replace_body_signal_string (MilterManagerChildren *children)
+emit_replace_body_signal (MilterManagerChildren *children)
 {
     MilterManagerChildrenPrivate *priv;
-    gsize offset, chunk_size, write_size;
+    const gchar *body;
+    gsize body_size, offset, chunk_size, write_size;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    if (!priv->body)
+        return TRUE;
 
+    body = milter_manager_body_spool_get_data(priv->body);
+    body_size = milter_manager_body_spool_get_size(priv->body);
     chunk_size =
         milter_manager_configuration_get_chunk_size(priv->configuration);
-    for (offset = 0; offset < priv->body->len; offset += write_size) {
-        write_size = MIN(priv->body->len - offset, chunk_size);
+    for (offset = 0; offset < body_size; offset += write_size) {
+        write_size = MIN(body_size - offset, chunk_size);
         g_signal_emit_by_name(children, "replace-body",
-                              priv->body->str + offset,
+                              body + offset,
                               write_size);
     }
 
     return TRUE;
 }
 
-static gboolean
-emit_replace_body_signal (MilterManagerChildren *children)
-{
-    MilterManagerChildrenPrivate *priv;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-    if (priv->body)
-        return emit_replace_body_signal_string(children);
-    else
-        return emit_replace_body_signal_file(children);
-}
-
 static MilterStatus
 send_command_to_child (MilterManagerChildren *children,
                        MilterServerContext *context,
@@ -1203,68 +1463,140 @@ send_command_to_child (MilterManagerChildren *children,
     return status;
 }
 
+static guint
+header_hash (gconstpointer data)
+{
+    const MilterHeader *header = data;
+    guint hash = 0;
+
+    if (header->name)
+        hash = g_str_hash(header->name);
+    if (header->value)
+        hash = hash * 31 + g_str_hash(header->value);
+
+    return hash;
+}
+
+static void
+push_original_header_position (GHashTable *table, gpointer key, guint position)
+{
+    GQueue *positions;
+
+    positions = g_hash_table_lookup(table, key);
+    if (!positions) {
+        positions = g_queue_new();
+        g_hash_table_insert(table, key, positions);
+    }
+    g_queue_push_tail(positions, GUINT_TO_POINTER(position));
+}
+
+static gint
+pop_unmatched_original_header_position (GHashTable *table, gconstpointer key,
+                                        const gboolean *matched)
+{
+    GQueue *positions;
+
+    positions = g_hash_table_lookup(table, key);
+    if (!positions)
+        return -1;
+
+    while (!g_queue_is_empty(positions)) {
+        guint position;
+
+        position = GPOINTER_TO_UINT(g_queue_pop_head(positions));
+        if (!matched[position])
+            return position;
+    }
+
+    return -1;
+}
+
+/*
+ * Diffs the processed headers against the original headers in
+ * linear time. Positions of not yet matched original headers are
+ * queued by header and by name. Matched positions are skipped
+ * lazily when they are popped from the other queue.
+ */
 static void
 emit_header_signals (MilterManagerChildren *children)
 {
     MilterManagerChildrenPrivate *priv;
-    const GList *header_list, *node;
-    MilterHeaders *processing_headers;
-    gint i;
+    MilterHeadersIter iter;
+    MilterHeader *header;
+    GHashTable *positions_by_header, *positions_by_name, *n_same_name_headers;
+    gboolean *matched;
+    guint *indexes_in_same_name;
+    guint i, n_original_headers;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
-    processing_headers = milter_headers_copy(priv->original_headers);
-    header_list = milter_headers_get_list(priv->headers);
-
-    /* FIXME the following process admits improvement. */
-    for (node = header_list, i = 0;
-         node;
-         node = g_list_next(node), i++) {
-        MilterHeader *header = node->data;
-        MilterHeader *found_header;
-        gint index;
-
-        if (milter_headers_find(processing_headers, header)) {
-            milter_headers_remove(processing_headers, header);
+    positions_by_header = g_hash_table_new_full(header_hash,
+                                                milter_header_equal,
+                                                NULL,
+                                                (GDestroyNotify)g_queue_free);
+    positions_by_name = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                              NULL,
+                                              (GDestroyNotify)g_queue_free);
+    n_same_name_headers = g_hash_table_new(g_str_hash, g_str_equal);
+
+    n_original_headers = milter_headers_length(priv->original_headers);
+    matched = g_new0(gboolean, n_original_headers);
+    indexes_in_same_name = g_new0(guint, n_original_headers);
+    milter_headers_iter_init(&iter, priv->original_headers);
+    for (i = 0; milter_headers_iter_next(&iter, &header); i++) {
+        guint n_same_names;
+
+        n_same_names = GPOINTER_TO_UINT(g_hash_table_lookup(n_same_name_headers,
+                                                            header->name));
+        n_same_names++;
+        g_hash_table_insert(n_same_name_headers,
+                            header->name, GUINT_TO_POINTER(n_same_names));
+        indexes_in_same_name[i] = n_same_names;
+
+        push_original_header_position(positions_by_header, header, i);
+        push_original_header_position(positions_by_name, header->name, i);
+    }
+
+    milter_headers_iter_init(&iter, priv->headers);
+    for (i = 0; milter_headers_iter_next(&iter, &header); i++) {
+        gint position;
+
+        position = pop_unmatched_original_header_position(positions_by_header,
+                                                          header, matched);
+        if (position >= 0) {
+            matched[position] = TRUE;
             continue;
         }
 
-        found_header = milter_headers_lookup_by_name(processing_headers,
-                                                     header->name);
-        if (!found_header) {
+        position = pop_unmatched_original_header_position(positions_by_name,
+                                                          header->name,
+                                                          matched);
+        if (position < 0) {
             g_signal_emit_by_name(children, "insert-header",
                                   i, header->name, header->value);
             continue;
         }
-        index = milter_headers_index_in_same_header_name(priv->original_headers,
-                                                         found_header);
-        if (index == -1) {
-            g_signal_emit_by_name(children, "add-header",
-                                  header->name, header->value);
-        } else {
-            g_signal_emit_by_name(children, "change-header",
-                                  header->name, index, header->value);
-            milter_headers_remove(processing_headers, found_header);
-        }
-    }
 
-    if (milter_headers_length(processing_headers) > 0) {
-        header_list = milter_headers_get_list(processing_headers);
+        g_signal_emit_by_name(children, "change-header",
+                              header->name, indexes_in_same_name[position],
+                              header->value);
+        matched[position] = TRUE;
+    }
 
-        for (node = g_list_last((GList *)header_list);
-             node;
-             node = g_list_previous(node)) {
-            MilterHeader *header = node->data;
-            gint index;
+    for (i = n_original_headers; i > 0; i--) {
+        if (matched[i - 1])
+            continue;
 
-            index = milter_headers_index_in_same_header_name(priv->original_headers,
-                                                             header);
-            g_signal_emit_by_name(children, "delete-header",
-                                  header->name, index);
-        }
+        header = milter_headers_get_nth_header(priv->original_headers, i);
+        g_signal_emit_by_name(children, "delete-header",
+                              header->name, indexes_in_same_name[i - 1]);
     }
 
-    g_object_unref(processing_headers);
+    g_free(matched);
+    g_free(indexes_in_same_name);
+    g_hash_table_unref(n_same_name_headers);
+    g_hash_table_unref(positions_by_name);
+    g_hash_table_unref(positions_by_header);
 }
 
 static void
@@ -1338,6 +1670,9 @@ send_first_command_to_next_child (MilterManagerChildren *children,
 
     next_child = get_first_child_in_command_waiting_child_queue(children);
     if (!next_child) {
+        if (priv->parallel_children &&
+            g_hash_table_size(priv->parallel_children) > 0)
+            return MILTER_STATUS_PROGRESS;
         emit_reply_for_message_oriented_command(children, priv->state);
         return MILTER_STATUS_PROGRESS;
     }
@@ -1372,7 +1707,12 @@ cb_continue (MilterServerContext *context, gpointer user_data)
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
-    state = milter_server_context_get_state(context);
+    if (is_parallel_child(children, context)) {
+        send_next_command_to_parallel_child(children, context);
+        return;
+    }
+
+    state = milter_server_context_get_state(context);
     compile_reply_status(children, state, MILTER_STATUS_CONTINUE);
 
     switch (state) {
@@ -1443,6 +1783,11 @@ cb_temporary_failure (MilterServerContext *context, gpointer user_data)
     }
     compile_reply_status(children, state, status);
 
+    if (is_parallel_child(children, context)) {
+        end_message_by_child(children, context, state, status);
+        return;
+    }
+
     switch (state) {
     case MILTER_SERVER_CONTEXT_STATE_CONNECT:
     case MILTER_SERVER_CONTEXT_STATE_HELO:
@@ -1461,9 +1806,7 @@ cb_temporary_failure (MilterServerContext *context, gpointer user_data)
     case MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER:
     case MILTER_SERVER_CONTEXT_STATE_BODY:
     case MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE:
-        milter_server_context_set_processing_message(context, FALSE);
-        emit_reply_for_message_oriented_command(children, state);
-        milter_manager_children_abort(children);
+        end_message_by_child(children, context, state, status);
         break;
     default:
         if (milter_need_error_log()) {
@@ -1513,6 +1856,11 @@ cb_reject (MilterServerContext *context, gpointer user_data)
     }
     compile_reply_status(children, state, status);
 
+    if (is_parallel_child(children, context)) {
+        end_message_by_child(children, context, state, status);
+        return;
+    }
+
     switch (state) {
     case MILTER_SERVER_CONTEXT_STATE_CONNECT:
     case MILTER_SERVER_CONTEXT_STATE_HELO:
@@ -1531,9 +1879,7 @@ cb_reject (MilterServerContext *context, gpointer user_data)
     case MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER:
     case MILTER_SERVER_CONTEXT_STATE_BODY:
     case MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE:
-        milter_server_context_set_processing_message(context, FALSE);
-        emit_reply_for_message_oriented_command(children, state);
-        milter_manager_children_abort(children);
+        end_message_by_child(children, context, state, status);
         break;
     default:
         if (milter_need_error_log()) {
@@ -1588,6 +1934,13 @@ cb_accept (MilterServerContext *context, gpointer user_data)
     state = milter_server_context_get_state(context);
 
     compile_reply_status(children, state, MILTER_STATUS_ACCEPT);
+
+    if (is_parallel_child(children, context)) {
+        milter_server_context_set_processing_message(context, FALSE);
+        finish_parallel_child(children, context, MILTER_STATUS_ACCEPT);
+        return;
+    }
+
     switch (state) {
     case MILTER_SERVER_CONTEXT_STATE_CONNECT:
     case MILTER_SERVER_CONTEXT_STATE_HELO:
@@ -1658,6 +2011,11 @@ cb_discard (MilterServerContext *context, gpointer user_data)
     }
     compile_reply_status(children, state, status);
 
+    if (is_parallel_child(children, context)) {
+        end_message_by_child(children, context, state, status);
+        return;
+    }
+
     switch (state) {
     case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM:
     case MILTER_SERVER_CONTEXT_STATE_DATA:
@@ -1671,9 +2029,7 @@ cb_discard (MilterServerContext *context, gpointer user_data)
     case MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER:
     case MILTER_SERVER_CONTEXT_STATE_BODY:
     case MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE:
-        milter_server_context_set_processing_message(context, FALSE);
-        emit_reply_for_message_oriented_command(children, state);
-        milter_manager_children_abort(children);
+        end_message_by_child(children, context, state, status);
         break;
     default:
         if (milter_need_error_log()) {
@@ -1700,6 +2056,11 @@ cb_skip (MilterServerContext *context, gpointer user_data)
     MilterServerContextState state;
     MilterManagerChildrenPrivate *priv;
 
+    if (is_parallel_child(children, context)) {
+        skip_body_of_parallel_child(children, context);
+        return;
+    }
+
     state = milter_server_context_get_state(context);
 
     compile_reply_status(children, state, MILTER_STATUS_SKIP);
@@ -1742,6 +2103,423 @@ normalize_header_value (MilterManagerChildren *children,
     return NULL;
 }
 
+static void
+share_header_packet (MilterManagerChildren *children,
+                     MilterServerContext *context,
+                     MilterHeader *header,
+                     gint value_offset)
+{
+    MilterManagerChildrenPrivate *priv;
+    HeaderPackets *header_packets;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (!priv->milters || !g_list_next(priv->milters))
+        return;
+
+    header_packets = g_hash_table_lookup(priv->header_packets, header);
+    if (header_packets &&
+        (g_strcmp0(header_packets->name, header->name) != 0 ||
+         g_strcmp0(header_packets->value, header->value) != 0)) {
+        g_hash_table_remove(priv->header_packets, header);
+        header_packets = NULL;
+    }
+    if (!header_packets) {
+        header_packets = header_packets_new(header);
+        g_hash_table_insert(priv->header_packets, header, header_packets);
+    }
+
+    if (!header_packets->packets[value_offset]) {
+        const gchar *packet = NULL;
+        gsize packet_size;
+
+        milter_command_encoder_encode_header(
+            MILTER_COMMAND_ENCODER(priv->command_encoder),
+            &packet, &packet_size,
+            header->name, header->value + value_offset);
+        header_packets->packets[value_offset] =
+            milter_command_packet_new(MILTER_COMMAND_HEADER,
+                                      packet, packet_size);
+    }
+
+    milter_server_context_set_command_packet(
+        context, header_packets->packets[value_offset]);
+}
+
+#define MILTER_MANAGER_MODIFICATION_ACTIONS                     \
+    (MILTER_ACTION_ADD_HEADERS |                                \
+     MILTER_ACTION_CHANGE_BODY |                                \
+     MILTER_ACTION_ADD_ENVELOPE_RECIPIENT |                     \
+     MILTER_ACTION_DELETE_ENVELOPE_RECIPIENT |                  \
+     MILTER_ACTION_CHANGE_HEADERS |                             \
+     MILTER_ACTION_QUARANTINE |                                 \
+     MILTER_ACTION_CHANGE_ENVELOPE_FROM |                       \
+     MILTER_ACTION_ADD_ENVELOPE_RECIPIENT_WITH_PARAMETERS)
+
+static gboolean
+is_parallel_capable (MilterServerContext *context)
+{
+    MilterManagerChild *child;
+    MilterOption *option;
+
+    child = MILTER_MANAGER_CHILD(context);
+    if (!milter_manager_child_is_parallel(child))
+        return FALSE;
+
+    if (milter_manager_child_is_evaluation_mode(child))
+        return TRUE;
+
+    /* A child that may modify the message must see the
+     * modifications by the previous children. */
+    option = milter_server_context_get_negotiate_reply_option(context);
+    if (!option)
+        return FALSE;
+    return !(milter_option_get_action(option) &
+             MILTER_MANAGER_MODIFICATION_ACTIONS);
+}
+
+static gboolean
+is_parallel_message_child (MilterServerContext *context)
+{
+    return milter_server_context_is_processing_message(context) &&
+        milter_server_context_has_accepted_recipient(context) &&
+        is_parallel_capable(context);
+}
+
+static gboolean
+has_parallel_message_child (MilterManagerChildren *children)
+{
+    MilterManagerChildrenPrivate *priv;
+    GList *node;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    for (node = priv->milters; node; node = g_list_next(node)) {
+        if (is_parallel_message_child(MILTER_SERVER_CONTEXT(node->data)))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static gboolean
+is_parallel_child (MilterManagerChildren *children,
+                   MilterServerContext *context)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    if (!priv->parallel_children)
+        return FALSE;
+    return g_hash_table_lookup(priv->parallel_children, context) != NULL;
+}
+
+static gboolean
+finish_parallel_child (MilterManagerChildren *children,
+                       MilterServerContext *context,
+                       MilterStatus status)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    if (!is_parallel_child(children, context))
+        return FALSE;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (milter_need_debug_log()) {
+        gchar *status_name;
+
+        status_name = milter_utils_get_enum_nick_name(MILTER_TYPE_STATUS,
+                                                      status);
+        milter_debug("[%u] [children][parallel][end][%s] [%u] %s",
+                     priv->tag,
+                     status_name,
+                     milter_agent_get_tag(MILTER_AGENT(context)),
+                     milter_server_context_get_name(context));
+        g_free(status_name);
+    }
+
+    compile_reply_status(children,
+                         MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE,
+                         status);
+    g_hash_table_remove(priv->parallel_children, context);
+
+    if (g_hash_table_size(priv->parallel_children) == 0) {
+        dispose_parallel_children(priv);
+        if (!priv->command_waiting_child_queue)
+            emit_reply_for_message_oriented_command(
+                children, MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE);
+    }
+
+    return TRUE;
+}
+
+static gboolean
+has_running_parallel_children (MilterManagerChildrenPrivate *priv)
+{
+    return priv->parallel_children &&
+        g_hash_table_size(priv->parallel_children) > 0;
+}
+
+static void
+abort_command_waiting_children (MilterManagerChildren *children,
+                                MilterServerContext *context)
+{
+    MilterManagerChildrenPrivate *priv;
+    GList *node;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    priv->command_waiting_child_queue =
+        g_list_remove(priv->command_waiting_child_queue, context);
+    for (node = priv->command_waiting_child_queue;
+         node;
+         node = g_list_next(node)) {
+        MilterServerContext *waiting_child = node->data;
+
+        milter_debug("[%u] [children][parallel][abort-waiting-child] [%u] %s",
+                     priv->tag,
+                     milter_agent_get_tag(MILTER_AGENT(waiting_child)),
+                     milter_server_context_get_name(waiting_child));
+        if (milter_server_context_is_processing_message(waiting_child))
+            milter_server_context_abort(waiting_child);
+        if (!milter_server_context_is_quitted(waiting_child))
+            milter_server_context_reset_message_related_data(waiting_child);
+    }
+    g_list_free(priv->command_waiting_child_queue);
+    priv->command_waiting_child_queue = NULL;
+}
+
+/*
+ * reject, temporary failure and discard end the message. While
+ * parallel children are processing the message, the reply is
+ * deferred until both of the serial chain and the parallel
+ * children are settled because they have commands in flight.
+ * The serial children that don't receive the message yet are
+ * aborted. The compiled status is emitted when the last of them
+ * is settled.
+ */
+static void
+end_message_by_child (MilterManagerChildren *children,
+                      MilterServerContext *context,
+                      MilterServerContextState state,
+                      MilterStatus status)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    milter_server_context_set_processing_message(context, FALSE);
+
+    if (is_parallel_child(children, context)) {
+        finish_parallel_child(children, context, status);
+        return;
+    }
+
+    if (!has_running_parallel_children(priv)) {
+        emit_reply_for_message_oriented_command(children, state);
+        milter_manager_children_abort(children);
+        return;
+    }
+
+    compile_reply_status(children,
+                         MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE,
+                         status);
+    abort_command_waiting_children(children, context);
+}
+
+static gsize
+read_parallel_body (MilterManagerChildren *children,
+                    ParallelChild *parallel_child,
+                    const gchar **chunk,
+                    gsize size)
+{
+    MilterManagerChildrenPrivate *priv;
+    gsize body_size, read_size;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (!priv->parallel_body)
+        return 0;
+
+    body_size = milter_manager_body_spool_get_size(priv->parallel_body);
+    if (parallel_child->body_offset >= body_size)
+        return 0;
+
+    read_size = MIN(body_size - parallel_child->body_offset, size);
+    *chunk = milter_manager_body_spool_get_data(priv->parallel_body) +
+        parallel_child->body_offset;
+    parallel_child->body_offset += read_size;
+    return read_size;
+}
+
+static void
+send_next_command_to_parallel_child (MilterManagerChildren *children,
+                                     MilterServerContext *context)
+{
+    MilterManagerChildrenPrivate *priv;
+    ParallelChild *parallel_child;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    parallel_child = g_hash_table_lookup(priv->parallel_children, context);
+
+    while (parallel_child->commands) {
+        MilterCommand command;
+        MilterServerContextState state;
+        gboolean success;
+
+        command = GPOINTER_TO_INT(parallel_child->commands->data);
+        switch (command) {
+        case MILTER_COMMAND_HEADER:
+        {
+            MilterHeader *header;
+            gint value_offset = 0;
+
+            parallel_child->header_index++;
+            header = milter_headers_get_nth_header(priv->parallel_headers,
+                                                   parallel_child->header_index);
+            if (!header) {
+                parallel_child->commands =
+                    g_list_delete_link(parallel_child->commands,
+                                       parallel_child->commands);
+                continue;
+            }
+            if (need_header_value_leading_space_conversion(children,
+                                                           context) &&
+                header->value && header->value[0] == ' ')
+                value_offset = 1;
+            state = MILTER_SERVER_CONTEXT_STATE_HEADER;
+            share_header_packet(children, context, header, value_offset);
+            success = milter_server_context_header(context,
+                                                   header->name,
+                                                   header->value +
+                                                   value_offset);
+            break;
+        }
+        case MILTER_COMMAND_END_OF_HEADER:
+            parallel_child->commands =
+                g_list_delete_link(parallel_child->commands,
+                                   parallel_child->commands);
+            state = MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER;
+            success = milter_server_context_end_of_header(context);
+            break;
+        case MILTER_COMMAND_BODY:
+        {
+            const gchar *chunk = NULL;
+            gsize chunk_size, read_size = 0;
+
+            chunk_size =
+                milter_manager_configuration_get_chunk_size(priv->configuration);
+            if (!milter_server_context_get_skip_body(context))
+                read_size = read_parallel_body(children, parallel_child,
+                                               &chunk, chunk_size);
+            if (read_size == 0) {
+                parallel_child->commands =
+                    g_list_delete_link(parallel_child->commands,
+                                       parallel_child->commands);
+                continue;
+            }
+            state = MILTER_SERVER_CONTEXT_STATE_BODY;
+            success = milter_server_context_body(context, chunk, read_size);
+            break;
+        }
+        case MILTER_COMMAND_END_OF_MESSAGE:
+            parallel_child->commands =
+                g_list_delete_link(parallel_child->commands,
+                                   parallel_child->commands);
+            state = MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE;
+            success =
+                milter_server_context_end_of_message(context,
+                                                     priv->end_of_message_chunk,
+                                                     priv->end_of_message_size);
+            break;
+        default:
+            parallel_child->commands =
+                g_list_delete_link(parallel_child->commands,
+                                   parallel_child->commands);
+            continue;
+        }
+
+        if (!success) {
+            MilterManagerChild *child;
+
+            child = MILTER_MANAGER_CHILD(context);
+            finish_parallel_child(children, context,
+                                  milter_manager_child_get_fallback_status(child));
+        } else if (!milter_server_context_need_reply(context, state)) {
+            g_signal_emit_by_name(context, "continue");
+        }
+        return;
+    }
+
+    finish_parallel_child(children, context, MILTER_STATUS_CONTINUE);
+}
+
+static void
+skip_body_of_parallel_child (MilterManagerChildren *children,
+                             MilterServerContext *context)
+{
+    MilterManagerChildrenPrivate *priv;
+    ParallelChild *parallel_child;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    parallel_child = g_hash_table_lookup(priv->parallel_children, context);
+
+    if (parallel_child->commands &&
+        GPOINTER_TO_INT(parallel_child->commands->data) == MILTER_COMMAND_BODY)
+        parallel_child->commands =
+            g_list_delete_link(parallel_child->commands,
+                               parallel_child->commands);
+    send_next_command_to_parallel_child(children, context);
+}
+
+static gboolean
+start_parallel_children (MilterManagerChildren *children)
+{
+    MilterManagerChildrenPrivate *priv;
+    GList *node, *targets = NULL;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    dispose_parallel_children(priv);
+    for (node = priv->milters; node; node = g_list_next(node)) {
+        MilterServerContext *context = node->data;
+        ParallelChild *parallel_child;
+
+        if (!is_parallel_message_child(context))
+            continue;
+
+        parallel_child = g_new0(ParallelChild, 1);
+        parallel_child->commands = g_list_copy(priv->command_queue);
+        parallel_child->header_index = 0;
+        parallel_child->body_offset = 0;
+        g_hash_table_insert(priv->parallel_children, context, parallel_child);
+        targets = g_list_append(targets, context);
+    }
+
+    if (!targets)
+        return FALSE;
+
+    priv->parallel_headers = g_object_ref(priv->original_headers);
+    if (priv->body)
+        priv->parallel_body = g_object_ref(priv->body);
+
+    milter_debug("[%u] [children][parallel][start] %d",
+                 priv->tag, g_list_length(targets));
+
+    /* All targets are registered before the first command is
+     * sent because a child may finish synchronously. */
+    for (node = targets; node; node = g_list_next(node)) {
+        MilterServerContext *context = node->data;
+
+        if (is_parallel_child(children, context))
+            send_next_command_to_parallel_child(children, context);
+    }
+    g_list_free(targets);
+
+    return TRUE;
+}
+
 static gboolean
 is_end_of_message_state (MilterManagerChildren *children,
                          MilterServerContext *context,
@@ -1802,6 +2580,16 @@ is_evaluation_mode (MilterManagerChildren *children,
     va_list args;
     GString *additional_info = NULL;
 
+    if (is_parallel_child(children, context)) {
+        priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+        milter_warning("[%u] [children][parallel][ignore][%s] [%u] %s",
+                       priv->tag,
+                       requested_action_name,
+                       milter_agent_get_tag(MILTER_AGENT(context)),
+                       milter_server_context_get_name(context));
+        return TRUE;
+    }
+
     if (!milter_manager_child_is_evaluation_mode(MILTER_MANAGER_CHILD(context)))
         return FALSE;
 
@@ -1856,6 +2644,12 @@ cb_add_header (MilterServerContext *context,
                           name,
                           value,
                           milter_server_context_get_name(context));
+        milter_manager_result_stream_emit_header(
+            milter_agent_get_tag(MILTER_AGENT(context)),
+            milter_server_context_get_name(context),
+            "add",
+            name,
+            value);
     }
 
     if (is_evaluation_mode(children, context, "add-header",
@@ -1896,6 +2690,12 @@ cb_insert_header (MilterServerContext *context,
                           name,
                           value,
                           milter_server_context_get_name(context));
+        milter_manager_result_stream_emit_header(
+            milter_agent_get_tag(MILTER_AGENT(context)),
+            milter_server_context_get_name(context),
+            "insert",
+            name,
+            value);
     }
 
     if (is_evaluation_mode(children, context, "insert-header",
@@ -1937,6 +2737,12 @@ cb_change_header (MilterServerContext *context,
                           name,
                           value,
                           milter_server_context_get_name(context));
+        milter_manager_result_stream_emit_header(
+            milter_agent_get_tag(MILTER_AGENT(context)),
+            milter_server_context_get_name(context),
+            "change",
+            name,
+            value);
     }
 
     if (is_evaluation_mode(children, context, "change-header",
@@ -2144,6 +2950,12 @@ cb_stopped (MilterServerContext *context, gpointer user_data)
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
     state = milter_server_context_get_state(context);
 
+    if (is_parallel_child(children, context)) {
+        milter_server_context_abort(context);
+        finish_parallel_child(children, context, MILTER_STATUS_ACCEPT);
+        return;
+    }
+
     switch (state) {
     case MILTER_SERVER_CONTEXT_STATE_CONNECT:
     case MILTER_SERVER_CONTEXT_STATE_HELO:
@@ -2205,6 +3017,8 @@ cb_writing_timeout (MilterServerContext *context, gpointer user_data)
     child = MILTER_MANAGER_CHILD(context);
     fallback_status = milter_manager_child_get_fallback_status(child);
 
+    milter_manager_statistics_child_timed_out(
+        milter_server_context_get_name(context));
     if (milter_need_error_log()) {
         gchar *state_name;
         gchar *fallback_status_name;
@@ -2227,7 +3041,8 @@ cb_writing_timeout (MilterServerContext *context, gpointer user_data)
 
     compile_reply_status(children, state, fallback_status);
     expire_child(children, context);
-    remove_child_from_queue(children, context);
+    if (!finish_parallel_child(children, context, fallback_status))
+        remove_child_from_queue(children, context);
 }
 
 static void
@@ -2245,6 +3060,8 @@ cb_reading_timeout (MilterServerContext *context, gpointer user_data)
     child = MILTER_MANAGER_CHILD(context);
     fallback_status = milter_manager_child_get_fallback_status(child);
 
+    milter_manager_statistics_child_timed_out(
+        milter_server_context_get_name(context));
     if (milter_need_error_log()) {
         gchar *state_name;
         gchar *fallback_status_name;
@@ -2267,7 +3084,8 @@ cb_reading_timeout (MilterServerContext *context, gpointer user_data)
 
     compile_reply_status(children, state, fallback_status);
     expire_child(children, context);
-    remove_child_from_queue(children, context);
+    if (!finish_parallel_child(children, context, fallback_status))
+        remove_child_from_queue(children, context);
 }
 
 static void
@@ -2285,6 +3103,8 @@ cb_end_of_message_timeout (MilterServerContext *context, gpointer user_data)
     child = MILTER_MANAGER_CHILD(context);
     fallback_status = milter_manager_child_get_fallback_status(child);
 
+    milter_manager_statistics_child_timed_out(
+        milter_server_context_get_name(context));
     if (milter_need_error_log()) {
         gchar *state_name;
         gchar *fallback_status_name;
@@ -2308,7 +3128,8 @@ cb_end_of_message_timeout (MilterServerContext *context, gpointer user_data)
 
     compile_reply_status(children, state, fallback_status);
     expire_child(children, context);
-    remove_child_from_queue(children, context);
+    if (!finish_parallel_child(children, context, fallback_status))
+        remove_child_from_queue(children, context);
 }
 
 static void
@@ -2351,7 +3172,8 @@ cb_error (MilterErrorEmittable *emittable, GError *error, gpointer user_data)
 
     compile_reply_status(children, state, fallback_status);
     expire_child(children, context);
-    remove_child_from_queue(children, context);
+    if (!finish_parallel_child(children, context, fallback_status))
+        remove_child_from_queue(children, context);
 }
 
 static void
@@ -2393,6 +3215,15 @@ cb_finished (MilterAgent *agent, gpointer user_data)
         g_free(state_name);
     }
 
+    if (is_parallel_child(children, context)) {
+        MilterManagerChild *child;
+
+        child = MILTER_MANAGER_CHILD(context);
+        finish_parallel_child(children, context,
+                              milter_manager_child_get_fallback_status(child));
+        return;
+    }
+
     switch (priv->processing_state) {
     case MILTER_SERVER_CONTEXT_STATE_NEGOTIATE:
         remove_queue_in_negotiate(children, MILTER_MANAGER_CHILD(context));
@@ -2728,6 +3559,8 @@ cb_connection_timeout (MilterServerContext *context, gpointer user_data)
     MilterManagerChildrenPrivate *priv;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(data->children);
+    milter_manager_statistics_child_timed_out(
+        milter_server_context_get_name(context));
     milter_error("[%u] [children][timeout][connection] [%u] %s",
                  priv->tag,
                  milter_agent_get_tag(MILTER_AGENT(context)),
@@ -2745,6 +3578,8 @@ cb_connection_error (MilterErrorEmittable *emittable, GError *error, gpointer us
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(data->children);
     context = MILTER_SERVER_CONTEXT(data->child);
+    milter_manager_statistics_child_connection_failed(
+        milter_server_context_get_name(context));
     milter_error("[%u] [children][error][connection] [%u] %s: %s",
                  priv->tag,
                  milter_agent_get_tag(MILTER_AGENT(context)),
@@ -3004,6 +3839,8 @@ init_command_waiting_child_queue (MilterManagerChildren *children, MilterCommand
         context = MILTER_SERVER_CONTEXT(node->data);
         if (milter_server_context_is_processing_message(context)) {
             if (milter_server_context_has_accepted_recipient(context)) {
+                if (is_parallel_capable(context))
+                    continue;
                 priv->command_waiting_child_queue =
                     g_list_append(priv->command_waiting_child_queue, context);
             } else {
@@ -3070,17 +3907,247 @@ init_reply_queue (MilterManagerChildren *children,
                         GINT_TO_POINTER(MILTER_STATUS_NOT_CHANGE));
 }
 
-static gboolean
-cb_idle_reply_negotiate_on_no_child (gpointer user_data)
+static MilterManagerConnectionPool *
+get_connection_pool (MilterManagerChildren *children,
+                     MilterServerContext *context)
 {
-    MilterManagerChildren *children = user_data;
+    MilterManagerChildrenPrivate *priv;
+    MilterManagerEgg *egg;
+    MilterManagerConnectionPool *pool;
 
-    reply_negotiate(children);
-    return FALSE;
-}
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
-gboolean
-milter_manager_children_negotiate (MilterManagerChildren *children,
+    if (!priv->configuration || !priv->negotiate_option)
+        return NULL;
+
+    egg = milter_manager_configuration_find_egg(
+        priv->configuration,
+        milter_server_context_get_name(context));
+    if (!egg)
+        return NULL;
+
+    pool = milter_manager_egg_get_connection_pool(egg);
+    if (!milter_manager_connection_pool_is_enabled(pool))
+        return NULL;
+
+    return pool;
+}
+
+static gboolean
+cb_idle_reuse_connections (gpointer user_data)
+{
+    MilterManagerChildren *children = user_data;
+    MilterManagerChildrenPrivate *priv;
+    GList *connections, *node;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    priv->reuse_connections_id = 0;
+    connections = priv->reused_connections;
+    priv->reused_connections = NULL;
+
+    for (node = connections; node; node = g_list_next(node)) {
+        ReusedConnection *connection = node->data;
+        MilterServerContext *context;
+        GError *error = NULL;
+
+        context = MILTER_SERVER_CONTEXT(connection->child);
+        setup_server_context_signals(children, context);
+        if (milter_server_context_reuse_connection(context,
+                                                   connection->channel,
+                                                   priv->negotiate_option,
+                                                   connection->reply_option,
+                                                   connection->macros_requests,
+                                                   &error))
+            continue;
+
+        milter_error("[%u] [children][error][connection-pool][reuse] [%u] "
+                     "%s: %s",
+                     priv->tag,
+                     milter_agent_get_tag(MILTER_AGENT(context)),
+                     error->message,
+                     milter_server_context_get_name(context));
+        g_error_free(error);
+        teardown_server_context_signals(connection->child, children);
+        child_establish_connection(connection->child, priv->option,
+                                   children, FALSE);
+    }
+    g_list_foreach(connections, (GFunc)reused_connection_free, NULL);
+    g_list_free(connections);
+
+    return FALSE;
+}
+
+/*
+ * A pooled connection has been negotiated already. We
+ * emulate its negotiate reply from idle to keep the same
+ * reply order as a fresh connection.
+ */
+static gboolean
+pop_pooled_connection (MilterManagerChildren *children,
+                       MilterManagerChild *child)
+{
+    MilterManagerChildrenPrivate *priv;
+    MilterManagerConnectionPool *pool;
+    ReusedConnection *connection;
+    GIOChannel *channel = NULL;
+    MilterOption *reply_option = NULL;
+    MilterMacrosRequests *macros_requests = NULL;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    pool = get_connection_pool(children, MILTER_SERVER_CONTEXT(child));
+    if (!pool)
+        return FALSE;
+
+    if (!milter_manager_connection_pool_pop(pool,
+                                            priv->event_loop,
+                                            priv->negotiate_option,
+                                            &channel,
+                                            &reply_option,
+                                            &macros_requests))
+        return FALSE;
+
+    connection = g_new0(ReusedConnection, 1);
+    connection->child = g_object_ref(child);
+    connection->channel = channel;
+    connection->reply_option = reply_option;
+    connection->macros_requests = macros_requests;
+    priv->reused_connections = g_list_append(priv->reused_connections,
+                                             connection);
+    if (priv->reuse_connections_id == 0)
+        priv->reuse_connections_id =
+            milter_event_loop_add_idle_full(priv->event_loop,
+                                            G_PRIORITY_DEFAULT,
+                                            cb_idle_reuse_connections,
+                                            children,
+                                            NULL);
+
+    return TRUE;
+}
+
+static void
+pending_pooled_connection_free (PendingPooledConnection *pending)
+{
+    g_signal_handler_disconnect(pending->context,
+                                pending->state_transited_signal_id);
+    g_signal_handler_disconnect(pending->context,
+                                pending->error_signal_id);
+    g_object_unref(pending->context);
+    g_object_unref(pending->pool);
+    g_object_unref(pending->loop);
+    g_object_unref(pending->option);
+    g_free(pending);
+}
+
+static void
+cb_pending_pooled_connection_state_transited (MilterServerContext *context,
+                                              MilterServerContextState state,
+                                              gpointer user_data)
+{
+    PendingPooledConnection *pending = user_data;
+    GIOChannel *channel;
+
+    if (state != MILTER_SERVER_CONTEXT_STATE_QUIT)
+        return;
+
+    channel = milter_server_context_steal_connection(context);
+    if (channel) {
+        MilterProtocolAgent *agent;
+
+        agent = MILTER_PROTOCOL_AGENT(context);
+        milter_manager_connection_pool_push(
+            pending->pool,
+            pending->loop,
+            channel,
+            pending->option,
+            milter_server_context_get_negotiate_reply_option(context),
+            milter_protocol_agent_get_macros_requests(agent));
+        g_io_channel_unref(channel);
+    } else {
+        milter_debug("[%u] [children][connection-pool][push][not-reusable] "
+                     "%s",
+                     milter_agent_get_tag(MILTER_AGENT(context)),
+                     milter_server_context_get_name(context));
+    }
+
+    pending_pooled_connection_free(pending);
+}
+
+static void
+cb_pending_pooled_connection_error (MilterErrorEmittable *emittable,
+                                    GError *error,
+                                    gpointer user_data)
+{
+    PendingPooledConnection *pending = user_data;
+
+    milter_debug("[%u] [children][connection-pool][push][error] %s: %s",
+                 milter_agent_get_tag(MILTER_AGENT(pending->context)),
+                 milter_server_context_get_name(pending->context),
+                 error->message);
+    pending_pooled_connection_free(pending);
+}
+
+/*
+ * The connection can be pooled only after QUIT_NC is
+ * flushed. The child context is kept until then even if
+ * @children is finished.
+ */
+static gboolean
+push_pooled_connection (MilterManagerChildren *children,
+                        MilterServerContext *context,
+                        gboolean *success)
+{
+    MilterManagerChildrenPrivate *priv;
+    MilterManagerConnectionPool *pool;
+    MilterOption *reply_option;
+    PendingPooledConnection *pending;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    pool = get_connection_pool(children, context);
+    if (!pool || milter_manager_connection_pool_is_full(pool))
+        return FALSE;
+
+    reply_option = milter_server_context_get_negotiate_reply_option(context);
+    if (!reply_option || milter_option_get_version(reply_option) < 6)
+        return FALSE;
+    if (milter_server_context_is_processing(context))
+        return FALSE;
+
+    if (!milter_server_context_quit_new_connection(context)) {
+        *success = FALSE;
+        return TRUE;
+    }
+
+    pending = g_new0(PendingPooledConnection, 1);
+    pending->pool = g_object_ref(pool);
+    pending->loop = g_object_ref(priv->event_loop);
+    pending->context = g_object_ref(context);
+    pending->option = g_object_ref(priv->negotiate_option);
+    pending->state_transited_signal_id =
+        g_signal_connect(context, "state-transited",
+                         G_CALLBACK(cb_pending_pooled_connection_state_transited),
+                         pending);
+    pending->error_signal_id =
+        g_signal_connect(context, "error",
+                         G_CALLBACK(cb_pending_pooled_connection_error),
+                         pending);
+
+    return TRUE;
+}
+
+static gboolean
+cb_idle_reply_negotiate_on_no_child (gpointer user_data)
+{
+    MilterManagerChildren *children = user_data;
+
+    reply_negotiate(children);
+    return FALSE;
+}
+
+gboolean
+milter_manager_children_negotiate (MilterManagerChildren *children,
                                    MilterOption          *option,
                                    MilterMacrosRequests  *macros_requests)
 {
@@ -3104,6 +4171,13 @@ milter_manager_children_negotiate (MilterManagerChildren *children,
         priv->initial_yes_steps = milter_option_get_step_yes(priv->option);
     }
 
+    if (priv->negotiate_option) {
+        g_object_unref(priv->negotiate_option);
+        priv->negotiate_option = NULL;
+    }
+    if (priv->option)
+        priv->negotiate_option = milter_option_copy(priv->option);
+
     if (!priv->milters) {
         priv->negotiated = TRUE;
         dispose_lazy_reply_negotiate_id(priv);
@@ -3129,6 +4203,9 @@ milter_manager_children_negotiate (MilterManagerChildren *children,
     for (node = copied_milters; node; node = g_list_next(node)) {
         MilterManagerChild *child = MILTER_MANAGER_CHILD(node->data);
 
+        if (pop_pooled_connection(children, child))
+            continue;
+
         if (!child_establish_connection(child, option, children, FALSE)) {
             if (privilege &&
                 milter_manager_children_start_child(children, child)) {
@@ -3149,9 +4226,11 @@ milter_manager_children_define_macro (MilterManagerChildren *children,
 {
     GList *node;
     MilterManagerChildrenPrivate *priv;
+    MilterMacroSnapshot *snapshot;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
+    snapshot = milter_macro_snapshot_new(command, macros);
     for (node = priv->milters; node; node = g_list_next(node)) {
         MilterManagerChild *child = node->data;
         MilterServerContext *context;
@@ -3185,8 +4264,10 @@ milter_manager_children_define_macro (MilterManagerChildren *children,
         default:
             break;
         }
-        milter_protocol_agent_set_macros_hash_table(agent, command, macros);
+        milter_protocol_agent_set_macro_snapshot(agent, snapshot);
     }
+    milter_macro_snapshot_unref(snapshot);
+
     return TRUE;
 }
 
@@ -3262,6 +4343,7 @@ milter_manager_children_connect (MilterManagerChildren *children,
                                  socklen_t              address_length)
 {
     GList *child, *targets;
+    MilterCommandPacket *command_packet = NULL;
     MilterManagerChildrenPrivate *priv;
     gboolean success = FALSE;
     gint n_queued_milters;
@@ -3286,8 +4368,19 @@ milter_manager_children_connect (MilterManagerChildren *children,
 
     n_queued_milters = priv->reply_queue->length;
     targets = g_list_copy(priv->reply_queue->head);
+    if (n_queued_milters > 1) {
+        const gchar *packet = NULL;
+        gsize packet_size;
+
+        milter_command_encoder_encode_connect(
+            MILTER_COMMAND_ENCODER(priv->command_encoder),
+            &packet, &packet_size, host_name, address, address_length);
+        command_packet = milter_command_packet_new(MILTER_COMMAND_CONNECT,
+                                                   packet, packet_size);
+    }
     for (child = targets; child; child = g_list_next(child)) {
         MilterServerContext *context = MILTER_SERVER_CONTEXT(child->data);
+        milter_server_context_set_command_packet(context, command_packet);
         if (milter_server_context_connect(context,
                                           host_name,
                                           address,
@@ -3295,6 +4388,8 @@ milter_manager_children_connect (MilterManagerChildren *children,
             success = TRUE;
         }
     }
+    if (command_packet)
+        milter_command_packet_unref(command_packet);
     milter_debug("[%u] [children][connect][sent] %d",
                  priv->tag, n_queued_milters);
     for (child = targets; child; child = g_list_next(child)) {
@@ -3313,6 +4408,7 @@ milter_manager_children_helo (MilterManagerChildren *children,
                               const gchar           *fqdn)
 {
     GList *child, *targets;
+    MilterCommandPacket *command_packet = NULL;
     MilterManagerChildrenPrivate *priv;
     gboolean success = FALSE;
     gint n_queued_milters;
@@ -3333,11 +4429,24 @@ milter_manager_children_helo (MilterManagerChildren *children,
 
     n_queued_milters = priv->reply_queue->length;
     targets = g_list_copy(priv->reply_queue->head);
+    if (n_queued_milters > 1) {
+        const gchar *packet = NULL;
+        gsize packet_size;
+
+        milter_command_encoder_encode_helo(
+            MILTER_COMMAND_ENCODER(priv->command_encoder),
+            &packet, &packet_size, fqdn);
+        command_packet = milter_command_packet_new(MILTER_COMMAND_HELO,
+                                                   packet, packet_size);
+    }
     for (child = targets; child; child = g_list_next(child)) {
         MilterServerContext *context = MILTER_SERVER_CONTEXT(child->data);
+        milter_server_context_set_command_packet(context, command_packet);
         if (milter_server_context_helo(context, fqdn))
             success = TRUE;
     }
+    if (command_packet)
+        milter_command_packet_unref(command_packet);
     milter_debug("[%u] [children][helo][sent] %d",
                  priv->tag, n_queued_milters);
     for (child = targets; child; child = g_list_next(child)) {
@@ -3356,6 +4465,7 @@ milter_manager_children_envelope_from (MilterManagerChildren *children,
                                        const gchar           *from)
 {
     GList *child, *targets;
+    MilterCommandPacket *command_packet = NULL;
     MilterManagerChildrenPrivate *priv;
     gboolean success = FALSE;
     gint n_queued_milters;
@@ -3376,11 +4486,24 @@ milter_manager_children_envelope_from (MilterManagerChildren *children,
 
     n_queued_milters = priv->reply_queue->length;
     targets = g_list_copy(priv->reply_queue->head);
+    if (n_queued_milters > 1) {
+        const gchar *packet = NULL;
+        gsize packet_size;
+
+        milter_command_encoder_encode_envelope_from(
+            MILTER_COMMAND_ENCODER(priv->command_encoder),
+            &packet, &packet_size, from);
+        command_packet = milter_command_packet_new(MILTER_COMMAND_ENVELOPE_FROM,
+                                                   packet, packet_size);
+    }
     for (child = targets; child; child = g_list_next(child)) {
         MilterServerContext *context = MILTER_SERVER_CONTEXT(child->data);
+        milter_server_context_set_command_packet(context, command_packet);
         if (milter_server_context_envelope_from(context, from))
             success = TRUE;
     }
+    if (command_packet)
+        milter_command_packet_unref(command_packet);
     milter_debug("[%u] [children][envelope-from][sent] %d",
                  priv->tag, n_queued_milters);
     for (child = targets; child; child = g_list_next(child)) {
@@ -3399,6 +4522,7 @@ milter_manager_children_envelope_recipient (MilterManagerChildren *children,
                                             const gchar           *recipient)
 {
     GList *child, *targets;
+    MilterCommandPacket *command_packet = NULL;
     MilterManagerChildrenPrivate *priv;
     gboolean success = FALSE;
     gint n_queued_milters;
@@ -3420,11 +4544,25 @@ milter_manager_children_envelope_recipient (MilterManagerChildren *children,
 
     n_queued_milters = priv->reply_queue->length;
     targets = g_list_copy(priv->reply_queue->head);
+    if (n_queued_milters > 1) {
+        const gchar *packet = NULL;
+        gsize packet_size;
+
+        milter_command_encoder_encode_envelope_recipient(
+            MILTER_COMMAND_ENCODER(priv->command_encoder),
+            &packet, &packet_size, recipient);
+        command_packet =
+            milter_command_packet_new(MILTER_COMMAND_ENVELOPE_RECIPIENT,
+                                      packet, packet_size);
+    }
     for (child = targets; child; child = g_list_next(child)) {
         MilterServerContext *context = MILTER_SERVER_CONTEXT(child->data);
+        milter_server_context_set_command_packet(context, command_packet);
         if (milter_server_context_envelope_recipient(context, recipient))
             success = TRUE;
     }
+    if (command_packet)
+        milter_command_packet_unref(command_packet);
     milter_debug("[%u] [children][envelope-recipient][sent] %d",
                  priv->tag, n_queued_milters);
     for (child = targets; child; child = g_list_next(child)) {
@@ -3484,6 +4622,17 @@ milter_manager_children_data (MilterManagerChildren *children)
     return success;
 }
 
+static gboolean
+continue_for_parallel_children (MilterManagerChildren *children)
+{
+    if (!has_parallel_message_child(children))
+        return FALSE;
+
+    /* Parallel children receive the message on end-of-message. */
+    g_signal_emit_by_name(children, "continue");
+    return TRUE;
+}
+
 static MilterStatus
 send_command_to_first_waiting_child (MilterManagerChildren *children,
                                      MilterCommand command)
@@ -3502,6 +4651,7 @@ milter_manager_children_unknown (MilterManagerChildren *children,
                                  const gchar           *command)
 {
     GList *child, *targets;
+    MilterCommandPacket *command_packet = NULL;
     MilterManagerChildrenPrivate *priv;
     gboolean success = FALSE;
     gint n_queued_milters;
@@ -3522,11 +4672,24 @@ milter_manager_children_unknown (MilterManagerChildren *children,
 
     n_queued_milters = priv->reply_queue->length;
     targets = g_list_copy(priv->reply_queue->head);
+    if (n_queued_milters > 1) {
+        const gchar *packet = NULL;
+        gsize packet_size;
+
+        milter_command_encoder_encode_unknown(
+            MILTER_COMMAND_ENCODER(priv->command_encoder),
+            &packet, &packet_size, command);
+        command_packet = milter_command_packet_new(MILTER_COMMAND_UNKNOWN,
+                                                   packet, packet_size);
+    }
     for (child = targets; child; child = g_list_next(child)) {
         MilterServerContext *context = MILTER_SERVER_CONTEXT(child->data);
+        milter_server_context_set_command_packet(context, command_packet);
         if (milter_server_context_unknown(context, command))
             success = TRUE;
     }
+    if (command_packet)
+        milter_command_packet_unref(command_packet);
     milter_debug("[%u] [children][unknown][sent] %d",
                  priv->tag, n_queued_milters);
     for (child = targets; child; child = g_list_next(child)) {
@@ -3561,6 +4724,7 @@ send_next_header_to_child (MilterManagerChildren *children, MilterServerContext
             value_offset = 1;
     }
 
+    share_header_packet(children, context, header, value_offset);
     if (milter_server_context_header(context,
                                      header->name,
                                      header->value + value_offset)) {
@@ -3619,6 +4783,9 @@ milter_manager_children_header (MilterManagerChildren *children,
     milter_headers_append_header(priv->headers, name, value);
     init_command_waiting_child_queue(children, MILTER_COMMAND_HEADER);
 
+    if (!priv->command_waiting_child_queue)
+        return continue_for_parallel_children(children);
+
     return MILTER_STATUS_PROGRESS ==
         send_command_to_first_waiting_child(children, MILTER_COMMAND_HEADER);
 }
@@ -3653,67 +4820,27 @@ milter_manager_children_end_of_header (MilterManagerChildren *children)
     priv->processing_state = priv->state;
     init_command_waiting_child_queue(children, MILTER_COMMAND_END_OF_HEADER);
 
+    if (!priv->command_waiting_child_queue)
+        return continue_for_parallel_children(children);
+
     return MILTER_STATUS_PROGRESS ==
         send_command_to_first_waiting_child(children,
                                             MILTER_COMMAND_END_OF_HEADER);
 }
 
 static gboolean
-open_body_file (MilterManagerChildren *children)
+write_body (MilterManagerChildren *children,
+            const gchar *chunk, gsize size)
 {
-    gint fd;
-    GError *error = NULL;
     MilterManagerChildrenPrivate *priv;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-
-    fd = g_file_open_tmp(NULL, &priv->body_file_name, &error);
-    if (error) {
-        milter_error("[%u] [children][error][body][open] %s",
-                     priv->tag, error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children),
-                                    error);
-        g_error_free(error);
-        return FALSE;
-    }
-    priv->body_file = g_io_channel_unix_new(fd);
-    g_io_channel_set_close_on_unref(priv->body_file, TRUE);
-
-    g_io_channel_set_encoding(priv->body_file, NULL, &error);
-    if (error) {
-        milter_error("[%u] [children][error][body][encoding] %s",
-                     priv->tag, error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children),
-                                    error);
-        g_error_free(error);
-        return FALSE;
-    }
-
-    return TRUE;
-}
-
-static gboolean
-write_body_to_file (MilterManagerChildren *children,
-                    const gchar *chunk,
-                    gsize size)
-{
     GError *error = NULL;
-    gsize written_size;
-    MilterManagerChildrenPrivate *priv;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
-    if (!priv->body_file && !open_body_file(children))
-        return FALSE;
-
-    if (!priv->body_file)
-        return TRUE;
-
-    if (!chunk || size == 0)
-        return TRUE;
+    if (!priv->body)
+        priv->body = milter_manager_body_spool_new();
 
-    g_io_channel_write_chars(priv->body_file, chunk, size, &written_size, &error);
-    if (error) {
+    if (!milter_manager_body_spool_append(priv->body, chunk, size, &error)) {
         milter_error("[%u] [children][error][body][write] %s",
                      priv->tag,
                      error->message);
@@ -3726,47 +4853,6 @@ write_body_to_file (MilterManagerChildren *children,
     return TRUE;
 }
 
-static gboolean
-write_body_to_string (MilterManagerChildren *children,
-                      const gchar *chunk,
-                      gsize size)
-{
-    MilterManagerChildrenPrivate *priv;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-
-    if (!priv->body)
-        priv->body = g_string_new_len(chunk, size);
-    else
-        g_string_append_len(priv->body, chunk, size);
-
-    if (priv->body->len > MAX_ON_MEMORY_BODY_SIZE) {
-        gboolean success;
-
-        success = write_body_to_file(children, priv->body->str, priv->body->len);
-        g_string_free(priv->body, TRUE);
-        priv->body = NULL;
-
-        return success;
-    }
-
-    return TRUE;
-}
-
-static gboolean
-write_body (MilterManagerChildren *children,
-            const gchar *chunk, gsize size)
-{
-    MilterManagerChildrenPrivate *priv;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-
-    if (priv->body_file)
-        return write_body_to_file(children, chunk, size);
-    else
-        return write_body_to_string(children, chunk, size);
-}
-
 gboolean
 milter_manager_children_body (MilterManagerChildren *children,
                               const gchar           *chunk,
@@ -3804,8 +4890,15 @@ milter_manager_children_body (MilterManagerChildren *children,
     init_command_waiting_child_queue(children, MILTER_COMMAND_BODY);
 
     first_child = get_first_child_in_command_waiting_child_queue(children);
-    if (!first_child)
-        return FALSE;
+    if (!first_child) {
+        if (!has_parallel_message_child(children))
+            return FALSE;
+        if (!write_body(children, chunk, size))
+            return FALSE;
+        priv->state = state;
+        priv->processing_state = state;
+        return continue_for_parallel_children(children);
+    }
 
     if (!write_body(children, chunk, size))
         return FALSE;
@@ -3829,48 +4922,6 @@ milter_manager_children_body (MilterManagerChildren *children,
 
 }
 
-static MilterStatus
-init_child_for_body_string (MilterManagerChildren *children,
-                            MilterServerContext *context)
-{
-    MilterManagerChildrenPrivate *priv;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-    priv->sent_body_offset = 0;
-
-    return MILTER_STATUS_NOT_CHANGE;
-}
-
-static MilterStatus
-init_child_for_body_file (MilterManagerChildren *children,
-                          MilterServerContext *context)
-{
-    MilterManagerChildrenPrivate *priv;
-    GError *error = NULL;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-    if (!priv->body_file)
-        return MILTER_STATUS_NOT_CHANGE;
-
-    g_io_channel_seek_position(priv->body_file, 0, G_SEEK_SET, &error);
-    if (error) {
-        MilterManagerChild *child;
-
-        milter_error("[%u] [children][error][body][send][seek] [%u] %s: %s",
-                     priv->tag,
-                     milter_agent_get_tag(MILTER_AGENT(context)),
-                     error->message,
-                     milter_server_context_get_name(context));
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children), error);
-        g_error_free(error);
-
-        child = MILTER_MANAGER_CHILD(context);
-        return milter_manager_child_get_fallback_status(child);
-    }
-
-    return MILTER_STATUS_NOT_CHANGE;
-}
-
 static MilterStatus
 init_child_for_body (MilterManagerChildren *children,
                      MilterServerContext *context)
@@ -3888,89 +4939,34 @@ init_child_for_body (MilterManagerChildren *children,
 
     priv->replaced_body_for_each_child = FALSE;
     priv->sending_body = TRUE;
-    if (priv->body)
-        return init_child_for_body_string(children, context);
-    else
-        return init_child_for_body_file(children, context);
+    priv->sent_body_offset = 0;
+
+    return MILTER_STATUS_NOT_CHANGE;
 }
 
 static MilterStatus
-send_body_to_child_file (MilterManagerChildren *children,
-                         MilterServerContext *context)
+send_body_chunk_to_child (MilterManagerChildren *children,
+                          MilterServerContext *context)
 {
     MilterStatus status = MILTER_STATUS_PROGRESS;
-    GError *error = NULL;
-    GIOStatus io_status = G_IO_STATUS_NORMAL;
     MilterManagerChildrenPrivate *priv;
-    gchar buffer[MILTER_CHUNK_SIZE + 1];
-    gsize read_size, chunk_size;
-    MilterManagerChild *child;
+    const gchar *body;
+    gsize body_size, chunk_size, write_size;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-    if (!priv->body_file)
+    if (!priv->body)
         return MILTER_STATUS_NOT_CHANGE;
 
-    chunk_size =
-        milter_manager_configuration_get_chunk_size(priv->configuration);
-    io_status = g_io_channel_read_chars(priv->body_file,
-                                        buffer, chunk_size,
-                                        &read_size, &error);
-
-    child = MILTER_MANAGER_CHILD(context);
-    switch (io_status) {
-    case G_IO_STATUS_ERROR:
-        status = milter_manager_child_get_fallback_status(child);
-        break;
-    case G_IO_STATUS_NORMAL:
-        if (milter_server_context_body(context, buffer, read_size)) {
-            status = MILTER_STATUS_PROGRESS;
-        } else {
-            status = milter_manager_child_get_fallback_status(child);
-        }
-        break;
-    case G_IO_STATUS_EOF:
-        status = MILTER_STATUS_NOT_CHANGE;
-        break;
-    case G_IO_STATUS_AGAIN:
-        status = MILTER_STATUS_PROGRESS;
-        break;
-    default:
-        status = milter_manager_child_get_fallback_status(child);
-        break;
-    }
-
-    if (error) {
-        milter_error("[%u] [children][error][body][send] [%u] %s: %s",
-                     priv->tag,
-                     milter_agent_get_tag(MILTER_AGENT(context)),
-                     error->message,
-                     milter_server_context_get_name(context));
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children), error);
-        g_error_free(error);
-
-        status = milter_manager_child_get_fallback_status(child);
-    }
-
-    return status;
-}
-
-static MilterStatus
-send_body_to_child_string (MilterManagerChildren *children,
-                           MilterServerContext *context)
-{
-    MilterStatus status = MILTER_STATUS_PROGRESS;
-    MilterManagerChildrenPrivate *priv;
-    gsize chunk_size, write_size;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-    if (priv->sent_body_offset >= priv->body->len)
+    body_size = milter_manager_body_spool_get_size(priv->body);
+    if (priv->sent_body_offset >= body_size)
         return MILTER_STATUS_NOT_CHANGE;
 
+    body = milter_manager_body_spool_get_data(priv->body);
     chunk_size =
         milter_manager_configuration_get_chunk_size(priv->configuration);
-    write_size = MIN(priv->body->len - priv->sent_body_offset, chunk_size);
+    write_size = MIN(body_size - priv->sent_body_offset, chunk_size);
     if (milter_server_context_body(context,
-                                   priv->body->str + priv->sent_body_offset,
+                                   body + priv->sent_body_offset,
                                    write_size)) {
         priv->sent_body_offset += write_size;
         init_command_waiting_child_queue(children, MILTER_COMMAND_BODY);
@@ -3998,10 +4994,7 @@ send_body_to_child (MilterManagerChildren *children, MilterServerContext *contex
         return MILTER_STATUS_NOT_CHANGE;
     }
 
-    if (priv->body)
-        status = send_body_to_child_string(children, context);
-    else
-        status = send_body_to_child_file(children, context);
+    status = send_body_chunk_to_child(children, context);
 
     if (status == MILTER_STATUS_PROGRESS &&
         !milter_server_context_need_reply(context, priv->processing_state)) {
@@ -4055,11 +5048,13 @@ milter_manager_children_end_of_message (MilterManagerChildren *children,
         g_free(priv->end_of_message_chunk);
     priv->end_of_message_chunk = g_strdup(chunk);
     priv->end_of_message_size = size;
-    if (priv->body_file)
-        g_io_channel_seek_position(priv->body_file, 0, G_SEEK_SET, NULL);
 
     priv->state = MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE;
     priv->processing_state = priv->state;
+    if (!priv->command_waiting_child_queue)
+        return start_parallel_children(children);
+
+    start_parallel_children(children);
     return MILTER_STATUS_PROGRESS ==
         send_command_to_first_waiting_child(children,
                                             MILTER_COMMAND_END_OF_MESSAGE);
@@ -4088,6 +5083,9 @@ milter_manager_children_quit (MilterManagerChildren *children)
         if (state == MILTER_SERVER_CONTEXT_STATE_QUIT)
             continue;
 
+        if (push_pooled_connection(children, context, &success))
+            continue;
+
         if (!milter_server_context_quit(context))
             success = FALSE;
     }
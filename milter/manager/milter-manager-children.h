@@ -64,11 +64,18 @@ GType                  milter_manager_children_get_type    (void) G_GNUC_CONST;
 
 MilterManagerChildren *milter_manager_children_new         (MilterManagerConfiguration *configuration,
                                                             MilterEventLoop            *event_loop);
+void                   milter_manager_children_reset       (MilterManagerChildren *children);
+void                   milter_manager_children_reuse       (MilterManagerChildren      *children,
+                                                            MilterManagerConfiguration *configuration,
+                                                            MilterEventLoop            *event_loop);
 
 void                   milter_manager_children_add_child   (MilterManagerChildren *children,
                                                             MilterManagerChild    *child);
 guint                  milter_manager_children_length      (MilterManagerChildren *children);
 GList                 *milter_manager_children_get_children(MilterManagerChildren *children);
+MilterManagerConfiguration *
+                       milter_manager_children_get_configuration
+                                                           (MilterManagerChildren *children);
 void                   milter_manager_children_foreach     (MilterManagerChildren *children,
                                                             GFunc                  func,
                                                             gpointer               user_data);
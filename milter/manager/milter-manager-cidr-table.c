@@ -0,0 +1,277 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "milter-manager-cidr-table.h"
+
+#define IPV4_ADDRESS_SIZE 4
+#define IPV6_ADDRESS_SIZE 16
+
+/*
+ * A binary trie per address family. Each bit of an address
+ * selects a child so that a lookup visits at most 32 (IPv4)
+ * or 128 (IPv6) nodes. A node that terminates a network has
+ * non-zero "order" that is the position of the network in
+ * the table.
+ */
+typedef struct _Node Node;
+struct _Node
+{
+    Node *children[2];
+    gpointer value;
+    guint order;
+};
+
+struct _MilterManagerCIDRTable
+{
+    Node *ipv4_root;
+    Node *ipv6_root;
+    guint size;
+    guint last_order;
+    GDestroyNotify value_destroy;
+};
+
+GQuark
+milter_manager_cidr_table_error_quark (void)
+{
+    return g_quark_from_static_string("milter-manager-cidr-table-error-quark");
+}
+
+MilterManagerCIDRTable *
+milter_manager_cidr_table_new (GDestroyNotify value_destroy)
+{
+    MilterManagerCIDRTable *table;
+
+    table = g_new0(MilterManagerCIDRTable, 1);
+    table->value_destroy = value_destroy;
+
+    return table;
+}
+
+static void
+node_free (MilterManagerCIDRTable *table, Node *node)
+{
+    if (!node)
+        return;
+
+    node_free(table, node->children[0]);
+    node_free(table, node->children[1]);
+    if (node->order > 0 && table->value_destroy)
+        table->value_destroy(node->value);
+    g_slice_free(Node, node);
+}
+
+void
+milter_manager_cidr_table_clear (MilterManagerCIDRTable *table)
+{
+    node_free(table, table->ipv4_root);
+    table->ipv4_root = NULL;
+    node_free(table, table->ipv6_root);
+    table->ipv6_root = NULL;
+    table->size = 0;
+    table->last_order = 0;
+}
+
+void
+milter_manager_cidr_table_free (MilterManagerCIDRTable *table)
+{
+    milter_manager_cidr_table_clear(table);
+    g_free(table);
+}
+
+static gboolean
+parse_address (const gchar *address, gint *family, guint8 *bytes)
+{
+    if (strchr(address, ':')) {
+        *family = AF_INET6;
+        return inet_pton(AF_INET6, address, bytes) == 1;
+    } else {
+        *family = AF_INET;
+        return inet_pton(AF_INET, address, bytes) == 1;
+    }
+}
+
+#define BIT_AT(bytes, i) (((bytes)[(i) / 8] >> (7 - (i) % 8)) & 1)
+
+static Node **
+root_for_family (MilterManagerCIDRTable *table, gint family)
+{
+    if (family == AF_INET6)
+        return &(table->ipv6_root);
+    else
+        return &(table->ipv4_root);
+}
+
+gboolean
+milter_manager_cidr_table_add (MilterManagerCIDRTable *table,
+                               const gchar *network,
+                               gpointer value,
+                               GError **error)
+{
+    gchar *address;
+    const gchar *prefix;
+    guint8 bytes[IPV6_ADDRESS_SIZE];
+    gint family;
+    guint prefix_length, max_prefix_length, i;
+    Node **node;
+
+    prefix = strchr(network, '/');
+    if (prefix)
+        address = g_strndup(network, prefix - network);
+    else
+        address = g_strdup(network);
+    if (!parse_address(address, &family, bytes)) {
+        g_set_error(error,
+                    MILTER_MANAGER_CIDR_TABLE_ERROR,
+                    MILTER_MANAGER_CIDR_TABLE_ERROR_INVALID_ADDRESS,
+                    "invalid address: <%s>", network);
+        g_free(address);
+        if (table->value_destroy)
+            table->value_destroy(value);
+        return FALSE;
+    }
+    g_free(address);
+
+    if (family == AF_INET6)
+        max_prefix_length = IPV6_ADDRESS_SIZE * 8;
+    else
+        max_prefix_length = IPV4_ADDRESS_SIZE * 8;
+
+    if (prefix) {
+        gchar *end;
+        gulong parsed_prefix_length;
+
+        /* strtoul() accepts leading spaces and a sign. */
+        parsed_prefix_length = strtoul(prefix + 1, &end, 10);
+        if (!g_ascii_isdigit(prefix[1]) || *end != '\0' ||
+            parsed_prefix_length > max_prefix_length) {
+            g_set_error(error,
+                        MILTER_MANAGER_CIDR_TABLE_ERROR,
+                        MILTER_MANAGER_CIDR_TABLE_ERROR_INVALID_PREFIX_LENGTH,
+                        "invalid prefix length: <%s>", network);
+            if (table->value_destroy)
+                table->value_destroy(value);
+            return FALSE;
+        }
+        prefix_length = parsed_prefix_length;
+    } else {
+        prefix_length = max_prefix_length;
+    }
+
+    node = root_for_family(table, family);
+    for (i = 0; ; i++) {
+        if (!*node)
+            *node = g_slice_new0(Node);
+        if (i == prefix_length)
+            break;
+        node = &((*node)->children[BIT_AT(bytes, i)]);
+    }
+
+    /* The first network wins like Postfix's cidr_table. */
+    if ((*node)->order > 0) {
+        if (table->value_destroy)
+            table->value_destroy(value);
+    } else {
+        (*node)->value = value;
+        (*node)->order = ++table->last_order;
+        table->size++;
+    }
+
+    return TRUE;
+}
+
+static gpointer
+lookup (MilterManagerCIDRTable *table, gint family, const guint8 *bytes)
+{
+    Node *node, *found = NULL;
+    guint i, n_bits;
+
+    if (family == AF_INET6)
+        n_bits = IPV6_ADDRESS_SIZE * 8;
+    else
+        n_bits = IPV4_ADDRESS_SIZE * 8;
+
+    node = *root_for_family(table, family);
+    for (i = 0; node; i++) {
+        if (node->order > 0 && (!found || node->order < found->order))
+            found = node;
+        if (i == n_bits)
+            break;
+        node = node->children[BIT_AT(bytes, i)];
+    }
+
+    return found ? found->value : NULL;
+}
+
+gpointer
+milter_manager_cidr_table_lookup (MilterManagerCIDRTable *table,
+                                  const gchar *address)
+{
+    guint8 bytes[IPV6_ADDRESS_SIZE];
+    gint family;
+
+    if (!parse_address(address, &family, bytes))
+        return NULL;
+
+    return lookup(table, family, bytes);
+}
+
+gpointer
+milter_manager_cidr_table_lookup_address (MilterManagerCIDRTable *table,
+                                          const struct sockaddr *address)
+{
+    switch (address->sa_family) {
+    case AF_INET:
+    {
+        const struct sockaddr_in *address_inet;
+
+        address_inet = (const struct sockaddr_in *)address;
+        return lookup(table, AF_INET,
+                      (const guint8 *)&(address_inet->sin_addr));
+    }
+    case AF_INET6:
+    {
+        const struct sockaddr_in6 *address_inet6;
+
+        address_inet6 = (const struct sockaddr_in6 *)address;
+        return lookup(table, AF_INET6,
+                      (const guint8 *)&(address_inet6->sin6_addr));
+    }
+    default:
+        return NULL;
+    }
+}
+
+guint
+milter_manager_cidr_table_get_size (MilterManagerCIDRTable *table)
+{
+    return table->size;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -0,0 +1,76 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MANAGER_CIDR_TABLE_H__
+#define __MILTER_MANAGER_CIDR_TABLE_H__
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define MILTER_MANAGER_CIDR_TABLE_ERROR           (milter_manager_cidr_table_error_quark())
+
+typedef enum
+{
+    MILTER_MANAGER_CIDR_TABLE_ERROR_INVALID_ADDRESS,
+    MILTER_MANAGER_CIDR_TABLE_ERROR_INVALID_PREFIX_LENGTH
+} MilterManagerCIDRTableError;
+
+typedef struct _MilterManagerCIDRTable MilterManagerCIDRTable;
+
+GQuark                  milter_manager_cidr_table_error_quark (void);
+
+MilterManagerCIDRTable *milter_manager_cidr_table_new
+                                        (GDestroyNotify value_destroy);
+void                    milter_manager_cidr_table_free
+                                        (MilterManagerCIDRTable *table);
+
+/*
+ * Networks are written as "ADDRESS[/PREFIX_LENGTH]". When
+ * some networks match an address, the value of the network
+ * that was added first is used like Postfix's cidr_table.
+ * The table owns @value even if it isn't stored because the
+ * network is invalid or duplicated.
+ */
+gboolean                milter_manager_cidr_table_add
+                                        (MilterManagerCIDRTable *table,
+                                         const gchar *network,
+                                         gpointer value,
+                                         GError **error);
+gpointer                milter_manager_cidr_table_lookup
+                                        (MilterManagerCIDRTable *table,
+                                         const gchar *address);
+gpointer                milter_manager_cidr_table_lookup_address
+                                        (MilterManagerCIDRTable *table,
+                                         const struct sockaddr *address);
+guint                   milter_manager_cidr_table_get_size
+                                        (MilterManagerCIDRTable *table);
+void                    milter_manager_cidr_table_clear
+                                        (MilterManagerCIDRTable *table);
+
+G_END_DECLS
+
+#endif /* __MILTER_MANAGER_CIDR_TABLE_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -37,6 +37,7 @@
 #define DEFAULT_FALLBACK_STATUS_AT_DISCONNECT MILTER_STATUS_TEMPORARY_FAILURE
 #define DEFAULT_MAINTENANCE_INTERVAL 10
 #define DEFAULT_CONNECTION_CHECK_INTERVAL 0
+#define MAX_N_THREADS 1000
 
 #define MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(obj)                   \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                                 \
@@ -77,11 +78,14 @@ struct _MilterManagerConfigurationPrivate
     guint connection_check_interval;
     MilterClientEventLoopBackend event_loop_backend;
     guint n_workers;
+    guint n_threads;
     guint default_packet_buffer_size;
     gboolean use_syslog;
     gchar *syslog_facility;
     guint chunk_size;
     guint max_pending_finished_sessions;
+    guint max_pooled_sessions;
+    gchar *result_stream_spec;
 };
 
 enum
@@ -114,12 +118,15 @@ enum
     PROP_CONNECTION_CHECK_INTERVAL,
     PROP_EVENT_LOOP_BACKEND,
     PROP_N_WORKERS,
+    PROP_N_THREADS,
     PROP_DEFAULT_PACKET_BUFFER_SIZE,
     PROP_PREFIX,
     PROP_USE_SYSLOG,
     PROP_SYSLOG_FACILITY,
     PROP_CHUNK_SIZE,
-    PROP_MAX_PENDING_FINISHED_SESSIONS
+    PROP_MAX_PENDING_FINISHED_SESSIONS,
+    PROP_MAX_POOLED_SESSIONS,
+    PROP_RESULT_STREAM_SPEC
 };
 
 enum
@@ -417,6 +424,14 @@ milter_manager_configuration_class_init (MilterManagerConfigurationClass *klass)
                              G_PARAM_READWRITE);
     g_object_class_install_property(gobject_class, PROP_N_WORKERS, spec);
 
+    spec = g_param_spec_uint("n-threads",
+                             "Number of threads",
+                             "The number of threads that process sessions "
+                             "by their own event loops",
+                             0, MAX_N_THREADS, 0,
+                             G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_N_THREADS, spec);
+
     spec = g_param_spec_uint("default-packet-buffer-size",
                              "Default packet buffer size",
                              "The default packet buffer size of client contexts "
@@ -466,6 +481,26 @@ milter_manager_configuration_class_init (MilterManagerConfigurationClass *klass)
                                     PROP_MAX_PENDING_FINISHED_SESSIONS,
                                     spec);
 
+    spec = g_param_spec_uint("max-pooled-sessions",
+                             "Maximum number of pooled sessions",
+                             "The maximum number of finished session objects "
+                             "kept for reuse by milter-manager",
+                             0, G_MAXUINT, 0,
+                             G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_MAX_POOLED_SESSIONS,
+                                    spec);
+
+    spec = g_param_spec_string("result-stream-spec",
+                               "Result stream spec",
+                               "The spec of the stream to which session "
+                               "results are written",
+                               NULL,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_RESULT_STREAM_SPEC,
+                                    spec);
+
     signals[CONNECTED] =
         g_signal_new("connected",
                      G_TYPE_FROM_CLASS(klass),
@@ -516,10 +551,12 @@ milter_manager_configuration_init (MilterManagerConfiguration *configuration)
                                             (GDestroyNotify)g_dataset_destroy);
     priv->connection_check_interval = DEFAULT_CONNECTION_CHECK_INTERVAL;
     priv->n_workers = 0;
+    priv->n_threads = 0;
     priv->default_packet_buffer_size = 0;
     priv->syslog_facility = NULL;
     priv->chunk_size = MILTER_CHUNK_SIZE;
     priv->max_pending_finished_sessions = 0;
+    priv->result_stream_spec = NULL;
 
     config_dir_env = g_getenv("MILTER_MANAGER_CONFIG_DIR");
     if (config_dir_env)
@@ -539,7 +576,10 @@ dispose (GObject *object)
     priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
 
     milter_manager_configuration_clear_load_paths(configuration);
-    milter_manager_configuration_clear(configuration, &error);
+    /* Signal handlers are destroyed by GObject. The last
+     * reference of a snapshot may be released by a session
+     * thread, so they aren't scanned here. */
+    clear_except_signal_handlers(configuration, &error);
     if (error) {
         milter_error("[configuration][dispose][clear][error] %s",
                      error->message);
@@ -676,6 +716,9 @@ set_property (GObject      *object,
     case PROP_N_WORKERS:
         milter_manager_configuration_set_n_workers(config, g_value_get_uint(value));
         break;
+    case PROP_N_THREADS:
+        milter_manager_configuration_set_n_threads(config, g_value_get_uint(value));
+        break;
     case PROP_DEFAULT_PACKET_BUFFER_SIZE:
         milter_manager_configuration_set_default_packet_buffer_size(
             config,
@@ -697,6 +740,14 @@ set_property (GObject      *object,
         milter_manager_configuration_set_max_pending_finished_sessions(
             config, g_value_get_uint(value));
         break;
+    case PROP_MAX_POOLED_SESSIONS:
+        milter_manager_configuration_set_max_pooled_sessions(
+            config, g_value_get_uint(value));
+        break;
+    case PROP_RESULT_STREAM_SPEC:
+        milter_manager_configuration_set_result_stream_spec(
+            config, g_value_get_string(value));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -794,6 +845,9 @@ get_property (GObject    *object,
     case PROP_N_WORKERS:
         g_value_set_uint(value, priv->n_workers);
         break;
+    case PROP_N_THREADS:
+        g_value_set_uint(value, priv->n_threads);
+        break;
     case PROP_DEFAULT_PACKET_BUFFER_SIZE:
         g_value_set_uint(value, priv->default_packet_buffer_size);
         break;
@@ -812,6 +866,12 @@ get_property (GObject    *object,
     case PROP_MAX_PENDING_FINISHED_SESSIONS:
         g_value_set_uint(value, priv->max_pending_finished_sessions);
         break;
+    case PROP_MAX_POOLED_SESSIONS:
+        g_value_set_uint(value, priv->max_pooled_sessions);
+        break;
+    case PROP_RESULT_STREAM_SPEC:
+        g_value_set_string(value, priv->result_stream_spec);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -1736,6 +1796,165 @@ milter_manager_configuration_setup_children (MilterManagerConfiguration *configu
     }
 }
 
+static gboolean
+check_multi_thread_applicable_condition (MilterManagerEgg *egg,
+                                         MilterManagerApplicableCondition *condition,
+                                         GError **error)
+{
+    guint i;
+    gboolean scripted = FALSE;
+
+    for (i = 0; i < MILTER_MANAGER_APPLICABLE_CONDITION_N_STAGES; i++) {
+        if (milter_manager_applicable_condition_has_stopper(condition, i)) {
+            scripted = TRUE;
+            break;
+        }
+    }
+    if (!scripted)
+        scripted = g_signal_has_handler_pending(
+            condition,
+            g_signal_lookup("attach-to",
+                            MILTER_TYPE_MANAGER_APPLICABLE_CONDITION),
+            0, FALSE);
+    if (!scripted)
+        return TRUE;
+
+    g_set_error(error,
+                MILTER_MANAGER_CONFIGURATION_ERROR,
+                MILTER_MANAGER_CONFIGURATION_ERROR_MULTI_THREAD,
+                "applicable condition <%s> of milter <%s> "
+                "can't be used in multi thread mode",
+                milter_manager_applicable_condition_get_name(condition),
+                milter_manager_egg_get_name(egg));
+    return FALSE;
+}
+
+/*
+ * Session threads in multi thread mode never run
+ * configuration scripts. This refuses configuration that
+ * needs them while sessions are processed: applicable
+ * conditions of enabled milters, "connected" and "hatched"
+ * hooks, connection checkers and pooled sessions.
+ */
+gboolean
+milter_manager_configuration_check_multi_thread (MilterManagerConfiguration *configuration,
+                                                 GError **error)
+{
+    MilterManagerConfigurationPrivate *priv;
+    GList *node;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+
+    if (priv->connection_check_interval > 0) {
+        g_set_error(error,
+                    MILTER_MANAGER_CONFIGURATION_ERROR,
+                    MILTER_MANAGER_CONFIGURATION_ERROR_MULTI_THREAD,
+                    "manager.connection_check_interval "
+                    "can't be used in multi thread mode: <%u>",
+                    priv->connection_check_interval);
+        return FALSE;
+    }
+
+    if (priv->max_pooled_sessions > 0) {
+        g_set_error(error,
+                    MILTER_MANAGER_CONFIGURATION_ERROR,
+                    MILTER_MANAGER_CONFIGURATION_ERROR_MULTI_THREAD,
+                    "manager.max_pooled_sessions "
+                    "can't be used in multi thread mode: <%u>",
+                    priv->max_pooled_sessions);
+        return FALSE;
+    }
+
+    if (g_signal_has_handler_pending(configuration, signals[CONNECTED],
+                                     0, FALSE)) {
+        g_set_error(error,
+                    MILTER_MANAGER_CONFIGURATION_ERROR,
+                    MILTER_MANAGER_CONFIGURATION_ERROR_MULTI_THREAD,
+                    "\"connected\" hooks, e.g. connection checkers, "
+                    "can't be used in multi thread mode");
+        return FALSE;
+    }
+
+    for (node = priv->eggs; node; node = g_list_next(node)) {
+        MilterManagerEgg *egg = node->data;
+        const GList *condition_node;
+
+        if (!milter_manager_egg_is_enabled(egg))
+            continue;
+
+        if (g_signal_has_handler_pending(
+                egg,
+                g_signal_lookup("hatched", MILTER_TYPE_MANAGER_EGG),
+                0, FALSE)) {
+            g_set_error(error,
+                        MILTER_MANAGER_CONFIGURATION_ERROR,
+                        MILTER_MANAGER_CONFIGURATION_ERROR_MULTI_THREAD,
+                        "\"hatched\" hooks of milter <%s> "
+                        "can't be used in multi thread mode",
+                        milter_manager_egg_get_name(egg));
+            return FALSE;
+        }
+
+        for (condition_node = milter_manager_egg_get_applicable_conditions(egg);
+             condition_node;
+             condition_node = g_list_next(condition_node)) {
+            if (!check_multi_thread_applicable_condition(egg,
+                                                         condition_node->data,
+                                                         error))
+                return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/*
+ * Creates a configuration for session threads in multi
+ * thread mode. It has the values, eggs and applicable
+ * conditions of @configuration but no configuration
+ * script, so it isn't changed by reloading. Eggs and
+ * applicable conditions are shared because reloading
+ * replaces them instead of changing them.
+ */
+MilterManagerConfiguration *
+milter_manager_configuration_snapshot (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfiguration *snapshot;
+    MilterManagerConfigurationPrivate *priv, *snapshot_priv;
+    GObjectClass *base_class;
+    GParamSpec **specs;
+    guint i, n_specs;
+
+    snapshot = g_object_new(MILTER_TYPE_MANAGER_CONFIGURATION, NULL);
+
+    base_class = g_type_class_ref(MILTER_TYPE_MANAGER_CONFIGURATION);
+    specs = g_object_class_list_properties(base_class, &n_specs);
+    for (i = 0; i < n_specs; i++) {
+        GValue value = {0};
+
+        if ((specs[i]->flags & G_PARAM_READWRITE) != G_PARAM_READWRITE)
+            continue;
+
+        g_value_init(&value, specs[i]->value_type);
+        g_object_get_property(G_OBJECT(configuration), specs[i]->name, &value);
+        g_object_set_property(G_OBJECT(snapshot), specs[i]->name, &value);
+        g_value_unset(&value);
+    }
+    g_free(specs);
+    g_type_class_unref(base_class);
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    snapshot_priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(snapshot);
+    snapshot_priv->eggs = g_list_copy(priv->eggs);
+    g_list_foreach(snapshot_priv->eggs, (GFunc)g_object_ref, NULL);
+    snapshot_priv->applicable_conditions =
+        g_list_copy(priv->applicable_conditions);
+    g_list_foreach(snapshot_priv->applicable_conditions,
+                   (GFunc)g_object_ref, NULL);
+
+    return snapshot;
+}
+
 MilterStatus
 milter_manager_configuration_get_fallback_status
                                      (MilterManagerConfiguration *configuration)
@@ -1947,9 +2166,16 @@ clear_manager (MilterManagerConfigurationPrivate *priv)
     priv->connection_check_interval = DEFAULT_CONNECTION_CHECK_INTERVAL;
     priv->event_loop_backend = MILTER_CLIENT_EVENT_LOOP_BACKEND_GLIB;
     priv->n_workers = 0;
+    priv->n_threads = 0;
     priv->default_packet_buffer_size = 0;
     priv->chunk_size = MILTER_CHUNK_SIZE;
     priv->max_pending_finished_sessions = 0;
+    priv->max_pooled_sessions = 0;
+
+    if (priv->result_stream_spec) {
+        g_free(priv->result_stream_spec);
+        priv->result_stream_spec = NULL;
+    }
 }
 
 static void
@@ -2032,16 +2258,15 @@ clear_log (MilterManagerConfigurationPrivate *priv)
     }
 }
 
-gboolean
-milter_manager_configuration_clear (MilterManagerConfiguration *configuration,
-                                    GError **error)
+static gboolean
+clear_except_signal_handlers (MilterManagerConfiguration *configuration,
+                              GError **error)
 {
     MilterManagerConfigurationPrivate *priv;
     MilterManagerConfigurationClass *configuration_class;
 
     priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
 
-    milter_manager_configuration_clear_signal_handlers(configuration);
     milter_manager_configuration_clear_eggs(configuration);
     milter_manager_configuration_clear_applicable_conditions(configuration);
     clear_controller(priv);
@@ -2069,6 +2294,14 @@ milter_manager_configuration_clear (MilterManagerConfiguration *configuration,
     return TRUE;
 }
 
+gboolean
+milter_manager_configuration_clear (MilterManagerConfiguration *configuration,
+                                    GError **error)
+{
+    milter_manager_configuration_clear_signal_handlers(configuration);
+    return clear_except_signal_handlers(configuration, error);
+}
+
 GPid
 milter_manager_configuration_fork (MilterManagerConfiguration *configuration)
 {
@@ -2330,6 +2563,25 @@ milter_manager_configuration_set_n_workers (MilterManagerConfiguration *configur
     priv->n_workers = n_workers;
 }
 
+guint
+milter_manager_configuration_get_n_threads (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    return priv->n_threads;
+}
+
+void
+milter_manager_configuration_set_n_threads (MilterManagerConfiguration *configuration,
+                                            guint                       n_threads)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    priv->n_threads = n_threads;
+}
+
 guint
 milter_manager_configuration_get_default_packet_buffer_size (MilterManagerConfiguration *configuration)
 {
@@ -2434,6 +2686,43 @@ milter_manager_configuration_set_max_pending_finished_sessions (MilterManagerCon
     priv->max_pending_finished_sessions = n_sessions;
 }
 
+guint
+milter_manager_configuration_get_max_pooled_sessions (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    return priv->max_pooled_sessions;
+}
+
+void
+milter_manager_configuration_set_max_pooled_sessions (MilterManagerConfiguration *configuration,
+                                                      guint                       n_sessions)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    priv->max_pooled_sessions = n_sessions;
+}
+
+const gchar *
+milter_manager_configuration_get_result_stream_spec (MilterManagerConfiguration *configuration)
+{
+    return MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration)->result_stream_spec;
+}
+
+void
+milter_manager_configuration_set_result_stream_spec (MilterManagerConfiguration *configuration,
+                                                     const gchar                *spec)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    if (priv->result_stream_spec)
+        g_free(priv->result_stream_spec);
+    priv->result_stream_spec = g_strdup(spec);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
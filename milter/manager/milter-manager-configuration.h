@@ -42,7 +42,8 @@ typedef enum
     MILTER_MANAGER_CONFIGURATION_ERROR_NOT_IMPLEMENTED,
     MILTER_MANAGER_CONFIGURATION_ERROR_NOT_EXIST,
     MILTER_MANAGER_CONFIGURATION_ERROR_UNKNOWN,
-    MILTER_MANAGER_CONFIGURATION_ERROR_SAVE
+    MILTER_MANAGER_CONFIGURATION_ERROR_SAVE,
+    MILTER_MANAGER_CONFIGURATION_ERROR_MULTI_THREAD
 } MilterManagerConfigurationError;
 
 typedef struct _MilterManagerConfigurationClass MilterManagerConfigurationClass;
@@ -241,6 +242,13 @@ void          milter_manager_configuration_event_loop_created
                                      (MilterManagerConfiguration *configuration,
                                       MilterEventLoop            *loop);
 
+gboolean      milter_manager_configuration_check_multi_thread
+                                     (MilterManagerConfiguration *configuration,
+                                      GError                    **error);
+MilterManagerConfiguration *
+              milter_manager_configuration_snapshot
+                                     (MilterManagerConfiguration *configuration);
+
 guint         milter_manager_configuration_get_suspend_time_on_unacceptable
                                      (MilterManagerConfiguration *configuration);
 void          milter_manager_configuration_set_suspend_time_on_unacceptable
@@ -363,6 +371,12 @@ void          milter_manager_configuration_set_n_workers
                                      (MilterManagerConfiguration *configuration,
                                       guint                       n_workers);
 
+guint         milter_manager_configuration_get_n_threads
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_n_threads
+                                     (MilterManagerConfiguration *configuration,
+                                      guint                       n_threads);
+
 guint         milter_manager_configuration_get_default_packet_buffer_size
                                      (MilterManagerConfiguration *configuration);
 void          milter_manager_configuration_set_default_packet_buffer_size
@@ -396,6 +410,18 @@ void          milter_manager_configuration_set_max_pending_finished_sessions
                                      (MilterManagerConfiguration *configuration,
                                       guint                       n_sessions);
 
+guint         milter_manager_configuration_get_max_pooled_sessions
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_max_pooled_sessions
+                                     (MilterManagerConfiguration *configuration,
+                                      guint                       n_sessions);
+
+const gchar  *milter_manager_configuration_get_result_stream_spec
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_result_stream_spec
+                                     (MilterManagerConfiguration *configuration,
+                                      const gchar                *spec);
+
 G_END_DECLS
 
 #endif /* __MILTER_MANAGER_CONFIGURATION_H__ */
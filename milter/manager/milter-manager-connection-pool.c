@@ -0,0 +1,490 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "milter-manager-connection-pool.h"
+#include "../core/milter-glib-compatible.h"
+
+#define MILTER_MANAGER_CONNECTION_POOL_GET_PRIVATE(obj)                 \
+    (G_TYPE_INSTANCE_GET_PRIVATE((obj),                                 \
+                                 MILTER_TYPE_MANAGER_CONNECTION_POOL,   \
+                                 MilterManagerConnectionPoolPrivate))
+
+typedef struct _MilterManagerConnectionPoolPrivate MilterManagerConnectionPoolPrivate;
+struct _MilterManagerConnectionPoolPrivate
+{
+    GQueue *connections;
+    GList *evicted_connections;
+    GMutex *mutex;
+    guint max_size;
+    gdouble idle_timeout;
+    guint n_hits;
+    guint n_misses;
+};
+
+/*
+ * An idle connection that is negotiated with "option" and
+ * is waiting for the next session. It is watched while it
+ * is idle because the only thing a milter may do on an
+ * idle connection is closing it.
+ *
+ * Its watches belong to the event loop of the "owner"
+ * thread. So only the owner thread frees it. A connection
+ * evicted by another thread is moved to
+ * "evicted_connections" and freed by the owner thread later.
+ */
+typedef struct _IdleConnection IdleConnection;
+struct _IdleConnection
+{
+    MilterManagerConnectionPool *pool;
+    GThread *owner;
+    MilterEventLoop *loop;
+    GIOChannel *channel;
+    MilterOption *option;
+    MilterOption *reply_option;
+    MilterMacrosRequests *macros_requests;
+    guint watch_id;
+    guint timeout_id;
+};
+
+G_DEFINE_TYPE(MilterManagerConnectionPool, milter_manager_connection_pool,
+              G_TYPE_OBJECT)
+
+static void dispose        (GObject         *object);
+
+static void
+milter_manager_connection_pool_class_init (MilterManagerConnectionPoolClass *klass)
+{
+    GObjectClass *gobject_class;
+
+    gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->dispose      = dispose;
+
+    g_type_class_add_private(gobject_class,
+                             sizeof(MilterManagerConnectionPoolPrivate));
+}
+
+static void
+milter_manager_connection_pool_init (MilterManagerConnectionPool *pool)
+{
+    MilterManagerConnectionPoolPrivate *priv;
+
+    priv = MILTER_MANAGER_CONNECTION_POOL_GET_PRIVATE(pool);
+    priv->connections = g_queue_new();
+    priv->evicted_connections = NULL;
+    priv->mutex = g_mutex_new();
+    priv->max_size = 0;
+    priv->idle_timeout = MILTER_MANAGER_CONNECTION_POOL_DEFAULT_IDLE_TIMEOUT;
+    priv->n_hits = 0;
+    priv->n_misses = 0;
+}
+
+static void
+idle_connection_stop_watching (IdleConnection *connection)
+{
+    if (connection->watch_id > 0) {
+        milter_event_loop_remove(connection->loop, connection->watch_id);
+        connection->watch_id = 0;
+    }
+    if (connection->timeout_id > 0) {
+        milter_event_loop_remove(connection->loop, connection->timeout_id);
+        connection->timeout_id = 0;
+    }
+}
+
+static void
+idle_connection_free (IdleConnection *connection)
+{
+    idle_connection_stop_watching(connection);
+
+    if (connection->channel)
+        g_io_channel_unref(connection->channel);
+    if (connection->option)
+        g_object_unref(connection->option);
+    if (connection->reply_option)
+        g_object_unref(connection->reply_option);
+    if (connection->macros_requests)
+        g_object_unref(connection->macros_requests);
+    g_object_unref(connection->loop);
+
+    g_free(connection);
+}
+
+static void
+dispose (GObject *object)
+{
+    MilterManagerConnectionPoolPrivate *priv;
+
+    priv = MILTER_MANAGER_CONNECTION_POOL_GET_PRIVATE(object);
+
+    /* Session threads have been finished. So all connections
+     * can be freed here. */
+    if (priv->connections) {
+        g_queue_foreach(priv->connections, (GFunc)idle_connection_free, NULL);
+        g_queue_free(priv->connections);
+        priv->connections = NULL;
+    }
+    if (priv->evicted_connections) {
+        g_list_foreach(priv->evicted_connections,
+                       (GFunc)idle_connection_free, NULL);
+        g_list_free(priv->evicted_connections);
+        priv->evicted_connections = NULL;
+    }
+
+    if (priv->mutex) {
+        g_mutex_free(priv->mutex);
+        priv->mutex = NULL;
+    }
+
+    G_OBJECT_CLASS(milter_manager_connection_pool_parent_class)->dispose(object);
+}
+
+MilterManagerConnectionPool *
+milter_manager_connection_pool_new (void)
+{
+    return g_object_new(MILTER_TYPE_MANAGER_CONNECTION_POOL, NULL);
+}
+
+/*
+ * Must be called with the lock. A connection owned by the
+ * current thread is returned in @freed_connections to be
+ * freed without the lock.
+ */
+static void
+evict_connection (MilterManagerConnectionPoolPrivate *priv,
+                  IdleConnection *connection,
+                  GList **freed_connections)
+{
+    if (connection->owner == g_thread_self()) {
+        *freed_connections = g_list_prepend(*freed_connections, connection);
+    } else {
+        priv->evicted_connections =
+            g_list_prepend(priv->evicted_connections, connection);
+    }
+}
+
+static void
+free_evicted_connections (GList *connections)
+{
+    while (connections) {
+        IdleConnection *connection = connections->data;
+
+        milter_debug("[connection-pool][expire][evict] %d",
+                     g_io_channel_unix_get_fd(connection->channel));
+        idle_connection_free(connection);
+        connections = g_list_delete_link(connections, connections);
+    }
+}
+
+static void
+reap_evicted_connections (MilterManagerConnectionPool *pool)
+{
+    MilterManagerConnectionPoolPrivate *priv;
+    GList *node, *next, *freed_connections = NULL;
+
+    priv = MILTER_MANAGER_CONNECTION_POOL_GET_PRIVATE(pool);
+
+    g_mutex_lock(priv->mutex);
+    for (node = priv->evicted_connections; node; node = next) {
+        IdleConnection *connection = node->data;
+
+        next = g_list_next(node);
+        if (connection->owner != g_thread_self())
+            continue;
+        priv->evicted_connections =
+            g_list_delete_link(priv->evicted_connections, node);
+        freed_connections = g_list_prepend(freed_connections, connection);
+    }
+    g_mutex_unlock(priv->mutex);
+
+    free_evicted_connections(freed_connections);
+}
+
+/*
+ * Called on the owner thread. So @connection is alive even
+ * if another thread evicted it.
+ */
+static void
+expire_connection (IdleConnection *connection, const gchar *reason)
+{
+    MilterManagerConnectionPool *pool;
+    MilterManagerConnectionPoolPrivate *priv;
+    GList *node;
+
+    pool = connection->pool;
+    priv = MILTER_MANAGER_CONNECTION_POOL_GET_PRIVATE(pool);
+
+    milter_debug("[connection-pool][expire][%s] %d",
+                 reason, g_io_channel_unix_get_fd(connection->channel));
+    g_mutex_lock(priv->mutex);
+    node = g_list_find(priv->evicted_connections, connection);
+    if (node)
+        priv->evicted_connections =
+            g_list_delete_link(priv->evicted_connections, node);
+    else
+        g_queue_remove(priv->connections, connection);
+    g_mutex_unlock(priv->mutex);
+    idle_connection_free(connection);
+
+    reap_evicted_connections(pool);
+}
+
+static gboolean
+cb_idle_connection_event (GIOChannel *channel, GIOCondition condition,
+                          gpointer user_data)
+{
+    IdleConnection *connection = user_data;
+
+    connection->watch_id = 0;
+    expire_connection(connection, "closed");
+
+    return FALSE;
+}
+
+static gboolean
+cb_idle_connection_timeout (gpointer user_data)
+{
+    IdleConnection *connection = user_data;
+
+    connection->timeout_id = 0;
+    expire_connection(connection, "timeout");
+
+    return FALSE;
+}
+
+void
+milter_manager_connection_pool_set_max_size (MilterManagerConnectionPool *pool,
+                                             guint max_size)
+{
+    MilterManagerConnectionPoolPrivate *priv;
+    GList *freed_connections = NULL;
+
+    priv = MILTER_MANAGER_CONNECTION_POOL_GET_PRIVATE(pool);
+    g_mutex_lock(priv->mutex);
+    priv->max_size = max_size;
+    while (g_queue_get_length(priv->connections) > priv->max_size) {
+        evict_connection(priv,
+                         g_queue_pop_tail(priv->connections),
+                         &freed_connections);
+    }
+    g_mutex_unlock(priv->mutex);
+
+    free_evicted_connections(freed_connections);
+}
+
+guint
+milter_manager_connection_pool_get_max_size (MilterManagerConnectionPool *pool)
+{
+    return MILTER_MANAGER_CONNECTION_POOL_GET_PRIVATE(pool)->max_size;
+}
+
+void
+milter_manager_connection_pool_set_idle_timeout (MilterManagerConnectionPool *pool,
+                                                 gdouble idle_timeout)
+{
+    MILTER_MANAGER_CONNECTION_POOL_GET_PRIVATE(pool)->idle_timeout = idle_timeout;
+}
+
+gdouble
+milter_manager_connection_pool_get_idle_timeout (MilterManagerConnectionPool *pool)
+{
+    return MILTER_MANAGER_CONNECTION_POOL_GET_PRIVATE(pool)->idle_timeout;
+}
+
+gboolean
+milter_manager_connection_pool_is_enabled (MilterManagerConnectionPool *pool)
+{
+    return MILTER_MANAGER_CONNECTION_POOL_GET_PRIVATE(pool)->max_size > 0;
+}
+
+gboolean
+milter_manager_connection_pool_is_full (MilterManagerConnectionPool *pool)
+{
+    MilterManagerConnectionPoolPrivate *priv;
+    gboolean full;
+
+    priv = MILTER_MANAGER_CONNECTION_POOL_GET_PRIVATE(pool);
+    g_mutex_lock(priv->mutex);
+    full = g_queue_get_length(priv->connections) >= priv->max_size;
+    g_mutex_unlock(priv->mutex);
+
+    return full;
+}
+
+gboolean
+milter_manager_connection_pool_push (MilterManagerConnectionPool *pool,
+                                     MilterEventLoop *loop,
+                                     GIOChannel *channel,
+                                     MilterOption *option,
+                                     MilterOption *reply_option,
+                                     MilterMacrosRequests *macros_requests)
+{
+    MilterManagerConnectionPoolPrivate *priv;
+    IdleConnection *connection;
+
+    priv = MILTER_MANAGER_CONNECTION_POOL_GET_PRIVATE(pool);
+
+    reap_evicted_connections(pool);
+
+    g_mutex_lock(priv->mutex);
+    if (g_queue_get_length(priv->connections) >= priv->max_size) {
+        g_mutex_unlock(priv->mutex);
+        milter_debug("[connection-pool][push][full] %d <%u>",
+                     g_io_channel_unix_get_fd(channel), priv->max_size);
+        return FALSE;
+    }
+
+    connection = g_new0(IdleConnection, 1);
+    connection->pool = pool;
+    connection->owner = g_thread_self();
+    connection->loop = g_object_ref(loop);
+    connection->channel = g_io_channel_ref(channel);
+    connection->option = milter_option_copy(option);
+    connection->reply_option = milter_option_copy(reply_option);
+    if (macros_requests)
+        connection->macros_requests = g_object_ref(macros_requests);
+    connection->watch_id =
+        milter_event_loop_watch_io(loop,
+                                   channel,
+                                   G_IO_IN | G_IO_PRI |
+                                   G_IO_ERR | G_IO_HUP | G_IO_NVAL,
+                                   cb_idle_connection_event,
+                                   connection);
+    if (priv->idle_timeout > 0)
+        connection->timeout_id =
+            milter_event_loop_add_timeout(loop,
+                                          priv->idle_timeout,
+                                          cb_idle_connection_timeout,
+                                          connection);
+    g_queue_push_head(priv->connections, connection);
+
+    milter_debug("[connection-pool][push] %d <%u/%u>",
+                 g_io_channel_unix_get_fd(channel),
+                 g_queue_get_length(priv->connections),
+                 priv->max_size);
+    g_mutex_unlock(priv->mutex);
+
+    return TRUE;
+}
+
+gboolean
+milter_manager_connection_pool_pop (MilterManagerConnectionPool *pool,
+                                    MilterEventLoop *loop,
+                                    MilterOption *option,
+                                    GIOChannel **channel,
+                                    MilterOption **reply_option,
+                                    MilterMacrosRequests **macros_requests)
+{
+    MilterManagerConnectionPoolPrivate *priv;
+    GList *node;
+
+    priv = MILTER_MANAGER_CONNECTION_POOL_GET_PRIVATE(pool);
+
+    reap_evicted_connections(pool);
+
+    g_mutex_lock(priv->mutex);
+    for (node = priv->connections->head; node; node = g_list_next(node)) {
+        IdleConnection *connection = node->data;
+
+        if (connection->loop != loop ||
+            connection->owner != g_thread_self())
+            continue;
+        if (!milter_option_equal(connection->option, option))
+            continue;
+
+        g_queue_delete_link(priv->connections, node);
+        priv->n_hits++;
+        milter_debug("[connection-pool][pop][hit] %d <%u/%u>",
+                     g_io_channel_unix_get_fd(connection->channel),
+                     g_queue_get_length(priv->connections),
+                     priv->max_size);
+        g_mutex_unlock(priv->mutex);
+
+        idle_connection_stop_watching(connection);
+
+        *channel = connection->channel;
+        connection->channel = NULL;
+        *reply_option = connection->reply_option;
+        connection->reply_option = NULL;
+        *macros_requests = connection->macros_requests;
+        connection->macros_requests = NULL;
+        idle_connection_free(connection);
+
+        return TRUE;
+    }
+
+    priv->n_misses++;
+    milter_debug("[connection-pool][pop][miss] <%u/%u>",
+                 g_queue_get_length(priv->connections),
+                 priv->max_size);
+    g_mutex_unlock(priv->mutex);
+
+    return FALSE;
+}
+
+void
+milter_manager_connection_pool_clear (MilterManagerConnectionPool *pool)
+{
+    MilterManagerConnectionPoolPrivate *priv;
+    IdleConnection *connection;
+    GList *freed_connections = NULL;
+
+    priv = MILTER_MANAGER_CONNECTION_POOL_GET_PRIVATE(pool);
+    g_mutex_lock(priv->mutex);
+    while ((connection = g_queue_pop_head(priv->connections))) {
+        evict_connection(priv, connection, &freed_connections);
+    }
+    g_mutex_unlock(priv->mutex);
+
+    free_evicted_connections(freed_connections);
+}
+
+guint
+milter_manager_connection_pool_get_n_idle_connections (MilterManagerConnectionPool *pool)
+{
+    MilterManagerConnectionPoolPrivate *priv;
+    guint n_idle_connections;
+
+    priv = MILTER_MANAGER_CONNECTION_POOL_GET_PRIVATE(pool);
+    g_mutex_lock(priv->mutex);
+    n_idle_connections = g_queue_get_length(priv->connections);
+    g_mutex_unlock(priv->mutex);
+
+    return n_idle_connections;
+}
+
+guint
+milter_manager_connection_pool_get_n_hits (MilterManagerConnectionPool *pool)
+{
+    return MILTER_MANAGER_CONNECTION_POOL_GET_PRIVATE(pool)->n_hits;
+}
+
+guint
+milter_manager_connection_pool_get_n_misses (MilterManagerConnectionPool *pool)
+{
+    return MILTER_MANAGER_CONNECTION_POOL_GET_PRIVATE(pool)->n_misses;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
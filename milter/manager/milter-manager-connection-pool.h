@@ -0,0 +1,102 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MANAGER_CONNECTION_POOL_H__
+#define __MILTER_MANAGER_CONNECTION_POOL_H__
+
+#include <glib-object.h>
+
+#include <milter/core.h>
+
+G_BEGIN_DECLS
+
+#define MILTER_MANAGER_CONNECTION_POOL_DEFAULT_IDLE_TIMEOUT 60.0
+
+#define MILTER_TYPE_MANAGER_CONNECTION_POOL            (milter_manager_connection_pool_get_type())
+#define MILTER_MANAGER_CONNECTION_POOL(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), MILTER_TYPE_MANAGER_CONNECTION_POOL, MilterManagerConnectionPool))
+#define MILTER_MANAGER_CONNECTION_POOL_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass), MILTER_TYPE_MANAGER_CONNECTION_POOL, MilterManagerConnectionPoolClass))
+#define MILTER_MANAGER_IS_CONNECTION_POOL(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj), MILTER_TYPE_MANAGER_CONNECTION_POOL))
+#define MILTER_MANAGER_IS_CONNECTION_POOL_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), MILTER_TYPE_MANAGER_CONNECTION_POOL))
+#define MILTER_MANAGER_CONNECTION_POOL_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj), MILTER_TYPE_MANAGER_CONNECTION_POOL, MilterManagerConnectionPoolClass))
+
+typedef struct _MilterManagerConnectionPool         MilterManagerConnectionPool;
+typedef struct _MilterManagerConnectionPoolClass    MilterManagerConnectionPoolClass;
+
+struct _MilterManagerConnectionPool
+{
+    GObject object;
+};
+
+struct _MilterManagerConnectionPoolClass
+{
+    GObjectClass parent_class;
+};
+
+GType                        milter_manager_connection_pool_get_type (void) G_GNUC_CONST;
+
+MilterManagerConnectionPool *milter_manager_connection_pool_new
+                                        (void);
+
+void                         milter_manager_connection_pool_set_max_size
+                                        (MilterManagerConnectionPool *pool,
+                                         guint max_size);
+guint                        milter_manager_connection_pool_get_max_size
+                                        (MilterManagerConnectionPool *pool);
+void                         milter_manager_connection_pool_set_idle_timeout
+                                        (MilterManagerConnectionPool *pool,
+                                         gdouble idle_timeout);
+gdouble                      milter_manager_connection_pool_get_idle_timeout
+                                        (MilterManagerConnectionPool *pool);
+
+gboolean                     milter_manager_connection_pool_is_enabled
+                                        (MilterManagerConnectionPool *pool);
+gboolean                     milter_manager_connection_pool_is_full
+                                        (MilterManagerConnectionPool *pool);
+
+gboolean                     milter_manager_connection_pool_push
+                                        (MilterManagerConnectionPool *pool,
+                                         MilterEventLoop *loop,
+                                         GIOChannel *channel,
+                                         MilterOption *option,
+                                         MilterOption *reply_option,
+                                         MilterMacrosRequests *macros_requests);
+gboolean                     milter_manager_connection_pool_pop
+                                        (MilterManagerConnectionPool *pool,
+                                         MilterEventLoop *loop,
+                                         MilterOption *option,
+                                         GIOChannel **channel,
+                                         MilterOption **reply_option,
+                                         MilterMacrosRequests **macros_requests);
+void                         milter_manager_connection_pool_clear
+                                        (MilterManagerConnectionPool *pool);
+
+guint                        milter_manager_connection_pool_get_n_idle_connections
+                                        (MilterManagerConnectionPool *pool);
+guint                        milter_manager_connection_pool_get_n_hits
+                                        (MilterManagerConnectionPool *pool);
+guint                        milter_manager_connection_pool_get_n_misses
+                                        (MilterManagerConnectionPool *pool);
+
+G_END_DECLS
+
+#endif /* __MILTER_MANAGER_CONNECTION_POOL_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
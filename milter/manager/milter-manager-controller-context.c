@@ -22,11 +22,13 @@
 #endif /* HAVE_CONFIG_H */
 
 #include <string.h>
+#include <unistd.h>
 
 #include "milter-manager-controller-context.h"
 #include "milter-manager-enum-types.h"
 #include "milter-manager-control-command-decoder.h"
 #include "milter-manager-control-reply-encoder.h"
+#include "milter-manager-statistics.h"
 
 #define MILTER_MANAGER_CONTROLLER_CONTEXT_GET_PRIVATE(obj)              \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                                 \
@@ -211,10 +213,87 @@ cb_decoder_reload (MilterManagerControlCommandDecoder *decoder,
     }
 }
 
+static void
+collect_connection_pool_status (MilterManagerConfiguration *config,
+                                GString *status, guint indent)
+{
+    const GList *node;
+
+    milter_utils_append_indent(status, indent);
+    g_string_append(status, "<connection-pools>\n");
+    for (node = milter_manager_configuration_get_eggs(config);
+         node;
+         node = g_list_next(node)) {
+        MilterManagerEgg *egg = node->data;
+        MilterManagerConnectionPool *pool;
+        gchar *escaped_name;
+
+        pool = milter_manager_egg_get_connection_pool(egg);
+        if (!milter_manager_connection_pool_is_enabled(pool))
+            continue;
+
+        escaped_name = g_markup_escape_text(milter_manager_egg_get_name(egg),
+                                            -1);
+        milter_utils_append_indent(status, indent + 2);
+        g_string_append_printf(
+            status,
+            "<connection-pool name=\"%s\" hits=\"%u\" misses=\"%u\" "
+            "idle=\"%u\" max=\"%u\"/>\n",
+            escaped_name,
+            milter_manager_connection_pool_get_n_hits(pool),
+            milter_manager_connection_pool_get_n_misses(pool),
+            milter_manager_connection_pool_get_n_idle_connections(pool),
+            milter_manager_connection_pool_get_max_size(pool));
+        g_free(escaped_name);
+    }
+    milter_utils_append_indent(status, indent);
+    g_string_append(status, "</connection-pools>\n");
+}
+
+static void
+collect_worker_status (MilterClient *client, GString *status, guint indent)
+{
+    GArray *pids;
+    guint i;
+
+    milter_utils_append_indent(status, indent);
+    g_string_append_printf(status, "<workers n-workers=\"%u\">\n",
+                           milter_client_get_n_workers(client));
+    pids = milter_client_get_worker_pids(client);
+    for (i = 0; pids && i < pids->len; i++) {
+        milter_utils_append_indent(status, indent + 2);
+        g_string_append_printf(status, "<worker pid=\"%d\"/>\n",
+                               (gint)g_array_index(pids, GPid, i));
+    }
+    milter_utils_append_indent(status, indent);
+    g_string_append(status, "</workers>\n");
+}
+
+/*
+ * All values are kept by counters that are updated on the
+ * way so that a monitoring tool can poll it frequently.
+ * Workers count session related values in memory shared
+ * with this process and they are summed up here.
+ */
 static void
 collect_status (MilterManagerControllerContext *context, GString *status)
 {
-    g_string_append(status, "FIXME");
+    MilterManagerControllerContextPrivate *priv;
+    MilterManagerConfiguration *config;
+    MilterClient *client;
+
+    priv = MILTER_MANAGER_CONTROLLER_CONTEXT_GET_PRIVATE(context);
+    config = milter_manager_get_configuration(priv->manager);
+    client = MILTER_CLIENT(priv->manager);
+
+    g_string_append_printf(status, "<status pid=\"%d\">\n", (gint)getpid());
+    milter_utils_append_indent(status, 2);
+    g_string_append_printf(status, "<sessions>%u</sessions>\n",
+                           milter_client_get_n_processing_sessions(client));
+    milter_manager_statistics_to_xml_string(status, 2);
+    collect_worker_status(client, status, 2);
+    collect_connection_pool_status(config, status, 2);
+    g_string_append(status, "</status>\n");
 }
 
 static void
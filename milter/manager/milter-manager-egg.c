@@ -57,6 +57,8 @@ struct _MilterManagerEggPrivate
     GList *applicable_conditions;
     MilterStatus fallback_status;
     gboolean evaluation_mode;
+    gboolean parallel;
+    MilterManagerConnectionPool *connection_pool;
 };
 
 enum
@@ -74,7 +76,10 @@ enum
     PROP_COMMAND,
     PROP_COMMAND_OPTIONS,
     PROP_FALLBACK_STATUS,
-    PROP_REPUTATION_MODE
+    PROP_REPUTATION_MODE,
+    PROP_PARALLEL,
+    PROP_CONNECTION_POOL_SIZE,
+    PROP_CONNECTION_POOL_IDLE_TIMEOUT
 };
 
 enum
@@ -216,6 +221,37 @@ milter_manager_egg_class_init (MilterManagerEggClass *klass)
                                 G_PARAM_READWRITE);
     g_object_class_install_property(gobject_class, PROP_REPUTATION_MODE, spec);
 
+    spec = g_param_spec_boolean("parallel",
+                                "Parallel",
+                                "Whether the milter is evaluated in parallel "
+                                "with other milters or not",
+                                FALSE,
+                                G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_PARALLEL, spec);
+
+    spec = g_param_spec_uint("connection-pool-size",
+                             "Connection pool size",
+                             "The max number of idle connections "
+                             "kept for reuse. 0 disables connection pool.",
+                             0,
+                             G_MAXUINT,
+                             0,
+                             G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_CONNECTION_POOL_SIZE,
+                                    spec);
+
+    spec = g_param_spec_double("connection-pool-idle-timeout",
+                               "Connection pool idle timeout",
+                               "The seconds an idle connection is kept "
+                               "in connection pool",
+                               0,
+                               G_MAXDOUBLE,
+                               MILTER_MANAGER_CONNECTION_POOL_DEFAULT_IDLE_TIMEOUT,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_CONNECTION_POOL_IDLE_TIMEOUT,
+                                    spec);
+
     signals[HATCHED] =
         g_signal_new("hatched",
                      G_TYPE_FROM_CLASS(klass),
@@ -259,6 +295,8 @@ milter_manager_egg_init (MilterManagerEgg *egg)
     priv->applicable_conditions = NULL;
     priv->fallback_status = MILTER_STATUS_ACCEPT;
     priv->evaluation_mode = FALSE;
+    priv->parallel = FALSE;
+    priv->connection_pool = milter_manager_connection_pool_new();
 }
 
 static void
@@ -302,6 +340,11 @@ dispose (GObject *object)
 
     milter_manager_egg_clear_applicable_conditions(egg);
 
+    if (priv->connection_pool) {
+        g_object_unref(priv->connection_pool);
+        priv->connection_pool = NULL;
+    }
+
     G_OBJECT_CLASS(milter_manager_egg_parent_class)->dispose(object);
 }
 
@@ -356,6 +399,17 @@ set_property (GObject      *object,
     case PROP_REPUTATION_MODE:
         milter_manager_egg_set_evaluation_mode(egg, g_value_get_boolean(value));
         break;
+    case PROP_PARALLEL:
+        milter_manager_egg_set_parallel(egg, g_value_get_boolean(value));
+        break;
+    case PROP_CONNECTION_POOL_SIZE:
+        milter_manager_egg_set_connection_pool_size(egg,
+                                                    g_value_get_uint(value));
+        break;
+    case PROP_CONNECTION_POOL_IDLE_TIMEOUT:
+        milter_manager_egg_set_connection_pool_idle_timeout(
+            egg, g_value_get_double(value));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -411,6 +465,19 @@ get_property (GObject    *object,
     case PROP_REPUTATION_MODE:
         g_value_set_boolean(value, priv->evaluation_mode);
         break;
+    case PROP_PARALLEL:
+        g_value_set_boolean(value, priv->parallel);
+        break;
+    case PROP_CONNECTION_POOL_SIZE:
+        g_value_set_uint(
+            value,
+            milter_manager_connection_pool_get_max_size(priv->connection_pool));
+        break;
+    case PROP_CONNECTION_POOL_IDLE_TIMEOUT:
+        g_value_set_double(
+            value,
+            milter_manager_connection_pool_get_idle_timeout(priv->connection_pool));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -462,6 +529,7 @@ milter_manager_egg_hatch (MilterManagerEgg *egg)
                   "command-options", priv->command_options,
                   "fallback-status", priv->fallback_status,
                   "evaluation-mode", priv->evaluation_mode,
+                  "parallel", priv->parallel,
                   NULL);
 
     if (priv->connection_spec) {
@@ -732,6 +800,64 @@ milter_manager_egg_is_evaluation_mode (MilterManagerEgg *egg)
     return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->evaluation_mode;
 }
 
+void
+milter_manager_egg_set_parallel (MilterManagerEgg *egg,
+                                 gboolean          parallel)
+{
+    MILTER_MANAGER_EGG_GET_PRIVATE(egg)->parallel = parallel;
+}
+
+gboolean
+milter_manager_egg_is_parallel (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->parallel;
+}
+
+void
+milter_manager_egg_set_connection_pool_size (MilterManagerEgg *egg,
+                                             guint             size)
+{
+    MilterManagerEggPrivate *priv;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+    milter_manager_connection_pool_set_max_size(priv->connection_pool, size);
+}
+
+guint
+milter_manager_egg_get_connection_pool_size (MilterManagerEgg *egg)
+{
+    MilterManagerEggPrivate *priv;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+    return milter_manager_connection_pool_get_max_size(priv->connection_pool);
+}
+
+void
+milter_manager_egg_set_connection_pool_idle_timeout (MilterManagerEgg *egg,
+                                                     gdouble           timeout)
+{
+    MilterManagerEggPrivate *priv;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+    milter_manager_connection_pool_set_idle_timeout(priv->connection_pool,
+                                                    timeout);
+}
+
+gdouble
+milter_manager_egg_get_connection_pool_idle_timeout (MilterManagerEgg *egg)
+{
+    MilterManagerEggPrivate *priv;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+    return milter_manager_connection_pool_get_idle_timeout(priv->connection_pool);
+}
+
+MilterManagerConnectionPool *
+milter_manager_egg_get_connection_pool (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->connection_pool;
+}
+
 void
 milter_manager_egg_add_applicable_condition (MilterManagerEgg *egg,
                                              MilterManagerApplicableCondition *condition)
@@ -809,6 +935,11 @@ milter_manager_egg_merge (MilterManagerEgg *egg,
 
 #undef MERGE_TIMEOUT
 
+    milter_manager_egg_set_connection_pool_size(
+        egg, milter_manager_egg_get_connection_pool_size(other_egg));
+    milter_manager_egg_set_connection_pool_idle_timeout(
+        egg, milter_manager_egg_get_connection_pool_idle_timeout(other_egg));
+
     description = milter_manager_egg_get_description(other_egg);
     if (description)
         milter_manager_egg_set_description(egg, description);
@@ -880,6 +1011,11 @@ milter_manager_egg_to_xml_string (MilterManagerEgg *egg,
                                             "evaluation-mode",
                                             priv->evaluation_mode,
                                             indent + 2);
+    if (priv->parallel)
+        milter_utils_xml_append_boolean_element(string,
+                                                "parallel",
+                                                priv->parallel,
+                                                indent + 2);
     if (priv->connection_spec)
         milter_utils_xml_append_text_element(string,
                                              "connection-spec",
@@ -896,6 +1032,26 @@ milter_manager_egg_to_xml_string (MilterManagerEgg *egg,
                                              priv->command_options,
                                              indent + 2);
 
+    if (milter_manager_connection_pool_is_enabled(priv->connection_pool)) {
+        gchar *size, *idle_timeout;
+
+        size = g_strdup_printf(
+            "%u",
+            milter_manager_connection_pool_get_max_size(priv->connection_pool));
+        milter_utils_xml_append_text_element(string,
+                                             "connection-pool-size", size,
+                                             indent + 2);
+        g_free(size);
+        idle_timeout = g_strdup_printf(
+            "%g",
+            milter_manager_connection_pool_get_idle_timeout(priv->connection_pool));
+        milter_utils_xml_append_text_element(string,
+                                             "connection-pool-idle-timeout",
+                                             idle_timeout,
+                                             indent + 2);
+        g_free(idle_timeout);
+    }
+
     if (priv->applicable_conditions) {
         GList *node = priv->applicable_conditions;
 
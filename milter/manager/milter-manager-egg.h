@@ -27,6 +27,7 @@
 #include <milter/manager/milter-manager-objects.h>
 #include <milter/manager/milter-manager-child.h>
 #include <milter/manager/milter-manager-applicable-condition.h>
+#include <milter/manager/milter-manager-connection-pool.h>
 
 G_BEGIN_DECLS
 
@@ -134,6 +135,24 @@ void                milter_manager_egg_set_evaluation_mode
                                                  gboolean          evaluation_mode);
 gboolean            milter_manager_egg_is_evaluation_mode
                                                 (MilterManagerEgg *egg);
+void                milter_manager_egg_set_parallel
+                                                (MilterManagerEgg *egg,
+                                                 gboolean          parallel);
+gboolean            milter_manager_egg_is_parallel
+                                                (MilterManagerEgg *egg);
+void                milter_manager_egg_set_connection_pool_size
+                                                (MilterManagerEgg *egg,
+                                                 guint             size);
+guint               milter_manager_egg_get_connection_pool_size
+                                                (MilterManagerEgg *egg);
+void                milter_manager_egg_set_connection_pool_idle_timeout
+                                                (MilterManagerEgg *egg,
+                                                 gdouble           timeout);
+gdouble             milter_manager_egg_get_connection_pool_idle_timeout
+                                                (MilterManagerEgg *egg);
+MilterManagerConnectionPool *
+                    milter_manager_egg_get_connection_pool
+                                                (MilterManagerEgg *egg);
 
 void                milter_manager_egg_add_applicable_condition
                                                 (MilterManagerEgg *egg,
@@ -25,6 +25,8 @@
 #include "milter-manager-leader.h"
 #include "milter-manager-enum-types.h"
 #include "milter-manager-children.h"
+#include "milter-manager-statistics.h"
+#include "milter-manager-result-stream.h"
 
 #define MILTER_MANAGER_LEADER_GET_PRIVATE(obj)                   \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                          \
@@ -37,11 +39,13 @@ struct _MilterManagerLeaderPrivate
     MilterManagerConfiguration *configuration;
     MilterClientContext *client_context;
     MilterManagerChildren *children;
+    MilterManagerChildren *spare_children;
     MilterManagerLeaderState state;
     gboolean sent_end_of_message;
     GIOChannel *launcher_read_channel;
     GIOChannel *launcher_write_channel;
     gboolean processing;
+    gboolean poolable;
     guint tag;
 };
 
@@ -149,14 +153,25 @@ milter_manager_leader_init (MilterManagerLeader *leader)
     priv->configuration = NULL;
     priv->client_context = NULL;
     priv->children = NULL;
+    priv->spare_children = NULL;
     priv->state = MILTER_MANAGER_LEADER_STATE_START;
+    milter_manager_statistics_leader_transit(MILTER_MANAGER_LEADER_STATE_INVALID,
+                                             priv->state);
     priv->sent_end_of_message = FALSE;
     priv->launcher_read_channel = NULL;
     priv->launcher_write_channel = NULL;
     priv->processing = FALSE;
+    priv->poolable = TRUE;
     priv->tag = 0;
 }
 
+static void
+set_state (MilterManagerLeaderPrivate *priv, MilterManagerLeaderState state)
+{
+    milter_manager_statistics_leader_transit(priv->state, state);
+    priv->state = state;
+}
+
 gboolean
 milter_manager_leader_check_connection (MilterManagerLeader *leader)
 {
@@ -218,6 +233,7 @@ milter_manager_leader_check_connection (MilterManagerLeader *leader)
         MilterStatus fallback_status;
 
         milter_statistics("[session][disconnected][%g](%u)", elapsed, priv->tag);
+        milter_manager_result_stream_emit_disconnected(priv->tag, elapsed);
 
         fallback_status =
             milter_manager_configuration_get_fallback_status_at_disconnect(
@@ -271,8 +287,14 @@ dispose (GObject *object)
         g_object_unref(priv->children);
         priv->children = NULL;
     }
+
+    if (priv->spare_children) {
+        g_object_unref(priv->spare_children);
+        priv->spare_children = NULL;
+    }
     milter_manager_leader_set_launcher_channel(leader, NULL, NULL);
 
+    set_state(priv, MILTER_MANAGER_LEADER_STATE_INVALID);
 
     G_OBJECT_CLASS(milter_manager_leader_parent_class)->dispose(object);
 }
@@ -358,6 +380,64 @@ milter_manager_leader_new (MilterManagerConfiguration *configuration,
                         NULL);
 }
 
+void
+milter_manager_leader_reset (MilterManagerLeader *leader)
+{
+    MilterManagerLeaderPrivate *priv;
+
+    priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
+
+    milter_debug("[%u] [leader][reset]", priv->tag);
+
+    milter_utils_disconnect_all_signal_handlers(leader);
+
+    if (priv->configuration) {
+        g_object_unref(priv->configuration);
+        priv->configuration = NULL;
+    }
+
+    if (priv->client_context) {
+        g_object_unref(priv->client_context);
+        priv->client_context = NULL;
+    }
+
+    if (priv->children) {
+        teardown_children_signals(leader, priv->children);
+        if (!priv->spare_children &&
+            G_OBJECT(priv->children)->ref_count == 1) {
+            milter_manager_children_reset(priv->children);
+            priv->spare_children = priv->children;
+        } else {
+            g_object_unref(priv->children);
+        }
+        priv->children = NULL;
+    }
+    milter_manager_leader_set_launcher_channel(leader, NULL, NULL);
+
+    set_state(priv, MILTER_MANAGER_LEADER_STATE_INVALID);
+    priv->sent_end_of_message = FALSE;
+    priv->processing = FALSE;
+    priv->tag = 0;
+}
+
+void
+milter_manager_leader_reuse (MilterManagerLeader *leader,
+                             MilterManagerConfiguration *configuration,
+                             MilterClientContext *client_context)
+{
+    MilterManagerLeaderPrivate *priv;
+
+    priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
+
+    g_object_set(leader,
+                 "configuration", configuration,
+                 "client-context", client_context,
+                 NULL);
+    set_state(priv, MILTER_MANAGER_LEADER_STATE_START);
+
+    milter_debug("[%u] [leader][reuse]", priv->tag);
+}
+
 static gboolean
 boolean_handled_accumulator (GSignalInvocationHint *ihint,
                              GValue *return_accu,
@@ -560,7 +640,7 @@ reply (MilterManagerLeader *leader, MilterStatus status)
             return;
         }
     }
-    priv->state = next_state(leader, priv->state);
+    set_state(priv, next_state(leader, priv->state));
 }
 
 static void
@@ -995,11 +1075,19 @@ milter_manager_leader_negotiate (MilterManagerLeader *leader,
     MilterEventLoop *event_loop;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_NEGOTIATE;
+    set_state(priv, MILTER_MANAGER_LEADER_STATE_NEGOTIATE);
 
     event_loop = milter_agent_get_event_loop(MILTER_AGENT(priv->client_context));
-    priv->children = milter_manager_children_new(priv->configuration,
-                                                 event_loop);
+    if (priv->spare_children) {
+        priv->children = priv->spare_children;
+        priv->spare_children = NULL;
+        milter_manager_children_reuse(priv->children,
+                                      priv->configuration,
+                                      event_loop);
+    } else {
+        priv->children = milter_manager_children_new(priv->configuration,
+                                                     event_loop);
+    }
     milter_manager_configuration_setup_children(priv->configuration,
                                                 priv->children,
                                                 priv->client_context);
@@ -1033,7 +1121,7 @@ milter_manager_leader_connect (MilterManagerLeader *leader,
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_CONNECT;
+    set_state(priv, MILTER_MANAGER_LEADER_STATE_CONNECT);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1055,7 +1143,7 @@ milter_manager_leader_helo (MilterManagerLeader *leader, const gchar *fqdn)
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_HELO;
+    set_state(priv, MILTER_MANAGER_LEADER_STATE_HELO);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1077,7 +1165,7 @@ milter_manager_leader_envelope_from (MilterManagerLeader *leader,
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_ENVELOPE_FROM;
+    set_state(priv, MILTER_MANAGER_LEADER_STATE_ENVELOPE_FROM);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1099,7 +1187,7 @@ milter_manager_leader_envelope_recipient (MilterManagerLeader *leader,
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_ENVELOPE_RECIPIENT;
+    set_state(priv, MILTER_MANAGER_LEADER_STATE_ENVELOPE_RECIPIENT);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1120,7 +1208,7 @@ milter_manager_leader_data (MilterManagerLeader *leader)
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_DATA;
+    set_state(priv, MILTER_MANAGER_LEADER_STATE_DATA);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1142,7 +1230,7 @@ milter_manager_leader_unknown (MilterManagerLeader *leader,
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_UNKNOWN;
+    set_state(priv, MILTER_MANAGER_LEADER_STATE_UNKNOWN);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1164,7 +1252,7 @@ milter_manager_leader_header (MilterManagerLeader *leader,
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_HEADER;
+    set_state(priv, MILTER_MANAGER_LEADER_STATE_HEADER);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1185,7 +1273,7 @@ milter_manager_leader_end_of_header (MilterManagerLeader *leader)
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_END_OF_HEADER;
+    set_state(priv, MILTER_MANAGER_LEADER_STATE_END_OF_HEADER);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1207,7 +1295,7 @@ milter_manager_leader_body (MilterManagerLeader *leader,
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_BODY;
+    set_state(priv, MILTER_MANAGER_LEADER_STATE_BODY);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1255,7 +1343,7 @@ milter_manager_leader_end_of_message (MilterManagerLeader *leader,
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
     if (is_replied_state(priv->state)) {
-        priv->state = MILTER_MANAGER_LEADER_STATE_END_OF_MESSAGE;
+        set_state(priv, MILTER_MANAGER_LEADER_STATE_END_OF_MESSAGE);
     } else {
         priv->sent_end_of_message = TRUE;
     }
@@ -1279,7 +1367,7 @@ milter_manager_leader_quit (MilterManagerLeader *leader)
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_QUIT;
+    set_state(priv, MILTER_MANAGER_LEADER_STATE_QUIT);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1297,7 +1385,7 @@ milter_manager_leader_abort (MilterManagerLeader *leader)
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_ABORT;
+    set_state(priv, MILTER_MANAGER_LEADER_STATE_ABORT);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1336,6 +1424,24 @@ milter_manager_leader_get_configuration (MilterManagerLeader *leader)
     return MILTER_MANAGER_LEADER_GET_PRIVATE(leader)->configuration;
 }
 
+/*
+ * A leader that has been passed to configuration scripts
+ * must not be pooled because scripts may keep it after
+ * the session is finished.
+ */
+void
+milter_manager_leader_set_poolable (MilterManagerLeader *leader,
+                                    gboolean poolable)
+{
+    MILTER_MANAGER_LEADER_GET_PRIVATE(leader)->poolable = poolable;
+}
+
+gboolean
+milter_manager_leader_is_poolable (MilterManagerLeader *leader)
+{
+    return MILTER_MANAGER_LEADER_GET_PRIVATE(leader)->poolable;
+}
+
 void
 milter_manager_leader_set_launcher_channel (MilterManagerLeader *leader,
                                             GIOChannel *read_channel,
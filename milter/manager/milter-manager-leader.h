@@ -95,9 +95,20 @@ GType                 milter_manager_leader_get_type    (void) G_GNUC_CONST;
 MilterManagerLeader  *milter_manager_leader_new
                                           (MilterManagerConfiguration *configuration,
                                            MilterClientContext        *client_context);
+void                  milter_manager_leader_reset
+                                          (MilterManagerLeader *leader);
+void                  milter_manager_leader_reuse
+                                          (MilterManagerLeader        *leader,
+                                           MilterManagerConfiguration *configuration,
+                                           MilterClientContext        *client_context);
 MilterManagerConfiguration *
                       milter_manager_leader_get_configuration
                                           (MilterManagerLeader *leader);
+void                  milter_manager_leader_set_poolable
+                                          (MilterManagerLeader *leader,
+                                           gboolean             poolable);
+gboolean              milter_manager_leader_is_poolable
+                                          (MilterManagerLeader *leader);
 
 void                  milter_manager_leader_set_launcher_channel
                                           (MilterManagerLeader *leader,
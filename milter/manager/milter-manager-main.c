@@ -163,6 +163,7 @@ milter_manager_quit (void)
         g_object_unref(the_manager);
         the_manager = NULL;
     }
+    milter_manager_result_stream_close();
 
     _milter_manager_configuration_quit();
 
@@ -233,6 +234,7 @@ static void
 reopen_log (int signum)
 {
     milter_logger_reopen(milter_logger());
+    milter_manager_result_stream_reopen();
 }
 
 static void
@@ -512,6 +514,46 @@ update_max_file_descriptors (MilterManager *manager)
     }
 }
 
+/*
+ * In multi thread mode, sessions are processed by
+ * per-thread event loops with a snapshot of the
+ * configuration. Configuration scripts are run only on the
+ * main thread.
+ */
+static gboolean
+setup_multi_thread_mode (MilterManager *manager)
+{
+    MilterClient *client;
+    MilterManagerConfiguration *configuration;
+    guint n_threads;
+    GError *error = NULL;
+
+    client = MILTER_CLIENT(manager);
+    configuration = milter_manager_get_configuration(manager);
+
+    n_threads = milter_manager_configuration_get_n_threads(configuration);
+    if (n_threads == 0)
+        return TRUE;
+
+    if (milter_client_get_n_workers(client) > 0) {
+        milter_warning("[manager][multi-thread][ignore] "
+                       "manager.n_workers takes precedence: <%u>",
+                       n_threads);
+        return TRUE;
+    }
+
+    if (!milter_manager_set_multi_thread_mode(manager, n_threads, &error)) {
+        milter_manager_error("failed to use multi thread mode: %s",
+                             error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+
+    milter_info("[manager][multi-thread] <%u>", n_threads);
+
+    return TRUE;
+}
+
 static void
 append_custom_configuration_directory (MilterManagerConfiguration *config)
 {
@@ -578,6 +620,7 @@ milter_manager_main (void)
     MilterManagerConfiguration *config;
     MilterEventLoop *loop;
     gboolean remove_socket, daemon;
+    guint n_workers;
     GError *error = NULL;
     struct sigaction shutdown_client_action;
     struct sigaction reload_configuration_request_action;
@@ -643,6 +686,13 @@ milter_manager_main (void)
     }
 
     loop = milter_client_get_event_loop(client);
+    if (!loop) {
+        loop = milter_client_create_event_loop(client, TRUE);
+        milter_client_set_event_loop(client, loop);
+        g_object_unref(loop);
+    }
+    milter_manager_statistics_watch_event_loop(
+        loop, MILTER_MANAGER_STATISTICS_EVENT_LOOP_CHECK_INTERVAL);
     controller = milter_manager_controller_new(manager, loop);
     if (controller && !milter_manager_controller_listen(controller, &error)) {
         milter_manager_error("failed to listen controller socket: %s",
@@ -666,6 +716,21 @@ milter_manager_main (void)
         }
     }
 
+    if (!setup_multi_thread_mode(manager)) {
+        if (controller)
+            g_object_unref(controller);
+        return FALSE;
+    }
+
+    n_workers = milter_client_get_n_workers(client);
+    if (n_workers > 0 && !milter_manager_statistics_share(n_workers, &error)) {
+        milter_warning("[manager][statistics][share][error] "
+                       "status reports only the master process: %s",
+                       error->message);
+        g_error_free(error);
+        error = NULL;
+    }
+
     the_manager = manager;
 
 #define SETUP_SIGNAL_ACTION(handler)            \
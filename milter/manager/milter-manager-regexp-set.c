@@ -0,0 +1,239 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <milter/core.h>
+#include "milter-manager-regexp-set.h"
+
+#define INLINE_FLAGS (G_REGEX_CASELESS |        \
+                      G_REGEX_MULTILINE |       \
+                      G_REGEX_DOTALL |          \
+                      G_REGEX_EXTENDED)
+
+/*
+ * All patterns are also compiled into one alternation so
+ * that text that matches no pattern, the common case, is
+ * rejected by one match. Only matched text is tested by
+ * each pattern to find the first one.
+ */
+struct _MilterManagerRegexpSet
+{
+    GPtrArray *regexps;
+    GString *alternation;
+    GRegex *combined;
+    gboolean combined_available;
+    gboolean combined_dirty;
+};
+
+GQuark
+milter_manager_regexp_set_error_quark (void)
+{
+    return g_quark_from_static_string("milter-manager-regexp-set-error-quark");
+}
+
+MilterManagerRegexpSet *
+milter_manager_regexp_set_new (void)
+{
+    MilterManagerRegexpSet *set;
+
+    set = g_new0(MilterManagerRegexpSet, 1);
+    set->regexps = g_ptr_array_new_with_free_func((GDestroyNotify)g_regex_unref);
+    set->alternation = g_string_new(NULL);
+    set->combined = NULL;
+    set->combined_available = TRUE;
+    set->combined_dirty = FALSE;
+
+    return set;
+}
+
+void
+milter_manager_regexp_set_free (MilterManagerRegexpSet *set)
+{
+    g_ptr_array_unref(set->regexps);
+    g_string_free(set->alternation, TRUE);
+    if (set->combined)
+        g_regex_unref(set->combined);
+    g_free(set);
+}
+
+/*
+ * Group numbers are shifted in the alternation. Patterns
+ * that refer to groups aren't combined because they may
+ * refer to other pattern's group.
+ */
+static gboolean
+refer_group (const gchar *pattern)
+{
+    const gchar *p;
+
+    for (p = pattern; *p; p++) {
+        if (p[0] == '\\') {
+            if (p[1] == '\0')
+                break;
+            if (g_ascii_isdigit(p[1]) && p[1] != '0')
+                return TRUE;
+            if (p[1] == 'g' || p[1] == 'k')
+                return TRUE;
+            p++;
+        } else if (p[0] == '(' && p[1] == '?') {
+            if (p[2] == '(' || p[2] == 'R' || p[2] == '|' ||
+                g_ascii_isdigit(p[2]) ||
+                ((p[2] == '+' || p[2] == '-') && g_ascii_isdigit(p[3])) ||
+                g_str_has_prefix(p + 2, "P=") ||
+                g_str_has_prefix(p + 2, "P>"))
+                return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static void
+append_alternative (MilterManagerRegexpSet *set,
+                    const gchar *pattern,
+                    GRegexCompileFlags flags)
+{
+    GString *alternation = set->alternation;
+
+    if ((flags & ~(INLINE_FLAGS | G_REGEX_RAW | G_REGEX_OPTIMIZE)) != 0) {
+        milter_debug("[regexp-set][combined][unavailable] "
+                     "flags can't be inlined: <%s>: <%d>",
+                     pattern, flags);
+        set->combined_available = FALSE;
+        return;
+    }
+
+    if (refer_group(pattern)) {
+        milter_debug("[regexp-set][combined][unavailable] "
+                     "group is referred: <%s>",
+                     pattern);
+        set->combined_available = FALSE;
+        return;
+    }
+
+    if (alternation->len > 0)
+        g_string_append_c(alternation, '|');
+    g_string_append(alternation, "(?");
+    if (flags & G_REGEX_CASELESS)
+        g_string_append_c(alternation, 'i');
+    if (flags & G_REGEX_MULTILINE)
+        g_string_append_c(alternation, 'm');
+    if (flags & G_REGEX_DOTALL)
+        g_string_append_c(alternation, 's');
+    if (flags & G_REGEX_EXTENDED)
+        g_string_append_c(alternation, 'x');
+    g_string_append_c(alternation, ':');
+    g_string_append(alternation, pattern);
+    /* A trailing comment in extended mode must not eat ")". */
+    if (flags & G_REGEX_EXTENDED)
+        g_string_append_c(alternation, '\n');
+    g_string_append_c(alternation, ')');
+}
+
+gboolean
+milter_manager_regexp_set_add (MilterManagerRegexpSet *set,
+                               const gchar *pattern,
+                               GRegexCompileFlags flags,
+                               GError **error)
+{
+    GRegex *regex;
+    GError *regex_error = NULL;
+
+    regex = g_regex_new(pattern, flags | G_REGEX_RAW, 0, &regex_error);
+    if (!regex) {
+        g_set_error(error,
+                    MILTER_MANAGER_REGEXP_SET_ERROR,
+                    MILTER_MANAGER_REGEXP_SET_ERROR_INVALID_PATTERN,
+                    "invalid pattern: <%s>: %s",
+                    pattern, regex_error->message);
+        g_error_free(regex_error);
+        return FALSE;
+    }
+    g_ptr_array_add(set->regexps, regex);
+
+    if (set->combined_available) {
+        append_alternative(set, pattern, flags);
+        set->combined_dirty = TRUE;
+    }
+
+    return TRUE;
+}
+
+static void
+compile_combined (MilterManagerRegexpSet *set)
+{
+    GError *error = NULL;
+
+    if (set->combined) {
+        g_regex_unref(set->combined);
+        set->combined = NULL;
+    }
+    set->combined_dirty = FALSE;
+
+    if (!set->combined_available)
+        return;
+
+    set->combined = g_regex_new(set->alternation->str,
+                                G_REGEX_RAW | G_REGEX_OPTIMIZE, 0,
+                                &error);
+    if (!set->combined) {
+        milter_debug("[regexp-set][combined][unavailable] %s",
+                     error->message);
+        g_error_free(error);
+        set->combined_available = FALSE;
+    }
+}
+
+gint
+milter_manager_regexp_set_match (MilterManagerRegexpSet *set,
+                                 const gchar *text)
+{
+    guint i;
+
+    if (set->regexps->len == 0)
+        return -1;
+
+    if (set->combined_dirty)
+        compile_combined(set);
+
+    if (set->combined && !g_regex_match(set->combined, text, 0, NULL))
+        return -1;
+
+    for (i = 0; i < set->regexps->len; i++) {
+        GRegex *regex = g_ptr_array_index(set->regexps, i);
+
+        if (g_regex_match(regex, text, 0, NULL))
+            return i;
+    }
+
+    return -1;
+}
+
+guint
+milter_manager_regexp_set_get_size (MilterManagerRegexpSet *set)
+{
+    return set->regexps->len;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
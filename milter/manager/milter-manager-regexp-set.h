@@ -0,0 +1,64 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MANAGER_REGEXP_SET_H__
+#define __MILTER_MANAGER_REGEXP_SET_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define MILTER_MANAGER_REGEXP_SET_ERROR           (milter_manager_regexp_set_error_quark())
+
+typedef enum
+{
+    MILTER_MANAGER_REGEXP_SET_ERROR_INVALID_PATTERN
+} MilterManagerRegexpSetError;
+
+typedef struct _MilterManagerRegexpSet MilterManagerRegexpSet;
+
+GQuark                  milter_manager_regexp_set_error_quark (void);
+
+MilterManagerRegexpSet *milter_manager_regexp_set_new
+                                        (void);
+void                    milter_manager_regexp_set_free
+                                        (MilterManagerRegexpSet *set);
+
+gboolean                milter_manager_regexp_set_add
+                                        (MilterManagerRegexpSet *set,
+                                         const gchar *pattern,
+                                         GRegexCompileFlags flags,
+                                         GError **error);
+/*
+ * Returns the index of the first added pattern that
+ * matches "text" or -1 if no pattern matches.
+ */
+gint                    milter_manager_regexp_set_match
+                                        (MilterManagerRegexpSet *set,
+                                         const gchar *text);
+guint                   milter_manager_regexp_set_get_size
+                                        (MilterManagerRegexpSet *set);
+
+G_END_DECLS
+
+#endif /* __MILTER_MANAGER_REGEXP_SET_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -0,0 +1,740 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#ifdef HAVE_PTHREAD_ATFORK
+#  include <pthread.h>
+#endif
+
+#include "../core/milter-glib-compatible.h"
+#include "milter-manager-result-stream.h"
+
+#ifndef MSG_NOSIGNAL
+#  define MSG_NOSIGNAL 0
+#endif
+
+#define MAX_QUEUED_RECORDS 4096
+
+static gchar *stream_spec = NULL;
+static gchar *stream_path = NULL;
+static gboolean stream_is_socket = FALSE;
+static gint stream_fd = -1;
+static volatile sig_atomic_t reopen_requested = 0;
+static guint n_dropped_records = 0;
+
+/*
+ * Records are built by session threads and queued. Only the
+ * writer thread writes them so that a slow file system or
+ * socket reader doesn't block sessions. The stream is
+ * opened and closed only while the writer thread isn't
+ * running. stream_mutex protects the queue and the writer
+ * state.
+ */
+static GMutex *stream_mutex = NULL;
+static GCond *stream_cond = NULL;
+static GThread *writer_thread = NULL;
+static gboolean writer_quitting = FALSE;
+static gboolean writer_writing = FALSE;
+static gboolean writer_forked = FALSE;
+static GQueue queued_records = G_QUEUE_INIT;
+#ifdef HAVE_PTHREAD_ATFORK
+static gboolean fork_handlers_registered = FALSE;
+#endif
+
+GQuark
+milter_manager_result_stream_error_quark (void)
+{
+    return g_quark_from_static_string("milter-manager-result-stream-error-quark");
+}
+
+static gint
+open_file (const gchar *path, GError **error)
+{
+    gint fd;
+
+    fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0640);
+    if (fd == -1) {
+        g_set_error(error,
+                    MILTER_MANAGER_RESULT_STREAM_ERROR,
+                    MILTER_MANAGER_RESULT_STREAM_ERROR_OPEN,
+                    "failed to open result stream file: <%s>: %s",
+                    path, g_strerror(errno));
+    }
+    return fd;
+}
+
+static gint
+open_socket (const gchar *path, GError **error)
+{
+    struct sockaddr_un address;
+    gint fd;
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        g_set_error(error,
+                    MILTER_MANAGER_RESULT_STREAM_ERROR,
+                    MILTER_MANAGER_RESULT_STREAM_ERROR_INVALID_SPEC,
+                    "result stream socket path is too long: <%s>", path);
+        return -1;
+    }
+
+    fd = socket(PF_UNIX, SOCK_DGRAM, 0);
+    if (fd == -1) {
+        g_set_error(error,
+                    MILTER_MANAGER_RESULT_STREAM_ERROR,
+                    MILTER_MANAGER_RESULT_STREAM_ERROR_OPEN,
+                    "failed to create result stream socket: %s",
+                    g_strerror(errno));
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) == -1) {
+        g_set_error(error,
+                    MILTER_MANAGER_RESULT_STREAM_ERROR,
+                    MILTER_MANAGER_RESULT_STREAM_ERROR_OPEN,
+                    "failed to connect result stream socket: <%s>: %s",
+                    path, g_strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static gint
+open_stream (const gchar *path, gboolean is_socket, GError **error)
+{
+    gint fd;
+
+    if (is_socket)
+        fd = open_socket(path, error);
+    else
+        fd = open_file(path, error);
+
+    if (fd != -1)
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    return fd;
+}
+
+static gboolean
+write_record (GString *record, gint *error_number)
+{
+    ssize_t written_size;
+
+    if (stream_is_socket) {
+        written_size = send(stream_fd, record->str, record->len,
+                            MSG_DONTWAIT | MSG_NOSIGNAL);
+    } else {
+        written_size = write(stream_fd, record->str, record->len);
+    }
+
+    if (written_size == -1) {
+        *error_number = errno;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void process_reopen_request (void);
+
+static gpointer
+writer_run (gpointer data)
+{
+    g_mutex_lock(stream_mutex);
+    while (TRUE) {
+        GQueue records;
+        GString *record;
+        guint n_failed_records = 0;
+        gint error_number = 0;
+
+        if (g_queue_is_empty(&queued_records)) {
+            if (writer_quitting) {
+                /* Records queued from now are dropped. */
+                writer_thread = NULL;
+                break;
+            }
+            g_cond_wait(stream_cond, stream_mutex);
+            continue;
+        }
+
+        records = queued_records;
+        g_queue_init(&queued_records);
+        writer_writing = TRUE;
+        g_mutex_unlock(stream_mutex);
+
+        if (reopen_requested)
+            process_reopen_request();
+        while ((record = g_queue_pop_head(&records))) {
+            if (!write_record(record, &error_number))
+                n_failed_records++;
+            g_string_free(record, TRUE);
+        }
+
+        g_mutex_lock(stream_mutex);
+        if (n_failed_records > 0) {
+            if (n_dropped_records == 0)
+                milter_error("[result-stream][write][error] <%s>: %s",
+                             stream_spec, g_strerror(error_number));
+            n_dropped_records += n_failed_records;
+        }
+        writer_writing = FALSE;
+        g_cond_broadcast(stream_cond);
+    }
+    g_mutex_unlock(stream_mutex);
+
+    return NULL;
+}
+
+#ifdef HAVE_PTHREAD_ATFORK
+/*
+ * The writer thread isn't inherited by a forked worker.
+ * Queued records are written before fork() so that they
+ * aren't written twice, and the worker starts its own
+ * writer when it queues a record.
+ */
+static void
+prepare_fork (void)
+{
+    g_mutex_lock(stream_mutex);
+    while (writer_thread &&
+           (!g_queue_is_empty(&queued_records) || writer_writing)) {
+        g_cond_wait(stream_cond, stream_mutex);
+    }
+}
+
+static void
+parent_after_fork (void)
+{
+    g_mutex_unlock(stream_mutex);
+}
+
+static void
+child_after_fork (void)
+{
+    writer_forked = (writer_thread != NULL);
+    writer_thread = NULL;
+    writer_writing = FALSE;
+    g_mutex_unlock(stream_mutex);
+}
+#endif
+
+/* stream_mutex must be locked. */
+static GThread *
+create_writer_thread (GError **error)
+{
+    writer_quitting = FALSE;
+    writer_forked = FALSE;
+    writer_thread = g_thread_try_new("milter_manager_result_stream_writer",
+                                     writer_run,
+                                     NULL,
+                                     error);
+#ifdef HAVE_PTHREAD_ATFORK
+    if (writer_thread && !fork_handlers_registered) {
+        pthread_atfork(prepare_fork, parent_after_fork, child_after_fork);
+        fork_handlers_registered = TRUE;
+    }
+#endif
+    return writer_thread;
+}
+
+static gboolean
+start_writer (GError **error)
+{
+    GError *thread_error = NULL;
+
+    g_mutex_lock(stream_mutex);
+    create_writer_thread(&thread_error);
+    g_mutex_unlock(stream_mutex);
+
+    if (thread_error) {
+        g_set_error(error,
+                    MILTER_MANAGER_RESULT_STREAM_ERROR,
+                    MILTER_MANAGER_RESULT_STREAM_ERROR_OPEN,
+                    "failed to start result stream writer: %s",
+                    thread_error->message);
+        g_error_free(thread_error);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* All queued records are written before the writer is stopped. */
+static void
+stop_writer (void)
+{
+    GThread *thread;
+
+    if (!stream_mutex)
+        return;
+
+    g_mutex_lock(stream_mutex);
+    thread = writer_thread;
+    writer_quitting = TRUE;
+    g_cond_broadcast(stream_cond);
+    g_mutex_unlock(stream_mutex);
+
+    if (thread)
+        g_thread_join(thread);
+
+    g_mutex_lock(stream_mutex);
+    writer_thread = NULL;
+    writer_quitting = FALSE;
+    writer_forked = FALSE;
+    g_mutex_unlock(stream_mutex);
+}
+
+static void
+close_stream (void)
+{
+    if (stream_fd != -1) {
+        if (n_dropped_records > 0)
+            milter_info("[result-stream][close][dropped] <%s>: %u",
+                        stream_spec, n_dropped_records);
+        close(stream_fd);
+        stream_fd = -1;
+    }
+
+    if (stream_spec) {
+        g_free(stream_spec);
+        stream_spec = NULL;
+    }
+    if (stream_path) {
+        g_free(stream_path);
+        stream_path = NULL;
+    }
+    stream_is_socket = FALSE;
+    reopen_requested = 0;
+}
+
+gboolean
+milter_manager_result_stream_open (const gchar *spec, GError **error)
+{
+    const gchar *path;
+    gboolean is_socket = FALSE;
+    gint fd;
+
+    if (!spec) {
+        milter_manager_result_stream_close();
+        return TRUE;
+    }
+
+    if (g_str_has_prefix(spec, "unix:")) {
+        path = spec + strlen("unix:");
+        is_socket = TRUE;
+    } else if (g_str_has_prefix(spec, "file:")) {
+        path = spec + strlen("file:");
+    } else {
+        path = spec;
+    }
+
+    if (!g_path_is_absolute(path)) {
+        g_set_error(error,
+                    MILTER_MANAGER_RESULT_STREAM_ERROR,
+                    MILTER_MANAGER_RESULT_STREAM_ERROR_INVALID_SPEC,
+                    "result stream path must be absolute: <%s>", spec);
+        milter_manager_result_stream_close();
+        return FALSE;
+    }
+
+    fd = open_stream(path, is_socket, error);
+    if (fd == -1) {
+        milter_manager_result_stream_close();
+        return FALSE;
+    }
+
+    if (!stream_mutex) {
+        stream_mutex = g_mutex_new();
+        stream_cond = g_cond_new();
+    }
+    milter_manager_result_stream_close();
+    stream_fd = fd;
+    stream_spec = g_strdup(spec);
+    stream_path = g_strdup(path);
+    stream_is_socket = is_socket;
+    reopen_requested = 0;
+    n_dropped_records = 0;
+    if (!start_writer(error)) {
+        close_stream();
+        return FALSE;
+    }
+    milter_debug("[result-stream][open] <%s>", spec);
+
+    return TRUE;
+}
+
+void
+milter_manager_result_stream_close (void)
+{
+    stop_writer();
+    close_stream();
+}
+
+void
+milter_manager_result_stream_flush (void)
+{
+    if (!stream_mutex)
+        return;
+
+    g_mutex_lock(stream_mutex);
+    while (writer_thread &&
+           (!g_queue_is_empty(&queued_records) || writer_writing)) {
+        g_cond_wait(stream_cond, stream_mutex);
+    }
+    g_mutex_unlock(stream_mutex);
+}
+
+gboolean
+milter_manager_result_stream_is_open (void)
+{
+    return stream_fd != -1;
+}
+
+const gchar *
+milter_manager_result_stream_get_spec (void)
+{
+    return stream_spec;
+}
+
+void
+milter_manager_result_stream_reopen (void)
+{
+    /* This may be called from a signal handler. The stream
+     * is reopened before the next record is written. */
+    reopen_requested = 1;
+}
+
+static void
+process_reopen_request (void)
+{
+    GError *error = NULL;
+    gint fd;
+
+    reopen_requested = 0;
+
+    fd = open_stream(stream_path, stream_is_socket, &error);
+    if (fd == -1) {
+        milter_error("[result-stream][reopen][error] %s", error->message);
+        g_error_free(error);
+        return;
+    }
+
+    close(stream_fd);
+    stream_fd = fd;
+}
+
+/* The record is freed. */
+static void
+queue_record (GString *record)
+{
+    g_string_append_c(record, '\n');
+
+    g_mutex_lock(stream_mutex);
+    if (!writer_thread && writer_forked)
+        create_writer_thread(NULL);
+    if (!writer_thread) {
+        g_string_free(record, TRUE);
+    } else if (g_queue_get_length(&queued_records) >= MAX_QUEUED_RECORDS) {
+        if (n_dropped_records == 0)
+            milter_error("[result-stream][queue][full] <%s>: %u",
+                         stream_spec, MAX_QUEUED_RECORDS);
+        n_dropped_records++;
+        g_string_free(record, TRUE);
+    } else {
+        g_queue_push_tail(&queued_records, record);
+        g_cond_broadcast(stream_cond);
+    }
+    g_mutex_unlock(stream_mutex);
+}
+
+/*
+ * A value isn't always UTF-8 because it may be a header
+ * value from a client. An invalid byte is replaced with
+ * U+FFFD REPLACEMENT CHARACTER so that the record is still
+ * valid JSON.
+ */
+static void
+append_string (GString *record, const gchar *string)
+{
+    const gchar *current;
+
+    if (!string) {
+        g_string_append(record, "null");
+        return;
+    }
+
+    g_string_append_c(record, '"');
+    current = string;
+    while (*current) {
+        guchar character = *current;
+
+        if (character >= 0x80) {
+            gunichar unichar;
+            const gchar *next;
+
+            unichar = g_utf8_get_char_validated(current, -1);
+            if (unichar == (gunichar)-1 || unichar == (gunichar)-2) {
+                g_string_append(record, "\\ufffd");
+                current++;
+            } else {
+                next = g_utf8_next_char(current);
+                g_string_append_len(record, current, next - current);
+                current = next;
+            }
+            continue;
+        }
+
+        switch (character) {
+        case '"':
+            g_string_append(record, "\\\"");
+            break;
+        case '\\':
+            g_string_append(record, "\\\\");
+            break;
+        case '\n':
+            g_string_append(record, "\\n");
+            break;
+        case '\r':
+            g_string_append(record, "\\r");
+            break;
+        case '\t':
+            g_string_append(record, "\\t");
+            break;
+        default:
+            if (character < 0x20)
+                g_string_append_printf(record, "\\u%04x", character);
+            else
+                g_string_append_c(record, character);
+            break;
+        }
+        current++;
+    }
+    g_string_append_c(record, '"');
+}
+
+static void
+append_key (GString *record, const gchar *key)
+{
+    g_string_append_printf(record, ",\"%s\":", key);
+}
+
+static void
+append_double (GString *record, gdouble value)
+{
+    gchar buffer[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_string_append(record, g_ascii_formatd(buffer, sizeof(buffer),
+                                            "%g", value));
+}
+
+static void
+append_enum (GString *record, GType type, gint value)
+{
+    gchar *nick;
+
+    nick = milter_utils_get_enum_nick_name(type, value);
+    append_string(record, nick);
+    g_free(nick);
+}
+
+static void
+append_status (GString *record, MilterStatus status)
+{
+    if (MILTER_STATUS_IS_PASS(status))
+        append_string(record, "pass");
+    else
+        append_enum(record, MILTER_TYPE_STATUS, status);
+}
+
+static void
+append_string_list (GString *record, const GList *strings)
+{
+    const GList *node;
+
+    g_string_append_c(record, '[');
+    for (node = strings; node; node = g_list_next(node)) {
+        if (node != strings)
+            g_string_append_c(record, ',');
+        append_string(record, node->data);
+    }
+    g_string_append_c(record, ']');
+}
+
+static GString *
+start_record (const gchar *type, guint tag)
+{
+    GString *record;
+    GTimeVal now;
+
+    record = g_string_new(NULL);
+    g_get_current_time(&now);
+    g_string_append_printf(record,
+                           "{\"time\":%ld.%06ld,\"type\":\"%s\",\"tag\":%u",
+                           (glong)now.tv_sec, (glong)now.tv_usec,
+                           type, tag);
+    return record;
+}
+
+static void
+finish_record (GString *record)
+{
+    g_string_append_c(record, '}');
+    queue_record(record);
+}
+
+void
+milter_manager_result_stream_emit_session (guint tag,
+                                           MilterClientContextState last_state,
+                                           MilterStatus status,
+                                           gdouble elapsed,
+                                           guint n_sessions)
+{
+    GString *record;
+
+    if (stream_fd == -1)
+        return;
+
+    record = start_record("session", tag);
+    append_key(record, "state");
+    append_enum(record, MILTER_TYPE_CLIENT_CONTEXT_STATE, last_state);
+    append_key(record, "status");
+    append_status(record, status);
+    append_key(record, "elapsed");
+    append_double(record, elapsed);
+    g_string_append_printf(record, ",\"n-sessions\":%u", n_sessions);
+    finish_record(record);
+}
+
+void
+milter_manager_result_stream_emit_disconnected (guint tag, gdouble elapsed)
+{
+    GString *record;
+
+    if (stream_fd == -1)
+        return;
+
+    record = start_record("disconnected", tag);
+    append_key(record, "elapsed");
+    append_double(record, elapsed);
+    finish_record(record);
+}
+
+void
+milter_manager_result_stream_emit_child (guint tag,
+                                         const gchar *name,
+                                         MilterServerContextState last_state,
+                                         MilterStatus status,
+                                         gdouble elapsed)
+{
+    GString *record;
+
+    if (stream_fd == -1)
+        return;
+
+    record = start_record("milter", tag);
+    append_key(record, "name");
+    append_string(record, name);
+    append_key(record, "state");
+    append_enum(record, MILTER_TYPE_SERVER_CONTEXT_STATE, last_state);
+    append_key(record, "status");
+    append_status(record, status);
+    append_key(record, "elapsed");
+    append_double(record, elapsed);
+    finish_record(record);
+}
+
+void
+milter_manager_result_stream_emit_header (guint tag,
+                                          const gchar *child_name,
+                                          const gchar *action,
+                                          const gchar *name,
+                                          const gchar *value)
+{
+    GString *record;
+
+    if (stream_fd == -1)
+        return;
+
+    record = start_record("header", tag);
+    append_key(record, "name");
+    append_string(record, child_name);
+    append_key(record, "action");
+    append_string(record, action);
+    append_key(record, "header");
+    append_string(record, name);
+    append_key(record, "value");
+    append_string(record, value);
+    finish_record(record);
+}
+
+void
+milter_manager_result_stream_emit_message (guint tag,
+                                           MilterMessageResult *result)
+{
+    GString *record;
+
+    if (stream_fd == -1)
+        return;
+
+    record = start_record("message", tag);
+    append_key(record, "from");
+    append_string(record, milter_message_result_get_from(result));
+    append_key(record, "recipients");
+    append_string_list(record, milter_message_result_get_recipients(result));
+    append_key(record, "temporary-failed-recipients");
+    append_string_list(
+        record,
+        milter_message_result_get_temporary_failed_recipients(result));
+    append_key(record, "rejected-recipients");
+    append_string_list(
+        record,
+        milter_message_result_get_rejected_recipients(result));
+    g_string_append_printf(record, ",\"body-size\":%" G_GUINT64_FORMAT,
+                           milter_message_result_get_body_size(result));
+    append_key(record, "state");
+    append_enum(record, MILTER_TYPE_STATE,
+                milter_message_result_get_state(result));
+    append_key(record, "status");
+    append_status(record, milter_message_result_get_status(result));
+    append_key(record, "quarantine");
+    g_string_append(record,
+                    milter_message_result_is_quarantine(result) ?
+                    "true" : "false");
+    append_key(record, "elapsed");
+    append_double(record, milter_message_result_get_elapsed_time(result));
+    finish_record(record);
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
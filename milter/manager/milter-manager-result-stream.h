@@ -0,0 +1,96 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MANAGER_RESULT_STREAM_H__
+#define __MILTER_MANAGER_RESULT_STREAM_H__
+
+#include <milter/core.h>
+#include <milter/client.h>
+#include <milter/server.h>
+
+G_BEGIN_DECLS
+
+#define MILTER_MANAGER_RESULT_STREAM_ERROR           (milter_manager_result_stream_error_quark())
+
+typedef enum
+{
+    MILTER_MANAGER_RESULT_STREAM_ERROR_INVALID_SPEC,
+    MILTER_MANAGER_RESULT_STREAM_ERROR_OPEN
+} MilterManagerResultStreamError;
+
+/*
+ * Process wide append-only stream of session results. Each
+ * result is written as a JSON object on its own line when
+ * a session, a child milter session or a message is
+ * finished. The stream is a file ("/path" or "file:/path")
+ * or a UNIX datagram socket ("unix:/path"). Records are
+ * written by a writer thread. They are dropped instead of
+ * blocking sessions when the writer can't keep up.
+ */
+
+GQuark   milter_manager_result_stream_error_quark
+                                    (void);
+
+gboolean milter_manager_result_stream_open
+                                    (const gchar *spec,
+                                     GError     **error);
+void     milter_manager_result_stream_close
+                                    (void);
+void     milter_manager_result_stream_flush
+                                    (void);
+gboolean milter_manager_result_stream_is_open
+                                    (void);
+const gchar *
+         milter_manager_result_stream_get_spec
+                                    (void);
+void     milter_manager_result_stream_reopen
+                                    (void);
+
+void     milter_manager_result_stream_emit_session
+                                    (guint                    tag,
+                                     MilterClientContextState last_state,
+                                     MilterStatus             status,
+                                     gdouble                  elapsed,
+                                     guint                    n_sessions);
+void     milter_manager_result_stream_emit_disconnected
+                                    (guint                    tag,
+                                     gdouble                  elapsed);
+void     milter_manager_result_stream_emit_child
+                                    (guint                    tag,
+                                     const gchar             *name,
+                                     MilterServerContextState last_state,
+                                     MilterStatus             status,
+                                     gdouble                  elapsed);
+void     milter_manager_result_stream_emit_header
+                                    (guint                    tag,
+                                     const gchar             *child_name,
+                                     const gchar             *action,
+                                     const gchar             *name,
+                                     const gchar             *value);
+void     milter_manager_result_stream_emit_message
+                                    (guint                    tag,
+                                     MilterMessageResult     *result);
+
+G_END_DECLS
+
+#endif /* __MILTER_MANAGER_RESULT_STREAM_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -0,0 +1,769 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+
+#include "milter-manager-statistics.h"
+#include "milter-manager-enum-types.h"
+
+#define N_LEADER_STATES (MILTER_MANAGER_LEADER_STATE_ABORT_REPLIED + 1)
+#define N_STATUSES (MILTER_STATUS_ERROR + 1)
+#define MAX_CHILDREN 64
+#define MAX_CHILD_NAME_SIZE 128
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#  define MAP_ANONYMOUS MAP_ANON
+#endif
+
+typedef struct _ChildStatistics ChildStatistics;
+struct _ChildStatistics
+{
+    gchar name[MAX_CHILD_NAME_SIZE];
+    guint n_connections;
+    guint n_connection_failures;
+    guint n_replies[N_STATUSES];
+    guint n_timeouts;
+};
+
+/*
+ * Counters of a process. They have no pointer so that
+ * workers can keep them in memory shared with the master.
+ */
+typedef struct _Counters Counters;
+struct _Counters
+{
+    /* Gauges: they reflect live objects and are never reset. */
+    guint n_leaders[N_LEADER_STATES];
+    guint n_active_leaders;
+    guint n_body_spools;
+    gsize body_spool_size;
+    gsize body_spool_capacity;
+
+    /* Counters: they are cleared by milter_manager_statistics_reset(). */
+    guint n_total_leaders;
+    gint n_children;
+    ChildStatistics children[MAX_CHILDREN];
+    gdouble last_event_loop_lag;
+    gdouble max_event_loop_lag;
+    gdouble total_event_loop_lag;
+    guint n_event_loop_checks;
+};
+
+static Counters local_counters;
+static Counters *counters = &local_counters;
+static Counters *shared_counters = NULL;
+static guint n_shared_counters = 0;
+
+/* Sessions may be processed by several threads. */
+G_LOCK_DEFINE_STATIC(statistics);
+
+/*
+ * Shares counters with @n_workers worker processes. It
+ * must be called before workers are forked. The calling
+ * process uses the first slot and each worker uses its own
+ * slot by milter_manager_statistics_use_worker_slot() so
+ * that the master can report counters of all processes.
+ */
+gboolean
+milter_manager_statistics_share (guint n_workers, GError **error)
+{
+    Counters *slots;
+    guint n_slots;
+
+    if (shared_counters)
+        milter_manager_statistics_unshare();
+
+    n_slots = n_workers + 1;
+    slots = mmap(NULL, sizeof(Counters) * n_slots,
+                 PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                 -1, 0);
+    if (slots == MAP_FAILED) {
+        g_set_error(error,
+                    G_FILE_ERROR,
+                    g_file_error_from_errno(errno),
+                    "failed to map shared statistics: %s",
+                    g_strerror(errno));
+        return FALSE;
+    }
+
+    G_LOCK(statistics);
+    memcpy(&(slots[0]), counters, sizeof(Counters));
+    shared_counters = slots;
+    n_shared_counters = n_slots;
+    counters = &(shared_counters[0]);
+    G_UNLOCK(statistics);
+
+    return TRUE;
+}
+
+void
+milter_manager_statistics_unshare (void)
+{
+    if (!shared_counters)
+        return;
+
+    G_LOCK(statistics);
+    memcpy(&local_counters, counters, sizeof(Counters));
+    counters = &local_counters;
+    munmap(shared_counters, sizeof(Counters) * n_shared_counters);
+    shared_counters = NULL;
+    n_shared_counters = 0;
+    G_UNLOCK(statistics);
+}
+
+void
+milter_manager_statistics_use_worker_slot (guint worker_id)
+{
+    if (!shared_counters || worker_id >= n_shared_counters)
+        return;
+
+    G_LOCK(statistics);
+    counters = &(shared_counters[worker_id]);
+    memset(counters, 0, sizeof(Counters));
+    G_UNLOCK(statistics);
+}
+
+void
+milter_manager_statistics_leader_transit (MilterManagerLeaderState from,
+                                          MilterManagerLeaderState to)
+{
+    if (from == to)
+        return;
+
+    G_LOCK(statistics);
+    if (from == MILTER_MANAGER_LEADER_STATE_INVALID) {
+        counters->n_active_leaders++;
+        counters->n_total_leaders++;
+    } else if (counters->n_leaders[from] > 0) {
+        counters->n_leaders[from]--;
+    }
+
+    if (to == MILTER_MANAGER_LEADER_STATE_INVALID) {
+        if (counters->n_active_leaders > 0)
+            counters->n_active_leaders--;
+    } else {
+        counters->n_leaders[to]++;
+    }
+    G_UNLOCK(statistics);
+}
+
+guint
+milter_manager_statistics_get_n_leaders (MilterManagerLeaderState state)
+{
+    guint n;
+
+    if (state == MILTER_MANAGER_LEADER_STATE_INVALID ||
+        (guint)state >= N_LEADER_STATES)
+        return 0;
+
+    G_LOCK(statistics);
+    n = counters->n_leaders[state];
+    G_UNLOCK(statistics);
+
+    return n;
+}
+
+guint
+milter_manager_statistics_get_n_active_leaders (void)
+{
+    guint n;
+
+    G_LOCK(statistics);
+    n = counters->n_active_leaders;
+    G_UNLOCK(statistics);
+
+    return n;
+}
+
+guint
+milter_manager_statistics_get_n_total_leaders (void)
+{
+    guint n;
+
+    G_LOCK(statistics);
+    n = counters->n_total_leaders;
+    G_UNLOCK(statistics);
+
+    return n;
+}
+
+static ChildStatistics *
+lookup_child_in (Counters *target, const gchar *name)
+{
+    gint i, n_children;
+
+    if (!name)
+        return NULL;
+
+    n_children = g_atomic_int_get(&(target->n_children));
+    for (i = 0; i < n_children; i++) {
+        ChildStatistics *statistics = &(target->children[i]);
+        if (strncmp(statistics->name, name, MAX_CHILD_NAME_SIZE - 1) == 0)
+            return statistics;
+    }
+
+    return NULL;
+}
+
+static ChildStatistics *
+lookup_child (const gchar *name)
+{
+    return lookup_child_in(counters, name);
+}
+
+/*
+ * A new entry is published by incrementing n_children after
+ * it is filled because the master reads it without the lock.
+ */
+static ChildStatistics *
+ensure_child_in (Counters *target, const gchar *name)
+{
+    ChildStatistics *statistics;
+    gint n_children;
+
+    statistics = lookup_child_in(target, name);
+    if (statistics)
+        return statistics;
+
+    n_children = target->n_children;
+    if (n_children >= MAX_CHILDREN)
+        return NULL;
+
+    statistics = &(target->children[n_children]);
+    memset(statistics, 0, sizeof(ChildStatistics));
+    g_strlcpy(statistics->name, name, MAX_CHILD_NAME_SIZE);
+    g_atomic_int_set(&(target->n_children), n_children + 1);
+
+    return statistics;
+}
+
+static ChildStatistics *
+ensure_child (const gchar *name)
+{
+    return ensure_child_in(counters, name);
+}
+
+void
+milter_manager_statistics_child_connected (const gchar *name)
+{
+    ChildStatistics *statistics;
+
+    if (!name)
+        return;
+    G_LOCK(statistics);
+    statistics = ensure_child(name);
+    if (statistics)
+        statistics->n_connections++;
+    G_UNLOCK(statistics);
+}
+
+void
+milter_manager_statistics_child_connection_failed (const gchar *name)
+{
+    ChildStatistics *statistics;
+
+    if (!name)
+        return;
+    G_LOCK(statistics);
+    statistics = ensure_child(name);
+    if (statistics)
+        statistics->n_connection_failures++;
+    G_UNLOCK(statistics);
+}
+
+void
+milter_manager_statistics_child_replied (const gchar *name,
+                                         MilterStatus status)
+{
+    ChildStatistics *statistics;
+
+    if (!name || (guint)status >= N_STATUSES)
+        return;
+    G_LOCK(statistics);
+    statistics = ensure_child(name);
+    if (statistics)
+        statistics->n_replies[status]++;
+    G_UNLOCK(statistics);
+}
+
+void
+milter_manager_statistics_child_timed_out (const gchar *name)
+{
+    ChildStatistics *statistics;
+
+    if (!name)
+        return;
+    G_LOCK(statistics);
+    statistics = ensure_child(name);
+    if (statistics)
+        statistics->n_timeouts++;
+    G_UNLOCK(statistics);
+}
+
+guint
+milter_manager_statistics_get_n_child_connections (const gchar *name)
+{
+    ChildStatistics *statistics;
+    guint n;
+
+    G_LOCK(statistics);
+    statistics = lookup_child(name);
+    n = statistics ? statistics->n_connections : 0;
+    G_UNLOCK(statistics);
+
+    return n;
+}
+
+guint
+milter_manager_statistics_get_n_child_connection_failures (const gchar *name)
+{
+    ChildStatistics *statistics;
+    guint n;
+
+    G_LOCK(statistics);
+    statistics = lookup_child(name);
+    n = statistics ? statistics->n_connection_failures : 0;
+    G_UNLOCK(statistics);
+
+    return n;
+}
+
+guint
+milter_manager_statistics_get_n_child_replies (const gchar *name,
+                                               MilterStatus status)
+{
+    ChildStatistics *statistics;
+    guint n_replies;
+
+    if ((guint)status >= N_STATUSES)
+        return 0;
+    G_LOCK(statistics);
+    statistics = lookup_child(name);
+    n_replies = statistics ? statistics->n_replies[status] : 0;
+    G_UNLOCK(statistics);
+
+    return n_replies;
+}
+
+guint
+milter_manager_statistics_get_n_child_timeouts (const gchar *name)
+{
+    ChildStatistics *statistics;
+    guint n;
+
+    G_LOCK(statistics);
+    statistics = lookup_child(name);
+    n = statistics ? statistics->n_timeouts : 0;
+    G_UNLOCK(statistics);
+
+    return n;
+}
+
+void
+milter_manager_statistics_body_spool_resize (gint n_spools_delta,
+                                             gssize size_delta,
+                                             gssize capacity_delta)
+{
+    G_LOCK(statistics);
+    counters->n_body_spools += n_spools_delta;
+    counters->body_spool_size += size_delta;
+    counters->body_spool_capacity += capacity_delta;
+    G_UNLOCK(statistics);
+}
+
+guint
+milter_manager_statistics_get_n_body_spools (void)
+{
+    guint n;
+
+    G_LOCK(statistics);
+    n = counters->n_body_spools;
+    G_UNLOCK(statistics);
+
+    return n;
+}
+
+gsize
+milter_manager_statistics_get_body_spool_size (void)
+{
+    gsize size;
+
+    G_LOCK(statistics);
+    size = counters->body_spool_size;
+    G_UNLOCK(statistics);
+
+    return size;
+}
+
+gsize
+milter_manager_statistics_get_body_spool_capacity (void)
+{
+    gsize size;
+
+    G_LOCK(statistics);
+    size = counters->body_spool_capacity;
+    G_UNLOCK(statistics);
+
+    return size;
+}
+
+typedef struct _EventLoopWatcher EventLoopWatcher;
+struct _EventLoopWatcher
+{
+    GTimer *timer;
+    gdouble interval;
+};
+
+static gboolean
+cb_check_event_loop (gpointer user_data)
+{
+    EventLoopWatcher *watcher = user_data;
+    gdouble lag;
+
+    lag = g_timer_elapsed(watcher->timer, NULL) - watcher->interval;
+    if (lag < 0.0)
+        lag = 0.0;
+    milter_manager_statistics_event_loop_lagged(lag);
+    g_timer_start(watcher->timer);
+
+    return TRUE;
+}
+
+static void
+free_event_loop_watcher (gpointer data)
+{
+    EventLoopWatcher *watcher = data;
+
+    g_timer_destroy(watcher->timer);
+    g_free(watcher);
+}
+
+/*
+ * The lag is how late a timeout is dispatched. It grows
+ * when a callback blocks the loop.
+ */
+guint
+milter_manager_statistics_watch_event_loop (MilterEventLoop *loop,
+                                            gdouble interval)
+{
+    EventLoopWatcher *watcher;
+
+    watcher = g_new0(EventLoopWatcher, 1);
+    watcher->timer = g_timer_new();
+    watcher->interval = interval;
+
+    return milter_event_loop_add_timeout_full(loop,
+                                              G_PRIORITY_DEFAULT,
+                                              interval,
+                                              cb_check_event_loop,
+                                              watcher,
+                                              free_event_loop_watcher);
+}
+
+void
+milter_manager_statistics_event_loop_lagged (gdouble lag)
+{
+    G_LOCK(statistics);
+    counters->last_event_loop_lag = lag;
+    if (lag > counters->max_event_loop_lag)
+        counters->max_event_loop_lag = lag;
+    counters->total_event_loop_lag += lag;
+    counters->n_event_loop_checks++;
+    G_UNLOCK(statistics);
+}
+
+gdouble
+milter_manager_statistics_get_last_event_loop_lag (void)
+{
+    gdouble lag;
+
+    G_LOCK(statistics);
+    lag = counters->last_event_loop_lag;
+    G_UNLOCK(statistics);
+
+    return lag;
+}
+
+gdouble
+milter_manager_statistics_get_max_event_loop_lag (void)
+{
+    gdouble lag;
+
+    G_LOCK(statistics);
+    lag = counters->max_event_loop_lag;
+    G_UNLOCK(statistics);
+
+    return lag;
+}
+
+static gdouble
+average_event_loop_lag (Counters *target)
+{
+    if (target->n_event_loop_checks == 0)
+        return 0.0;
+    return target->total_event_loop_lag / target->n_event_loop_checks;
+}
+
+gdouble
+milter_manager_statistics_get_average_event_loop_lag (void)
+{
+    gdouble lag;
+
+    G_LOCK(statistics);
+    lag = average_event_loop_lag(counters);
+    G_UNLOCK(statistics);
+
+    return lag;
+}
+
+/* Only counters of this process are cleared. */
+void
+milter_manager_statistics_reset (void)
+{
+    G_LOCK(statistics);
+    counters->n_total_leaders = 0;
+    g_atomic_int_set(&(counters->n_children), 0);
+    counters->last_event_loop_lag = 0.0;
+    counters->max_event_loop_lag = 0.0;
+    counters->total_event_loop_lag = 0.0;
+    counters->n_event_loop_checks = 0;
+    G_UNLOCK(statistics);
+}
+
+static void
+merge_counters (Counters *sum, Counters *target)
+{
+    gint i, n_children;
+    guint state, status;
+
+    for (state = 0; state < N_LEADER_STATES; state++)
+        sum->n_leaders[state] += target->n_leaders[state];
+    sum->n_active_leaders += target->n_active_leaders;
+    sum->n_body_spools += target->n_body_spools;
+    sum->body_spool_size += target->body_spool_size;
+    sum->body_spool_capacity += target->body_spool_capacity;
+
+    sum->n_total_leaders += target->n_total_leaders;
+    n_children = g_atomic_int_get(&(target->n_children));
+    for (i = 0; i < n_children; i++) {
+        ChildStatistics *child = &(target->children[i]);
+        ChildStatistics *sum_child;
+
+        sum_child = ensure_child_in(sum, child->name);
+        if (!sum_child)
+            continue;
+        sum_child->n_connections += child->n_connections;
+        sum_child->n_connection_failures += child->n_connection_failures;
+        for (status = 0; status < N_STATUSES; status++)
+            sum_child->n_replies[status] += child->n_replies[status];
+        sum_child->n_timeouts += child->n_timeouts;
+    }
+    if (target->last_event_loop_lag > sum->last_event_loop_lag)
+        sum->last_event_loop_lag = target->last_event_loop_lag;
+    if (target->max_event_loop_lag > sum->max_event_loop_lag)
+        sum->max_event_loop_lag = target->max_event_loop_lag;
+    sum->total_event_loop_lag += target->total_event_loop_lag;
+    sum->n_event_loop_checks += target->n_event_loop_checks;
+}
+
+/*
+ * Slots of workers are read without their lock. A report
+ * may mix values from slightly different moments but each
+ * value is consistent by itself.
+ */
+static void
+collect_counters (Counters *sum)
+{
+    guint i;
+
+    G_LOCK(statistics);
+    if (!shared_counters) {
+        merge_counters(sum, counters);
+    } else {
+        for (i = 0; i < n_shared_counters; i++)
+            merge_counters(sum, &(shared_counters[i]));
+    }
+    G_UNLOCK(statistics);
+}
+
+static void
+append_uint_element (GString *string, const gchar *name, guint64 value,
+                     guint indent)
+{
+    milter_utils_append_indent(string, indent);
+    g_string_append_printf(string, "<%s>%" G_GUINT64_FORMAT "</%s>\n",
+                           name, value, name);
+}
+
+static void
+append_double_element (GString *string, const gchar *name, gdouble value,
+                       guint indent)
+{
+    gchar buffer[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_ascii_formatd(buffer, sizeof(buffer), "%.6f", value);
+    milter_utils_xml_append_text_element(string, name, buffer, indent);
+}
+
+static void
+leaders_to_xml_string (GString *string, Counters *sum, guint indent)
+{
+    gint state;
+
+    milter_utils_append_indent(string, indent);
+    g_string_append(string, "<leaders>\n");
+    append_uint_element(string, "active", sum->n_active_leaders, indent + 2);
+    append_uint_element(string, "total", sum->n_total_leaders, indent + 2);
+    for (state = MILTER_MANAGER_LEADER_STATE_START;
+         state < N_LEADER_STATES;
+         state++) {
+        gchar *state_name;
+
+        if (sum->n_leaders[state] == 0)
+            continue;
+
+        state_name =
+            milter_utils_get_enum_nick_name(MILTER_TYPE_MANAGER_LEADER_STATE,
+                                            state);
+        milter_utils_append_indent(string, indent + 2);
+        g_string_append_printf(string, "<state name=\"%s\">%u</state>\n",
+                               state_name, sum->n_leaders[state]);
+        g_free(state_name);
+    }
+    milter_utils_append_indent(string, indent);
+    g_string_append(string, "</leaders>\n");
+}
+
+static void
+child_to_xml_string (GString *string, ChildStatistics *statistics,
+                     guint indent)
+{
+    gchar *escaped_name;
+    gint status;
+
+    escaped_name = g_markup_escape_text(statistics->name, -1);
+    milter_utils_append_indent(string, indent);
+    g_string_append_printf(string, "<child name=\"%s\">\n", escaped_name);
+    g_free(escaped_name);
+
+    append_uint_element(string, "connections",
+                        statistics->n_connections, indent + 2);
+    append_uint_element(string, "connection-failures",
+                        statistics->n_connection_failures, indent + 2);
+    append_uint_element(string, "timeouts",
+                        statistics->n_timeouts, indent + 2);
+
+    milter_utils_append_indent(string, indent + 2);
+    g_string_append(string, "<replies>\n");
+    for (status = 0; status < N_STATUSES; status++) {
+        gchar *status_name;
+
+        if (statistics->n_replies[status] == 0)
+            continue;
+
+        status_name = milter_utils_get_enum_nick_name(MILTER_TYPE_STATUS,
+                                                      status);
+        milter_utils_append_indent(string, indent + 4);
+        g_string_append_printf(string, "<reply status=\"%s\">%u</reply>\n",
+                               status_name, statistics->n_replies[status]);
+        g_free(status_name);
+    }
+    milter_utils_append_indent(string, indent + 2);
+    g_string_append(string, "</replies>\n");
+
+    milter_utils_append_indent(string, indent);
+    g_string_append(string, "</child>\n");
+}
+
+static gint
+compare_child_name (gconstpointer a, gconstpointer b)
+{
+    const ChildStatistics *child_a = a;
+    const ChildStatistics *child_b = b;
+
+    return strcmp(child_a->name, child_b->name);
+}
+
+static void
+children_to_xml_string (GString *string, Counters *sum, guint indent)
+{
+    gint i;
+
+    milter_utils_append_indent(string, indent);
+    g_string_append(string, "<children>\n");
+    qsort(sum->children, sum->n_children, sizeof(ChildStatistics),
+          compare_child_name);
+    for (i = 0; i < sum->n_children; i++)
+        child_to_xml_string(string, &(sum->children[i]), indent + 2);
+    milter_utils_append_indent(string, indent);
+    g_string_append(string, "</children>\n");
+}
+
+/*
+ * Counters of all processes are summed up. The largest lag
+ * of the processes is reported as the last and max lags.
+ */
+void
+milter_manager_statistics_to_xml_string (GString *string, guint indent)
+{
+    Counters *sum;
+
+    sum = g_new0(Counters, 1);
+    collect_counters(sum);
+
+    leaders_to_xml_string(string, sum, indent);
+    children_to_xml_string(string, sum, indent);
+
+    milter_utils_append_indent(string, indent);
+    g_string_append(string, "<body-spool>\n");
+    append_uint_element(string, "spools", sum->n_body_spools, indent + 2);
+    append_uint_element(string, "size", sum->body_spool_size, indent + 2);
+    append_uint_element(string, "capacity", sum->body_spool_capacity,
+                        indent + 2);
+    milter_utils_append_indent(string, indent);
+    g_string_append(string, "</body-spool>\n");
+
+    milter_utils_append_indent(string, indent);
+    g_string_append(string, "<event-loop>\n");
+    append_double_element(string, "last-lag",
+                          sum->last_event_loop_lag, indent + 2);
+    append_double_element(string, "max-lag",
+                          sum->max_event_loop_lag, indent + 2);
+    append_double_element(string, "average-lag",
+                          average_event_loop_lag(sum),
+                          indent + 2);
+    append_uint_element(string, "checks", sum->n_event_loop_checks,
+                        indent + 2);
+    milter_utils_append_indent(string, indent);
+    g_string_append(string, "</event-loop>\n");
+
+    g_free(sum);
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
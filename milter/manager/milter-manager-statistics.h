@@ -0,0 +1,109 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MANAGER_STATISTICS_H__
+#define __MILTER_MANAGER_STATISTICS_H__
+
+#include <milter/core.h>
+#include <milter/manager/milter-manager-leader.h>
+
+G_BEGIN_DECLS
+
+#define MILTER_MANAGER_STATISTICS_EVENT_LOOP_CHECK_INTERVAL 1.0
+
+/*
+ * Process wide counters for the "status" controller
+ * command. They are updated by leaders, children and body
+ * spools when their state is changed so that a status
+ * report doesn't need to walk live objects.
+ */
+
+gboolean milter_manager_statistics_share
+                                    (guint    n_workers,
+                                     GError **error);
+void     milter_manager_statistics_unshare
+                                    (void);
+void     milter_manager_statistics_use_worker_slot
+                                    (guint worker_id);
+
+void     milter_manager_statistics_leader_transit
+                                    (MilterManagerLeaderState from,
+                                     MilterManagerLeaderState to);
+guint    milter_manager_statistics_get_n_leaders
+                                    (MilterManagerLeaderState state);
+guint    milter_manager_statistics_get_n_active_leaders
+                                    (void);
+guint    milter_manager_statistics_get_n_total_leaders
+                                    (void);
+
+void     milter_manager_statistics_child_connected
+                                    (const gchar *name);
+void     milter_manager_statistics_child_connection_failed
+                                    (const gchar *name);
+void     milter_manager_statistics_child_replied
+                                    (const gchar *name,
+                                     MilterStatus status);
+void     milter_manager_statistics_child_timed_out
+                                    (const gchar *name);
+guint    milter_manager_statistics_get_n_child_connections
+                                    (const gchar *name);
+guint    milter_manager_statistics_get_n_child_connection_failures
+                                    (const gchar *name);
+guint    milter_manager_statistics_get_n_child_replies
+                                    (const gchar *name,
+                                     MilterStatus status);
+guint    milter_manager_statistics_get_n_child_timeouts
+                                    (const gchar *name);
+
+void     milter_manager_statistics_body_spool_resize
+                                    (gint   n_spools_delta,
+                                     gssize size_delta,
+                                     gssize capacity_delta);
+guint    milter_manager_statistics_get_n_body_spools
+                                    (void);
+gsize    milter_manager_statistics_get_body_spool_size
+                                    (void);
+gsize    milter_manager_statistics_get_body_spool_capacity
+                                    (void);
+
+guint    milter_manager_statistics_watch_event_loop
+                                    (MilterEventLoop *loop,
+                                     gdouble interval);
+void     milter_manager_statistics_event_loop_lagged
+                                    (gdouble lag);
+gdouble  milter_manager_statistics_get_last_event_loop_lag
+                                    (void);
+gdouble  milter_manager_statistics_get_max_event_loop_lag
+                                    (void);
+gdouble  milter_manager_statistics_get_average_event_loop_lag
+                                    (void);
+
+void     milter_manager_statistics_reset
+                                    (void);
+void     milter_manager_statistics_to_xml_string
+                                    (GString *string,
+                                     guint indent);
+
+G_END_DECLS
+
+#endif /* __MILTER_MANAGER_STATISTICS_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
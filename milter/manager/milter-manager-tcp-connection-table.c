@@ -0,0 +1,528 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#if defined(HAVE_LINUX_NETLINK_H) &&            \
+    defined(HAVE_LINUX_SOCK_DIAG_H) &&          \
+    defined(HAVE_LINUX_INET_DIAG_H)
+#  define USE_SOCK_DIAG 1
+#  include <linux/netlink.h>
+#  include <linux/sock_diag.h>
+#  include <linux/inet_diag.h>
+#endif
+
+#include "milter-manager-tcp-connection-table.h"
+
+#define PROC_NET_TCP "/proc/net/tcp"
+#define PROC_NET_TCP6 "/proc/net/tcp6"
+
+/*
+ * The state of the socket connected to a remote address is
+ * asked to the kernel by NETLINK_SOCK_DIAG with a filter for
+ * the address. If it isn't available, /proc/net/tcp{,6} are
+ * parsed into a cache that is keyed by the remote address
+ * in the same hex notation as the files.
+ */
+struct _MilterManagerTCPConnectionTable
+{
+    gboolean sock_diag_available;
+    GHashTable *cache;
+    GTimer *cache_timer;
+    gdouble cache_lifetime;
+};
+
+typedef struct _CachedConnection CachedConnection;
+struct _CachedConnection
+{
+    MilterManagerTCPState state;
+    gchar *local_address;
+};
+
+static void
+cached_connection_free (CachedConnection *connection)
+{
+    g_free(connection->local_address);
+    g_free(connection);
+}
+
+MilterManagerTCPConnectionTable *
+milter_manager_tcp_connection_table_new (void)
+{
+    MilterManagerTCPConnectionTable *table;
+
+    table = g_new0(MilterManagerTCPConnectionTable, 1);
+#ifdef USE_SOCK_DIAG
+    table->sock_diag_available = TRUE;
+#else
+    table->sock_diag_available = FALSE;
+#endif
+    table->cache = NULL;
+    table->cache_timer = NULL;
+    table->cache_lifetime =
+        MILTER_MANAGER_TCP_CONNECTION_TABLE_DEFAULT_CACHE_LIFETIME;
+
+    return table;
+}
+
+void
+milter_manager_tcp_connection_table_free (MilterManagerTCPConnectionTable *table)
+{
+    milter_manager_tcp_connection_table_purge_cache(table);
+    g_free(table);
+}
+
+gboolean
+milter_manager_tcp_connection_table_is_available (MilterManagerTCPConnectionTable *table)
+{
+    if (table->sock_diag_available)
+        return TRUE;
+    return g_file_test(PROC_NET_TCP, G_FILE_TEST_EXISTS);
+}
+
+void
+milter_manager_tcp_connection_table_set_cache_lifetime (MilterManagerTCPConnectionTable *table,
+                                                        gdouble lifetime)
+{
+    table->cache_lifetime = lifetime;
+}
+
+gdouble
+milter_manager_tcp_connection_table_get_cache_lifetime (MilterManagerTCPConnectionTable *table)
+{
+    return table->cache_lifetime;
+}
+
+void
+milter_manager_tcp_connection_table_purge_cache (MilterManagerTCPConnectionTable *table)
+{
+    if (table->cache) {
+        g_hash_table_unref(table->cache);
+        table->cache = NULL;
+    }
+    if (table->cache_timer) {
+        g_timer_destroy(table->cache_timer);
+        table->cache_timer = NULL;
+    }
+}
+
+static gboolean
+map_ipv4_address (const struct sockaddr_in *address,
+                  struct sockaddr_in6 *mapped_address)
+{
+    memset(mapped_address, 0, sizeof(*mapped_address));
+    mapped_address->sin6_family = AF_INET6;
+    mapped_address->sin6_port = address->sin_port;
+    mapped_address->sin6_addr.s6_addr[10] = 0xff;
+    mapped_address->sin6_addr.s6_addr[11] = 0xff;
+    memcpy(mapped_address->sin6_addr.s6_addr + 12,
+           &(address->sin_addr), sizeof(address->sin_addr));
+    return TRUE;
+}
+
+#ifdef USE_SOCK_DIAG
+typedef enum {
+    SOCK_DIAG_FOUND,
+    SOCK_DIAG_NOT_FOUND,
+    SOCK_DIAG_ERROR
+} SockDiagResult;
+
+static gboolean
+send_sock_diag_request (gint fd, const struct sockaddr *remote_address)
+{
+    gchar buffer[NLMSG_SPACE(sizeof(struct inet_diag_req_v2)) +
+                 NLA_HDRLEN +
+                 sizeof(struct inet_diag_bc_op) +
+                 sizeof(struct inet_diag_hostcond) +
+                 sizeof(struct in6_addr)];
+    struct nlmsghdr *header;
+    struct inet_diag_req_v2 *request;
+    struct nlattr *attribute;
+    struct inet_diag_bc_op *operation;
+    struct inet_diag_hostcond *condition;
+    struct sockaddr_nl netlink_address;
+    const void *address;
+    gsize address_size, bytecode_size;
+    gint port;
+
+    if (remote_address->sa_family == AF_INET6) {
+        const struct sockaddr_in6 *inet6;
+
+        inet6 = (const struct sockaddr_in6 *)remote_address;
+        address = &(inet6->sin6_addr);
+        address_size = sizeof(inet6->sin6_addr);
+        port = ntohs(inet6->sin6_port);
+    } else {
+        const struct sockaddr_in *inet;
+
+        inet = (const struct sockaddr_in *)remote_address;
+        address = &(inet->sin_addr);
+        address_size = sizeof(inet->sin_addr);
+        port = ntohs(inet->sin_port);
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    bytecode_size = sizeof(*operation) + sizeof(*condition) + address_size;
+
+    header = (struct nlmsghdr *)buffer;
+    header->nlmsg_len =
+        NLMSG_SPACE(sizeof(*request)) + NLA_HDRLEN + bytecode_size;
+    header->nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    header->nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+
+    request = NLMSG_DATA(header);
+    request->sdiag_family = remote_address->sa_family;
+    request->sdiag_protocol = IPPROTO_TCP;
+    request->idiag_states = ~0U;
+
+    /* The filter accepts only sockets whose destination,
+     * the SMTP client, is "remote_address". "yes" jumps to
+     * the end of the bytecode and "no" jumps beyond it. */
+    attribute = (struct nlattr *)(buffer + NLMSG_SPACE(sizeof(*request)));
+    attribute->nla_type = INET_DIAG_REQ_BYTECODE;
+    attribute->nla_len = NLA_HDRLEN + bytecode_size;
+
+    operation = (struct inet_diag_bc_op *)((gchar *)attribute + NLA_HDRLEN);
+    operation->code = INET_DIAG_BC_D_COND;
+    operation->yes = bytecode_size;
+    operation->no = bytecode_size + 4;
+
+    condition = (struct inet_diag_hostcond *)(operation + 1);
+    condition->family = remote_address->sa_family;
+    condition->prefix_len = address_size * 8;
+    condition->port = port;
+    memcpy(condition->addr, address, address_size);
+
+    memset(&netlink_address, 0, sizeof(netlink_address));
+    netlink_address.nl_family = AF_NETLINK;
+
+    return sendto(fd, buffer, header->nlmsg_len, 0,
+                  (struct sockaddr *)&netlink_address,
+                  sizeof(netlink_address)) == (gssize)header->nlmsg_len;
+}
+
+static void
+inet_diag_sockid_to_local_address (const struct inet_diag_msg *message,
+                                   MilterGenericSocketAddress *local_address)
+{
+    memset(local_address, 0, sizeof(*local_address));
+    if (message->idiag_family == AF_INET6) {
+        struct sockaddr_in6 *inet6 = &(local_address->address.inet6);
+
+        inet6->sin6_family = AF_INET6;
+        inet6->sin6_port = message->id.idiag_sport;
+        memcpy(&(inet6->sin6_addr), message->id.idiag_src,
+               sizeof(inet6->sin6_addr));
+    } else {
+        struct sockaddr_in *inet = &(local_address->address.inet);
+
+        inet->sin_family = AF_INET;
+        inet->sin_port = message->id.idiag_sport;
+        memcpy(&(inet->sin_addr), message->id.idiag_src,
+               sizeof(inet->sin_addr));
+    }
+}
+
+static SockDiagResult
+lookup_sock_diag (const struct sockaddr *remote_address,
+                  MilterManagerTCPState *state,
+                  MilterGenericSocketAddress *local_address)
+{
+    gint fd;
+    SockDiagResult result = SOCK_DIAG_NOT_FOUND;
+    gboolean done = FALSE;
+
+    fd = socket(AF_NETLINK, SOCK_DGRAM, NETLINK_SOCK_DIAG);
+    if (fd == -1) {
+        milter_debug("[tcp-connection-table][sock-diag][socket][error] %s",
+                     g_strerror(errno));
+        return SOCK_DIAG_ERROR;
+    }
+
+    if (!send_sock_diag_request(fd, remote_address)) {
+        milter_debug("[tcp-connection-table][sock-diag][send][error] %s",
+                     g_strerror(errno));
+        close(fd);
+        return SOCK_DIAG_ERROR;
+    }
+
+    /* Responses are read until NLMSG_DONE to drain the dump. */
+    while (!done) {
+        gchar buffer[8192];
+        struct nlmsghdr *header;
+        gssize read_size;
+
+        read_size = recv(fd, buffer, sizeof(buffer), 0);
+        if (read_size == -1) {
+            if (errno == EINTR)
+                continue;
+            milter_debug("[tcp-connection-table][sock-diag][recv][error] %s",
+                         g_strerror(errno));
+            result = SOCK_DIAG_ERROR;
+            break;
+        }
+        if (read_size == 0)
+            break;
+
+        for (header = (struct nlmsghdr *)buffer;
+             NLMSG_OK(header, (gsize)read_size);
+             header = NLMSG_NEXT(header, read_size)) {
+            const struct inet_diag_msg *message;
+
+            if (header->nlmsg_type == NLMSG_DONE) {
+                done = TRUE;
+                break;
+            }
+            if (header->nlmsg_type == NLMSG_ERROR) {
+                const struct nlmsgerr *error = NLMSG_DATA(header);
+
+                milter_debug("[tcp-connection-table][sock-diag][error] %s",
+                             g_strerror(-error->error));
+                result = SOCK_DIAG_ERROR;
+                done = TRUE;
+                break;
+            }
+            if (result == SOCK_DIAG_FOUND)
+                continue;
+
+            message = NLMSG_DATA(header);
+            *state = message->idiag_state;
+            if (local_address)
+                inet_diag_sockid_to_local_address(message, local_address);
+            result = SOCK_DIAG_FOUND;
+        }
+    }
+    close(fd);
+
+    return result;
+}
+#endif
+
+static gchar *
+format_proc_net_tcp_address (const struct sockaddr *address)
+{
+    if (address->sa_family == AF_INET6) {
+        const struct sockaddr_in6 *inet6;
+        guint32 words[4];
+
+        inet6 = (const struct sockaddr_in6 *)address;
+        memcpy(words, &(inet6->sin6_addr), sizeof(words));
+        return g_strdup_printf("%08X%08X%08X%08X:%04X",
+                               words[0], words[1], words[2], words[3],
+                               ntohs(inet6->sin6_port));
+    } else {
+        const struct sockaddr_in *inet;
+        guint32 word;
+
+        inet = (const struct sockaddr_in *)address;
+        memcpy(&word, &(inet->sin_addr), sizeof(word));
+        return g_strdup_printf("%08X:%04X", word, ntohs(inet->sin_port));
+    }
+}
+
+static gboolean
+parse_proc_net_tcp_address (const gchar *hex,
+                            MilterGenericSocketAddress *address)
+{
+    guint32 words[4];
+    guint port;
+
+    memset(address, 0, sizeof(*address));
+    if (sscanf(hex, "%8X%8X%8X%8X:%4X",
+               &words[0], &words[1], &words[2], &words[3], &port) == 5) {
+        struct sockaddr_in6 *inet6 = &(address->address.inet6);
+
+        inet6->sin6_family = AF_INET6;
+        inet6->sin6_port = htons(port);
+        memcpy(&(inet6->sin6_addr), words, sizeof(words));
+        return TRUE;
+    } else if (sscanf(hex, "%8X:%4X", &words[0], &port) == 2) {
+        struct sockaddr_in *inet = &(address->address.inet);
+
+        inet->sin_family = AF_INET;
+        inet->sin_port = htons(port);
+        memcpy(&(inet->sin_addr), &words[0], sizeof(words[0]));
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+static void
+load_proc_net_tcp (GHashTable *cache, const gchar *path)
+{
+    FILE *file;
+    gchar line[512];
+
+    file = fopen(path, "r");
+    if (!file) {
+        milter_debug("[tcp-connection-table][proc][open][error] <%s>: %s",
+                     path, g_strerror(errno));
+        return;
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        gchar local_address[64], remote_address[64];
+        guint state;
+        CachedConnection *connection;
+
+        if (sscanf(line, " %*u: %63s %63s %X",
+                   local_address, remote_address, &state) != 3)
+            continue;
+
+        connection = g_new(CachedConnection, 1);
+        connection->state = state;
+        connection->local_address = g_strdup(local_address);
+        g_hash_table_replace(cache, g_strdup(remote_address), connection);
+    }
+    fclose(file);
+}
+
+static void
+update_cache (MilterManagerTCPConnectionTable *table)
+{
+    if (table->cache &&
+        g_timer_elapsed(table->cache_timer, NULL) <= table->cache_lifetime)
+        return;
+
+    milter_manager_tcp_connection_table_purge_cache(table);
+    table->cache = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                         g_free,
+                                         (GDestroyNotify)cached_connection_free);
+    load_proc_net_tcp(table->cache, PROC_NET_TCP);
+    load_proc_net_tcp(table->cache, PROC_NET_TCP6);
+    table->cache_timer = g_timer_new();
+}
+
+static gboolean
+lookup_proc_net_tcp (MilterManagerTCPConnectionTable *table,
+                     const struct sockaddr *remote_address,
+                     MilterManagerTCPState *state,
+                     MilterGenericSocketAddress *local_address)
+{
+    gchar *key;
+    CachedConnection *connection;
+
+    update_cache(table);
+
+    key = format_proc_net_tcp_address(remote_address);
+    connection = g_hash_table_lookup(table->cache, key);
+    g_free(key);
+    if (!connection)
+        return FALSE;
+
+    *state = connection->state;
+    if (local_address)
+        parse_proc_net_tcp_address(connection->local_address, local_address);
+    return TRUE;
+}
+
+static gboolean
+lookup (MilterManagerTCPConnectionTable *table,
+        const struct sockaddr *remote_address,
+        MilterManagerTCPState *state,
+        MilterGenericSocketAddress *local_address)
+{
+#ifdef USE_SOCK_DIAG
+    if (table->sock_diag_available) {
+        switch (lookup_sock_diag(remote_address, state, local_address)) {
+        case SOCK_DIAG_FOUND:
+            return TRUE;
+        case SOCK_DIAG_NOT_FOUND:
+            return FALSE;
+        case SOCK_DIAG_ERROR:
+            milter_info("[tcp-connection-table][sock-diag][unavailable] "
+                        "fallback to <%s>", PROC_NET_TCP);
+            table->sock_diag_available = FALSE;
+            break;
+        }
+    }
+#endif
+
+    return lookup_proc_net_tcp(table, remote_address, state, local_address);
+}
+
+gboolean
+milter_manager_tcp_connection_table_lookup (MilterManagerTCPConnectionTable *table,
+                                            const struct sockaddr *remote_address,
+                                            MilterManagerTCPState *state,
+                                            MilterGenericSocketAddress *local_address)
+{
+    struct sockaddr_in6 mapped_address;
+
+    switch (remote_address->sa_family) {
+    case AF_INET:
+        if (lookup(table, remote_address, state, local_address))
+            return TRUE;
+        /* The SMTP server may accept IPv4 clients by an IPv6 socket. */
+        map_ipv4_address((const struct sockaddr_in *)remote_address,
+                         &mapped_address);
+        return lookup(table, (const struct sockaddr *)&mapped_address,
+                      state, local_address);
+    case AF_INET6:
+        return lookup(table, remote_address, state, local_address);
+    default:
+        return FALSE;
+    }
+}
+
+const gchar *
+milter_manager_tcp_state_to_string (MilterManagerTCPState state)
+{
+    switch (state) {
+    case MILTER_MANAGER_TCP_STATE_ESTABLISHED:
+        return "ESTABLISHED";
+    case MILTER_MANAGER_TCP_STATE_SYN_SENT:
+        return "SYN_SENT";
+    case MILTER_MANAGER_TCP_STATE_SYN_RECV:
+        return "SYN_RECV";
+    case MILTER_MANAGER_TCP_STATE_FIN_WAIT1:
+        return "FIN_WAIT1";
+    case MILTER_MANAGER_TCP_STATE_FIN_WAIT2:
+        return "FIN_WAIT2";
+    case MILTER_MANAGER_TCP_STATE_TIME_WAIT:
+        return "TIME_WAIT";
+    case MILTER_MANAGER_TCP_STATE_CLOSE:
+        return "CLOSE";
+    case MILTER_MANAGER_TCP_STATE_CLOSE_WAIT:
+        return "CLOSE_WAIT";
+    case MILTER_MANAGER_TCP_STATE_LAST_ACK:
+        return "LAST_ACK";
+    case MILTER_MANAGER_TCP_STATE_LISTEN:
+        return "LISTEN";
+    case MILTER_MANAGER_TCP_STATE_CLOSING:
+        return "CLOSING";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
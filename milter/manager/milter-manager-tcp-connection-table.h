@@ -0,0 +1,84 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MANAGER_TCP_CONNECTION_TABLE_H__
+#define __MILTER_MANAGER_TCP_CONNECTION_TABLE_H__
+
+#include <milter/core.h>
+
+G_BEGIN_DECLS
+
+#define MILTER_MANAGER_TCP_CONNECTION_TABLE_DEFAULT_CACHE_LIFETIME 5.0
+
+/* The same values as the kernel's TCP states. */
+typedef enum
+{
+    MILTER_MANAGER_TCP_STATE_UNKNOWN,
+    MILTER_MANAGER_TCP_STATE_ESTABLISHED,
+    MILTER_MANAGER_TCP_STATE_SYN_SENT,
+    MILTER_MANAGER_TCP_STATE_SYN_RECV,
+    MILTER_MANAGER_TCP_STATE_FIN_WAIT1,
+    MILTER_MANAGER_TCP_STATE_FIN_WAIT2,
+    MILTER_MANAGER_TCP_STATE_TIME_WAIT,
+    MILTER_MANAGER_TCP_STATE_CLOSE,
+    MILTER_MANAGER_TCP_STATE_CLOSE_WAIT,
+    MILTER_MANAGER_TCP_STATE_LAST_ACK,
+    MILTER_MANAGER_TCP_STATE_LISTEN,
+    MILTER_MANAGER_TCP_STATE_CLOSING
+} MilterManagerTCPState;
+
+typedef struct _MilterManagerTCPConnectionTable MilterManagerTCPConnectionTable;
+
+MilterManagerTCPConnectionTable *
+             milter_manager_tcp_connection_table_new
+                                        (void);
+void         milter_manager_tcp_connection_table_free
+                                        (MilterManagerTCPConnectionTable *table);
+
+gboolean     milter_manager_tcp_connection_table_is_available
+                                        (MilterManagerTCPConnectionTable *table);
+
+void         milter_manager_tcp_connection_table_set_cache_lifetime
+                                        (MilterManagerTCPConnectionTable *table,
+                                         gdouble lifetime);
+gdouble      milter_manager_tcp_connection_table_get_cache_lifetime
+                                        (MilterManagerTCPConnectionTable *table);
+void         milter_manager_tcp_connection_table_purge_cache
+                                        (MilterManagerTCPConnectionTable *table);
+
+/*
+ * Looks up the local TCP socket that is connected to
+ * "remote_address". "local_address" may be NULL.
+ */
+gboolean     milter_manager_tcp_connection_table_lookup
+                                        (MilterManagerTCPConnectionTable *table,
+                                         const struct sockaddr *remote_address,
+                                         MilterManagerTCPState *state,
+                                         MilterGenericSocketAddress *local_address);
+
+const gchar *milter_manager_tcp_state_to_string
+                                        (MilterManagerTCPState state);
+
+G_END_DECLS
+
+#endif /* __MILTER_MANAGER_TCP_CONNECTION_TABLE_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
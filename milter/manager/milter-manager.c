@@ -31,6 +31,9 @@
 
 #include "milter-manager.h"
 #include "milter-manager-leader.h"
+#include "milter-manager-statistics.h"
+#include "milter-manager-result-stream.h"
+#include "../core/milter-glib-compatible.h"
 
 #define MILTER_MANAGER_GET_PRIVATE(obj)                 \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                 \
@@ -41,7 +44,10 @@ typedef struct _MilterManagerPrivate MilterManagerPrivate;
 struct _MilterManagerPrivate
 {
     MilterManagerConfiguration *configuration;
+    MilterManagerConfiguration *session_configuration;
+    GMutex *session_configuration_mutex;
     GList *leaders;
+    GMutex *leaders_mutex;
     GList *next_connection_checked_leader;
     gboolean connection_checking;
 
@@ -52,6 +58,8 @@ struct _MilterManagerPrivate
     guint current_periodical_connection_check_interval;
 
     GList *finished_leaders;
+    GList *pooled_leaders;
+    guint n_pooled_leaders;
 
     gboolean is_custom_n_workers;
     gboolean is_custom_run_as_daemon;
@@ -215,7 +223,10 @@ milter_manager_init (MilterManager *manager)
     priv = MILTER_MANAGER_GET_PRIVATE(manager);
 
     priv->configuration = NULL;
+    priv->session_configuration = NULL;
+    priv->session_configuration_mutex = g_mutex_new();
     priv->leaders = NULL;
+    priv->leaders_mutex = g_mutex_new();
     priv->next_connection_checked_leader = NULL;
     priv->connection_checking = FALSE;
 
@@ -226,6 +237,8 @@ milter_manager_init (MilterManager *manager)
     priv->current_periodical_connection_check_interval = 0;
 
     priv->finished_leaders = NULL;
+    priv->pooled_leaders = NULL;
+    priv->n_pooled_leaders = 0;
 }
 
 static void
@@ -252,24 +265,86 @@ dispose_periodical_connection_checker (MilterManager *manager)
     priv->periodical_connection_checker_id = 0;
 }
 
+static gboolean
+pool_leader (MilterManagerPrivate *priv, MilterManagerLeader *leader)
+{
+    guint max_pooled_sessions;
+
+    if (!priv->configuration)
+        return FALSE;
+
+    max_pooled_sessions =
+        milter_manager_configuration_get_max_pooled_sessions(priv->configuration);
+    if (priv->n_pooled_leaders >= max_pooled_sessions)
+        return FALSE;
+
+    if (!milter_manager_leader_is_poolable(leader))
+        return FALSE;
+
+    milter_manager_leader_reset(leader);
+    priv->pooled_leaders = g_list_prepend(priv->pooled_leaders, leader);
+    priv->n_pooled_leaders++;
+
+    return TRUE;
+}
+
 static void
 dispose_finished_leaders (MilterManagerPrivate *priv)
 {
     GList *node;
     guint n_leaders = 0;
+    guint n_pooled_leaders = 0;
 
     if (!priv->finished_leaders)
         return;
 
     for (node = priv->finished_leaders; node; node = g_list_next(node)) {
         MilterManagerLeader *leader = node->data;
-        g_object_unref(leader);
-        n_leaders++;
+        if (pool_leader(priv, leader)) {
+            n_pooled_leaders++;
+        } else {
+            g_object_unref(leader);
+            n_leaders++;
+        }
     }
     g_list_free(priv->finished_leaders);
     priv->finished_leaders = NULL;
 
-    milter_debug("[manager][dispose][leaders] %u", n_leaders);
+    milter_debug("[manager][dispose][leaders] %u (pooled: %u)",
+                 n_leaders, n_pooled_leaders);
+}
+
+static void
+dispose_pooled_leaders (MilterManagerPrivate *priv)
+{
+    if (!priv->pooled_leaders)
+        return;
+
+    g_list_foreach(priv->pooled_leaders, (GFunc)g_object_unref, NULL);
+    g_list_free(priv->pooled_leaders);
+    priv->pooled_leaders = NULL;
+    priv->n_pooled_leaders = 0;
+}
+
+static MilterManagerLeader *
+create_leader (MilterManagerPrivate *priv,
+               MilterManagerConfiguration *configuration,
+               MilterClientContext *context,
+               gboolean multi_thread_mode)
+{
+    MilterManagerLeader *leader;
+
+    /* Pooled sessions are refused in multi thread mode. */
+    if (multi_thread_mode || !priv->pooled_leaders)
+        return milter_manager_leader_new(configuration, context);
+
+    leader = priv->pooled_leaders->data;
+    priv->pooled_leaders = g_list_delete_link(priv->pooled_leaders,
+                                              priv->pooled_leaders);
+    priv->n_pooled_leaders--;
+    milter_manager_leader_reuse(leader, configuration, context);
+
+    return leader;
 }
 
 static void
@@ -283,6 +358,7 @@ dispose (GObject *object)
 
     dispose_periodical_connection_checker(manager);
     dispose_finished_leaders(priv);
+    dispose_pooled_leaders(priv);
 
     if (priv->configuration) {
         configuration_set_manager(priv->configuration, NULL);
@@ -296,6 +372,21 @@ dispose (GObject *object)
     }
     priv->next_connection_checked_leader = NULL;
 
+    if (priv->leaders_mutex) {
+        g_mutex_free(priv->leaders_mutex);
+        priv->leaders_mutex = NULL;
+    }
+
+    if (priv->session_configuration) {
+        g_object_unref(priv->session_configuration);
+        priv->session_configuration = NULL;
+    }
+
+    if (priv->session_configuration_mutex) {
+        g_mutex_free(priv->session_configuration_mutex);
+        priv->session_configuration_mutex = NULL;
+    }
+
     milter_manager_set_launcher_channel(MILTER_MANAGER(object), NULL, NULL);
 
     G_OBJECT_CLASS(milter_manager_parent_class)->dispose(object);
@@ -634,11 +725,33 @@ cb_client_timeout (MilterClientContext *context, gpointer user_data)
     milter_manager_leader_timeout(leader);
 }
 
+static void
+cb_client_message_processed (MilterClientContext *context,
+                             MilterMessageResult *result,
+                             gpointer user_data)
+{
+    milter_manager_result_stream_emit_message(
+        milter_agent_get_tag(MILTER_AGENT(context)),
+        result);
+}
+
 static void
 cb_client_finished (MilterClientContext *context, gpointer user_data)
 {
     MilterManagerLeader *leader = user_data;
 
+    if (milter_manager_result_stream_is_open()) {
+        MilterAgent *agent;
+
+        agent = MILTER_AGENT(context);
+        milter_manager_result_stream_emit_session(
+            milter_agent_get_tag(agent),
+            milter_client_context_get_last_state(context),
+            milter_client_context_get_status(context),
+            milter_agent_get_elapsed(agent),
+            milter_manager_statistics_get_n_active_leaders());
+    }
+
     if (milter_need_log(MILTER_LOG_LEVEL_DEBUG |
                         MILTER_LOG_LEVEL_STATISTICS)) {
         MilterAgent *agent;
@@ -720,6 +833,7 @@ teardown_client_context_signals (MilterClientContext *context,
     DISCONNECT(abort);
     DISCONNECT(define_macro);
     DISCONNECT(timeout);
+    DISCONNECT(message_processed);
 
     DISCONNECT(finished);
 
@@ -729,6 +843,35 @@ teardown_client_context_signals (MilterClientContext *context,
                                          finished_data);
 }
 
+static gboolean
+cb_idle_dispose_leader (gpointer user_data)
+{
+    return FALSE;
+}
+
+/*
+ * In multi thread mode, a finished leader is released on
+ * the event loop of the thread that processed the session.
+ */
+static void
+multi_thread_leader_finished (MilterManagerPrivate *priv,
+                              MilterClientContext *client_context,
+                              MilterManagerLeader *leader)
+{
+    MilterEventLoop *loop;
+
+    g_mutex_lock(priv->leaders_mutex);
+    priv->leaders = g_list_remove(priv->leaders, leader);
+    g_mutex_unlock(priv->leaders_mutex);
+
+    loop = milter_agent_get_event_loop(MILTER_AGENT(client_context));
+    milter_event_loop_add_idle_full(loop,
+                                    G_PRIORITY_DEFAULT,
+                                    cb_idle_dispose_leader,
+                                    leader,
+                                    g_object_unref);
+}
+
 static void
 cb_leader_finished (MilterFinishedEmittable *emittable, gpointer user_data)
 {
@@ -743,6 +886,12 @@ cb_leader_finished (MilterFinishedEmittable *emittable, gpointer user_data)
     teardown_client_context_signals(client_context, leader, finish_data);
 
     priv = MILTER_MANAGER_GET_PRIVATE(finish_data->manager);
+    if (milter_client_is_multi_thread_mode(MILTER_CLIENT(finish_data->manager))) {
+        multi_thread_leader_finished(priv, client_context, leader);
+        g_free(finish_data);
+        return;
+    }
+
     if (!priv->connection_checking) {
         GList *node;
         node = g_list_find(priv->leaders, leader);
@@ -762,18 +911,39 @@ cb_leader_finished (MilterFinishedEmittable *emittable, gpointer user_data)
     g_free(finish_data);
 }
 
+static MilterManagerConfiguration *
+ref_session_configuration (MilterManagerPrivate *priv)
+{
+    MilterManagerConfiguration *configuration;
+
+    g_mutex_lock(priv->session_configuration_mutex);
+    configuration = g_object_ref(priv->session_configuration);
+    g_mutex_unlock(priv->session_configuration_mutex);
+
+    return configuration;
+}
+
 static void
 setup_context_signals (MilterClientContext *context,
                        MilterManager *manager)
 {
     MilterManagerLeader *leader;
     MilterManagerPrivate *priv;
+    MilterManagerConfiguration *configuration;
     LeaderFinishData *finish_data;
+    gboolean multi_thread_mode;
 
     priv = MILTER_MANAGER_GET_PRIVATE(manager);
-
-    leader = milter_manager_leader_new(priv->configuration, context);
+    multi_thread_mode = milter_client_is_multi_thread_mode(MILTER_CLIENT(manager));
+
+    if (multi_thread_mode)
+        configuration = ref_session_configuration(priv);
+    else
+        configuration = g_object_ref(priv->configuration);
+    leader = create_leader(priv, configuration, context, multi_thread_mode);
+    g_mutex_lock(priv->leaders_mutex);
     priv->leaders = g_list_prepend(priv->leaders, leader);
+    g_mutex_unlock(priv->leaders_mutex);
 
 #define CONNECT(name)                                   \
     g_signal_connect(context, #name,                    \
@@ -794,6 +964,7 @@ setup_context_signals (MilterClientContext *context,
     CONNECT(abort);
     CONNECT(define_macro);
     CONNECT(timeout);
+    CONNECT(message_processed);
 
     CONNECT(finished);
 
@@ -808,7 +979,14 @@ setup_context_signals (MilterClientContext *context,
                                                priv->launcher_read_channel,
                                                priv->launcher_write_channel);
 
-    g_signal_emit_by_name(priv->configuration, "connected", leader);
+    /* "connected" hooks may keep the leader. */
+    if (g_signal_has_handler_pending(configuration,
+                                     g_signal_lookup("connected",
+                                                     MILTER_TYPE_MANAGER_CONFIGURATION),
+                                     0, FALSE))
+        milter_manager_leader_set_poolable(leader, FALSE);
+    g_signal_emit_by_name(configuration, "connected", leader);
+    g_object_unref(configuration);
 }
 
 static void
@@ -822,7 +1000,9 @@ connection_established (MilterClient *client, MilterClientContext *context)
     milter_debug("[%u] [manager][session][start]",
                  milter_agent_get_tag(MILTER_AGENT(context)));
 
-    start_periodical_connection_checker(manager);
+    /* Connection checkers are refused in multi thread mode. */
+    if (!milter_client_is_multi_thread_mode(client))
+        start_periodical_connection_checker(manager);
 }
 
 static const gchar *
@@ -1405,6 +1585,7 @@ static void
 worker_created (MilterClient *client)
 {
     milter_debug("[manager][worker-created] pid=<%d>", getpid());
+    milter_manager_statistics_use_worker_slot(milter_client_get_worker_id(client));
 }
 
 MilterManagerConfiguration *
@@ -1419,6 +1600,25 @@ milter_manager_get_leaders (MilterManager *manager)
     return MILTER_MANAGER_GET_PRIVATE(manager)->leaders;
 }
 
+/*
+ * Leaders are added and removed by session threads in multi
+ * thread mode. The list returned by
+ * milter_manager_get_leaders() must be used between
+ * milter_manager_lock_leaders() and
+ * milter_manager_unlock_leaders() in the mode.
+ */
+void
+milter_manager_lock_leaders (MilterManager *manager)
+{
+    g_mutex_lock(MILTER_MANAGER_GET_PRIVATE(manager)->leaders_mutex);
+}
+
+void
+milter_manager_unlock_leaders (MilterManager *manager)
+{
+    g_mutex_unlock(MILTER_MANAGER_GET_PRIVATE(manager)->leaders_mutex);
+}
+
 static void
 apply_syslog_parameters (MilterManager *manager)
 {
@@ -1444,6 +1644,23 @@ apply_syslog_parameters (MilterManager *manager)
     }
 }
 
+static void
+apply_result_stream_parameters (MilterManager *manager)
+{
+    MilterManagerPrivate *priv;
+    const gchar *spec;
+    GError *error = NULL;
+
+    priv = MILTER_MANAGER_GET_PRIVATE(manager);
+    spec = milter_manager_configuration_get_result_stream_spec(
+        priv->configuration);
+    if (!milter_manager_result_stream_open(spec, &error)) {
+        milter_error("[manager][result-stream][open][error] %s",
+                     error->message);
+        g_error_free(error);
+    }
+}
+
 static void
 apply_custom_parameters (MilterManager *manager)
 {
@@ -1540,19 +1757,79 @@ apply_custom_parameters (MilterManager *manager)
     }
 }
 
+/*
+ * Session threads in multi thread mode use a snapshot of
+ * the configuration. A session keeps the snapshot that it
+ * started with, so reloading just replaces the snapshot
+ * for new sessions. The current snapshot is kept when the
+ * reloaded configuration can't be used by session threads.
+ */
+static gboolean
+update_session_configuration (MilterManagerPrivate *priv, GError **error)
+{
+    MilterManagerConfiguration *snapshot, *old_snapshot;
+
+    if (!milter_manager_configuration_check_multi_thread(priv->configuration,
+                                                         error))
+        return FALSE;
+
+    snapshot = milter_manager_configuration_snapshot(priv->configuration);
+    g_mutex_lock(priv->session_configuration_mutex);
+    old_snapshot = priv->session_configuration;
+    priv->session_configuration = snapshot;
+    g_mutex_unlock(priv->session_configuration_mutex);
+
+    if (old_snapshot)
+        g_object_unref(old_snapshot);
+
+    return TRUE;
+}
+
 gboolean
 milter_manager_reload (MilterManager *manager, GError **error)
 {
     MilterManagerPrivate *priv;
     gboolean success;
+    GError *local_error = NULL;
 
     priv = MILTER_MANAGER_GET_PRIVATE(manager);
     success = milter_manager_configuration_reload(priv->configuration, error);
     apply_syslog_parameters(manager);
     apply_custom_parameters(manager);
+    apply_result_stream_parameters(manager);
+    dispose_pooled_leaders(priv);
+
+    if (success && milter_client_is_multi_thread_mode(MILTER_CLIENT(manager))) {
+        success = update_session_configuration(priv, &local_error);
+        if (!success) {
+            milter_error("[manager][reload][multi-thread][error] %s",
+                         local_error->message);
+            g_propagate_error(error, local_error);
+        }
+    }
+
     return success;
 }
 
+gboolean
+milter_manager_set_multi_thread_mode (MilterManager *manager,
+                                      guint n_threads,
+                                      GError **error)
+{
+    MilterManagerPrivate *priv;
+    MilterClient *client;
+
+    priv = MILTER_MANAGER_GET_PRIVATE(manager);
+    if (!update_session_configuration(priv, error))
+        return FALSE;
+
+    client = MILTER_CLIENT(manager);
+    milter_client_set_multi_thread_mode(client, TRUE);
+    milter_client_set_n_threads(client, n_threads);
+
+    return TRUE;
+}
+
 void
 milter_manager_set_launcher_channel (MilterManager *manager,
                                      GIOChannel *read_channel,
@@ -55,9 +55,17 @@ MilterManager        *milter_manager_new         (MilterManagerConfiguration *co
 
 MilterManagerConfiguration *milter_manager_get_configuration (MilterManager *manager);
 const GList          *milter_manager_get_leaders (MilterManager *manager);
+void                  milter_manager_lock_leaders
+                                                 (MilterManager *manager);
+void                  milter_manager_unlock_leaders
+                                                 (MilterManager *manager);
 
 gboolean              milter_manager_reload      (MilterManager *manager,
                                                   GError       **error);
+gboolean              milter_manager_set_multi_thread_mode
+                                                 (MilterManager *manager,
+                                                  guint          n_threads,
+                                                  GError       **error);
 void                  milter_manager_set_launcher_channel
                                                  (MilterManager *manager,
                                                   GIOChannel *read_channel,
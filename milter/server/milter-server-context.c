@@ -92,12 +92,13 @@ struct _MilterServerContextPrivate
     MilterServerContextState last_state;
     gchar *reply_code;
     MilterOption *option;
+    MilterOption *negotiate_reply_option;
 
     gdouble connection_timeout;
     gdouble writing_timeout;
     gdouble reading_timeout;
     gdouble end_of_message_timeout;
-    guint timeout_id;
+    MilterEventLoopTimer timeout_timer;
     guint connect_watch_id;
 
     gboolean skip_body;
@@ -113,10 +114,18 @@ struct _MilterServerContextPrivate
     gboolean negotiated;
     gboolean processing_message;
     gboolean quitted;
+    gboolean quit_new_connection;
+    gboolean connection_reusable;
 
     gchar *current_recipient;
 
     MilterMessageResult *message_result;
+
+    MilterCommandPacket *command_packet;
+
+    /* Macros are encoded separately so that the encoded
+     * command packet isn't overwritten by them. */
+    MilterEncoder *macro_encoder;
 };
 
 enum
@@ -170,6 +179,13 @@ static gboolean write_packet         (MilterServerContext      *context,
                                       const gchar              *packet,
                                       gsize                     packet_size,
                                       MilterServerContextState  next_state);
+static gboolean write_scattered_packet
+                                     (MilterServerContext      *context,
+                                      const gchar              *packet,
+                                      gsize                     packet_size,
+                                      const gchar              *trailer,
+                                      gsize                     trailer_size,
+                                      MilterServerContextState  next_state);
 
 static MilterDecoder *decoder_new    (MilterAgent *agent);
 static MilterEncoder *encoder_new    (MilterAgent *agent);
@@ -288,6 +304,11 @@ milter_server_context_class_init (MilterServerContextClass *klass)
                      _milter_marshal_BOOLEAN__VOID,
                      G_TYPE_BOOLEAN, 0);
 
+    /*
+     * The chunk may be a slice of a larger body that isn't
+     * NUL-terminated. It is passed as is without copying and
+     * handlers must read only the given size.
+     */
     signals[STOP_ON_BODY] =
         g_signal_new("stop-on-body",
                      G_TYPE_FROM_CLASS(klass),
@@ -296,10 +317,14 @@ milter_server_context_class_init (MilterServerContextClass *klass)
                      stop_on_accumulator, NULL,
 #if GLIB_SIZEOF_SIZE_T == 8
                      _milter_marshal_BOOLEAN__STRING_UINT64,
-                     G_TYPE_BOOLEAN, 2, G_TYPE_STRING, G_TYPE_UINT64
+                     G_TYPE_BOOLEAN, 2,
+                     G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE,
+                     G_TYPE_UINT64
 #else
                      _milter_marshal_BOOLEAN__STRING_UINT,
-                     G_TYPE_BOOLEAN, 2, G_TYPE_STRING, G_TYPE_UINT
+                     G_TYPE_BOOLEAN, 2,
+                     G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE,
+                     G_TYPE_UINT
 #endif
             );
 
@@ -312,10 +337,14 @@ milter_server_context_class_init (MilterServerContextClass *klass)
                      stop_on_accumulator, NULL,
 #if GLIB_SIZEOF_SIZE_T == 8
                      _milter_marshal_BOOLEAN__STRING_UINT64,
-                     G_TYPE_BOOLEAN, 2, G_TYPE_STRING, G_TYPE_UINT64
+                     G_TYPE_BOOLEAN, 2,
+                     G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE,
+                     G_TYPE_UINT64
 #else
                      _milter_marshal_BOOLEAN__STRING_UINT,
-                     G_TYPE_BOOLEAN, 2, G_TYPE_STRING, G_TYPE_UINT
+                     G_TYPE_BOOLEAN, 2,
+                     G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE,
+                     G_TYPE_UINT
 #endif
             );
 
@@ -468,12 +497,13 @@ milter_server_context_init (MilterServerContext *context)
     priv->last_state = MILTER_SERVER_CONTEXT_STATE_START;
 
     priv->option = NULL;
+    priv->negotiate_reply_option = NULL;
     priv->name = NULL;
     priv->body_response_queue = NULL;
     priv->process_body_count = 0;
     priv->sent_end_of_message = FALSE;
 
-    priv->timeout_id = 0;
+    milter_event_loop_timer_init(&(priv->timeout_timer));
     priv->connection_timeout = MILTER_SERVER_CONTEXT_DEFAULT_CONNECTION_TIMEOUT;
     priv->writing_timeout = MILTER_SERVER_CONTEXT_DEFAULT_WRITING_TIMEOUT;
     priv->reading_timeout = MILTER_SERVER_CONTEXT_DEFAULT_READING_TIMEOUT;
@@ -490,10 +520,25 @@ milter_server_context_init (MilterServerContext *context)
     priv->negotiated = FALSE;
     priv->processing_message = FALSE;
     priv->quitted = FALSE;
+    priv->quit_new_connection = FALSE;
+    priv->connection_reusable = FALSE;
 
     priv->current_recipient = NULL;
 
     priv->message_result = NULL;
+
+    priv->command_packet = NULL;
+
+    priv->macro_encoder = NULL;
+}
+
+static void
+dispose_command_packet (MilterServerContextPrivate *priv)
+{
+    if (priv->command_packet) {
+        milter_command_packet_unref(priv->command_packet);
+        priv->command_packet = NULL;
+    }
 }
 
 static void
@@ -506,17 +551,15 @@ disable_timeout (MilterServerContext *context)
         const gchar *name;
 
         name = milter_server_context_get_name(context);
-        milter_debug("[%u] [server][timeout][disable] [%s] [%u] (%p)",
+        milter_debug("[%u] [server][timeout][disable] [%s] (%p)",
                      milter_agent_get_tag(MILTER_AGENT(context)),
                      NULL_SAFE_NAME(name),
-                     priv->timeout_id,
                      context);
     }
-    if (priv->timeout_id > 0) {
+    if (milter_event_loop_timer_is_armed(&(priv->timeout_timer))) {
         MilterEventLoop *loop;
         loop = milter_agent_get_event_loop(MILTER_AGENT(context));
-        milter_event_loop_remove(loop, priv->timeout_id);
-        priv->timeout_id = 0;
+        milter_event_loop_disarm_timer(loop, &(priv->timeout_timer));
     }
 }
 
@@ -615,6 +658,12 @@ dispose (GObject *object)
     disable_timeout(context);
     dispose_connect_watch(context);
     dispose_client_channel(priv);
+    dispose_command_packet(priv);
+
+    if (priv->macro_encoder) {
+        g_object_unref(priv->macro_encoder);
+        priv->macro_encoder = NULL;
+    }
 
     if (priv->spec) {
         g_free(priv->spec);
@@ -633,6 +682,11 @@ dispose (GObject *object)
         priv->option = NULL;
     }
 
+    if (priv->negotiate_reply_option) {
+        g_object_unref(priv->negotiate_reply_option);
+        priv->negotiate_reply_option = NULL;
+    }
+
     if (priv->body) {
         if (priv->body->len > 0) {
             milter_error("[%u] [server][dispose][body][remained] [%s] "
@@ -793,6 +847,7 @@ milter_server_context_set_state (MilterServerContext *context,
     MilterServerContextState previous_last_state;
 
     priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+    dispose_command_packet(priv);
     previous_state = priv->state;
     previous_last_state = priv->last_state;
     if (MILTER_SERVER_CONTEXT_STATE_NEGOTIATE <= state &&
@@ -894,10 +949,9 @@ cb_writing_timeout (gpointer data)
         priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
         if (priv)
             name = milter_server_context_get_name(context);
-        milter_debug("[%u] [server][timeout][writing] [%s] [%u] (%p)",
+        milter_debug("[%u] [server][timeout][writing] [%s] (%p)",
                      priv ? milter_agent_get_tag(agent) : 0,
                      NULL_SAFE_NAME(name),
-                     priv ? priv->timeout_id : 0,
                      context);
     }
     g_signal_emit(context, signals[WRITING_TIMEOUT], 0);
@@ -920,10 +974,9 @@ cb_end_of_message_timeout (gpointer data)
         priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
         if (priv)
             name = milter_server_context_get_name(context);
-        milter_debug("[%u] [server][timeout][end-of-message] [%s] [%u] (%p)",
+        milter_debug("[%u] [server][timeout][end-of-message] [%s] (%p)",
                      priv ? milter_agent_get_tag(agent) : 0,
                      NULL_SAFE_NAME(name),
-                     priv ? priv->timeout_id : 0,
                      context);
     }
     g_signal_emit(context, signals[END_OF_MESSAGE_TIMEOUT], 0);
@@ -946,10 +999,9 @@ cb_reading_timeout (gpointer data)
         priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
         if (priv)
             name = milter_server_context_get_name(context);
-        milter_debug("[%u] [server][timeout][reading] [%s] [%u] (%p)",
+        milter_debug("[%u] [server][timeout][reading] [%s] (%p)",
                      priv ? milter_agent_get_tag(agent) : 0,
                      NULL_SAFE_NAME(name),
-                     priv ? priv->timeout_id : 0,
                      context);
     }
     g_signal_emit(context, signals[READING_TIMEOUT], 0);
@@ -965,7 +1017,7 @@ milter_server_context_is_processing (MilterServerContext *context)
 
     priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
 
-    return priv->timeout_id != 0;
+    return milter_event_loop_timer_is_armed(&(priv->timeout_timer));
 }
 
 static GHashTable *
@@ -974,17 +1026,14 @@ filter_macros (GHashTable *macros, GList *request_symbols)
     GList *symbol;
     GHashTable *filtered_macros;
 
-    filtered_macros = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                            g_free, g_free);
+    /* Keys and values are borrowed from macros. */
+    filtered_macros = g_hash_table_new(g_str_hash, g_str_equal);
 
     for (symbol = request_symbols; symbol; symbol = g_list_next(symbol)) {
-        const gchar *value;
+        gpointer value;
         value = g_hash_table_lookup(macros, symbol->data);
-        if (value) {
-            g_hash_table_insert(filtered_macros,
-                                g_strdup(symbol->data),
-                                g_strdup(value));
-        }
+        if (value)
+            g_hash_table_insert(filtered_macros, symbol->data, value);
     }
 
     if (g_hash_table_size(filtered_macros) == 0) {
@@ -995,18 +1044,17 @@ filter_macros (GHashTable *macros, GList *request_symbols)
     return filtered_macros;
 }
 
-static void
-prepend_macro (MilterServerContext *context, GString *packed_packet,
-               MilterCommand command)
+static gboolean
+encode_macro (MilterServerContext *context, MilterCommand command,
+              const gchar **packet, gsize *packet_size)
 {
+    MilterServerContextPrivate *priv;
     GHashTable *macros, *filtered_macros = NULL, *target_macros;
     GList *request_symbols = NULL;
-    const gchar *packet = NULL;
-    gsize packet_size;
-    MilterEncoder *encoder;
     MilterAgent *agent;
     MilterProtocolAgent *protocol_agent;
     MilterMacrosRequests *macros_requests;
+    MilterMacroSnapshot *snapshot = NULL;
 
     agent = MILTER_AGENT(context);
     protocol_agent = MILTER_PROTOCOL_AGENT(context);
@@ -1016,7 +1064,7 @@ prepend_macro (MilterServerContext *context, GString *packed_packet,
     milter_protocol_agent_set_macro_context(protocol_agent,
                                             MILTER_COMMAND_UNKNOWN);
     if (!macros || g_hash_table_size(macros) == 0)
-        return;
+        return FALSE;
 
     target_macros = macros;
     macros_requests = milter_protocol_agent_get_macros_requests(protocol_agent);
@@ -1027,17 +1075,28 @@ prepend_macro (MilterServerContext *context, GString *packed_packet,
         if (request_symbols)
             filtered_macros = filter_macros(macros, request_symbols);
         if (!filtered_macros)
-            return;
+            return FALSE;
         target_macros = filtered_macros;
     }
 
-    encoder = milter_agent_get_encoder(agent);
-    milter_command_encoder_encode_define_macro(MILTER_COMMAND_ENCODER(encoder),
-                                               &packet, &packet_size,
-                                               command,
-                                               target_macros);
-    if (filtered_macros)
-        g_hash_table_unref(filtered_macros);
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+    if (!priv->macro_encoder)
+        priv->macro_encoder = milter_command_encoder_new();
+    milter_encoder_set_tag(priv->macro_encoder, milter_agent_get_tag(agent));
+    if (!filtered_macros)
+        snapshot = milter_protocol_agent_get_macro_snapshot(protocol_agent,
+                                                            command);
+    if (snapshot) {
+        milter_macro_snapshot_encode(snapshot,
+                                     MILTER_COMMAND_ENCODER(priv->macro_encoder),
+                                     packet, packet_size);
+    } else {
+        milter_command_encoder_encode_define_macro(
+            MILTER_COMMAND_ENCODER(priv->macro_encoder),
+            packet, packet_size,
+            command,
+            target_macros);
+    }
 
     if (milter_need_debug_log()) {
         gchar *command_name;
@@ -1055,8 +1114,10 @@ prepend_macro (MilterServerContext *context, GString *packed_packet,
         g_free(command_name);
         g_free(inspected_macros);
     }
+    if (filtered_macros)
+        g_hash_table_unref(filtered_macros);
 
-    g_string_prepend_len(packed_packet, packet, packet_size);
+    return TRUE;
 }
 
 static void
@@ -1162,21 +1223,20 @@ reset_end_of_message_timeout (MilterServerContext *context)
     priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
     agent = MILTER_AGENT(context);
     loop = milter_agent_get_event_loop(agent);
-    priv->timeout_id =
-        milter_event_loop_add_timeout(loop,
-                                      priv->end_of_message_timeout,
-                                      cb_end_of_message_timeout,
-                                      context);
+    milter_event_loop_arm_timer(loop,
+                                &(priv->timeout_timer),
+                                priv->end_of_message_timeout,
+                                cb_end_of_message_timeout,
+                                context);
     if (milter_need_debug_log()) {
         const gchar *name;
 
         name = milter_server_context_get_name(context);
         milter_debug("[%u] [server][timeout][end-of-message][registered][%g] "
-                     "[%s] <%u> (%p)",
+                     "[%s] (%p)",
                      milter_agent_get_tag(agent),
                      priv->end_of_message_timeout,
                      NULL_SAFE_NAME(name),
-                     priv->timeout_id,
                      context);
     }
 }
@@ -1237,12 +1297,13 @@ flush_body (MilterServerContext *context)
     command_encoder = MILTER_COMMAND_ENCODER(encoder);
     append_body_response_queue(context);
 
-    milter_command_encoder_encode_body(command_encoder,
-                                       &packet, &packet_size,
-                                       priv->body->str,
-                                       priv->body->len,
-                                       &packed_size);
-    if (!write_packet(context, packet, packet_size, state))
+    milter_command_encoder_encode_body_scattered(command_encoder,
+                                                 &packet, &packet_size,
+                                                 priv->body->str,
+                                                 priv->body->len,
+                                                 &packed_size);
+    if (!write_scattered_packet(context, packet, packet_size,
+                                priv->body->str, packed_size, state))
         return FALSE;
 
     g_string_erase(priv->body, 0, packed_size);
@@ -1283,17 +1344,16 @@ process_next_state_body (MilterServerContext *context)
 
     disable_timeout(context);
     loop = milter_agent_get_event_loop(MILTER_AGENT(context));
-    priv->timeout_id =
-        milter_event_loop_add_timeout(loop,
-                                      priv->reading_timeout,
-                                      cb_reading_timeout,
-                                      context);
+    milter_event_loop_arm_timer(loop,
+                                &(priv->timeout_timer),
+                                priv->reading_timeout,
+                                cb_reading_timeout,
+                                context);
     milter_debug("[%u] [server][timeout][reading][registered][%g] "
-                 "[%s] <%u> (%p)",
+                 "[%s] (%p)",
                  tag,
                  priv->reading_timeout,
                  NULL_SAFE_NAME(name),
-                 priv->timeout_id,
                  context);
 
     return TRUE;
@@ -1368,6 +1428,8 @@ process_next_state (MilterServerContext *context,
         break;
     case MILTER_SERVER_CONTEXT_STATE_QUIT:
         milter_agent_shutdown(agent);
+        if (priv->quit_new_connection)
+            priv->connection_reusable = milter_agent_is_finished(agent);
         milter_server_context_set_state(context, next_state);
         break;
     case MILTER_SERVER_CONTEXT_STATE_ABORT:
@@ -1394,17 +1456,16 @@ process_next_state (MilterServerContext *context,
             MilterEventLoop *loop;
 
             loop = milter_agent_get_event_loop(agent);
-            priv->timeout_id =
-                milter_event_loop_add_timeout(loop,
-                                              priv->reading_timeout,
-                                              cb_reading_timeout,
-                                              context);
+            milter_event_loop_arm_timer(loop,
+                                        &(priv->timeout_timer),
+                                        priv->reading_timeout,
+                                        cb_reading_timeout,
+                                        context);
             milter_debug("[%u] [server][timeout][reading][registered][%g] "
-                         "[%s] <%u> (%p)",
+                         "[%s] (%p)",
                          tag,
                          priv->reading_timeout,
                          NULL_SAFE_NAME(name),
-                         priv->timeout_id,
                          context);
         } else {
             g_timer_stop(priv->elapsed);
@@ -1476,13 +1537,18 @@ flushed (MilterAgent *agent)
 }
 
 static gboolean
-write_packet (MilterServerContext *context,
-              const gchar *packet, gsize packet_size,
-              MilterServerContextState next_state)
+write_scattered_packet (MilterServerContext *context,
+                        const gchar *packet, gsize packet_size,
+                        const gchar *trailer, gsize trailer_size,
+                        MilterServerContextState next_state)
 {
     GError *agent_error = NULL;
+    struct iovec vectors[3];
+    guint n_vectors = 0;
     MilterServerContextPrivate *priv;
-    GString *packed_packet;
+    MilterCommand macro_command = MILTER_COMMAND_UNKNOWN;
+    const gchar *macro_packet = NULL;
+    gsize macro_packet_size = 0;
     guint tag;
     MilterEventLoop *loop;
     const gchar *name;
@@ -1536,66 +1602,86 @@ write_packet (MilterServerContext *context,
             g_timer_continue(priv->elapsed);
         }
         disable_timeout(context);
-        priv->timeout_id = milter_event_loop_add_timeout(loop,
-                                                         priv->writing_timeout,
-                                                         cb_writing_timeout,
-                                                         context);
+        milter_event_loop_arm_timer(loop,
+                                    &(priv->timeout_timer),
+                                    priv->writing_timeout,
+                                    cb_writing_timeout,
+                                    context);
         if (milter_need_debug_log()) {
             const gchar *name;
 
             name = milter_server_context_get_name(context);
             milter_debug("[%u] [server][timeout][writing][registered][%g] "
-                         "[%s] <%u> (%p)",
+                         "[%s] (%p)",
                          tag,
                          priv->writing_timeout,
                          NULL_SAFE_NAME(name),
-                         priv->timeout_id,
                          context);
         }
         break;
     }
 
-    packed_packet = g_string_new_len(packet, packet_size);
     switch (next_state) {
     case MILTER_SERVER_CONTEXT_STATE_HELO:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_HELO);
+        macro_command = MILTER_COMMAND_HELO;
         break;
     case MILTER_SERVER_CONTEXT_STATE_CONNECT:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_CONNECT);
+        macro_command = MILTER_COMMAND_CONNECT;
         break;
     case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_ENVELOPE_FROM);
+        macro_command = MILTER_COMMAND_ENVELOPE_FROM;
         break;
     case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_ENVELOPE_RECIPIENT);
+        macro_command = MILTER_COMMAND_ENVELOPE_RECIPIENT;
         break;
     case MILTER_SERVER_CONTEXT_STATE_DATA:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_DATA);
+        macro_command = MILTER_COMMAND_DATA;
         break;
     case MILTER_SERVER_CONTEXT_STATE_HEADER:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_HEADER);
+        macro_command = MILTER_COMMAND_HEADER;
         break;
     case MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_END_OF_HEADER);
+        macro_command = MILTER_COMMAND_END_OF_HEADER;
         break;
     case MILTER_SERVER_CONTEXT_STATE_BODY:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_BODY);
+        macro_command = MILTER_COMMAND_BODY;
         break;
     case MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_END_OF_MESSAGE);
+        macro_command = MILTER_COMMAND_END_OF_MESSAGE;
         break;
     default:
         break;
     }
 
-    milter_agent_write_packet(MILTER_AGENT(context),
-                              packed_packet->str, packed_packet->len,
-                              &agent_error);
-    g_string_free(packed_packet, TRUE);
+    /* The packet may be shared with other children. Only the
+     * macros are encoded for this child and they are written
+     * before the packet without copying it. */
+    if (macro_command != MILTER_COMMAND_UNKNOWN &&
+        encode_macro(context, macro_command,
+                     &macro_packet, &macro_packet_size)) {
+        vectors[n_vectors].iov_base = (gchar *)macro_packet;
+        vectors[n_vectors].iov_len = macro_packet_size;
+        n_vectors++;
+    }
+    vectors[n_vectors].iov_base = (gchar *)packet;
+    vectors[n_vectors].iov_len = packet_size;
+    n_vectors++;
+    if (trailer_size > 0) {
+        vectors[n_vectors].iov_base = (gchar *)trailer;
+        vectors[n_vectors].iov_len = trailer_size;
+        n_vectors++;
+    }
+    priv->next_states = g_list_append(priv->next_states,
+                                      GUINT_TO_POINTER(next_state));
+    milter_agent_write_packet_vectors(MILTER_AGENT(context),
+                                      vectors, n_vectors,
+                                      &agent_error);
 
     if (agent_error) {
         GError *error = NULL;
 
+        priv->next_states = g_list_delete_link(priv->next_states,
+                                               g_list_last(priv->next_states));
         disable_timeout(context);
         milter_utils_set_error_with_sub_error(
             &error,
@@ -1617,11 +1703,65 @@ write_packet (MilterServerContext *context,
         return FALSE;
     }
 
-    priv->next_states = g_list_append(priv->next_states,
-                                      GUINT_TO_POINTER(next_state));
     return TRUE;
 }
 
+static gboolean
+write_packet (MilterServerContext *context,
+              const gchar *packet, gsize packet_size,
+              MilterServerContextState next_state)
+{
+    return write_scattered_packet(context, packet, packet_size, NULL, 0,
+                                  next_state);
+}
+
+void
+milter_server_context_set_command_packet (MilterServerContext *context,
+                                          MilterCommandPacket *packet)
+{
+    MilterServerContextPrivate *priv;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+    if (packet)
+        milter_command_packet_ref(packet);
+    dispose_command_packet(priv);
+    priv->command_packet = packet;
+}
+
+static MilterCommandPacket *
+take_command_packet (MilterServerContext *context, MilterCommand command)
+{
+    MilterServerContextPrivate *priv;
+    MilterCommandPacket *command_packet;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+    command_packet = priv->command_packet;
+    priv->command_packet = NULL;
+    if (command_packet &&
+        milter_command_packet_get_command(command_packet) != command) {
+        milter_command_packet_unref(command_packet);
+        command_packet = NULL;
+    }
+
+    return command_packet;
+}
+
+static gboolean
+write_command_packet (MilterServerContext *context,
+                      MilterCommandPacket *command_packet,
+                      MilterServerContextState next_state)
+{
+    gboolean success;
+
+    success = write_packet(context,
+                           milter_command_packet_get_data(command_packet),
+                           milter_command_packet_get_size(command_packet),
+                           next_state);
+    milter_command_packet_unref(command_packet);
+
+    return success;
+}
+
 static void
 stop_on_state (MilterServerContext *context, MilterServerContextState state)
 {
@@ -1699,6 +1839,7 @@ milter_server_context_helo (MilterServerContext *context,
     const gchar *packet = NULL;
     gsize packet_size;
     MilterEncoder *encoder;
+    MilterCommandPacket *command_packet;
     gboolean stop = FALSE;
     guint tag = 0;
     const gchar *name = NULL;
@@ -1724,6 +1865,11 @@ milter_server_context_helo (MilterServerContext *context,
         return TRUE;
     }
 
+    command_packet = take_command_packet(context, MILTER_COMMAND_HELO);
+    if (command_packet)
+        return write_command_packet(context, command_packet,
+                                    MILTER_SERVER_CONTEXT_STATE_HELO);
+
     encoder = milter_agent_get_encoder(MILTER_AGENT(context));
     milter_command_encoder_encode_helo(MILTER_COMMAND_ENCODER(encoder),
                                        &packet, &packet_size, fqdn);
@@ -1775,6 +1921,7 @@ milter_server_context_connect (MilterServerContext *context,
     const gchar *packet = NULL;
     gsize packet_size;
     MilterEncoder *encoder;
+    MilterCommandPacket *command_packet;
     gboolean stop = FALSE;
     guint tag = 0;
     const gchar *name = NULL;
@@ -1807,6 +1954,11 @@ milter_server_context_connect (MilterServerContext *context,
         return TRUE;
     }
 
+    command_packet = take_command_packet(context, MILTER_COMMAND_CONNECT);
+    if (command_packet)
+        return write_command_packet(context, command_packet,
+                                    MILTER_SERVER_CONTEXT_STATE_CONNECT);
+
     encoder = milter_agent_get_encoder(MILTER_AGENT(context));
     milter_command_encoder_encode_connect(MILTER_COMMAND_ENCODER(encoder),
                                           &packet, &packet_size,
@@ -1849,6 +2001,7 @@ milter_server_context_envelope_from (MilterServerContext *context,
     const gchar *packet = NULL;
     gsize packet_size;
     MilterEncoder *encoder;
+    MilterCommandPacket *command_packet;
     gboolean stop = FALSE;
     guint tag = 0;
     const gchar *name = NULL;
@@ -1905,6 +2058,12 @@ milter_server_context_envelope_from (MilterServerContext *context,
         return TRUE;
     }
 
+    command_packet = take_command_packet(context,
+                                         MILTER_COMMAND_ENVELOPE_FROM);
+    if (command_packet)
+        return write_command_packet(
+            context, command_packet, MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM);
+
     encoder = milter_agent_get_encoder(MILTER_AGENT(context));
     milter_command_encoder_encode_envelope_from(MILTER_COMMAND_ENCODER(encoder),
                                                 &packet, &packet_size, from);
@@ -1921,6 +2080,7 @@ milter_server_context_envelope_recipient (MilterServerContext *context,
     const gchar *packet = NULL;
     gsize packet_size;
     MilterEncoder *encoder;
+    MilterCommandPacket *command_packet;
     MilterCommandEncoder *command_encoder;
     gboolean stop = FALSE;
     guint tag = 0;
@@ -1967,6 +2127,13 @@ milter_server_context_envelope_recipient (MilterServerContext *context,
         return TRUE;
     }
 
+    command_packet = take_command_packet(context,
+                                         MILTER_COMMAND_ENVELOPE_RECIPIENT);
+    if (command_packet)
+        return write_command_packet(
+            context, command_packet,
+            MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT);
+
     encoder = milter_agent_get_encoder(MILTER_AGENT(context));
     command_encoder = MILTER_COMMAND_ENCODER(encoder);
     milter_command_encoder_encode_envelope_recipient(command_encoder,
@@ -2035,6 +2202,7 @@ milter_server_context_unknown (MilterServerContext *context,
     const gchar *packet = NULL;
     gsize packet_size;
     MilterEncoder *encoder;
+    MilterCommandPacket *command_packet;
     guint tag = 0;
     const gchar *name = NULL;
 
@@ -2055,6 +2223,11 @@ milter_server_context_unknown (MilterServerContext *context,
         return TRUE;
     }
 
+    command_packet = take_command_packet(context, MILTER_COMMAND_UNKNOWN);
+    if (command_packet)
+        return write_command_packet(context, command_packet,
+                                    MILTER_SERVER_CONTEXT_STATE_UNKNOWN);
+
     encoder = milter_agent_get_encoder(MILTER_AGENT(context));
     milter_command_encoder_encode_unknown(MILTER_COMMAND_ENCODER(encoder),
                                           &packet, &packet_size, command);
@@ -2072,6 +2245,7 @@ milter_server_context_header (MilterServerContext *context,
     const gchar *packet = NULL;
     gsize packet_size;
     MilterEncoder *encoder;
+    MilterCommandPacket *command_packet;
     gboolean stop = FALSE;
     guint tag;
     const gchar *name;
@@ -2111,6 +2285,11 @@ milter_server_context_header (MilterServerContext *context,
         return TRUE;
     }
 
+    command_packet = take_command_packet(context, MILTER_COMMAND_HEADER);
+    if (command_packet)
+        return write_command_packet(context, command_packet,
+                                    MILTER_SERVER_CONTEXT_STATE_HEADER);
+
     encoder = milter_agent_get_encoder(MILTER_AGENT(context));
     milter_command_encoder_encode_header(MILTER_COMMAND_ENCODER(encoder),
                                          &packet, &packet_size,
@@ -2294,6 +2473,29 @@ milter_server_context_quit (MilterServerContext *context)
                         MILTER_SERVER_CONTEXT_STATE_QUIT);
 }
 
+gboolean
+milter_server_context_quit_new_connection (MilterServerContext *context)
+{
+    MilterServerContextPrivate *priv;
+    const gchar *packet = NULL;
+    gsize packet_size;
+    MilterEncoder *encoder;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+    priv->quitted = TRUE;
+    priv->quit_new_connection = TRUE;
+
+    milter_debug("[%u] [server][send][quit-new-connection] [%s]",
+                 milter_agent_get_tag(MILTER_AGENT(context)),
+                 milter_server_context_get_name(context));
+    encoder = milter_agent_get_encoder(MILTER_AGENT(context));
+    milter_command_encoder_encode_quit_new_connection(
+        MILTER_COMMAND_ENCODER(encoder), &packet, &packet_size);
+
+    return write_packet(context, packet, packet_size,
+                        MILTER_SERVER_CONTEXT_STATE_QUIT);
+}
+
 
 gboolean
 milter_server_context_abort (MilterServerContext *context)
@@ -2445,6 +2647,9 @@ cb_decoder_negotiate_reply (MilterDecoder *decoder,
             MilterProtocolAgent *agent;
             agent = MILTER_PROTOCOL_AGENT(context);
             priv->negotiated = TRUE;
+            if (priv->negotiate_reply_option)
+                g_object_unref(priv->negotiate_reply_option);
+            priv->negotiate_reply_option = milter_option_copy(option);
             milter_protocol_agent_set_macros_requests(agent, macros_requests);
             g_signal_emit_by_name(context, "negotiate-reply",
                                   option, macros_requests);
@@ -3352,10 +3557,9 @@ cb_connection_timeout (gpointer data)
     if (priv)
         name = milter_server_context_get_name(context);
     agent = MILTER_AGENT(context);
-    milter_debug("[%u] [server][timeout][connection] [%s] [%u] (%p)",
+    milter_debug("[%u] [server][timeout][connection] [%s] (%p)",
                  priv ? milter_agent_get_tag(agent) : 0,
                  NULL_SAFE_NAME(name),
-                 priv ? priv->timeout_id : 0,
                  context);
     milter_error("[%u] [server][timeout][connection] [%s]",
                  priv ? milter_agent_get_tag(agent) : 0,
@@ -3373,7 +3577,7 @@ prepare_reader (MilterServerContext *context)
 
     priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
 
-    reader = milter_reader_io_channel_new(priv->client_channel);
+    reader = milter_reader_socket_io_channel_new(priv->client_channel);
     milter_agent_set_reader(MILTER_AGENT(context), reader);
     g_object_unref(reader);
 
@@ -3389,6 +3593,7 @@ prepare_writer (MilterServerContext *context)
     priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
 
     writer = milter_writer_io_channel_new(priv->client_channel);
+    milter_writer_set_use_writev(writer, TRUE);
     milter_agent_set_writer(MILTER_AGENT(context), writer);
     g_object_unref(writer);
 
@@ -3523,21 +3728,21 @@ milter_server_context_establish_connection (MilterServerContext *context,
                                    connect_watch_func, context);
 
     disable_timeout(context);
-    priv->timeout_id = milter_event_loop_add_timeout(loop,
-                                                     priv->connection_timeout,
-                                                     cb_connection_timeout,
-                                                     context);
+    milter_event_loop_arm_timer(loop,
+                                &(priv->timeout_timer),
+                                priv->connection_timeout,
+                                cb_connection_timeout,
+                                context);
     if (milter_need_debug_log()) {
         const gchar *name = NULL;
 
         if (priv)
             name = milter_server_context_get_name(context);
         milter_debug("[%u] [server][timeout][connection][registered][%g] "
-                     "[%s] <%u> (%p)",
+                     "[%s] (%p)",
                      milter_agent_get_tag(agent),
                      priv->connection_timeout,
                      NULL_SAFE_NAME(name),
-                     priv->timeout_id,
                      context);
     }
 
@@ -3572,6 +3777,89 @@ milter_server_context_establish_connection (MilterServerContext *context,
     return TRUE;
 }
 
+GIOChannel *
+milter_server_context_steal_connection (MilterServerContext *context)
+{
+    MilterServerContextPrivate *priv;
+    GIOChannel *channel;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+    if (!priv->connection_reusable)
+        return NULL;
+
+    milter_debug("[%u] [server][connection][steal] [%s]",
+                 milter_agent_get_tag(MILTER_AGENT(context)),
+                 milter_server_context_get_name(context));
+
+    channel = priv->client_channel;
+    priv->client_channel = NULL;
+    priv->connection_reusable = FALSE;
+
+    return channel;
+}
+
+gboolean
+milter_server_context_reuse_connection (MilterServerContext *context,
+                                        GIOChannel *channel,
+                                        MilterOption *option,
+                                        MilterOption *reply_option,
+                                        MilterMacrosRequests *macros_requests,
+                                        GError **error)
+{
+    MilterServerContextPrivate *priv;
+    MilterAgent *agent;
+    GError *agent_error = NULL;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+    agent = MILTER_AGENT(context);
+
+    if (priv->client_channel) {
+        g_set_error(error,
+                    MILTER_SERVER_CONTEXT_ERROR,
+                    MILTER_SERVER_CONTEXT_ERROR_BUSY,
+                    "Already connected: %s", priv->spec);
+        return FALSE;
+    }
+
+    priv->client_channel = g_io_channel_ref(channel);
+    prepare_reader(context);
+    prepare_writer(context);
+    if (!milter_agent_start(agent, &agent_error)) {
+        dispose_client_channel(priv);
+        milter_utils_set_error_with_sub_error(
+            error,
+            MILTER_SERVER_CONTEXT_ERROR,
+            MILTER_SERVER_CONTEXT_ERROR_CONNECTION_FAILURE,
+            agent_error,
+            "Failed to start reused connection to %s", priv->spec);
+        return FALSE;
+    }
+
+    milter_debug("[%u] [server][connection][reuse] [%s] %d",
+                 milter_agent_get_tag(agent),
+                 milter_server_context_get_name(context),
+                 g_io_channel_unix_get_fd(channel));
+
+    g_timer_start(priv->elapsed);
+    if (priv->option)
+        g_object_unref(priv->option);
+    priv->option = milter_option_copy(option);
+    milter_option_combine(priv->option, reply_option);
+    if (priv->negotiate_reply_option)
+        g_object_unref(priv->negotiate_reply_option);
+    priv->negotiate_reply_option = milter_option_copy(reply_option);
+
+    milter_server_context_set_state(context,
+                                    MILTER_SERVER_CONTEXT_STATE_NEGOTIATE);
+    priv->negotiated = TRUE;
+    milter_protocol_agent_set_macros_requests(MILTER_PROTOCOL_AGENT(context),
+                                              macros_requests);
+    g_signal_emit_by_name(context, "negotiate-reply",
+                          reply_option, macros_requests);
+
+    return TRUE;
+}
+
 void
 milter_server_context_set_connection_timeout (MilterServerContext *context,
                                               gdouble timeout)
@@ -3650,6 +3938,12 @@ milter_server_context_is_negotiated (MilterServerContext *context)
     return MILTER_SERVER_CONTEXT_GET_PRIVATE(context)->negotiated;
 }
 
+MilterOption *
+milter_server_context_get_negotiate_reply_option (MilterServerContext *context)
+{
+    return MILTER_SERVER_CONTEXT_GET_PRIVATE(context)->negotiate_reply_option;
+}
+
 gboolean
 milter_server_context_is_processing_message (MilterServerContext *context)
 {
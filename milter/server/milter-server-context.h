@@ -313,6 +313,51 @@ gboolean             milter_server_context_establish_connection
                                                        (MilterServerContext *context,
                                                         GError **error);
 
+/**
+ * milter_server_context_steal_connection:
+ * @context: a %MilterServerContext.
+ *
+ * Takes the connection out of @context after
+ * milter_server_context_quit_new_connection() is flushed
+ * and @context is finished. The connection is still
+ * negotiated with the option sent by
+ * milter_server_context_negotiate().
+ *
+ * Returns: the connection to client or %NULL if @context
+ * doesn't have a reusable connection. It should be
+ * released with g_io_channel_unref().
+ */
+GIOChannel          *milter_server_context_steal_connection
+                                                       (MilterServerContext *context);
+
+/**
+ * milter_server_context_reuse_connection:
+ * @context: a %MilterServerContext.
+ * @channel: a connection taken by
+ *           milter_server_context_steal_connection().
+ * @option: the option used for the negotiation on @channel.
+ * @reply_option: the option replied for the negotiation on
+ *                @channel.
+ * @macros_requests: the macros requests replied for the
+ *                   negotiation on @channel.
+ * @error: return location for an error, or %NULL.
+ *
+ * Uses @channel as the connection to client instead of
+ * establishing a new connection. @context becomes
+ * negotiated state without sending negotiate command and
+ * #MilterReplySignals::negotiate-reply signal is emitted
+ * with @reply_option and @macros_requests.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean             milter_server_context_reuse_connection
+                                                       (MilterServerContext *context,
+                                                        GIOChannel *channel,
+                                                        MilterOption *option,
+                                                        MilterOption *reply_option,
+                                                        MilterMacrosRequests *macros_requests,
+                                                        GError **error);
+
 
 /**
  * milter_server_context_get_status:
@@ -379,6 +424,22 @@ MilterServerContextState milter_server_context_get_last_state (MilterServerConte
 gboolean             milter_server_context_is_processing
                                                        (MilterServerContext *context);
 
+/**
+ * milter_server_context_set_command_packet:
+ * @context: a %MilterServerContext.
+ * @packet: the pre-encoded command packet.
+ *
+ * Sets the packet that is written for the next command
+ * instead of encoding it again. It is used only when the
+ * next command is the same command as @packet and is
+ * dropped when the next command is sent, skipped or
+ * stopped. It is used to share a packet encoded once
+ * between all children.
+ */
+void                 milter_server_context_set_command_packet
+                                                       (MilterServerContext *context,
+                                                        MilterCommandPacket *packet);
+
 /**
  * milter_server_context_negotiate:
  * @context: a %MilterServerContext.
@@ -532,6 +593,20 @@ gboolean             milter_server_context_end_of_message
  */
 gboolean             milter_server_context_quit        (MilterServerContext *context);
 
+/**
+ * milter_server_context_quit_new_connection:
+ * @context: a %MilterServerContext.
+ *
+ * Quits the current session but keeps the connection for
+ * a new session. The connection can be taken by
+ * milter_server_context_steal_connection(). It requires
+ * milter protocol version 6 or later.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean             milter_server_context_quit_new_connection
+                                                       (MilterServerContext *context);
+
 /**
  * milter_server_context_abort:
  * @context: a %MilterServerContext.
@@ -628,6 +703,18 @@ gdouble              milter_server_context_get_elapsed (MilterServerContext *con
 gboolean             milter_server_context_is_negotiated
                                                        (MilterServerContext *context);
 
+/**
+ * milter_server_context_get_negotiate_reply_option:
+ * @context: a %MilterServerContext.
+ *
+ * Gets the option replied by client for the negotiation.
+ *
+ * Returns: the replied option or %NULL if @context isn't
+ * negotiated yet.
+ */
+MilterOption        *milter_server_context_get_negotiate_reply_option
+                                                       (MilterServerContext *context);
+
 /**
  * milter_server_context_is_processing_message:
  * @context: a %MilterServerContext.
@@ -70,11 +70,22 @@ void test_custom_fork (void);
 void test_default_packet_buffer_size (void);
 void test_worker_id (void);
 void test_max_pending_finished_sessions (void);
+void test_multi_thread_mode (void);
+void test_n_threads (void);
+void test_multi_thread_sessions (void);
+void test_multi_thread_shutdown_with_sessions (void);
+void test_worker_sharding (void);
+void test_n_accepted_connections (void);
+void test_max_connections_suspend (void);
+void test_max_accepts_per_wakeup (void);
+void test_accept_queued_connections (void);
+void test_accept_queued_connections_one_per_wakeup (void);
 
 static MilterEventLoop *loop;
 
 static MilterClient *client;
 static MilterTestServer *server;
+static MilterTestServer *over_server;
 
 static MilterDecoder *decoder;
 static MilterCommandEncoder *encoder;
@@ -138,6 +149,21 @@ static guint loop_run_count;
 static guint n_worker_fork_called;
 static guint64 n_workers;
 
+#define N_EXTRA_SERVERS 3
+static MilterTestServer *extra_servers[N_EXTRA_SERVERS];
+static MilterDecoder *extra_decoders[N_EXTRA_SERVERS];
+static volatile gint n_multi_thread_helos;
+static volatile gint n_multi_thread_finished_emissions;
+static gboolean multi_thread_shutdown_first;
+static gboolean multi_thread_started;
+static gboolean multi_thread_closed;
+static gboolean multi_thread_shutdown;
+static guint multi_thread_timeout_id;
+
+static guint observe_accepts_id;
+static guint n_observed_accepted_connections;
+static guint n_accept_wakeups;
+
 static void
 cb_negotiate (MilterClientContext *context, MilterOption *option,
               MilterMacrosRequests *macros_requests, gpointer user_data)
@@ -345,6 +371,7 @@ cut_setup (void)
     milter_event_loop_set_custom_run_func(loop, loop_run);
     setup_client_signals();
     server = NULL;
+    over_server = NULL;
 
     decoder = milter_reply_decoder_new();
     encoder = MILTER_COMMAND_ENCODER(milter_command_encoder_new());
@@ -402,6 +429,37 @@ cut_setup (void)
     tmp_dir = milter_test_get_tmp_dir();
 
     n_worker_fork_called = 0;
+
+    memset(extra_servers, 0, sizeof(extra_servers));
+    memset(extra_decoders, 0, sizeof(extra_decoders));
+    n_multi_thread_helos = 0;
+    n_multi_thread_finished_emissions = 0;
+    multi_thread_shutdown_first = FALSE;
+    multi_thread_started = FALSE;
+    multi_thread_closed = FALSE;
+    multi_thread_shutdown = FALSE;
+    multi_thread_timeout_id = 0;
+
+    observe_accepts_id = 0;
+    n_observed_accepted_connections = 0;
+    n_accept_wakeups = 0;
+}
+
+static void
+close_extra_servers (void)
+{
+    guint i;
+
+    for (i = 0; i < N_EXTRA_SERVERS; i++) {
+        if (extra_servers[i]) {
+            g_object_unref(extra_servers[i]);
+            extra_servers[i] = NULL;
+        }
+        if (extra_decoders[i]) {
+            g_object_unref(extra_decoders[i]);
+            extra_decoders[i] = NULL;
+        }
+    }
 }
 
 void
@@ -411,9 +469,17 @@ cut_teardown (void)
         milter_event_loop_remove(loop, idle_id);
     if (idle_shutdown_id > 0)
         milter_event_loop_remove(loop, idle_shutdown_id);
+    if (multi_thread_timeout_id > 0)
+        milter_event_loop_remove(loop, multi_thread_timeout_id);
+    if (observe_accepts_id > 0)
+        milter_event_loop_remove(loop, observe_accepts_id);
+
+    close_extra_servers();
 
     if (server)
         g_object_unref(server);
+    if (over_server)
+        g_object_unref(over_server);
     if (client)
         g_object_unref(client);
 
@@ -1099,6 +1165,308 @@ test_max_pending_finished_sessions (void)
         29, milter_client_get_max_pending_finished_sessions(client));
 }
 
+void
+test_multi_thread_mode (void)
+{
+    cut_assert_false(milter_client_is_multi_thread_mode(client));
+    milter_client_set_multi_thread_mode(client, TRUE);
+    cut_assert_true(milter_client_is_multi_thread_mode(client));
+}
+
+void
+test_n_threads (void)
+{
+    cut_assert_equal_uint(0, milter_client_get_n_threads(client));
+    milter_client_set_n_threads(client, 4);
+    cut_assert_equal_uint(4, milter_client_get_n_threads(client));
+}
+
+static void
+cb_multi_thread_helo (MilterClientContext *context, const gchar *fqdn,
+                      gpointer user_data)
+{
+    g_atomic_int_inc(&n_multi_thread_helos);
+}
+
+static void
+cb_multi_thread_finished (MilterFinishedEmittable *emittable,
+                          gpointer user_data)
+{
+    g_atomic_int_inc(&n_multi_thread_finished_emissions);
+}
+
+static void
+cb_multi_thread_connection_established (MilterClient *client,
+                                        MilterClientContext *context,
+                                        gpointer user_data)
+{
+    g_signal_connect(context, "helo",
+                     G_CALLBACK(cb_multi_thread_helo), NULL);
+    g_signal_connect(context, "finished",
+                     G_CALLBACK(cb_multi_thread_finished), NULL);
+}
+
+static void
+open_extra_servers (gboolean send_helo)
+{
+    guint i;
+
+    for (i = 0; i < N_EXTRA_SERVERS; i++) {
+        extra_decoders[i] = milter_reply_decoder_new();
+        cut_trace(extra_servers[i] =
+                  milter_test_server_new(spec, extra_decoders[i], loop));
+        if (send_helo) {
+            const gchar *packet;
+            gsize packet_size;
+
+            milter_command_encoder_encode_helo(encoder,
+                                               &packet, &packet_size, fqdn);
+            milter_test_server_write(extra_servers[i], packet, packet_size);
+        }
+    }
+}
+
+static gboolean
+cb_idle_multi_thread_helo (gpointer user_data)
+{
+    cut_trace(open_extra_servers(TRUE));
+    multi_thread_started = TRUE;
+
+    return FALSE;
+}
+
+static gboolean
+cb_timeout_multi_thread_step (gpointer user_data)
+{
+    if (!multi_thread_started)
+        return TRUE;
+
+    if (g_atomic_int_get(&n_multi_thread_helos) < N_EXTRA_SERVERS)
+        return TRUE;
+
+    if (multi_thread_shutdown_first && !multi_thread_shutdown) {
+        multi_thread_shutdown = TRUE;
+        milter_client_shutdown(client);
+        return TRUE;
+    }
+
+    if (!multi_thread_closed) {
+        multi_thread_closed = TRUE;
+        close_extra_servers();
+        return TRUE;
+    }
+
+    if (multi_thread_shutdown) {
+        multi_thread_timeout_id = 0;
+        return FALSE;
+    }
+
+    if (milter_client_get_n_processing_sessions(client) > 0)
+        return TRUE;
+
+    multi_thread_shutdown = TRUE;
+    milter_client_shutdown(client);
+    multi_thread_timeout_id = 0;
+    return FALSE;
+}
+
+static void
+run_multi_thread_client (void)
+{
+    GError *error = NULL;
+
+    milter_client_set_multi_thread_mode(client, TRUE);
+    milter_client_set_n_threads(client, 2);
+    g_signal_handlers_disconnect_by_func(client,
+                                         cb_connection_established,
+                                         NULL);
+    g_signal_connect(client, "connection-established",
+                     G_CALLBACK(cb_multi_thread_connection_established),
+                     NULL);
+
+    idle_id = milter_event_loop_add_idle(loop,
+                                         cb_idle_multi_thread_helo,
+                                         NULL);
+    multi_thread_timeout_id =
+        milter_event_loop_add_timeout(loop, 0.01,
+                                      cb_timeout_multi_thread_step,
+                                      NULL);
+
+    milter_client_set_connection_spec(client, spec, &error);
+    gcut_assert_error(error);
+    milter_client_run(client, &error);
+    gcut_assert_error(error);
+}
+
+void
+test_multi_thread_sessions (void)
+{
+    if (n_workers > 0)
+        cut_omit("can't obtain the result from callbacks in child process");
+
+    cut_trace(run_multi_thread_client());
+
+    cut_assert_equal_int(N_EXTRA_SERVERS,
+                         g_atomic_int_get(&n_multi_thread_helos));
+    cut_assert_equal_int(N_EXTRA_SERVERS,
+                         g_atomic_int_get(&n_multi_thread_finished_emissions));
+    cut_assert_equal_uint(N_EXTRA_SERVERS,
+                          milter_client_get_n_accepted_connections(client));
+    cut_assert_equal_uint(0, milter_client_get_n_processing_sessions(client));
+}
+
+void
+test_multi_thread_shutdown_with_sessions (void)
+{
+    if (n_workers > 0)
+        cut_omit("can't obtain the result from callbacks in child process");
+
+    multi_thread_shutdown_first = TRUE;
+    cut_trace(run_multi_thread_client());
+
+    cut_assert_true(multi_thread_closed);
+    cut_assert_equal_int(N_EXTRA_SERVERS,
+                         g_atomic_int_get(&n_multi_thread_finished_emissions));
+    cut_assert_equal_uint(0, milter_client_get_n_processing_sessions(client));
+}
+
+void
+test_worker_sharding (void)
+{
+    cut_assert_false(milter_client_is_worker_sharding(client));
+    milter_client_set_worker_sharding(client, TRUE);
+    cut_assert_true(milter_client_is_worker_sharding(client));
+}
+
+void
+test_n_accepted_connections (void)
+{
+    GError *error = NULL;
+
+    if (n_workers > 0)
+        cut_omit("can't obtain the result from callbacks in child process");
+
+    cut_assert_equal_uint(0, milter_client_get_n_accepted_connections(client));
+
+    idle_id = milter_event_loop_add_idle(loop, cb_idle_helo, NULL);
+
+    cut_trace(setup_client());
+    milter_client_run(client, &error);
+    gcut_assert_error(error);
+
+    cut_assert_equal_uint(1, milter_client_get_n_accepted_connections(client));
+}
+
+static gboolean
+cb_idle_over_max_connections (gpointer user_data)
+{
+    cut_trace(setup_test_server());
+    cut_trace(over_server = milter_test_server_new(spec, decoder, loop));
+
+    return FALSE;
+}
+
+void
+test_max_connections_suspend (void)
+{
+    GError *error = NULL;
+
+    if (n_workers > 0)
+        cut_omit("can't obtain the result from callbacks in child process");
+
+    milter_client_set_max_connections(client, 1);
+    milter_client_set_suspend_time_on_unacceptable(client, 1);
+
+    idle_id = milter_event_loop_add_idle(loop,
+                                         cb_idle_over_max_connections,
+                                         NULL);
+
+    cut_trace(setup_client());
+    milter_client_run(client, &error);
+    gcut_assert_error(error);
+
+    cut_assert_equal_uint(0, shutdown_count);
+    cut_assert_equal_uint(1, milter_client_get_n_accepted_connections(client));
+}
+
+void
+test_max_accepts_per_wakeup (void)
+{
+    cut_assert_equal_uint(MILTER_CLIENT_DEFAULT_MAX_ACCEPTS_PER_WAKEUP,
+                          milter_client_get_max_accepts_per_wakeup(client));
+    milter_client_set_max_accepts_per_wakeup(client, 1);
+    cut_assert_equal_uint(1, milter_client_get_max_accepts_per_wakeup(client));
+}
+
+static gboolean
+cb_idle_observe_accepts (gpointer user_data)
+{
+    guint n_accepted_connections;
+
+    n_accepted_connections = milter_client_get_n_accepted_connections(client);
+    if (n_accepted_connections > n_observed_accepted_connections) {
+        n_accept_wakeups++;
+        n_observed_accepted_connections = n_accepted_connections;
+    }
+    if (n_accepted_connections < N_EXTRA_SERVERS)
+        return TRUE;
+
+    close_extra_servers();
+    observe_accepts_id = 0;
+    return FALSE;
+}
+
+static gboolean
+cb_idle_queue_connections (gpointer user_data)
+{
+    /* All connections are queued on the listening socket
+     * before the client is woken up to accept them. */
+    cut_trace(open_extra_servers(FALSE));
+    observe_accepts_id = milter_event_loop_add_idle(loop,
+                                                    cb_idle_observe_accepts,
+                                                    NULL);
+
+    return FALSE;
+}
+
+static void
+accept_queued_connections (void)
+{
+    GError *error = NULL;
+
+    idle_id = milter_event_loop_add_idle(loop,
+                                         cb_idle_queue_connections,
+                                         NULL);
+
+    cut_trace(setup_client());
+    milter_client_run(client, &error);
+    gcut_assert_error(error);
+
+    cut_assert_equal_uint(N_EXTRA_SERVERS,
+                          milter_client_get_n_accepted_connections(client));
+}
+
+void
+test_accept_queued_connections (void)
+{
+    if (n_workers > 0)
+        cut_omit("can't obtain the result from callbacks in child process");
+
+    milter_client_set_max_accepts_per_wakeup(client, N_EXTRA_SERVERS);
+    cut_trace(accept_queued_connections());
+    cut_assert_equal_uint(1, n_accept_wakeups);
+}
+
+void
+test_accept_queued_connections_one_per_wakeup (void)
+{
+    if (n_workers > 0)
+        cut_omit("can't obtain the result from callbacks in child process");
+
+    milter_client_set_max_accepts_per_wakeup(client, 1);
+    cut_trace(accept_queued_connections());
+    cut_assert_equal_uint(N_EXTRA_SERVERS, n_accept_wakeups);
+}
 
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
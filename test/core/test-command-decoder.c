@@ -74,6 +74,7 @@ void test_decode_abort (void);
 void test_decode_abort_with_garbage (void);
 void test_decode_quit (void);
 void test_decode_quit_with_garbage (void);
+void test_decode_quit_new_connection (void);
 void test_decode_unknown (void);
 void test_decode_unknown_without_null (void);
 void test_decode_unexpected_command (void);
@@ -97,6 +98,7 @@ static gint n_bodies;
 static gint n_end_of_messages;
 static gint n_aborts;
 static gint n_quits;
+static gint n_quit_new_connections;
 static gint n_unknowns;
 
 static MilterOption *negotiate_option;
@@ -247,6 +249,12 @@ cb_quit (MilterDecoder *decoder, gpointer user_data)
     n_quits++;
 }
 
+static void
+cb_quit_new_connection (MilterDecoder *decoder, gpointer user_data)
+{
+    n_quit_new_connections++;
+}
+
 static void
 cb_unknown (MilterDecoder *decoder, const gchar *command, gpointer user_data)
 {
@@ -276,6 +284,7 @@ setup_signals (MilterDecoder *decoder)
     CONNECT(end_of_message);
     CONNECT(abort);
     CONNECT(quit);
+    CONNECT(quit_new_connection);
     CONNECT(unknown);
 
 #undef CONNECT
@@ -303,6 +312,7 @@ setup (void)
     n_end_of_messages = 0;
     n_aborts = 0;
     n_quits = 0;
+    n_quit_new_connections = 0;
     n_unknowns = 0;
 
     buffer = g_string_new(NULL);
@@ -1590,6 +1600,16 @@ test_decode_quit_with_garbage (void)
     gcut_assert_equal_error(expected_error, actual_error);
 }
 
+void
+test_decode_quit_new_connection (void)
+{
+    g_string_append(buffer, "K");
+    gcut_assert_error(decode());
+
+    cut_assert_equal_int(1, n_quit_new_connections);
+    cut_assert_equal_int(0, n_quits);
+}
+
 void
 test_decode_unknown (void)
 {
@@ -45,6 +45,8 @@ void test_encode_data (void);
 void test_encode_header (void);
 void test_encode_end_of_header (void);
 void test_encode_body (void);
+void test_encode_body_scattered (void);
+void test_encode_body_scattered_large (void);
 void test_encode_end_of_message (void);
 void test_encode_end_of_message_with_data (void);
 void test_encode_abort (void);
@@ -53,6 +55,7 @@ void test_encode_unknown (void);
 
 static MilterCommandEncoder *encoder;
 static GString *expected;
+static GString *scattered;
 static GHashTable *macros;
 
 void
@@ -61,6 +64,7 @@ setup (void)
     encoder = MILTER_COMMAND_ENCODER(milter_command_encoder_new());
 
     expected = g_string_new(NULL);
+    scattered = g_string_new(NULL);
 
     macros = NULL;
 }
@@ -75,6 +79,9 @@ teardown (void)
     if (expected)
         g_string_free(expected, TRUE);
 
+    if (scattered)
+        g_string_free(scattered, TRUE);
+
     if (macros)
         g_hash_table_unref(macros);
 }
@@ -555,6 +562,61 @@ test_encode_body (void)
     cut_assert_equal_uint(sizeof(body), packed_size);
 }
 
+void
+test_encode_body_scattered (void)
+{
+    const gchar body[] =
+        "La de da de da 1.\n"
+        "La de da de da 2.\n"
+        "La de da de da 3.\n"
+        "La de da de da 4.";
+    const gchar *header;
+    gsize header_size = 0, packed_size;
+
+    g_string_append(expected, "B");
+    g_string_append_len(expected, body, sizeof(body));
+    pack(expected);
+
+    milter_command_encoder_encode_body_scattered(encoder,
+                                                 &header, &header_size,
+                                                 body, sizeof(body),
+                                                 &packed_size);
+    cut_assert_equal_uint(sizeof(body), packed_size);
+
+    g_string_append_len(scattered, header, header_size);
+    g_string_append_len(scattered, body, packed_size);
+    cut_assert_equal_memory(expected->str, expected->len,
+                            scattered->str, scattered->len);
+}
+
+void
+test_encode_body_scattered_large (void)
+{
+    GString *body;
+    const gchar *header;
+    gsize header_size = 0, packed_size;
+
+    body = g_string_new(NULL);
+    g_string_set_size(body, MILTER_CHUNK_SIZE + 1);
+    memset(body->str, 'X', body->len);
+
+    g_string_append(expected, "B");
+    g_string_append_len(expected, body->str, MILTER_CHUNK_SIZE);
+    pack(expected);
+
+    milter_command_encoder_encode_body_scattered(encoder,
+                                                 &header, &header_size,
+                                                 body->str, body->len,
+                                                 &packed_size);
+    g_string_append_len(scattered, header, header_size);
+    g_string_append_len(scattered, body->str, packed_size);
+    g_string_free(body, TRUE);
+
+    cut_assert_equal_uint(MILTER_CHUNK_SIZE, packed_size);
+    cut_assert_equal_memory(expected->str, expected->len,
+                            scattered->str, scattered->len);
+}
+
 void
 test_encode_end_of_message (void)
 {
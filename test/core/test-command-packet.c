@@ -0,0 +1,86 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <milter/core/milter-command-packet.h>
+#include <milter/core/milter-command-encoder.h>
+#include <milter/core/milter-enum-types.h>
+
+#include <gcutter.h>
+
+void test_new (void);
+void test_ref (void);
+
+static MilterCommandPacket *command_packet;
+static MilterCommandEncoder *encoder;
+
+void
+cut_setup (void)
+{
+    command_packet = NULL;
+    encoder = MILTER_COMMAND_ENCODER(milter_command_encoder_new());
+}
+
+void
+cut_teardown (void)
+{
+    if (command_packet)
+        milter_command_packet_unref(command_packet);
+    if (encoder)
+        g_object_unref(encoder);
+}
+
+void
+test_new (void)
+{
+    const gchar *packet;
+    gsize packet_size;
+
+    milter_command_encoder_encode_helo(encoder, &packet, &packet_size,
+                                       "delian");
+    command_packet = milter_command_packet_new(MILTER_COMMAND_HELO,
+                                               packet, packet_size);
+    milter_command_encoder_encode_helo(encoder, &packet, &packet_size,
+                                       "mail.example.com");
+
+    gcut_assert_equal_enum(MILTER_TYPE_COMMAND,
+                           MILTER_COMMAND_HELO,
+                           milter_command_packet_get_command(command_packet));
+    milter_command_encoder_encode_helo(encoder, &packet, &packet_size,
+                                       "delian");
+    cut_assert_equal_memory(packet, packet_size,
+                            milter_command_packet_get_data(command_packet),
+                            milter_command_packet_get_size(command_packet));
+}
+
+void
+test_ref (void)
+{
+    command_packet = milter_command_packet_new(MILTER_COMMAND_DATA, "T", 1);
+
+    cut_assert_equal_pointer(command_packet,
+                             milter_command_packet_ref(command_packet));
+    milter_command_packet_unref(command_packet);
+    cut_assert_equal_memory("T", 1,
+                            milter_command_packet_get_data(command_packet),
+                            milter_command_packet_get_size(command_packet));
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
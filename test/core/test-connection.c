@@ -45,6 +45,7 @@ void test_listen (void);
 void test_listen_exist_socket (void);
 void test_listen_remove_failure (void);
 void test_listen_nonexistent_path (void);
+void test_listen_reuse_port (void);
 
 static struct sockaddr *actual_address;
 static socklen_t actual_address_size;
@@ -610,6 +611,28 @@ test_listen_nonexistent_path (void)
     cut_assert_equal_int(0, address_size);
 }
 
+void
+test_listen_reuse_port (void)
+{
+    const gchar spec[] = "inet:9999@127.0.0.1";
+    GIOChannel *channel1, *channel2;
+    GError *error = NULL;
+
+#ifndef SO_REUSEPORT
+    cut_omit("SO_REUSEPORT isn't supported");
+#endif
+
+    channel1 = milter_connection_listen_full(spec, 5, NULL, NULL,
+                                             FALSE, TRUE, &error);
+    gcut_assert_error(error);
+    cut_take(channel1, (CutDestroyFunction)g_io_channel_unref);
+
+    channel2 = milter_connection_listen_full(spec, 5, NULL, NULL,
+                                             FALSE, TRUE, &error);
+    gcut_assert_error(error);
+    cut_take(channel2, (CutDestroyFunction)g_io_channel_unref);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -0,0 +1,192 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <milter/core/milter-command-decoder.h>
+#include <milter-test-utils.h>
+
+#include <gcutter.h>
+
+#define BENCHMARK_CHUNK_SIZE 1500
+
+void test_decode_packet_logs (void);
+
+static MilterDecoder *decoder;
+static GString *packets;
+static GError *actual_error;
+static gint n_commands;
+
+void
+cut_setup (void)
+{
+    decoder = milter_command_decoder_new();
+    packets = g_string_new(NULL);
+    actual_error = NULL;
+    n_commands = 0;
+}
+
+void
+cut_teardown (void)
+{
+    if (decoder)
+        g_object_unref(decoder);
+    if (packets)
+        g_string_free(packets, TRUE);
+    if (actual_error)
+        g_error_free(actual_error);
+}
+
+/*
+ * Packet logs are tshark hex dumps: unindented "Data" blocks are
+ * sent by MTA and indented ones are replies from milter. We use
+ * only the former because they are what MilterCommandDecoder reads.
+ */
+static void
+append_command_bytes (GString *bytes, const gchar *line)
+{
+    gint i;
+    const gchar *hex;
+
+    if (!g_ascii_isxdigit(line[0]) || strlen(line) < 6 ||
+        line[4] != ' ' || line[5] != ' ')
+        return;
+
+    for (i = 0, hex = line + 6; i < 16; i++, hex += 3) {
+        if (!g_ascii_isxdigit(hex[0]) || !g_ascii_isxdigit(hex[1]))
+            break;
+        g_string_append_c(bytes,
+                          g_ascii_xdigit_value(hex[0]) * 16 +
+                          g_ascii_xdigit_value(hex[1]));
+        if (hex[2] != ' ')
+            break;
+    }
+}
+
+static void
+load_packet_logs (void)
+{
+    gchar *packet_dir;
+    GDir *dir;
+    const gchar *name;
+
+    packet_dir = g_build_filename(milter_test_get_source_dir(),
+                                  "data", "packet", NULL);
+    cut_take_string(packet_dir);
+    dir = g_dir_open(packet_dir, 0, &actual_error);
+    gcut_assert_error(actual_error);
+
+    while ((name = g_dir_read_name(dir))) {
+        gchar *path, *content;
+        gchar **lines, **line;
+
+        if (!g_str_has_prefix(name, "milter-packet-") ||
+            !g_str_has_suffix(name, ".log"))
+            continue;
+
+        path = g_build_filename(packet_dir, name, NULL);
+        g_file_get_contents(path, &content, NULL, &actual_error);
+        g_free(path);
+        if (actual_error)
+            break;
+
+        lines = g_strsplit(content, "\n", -1);
+        for (line = lines; *line; line++) {
+            append_command_bytes(packets, *line);
+        }
+        g_strfreev(lines);
+        g_free(content);
+    }
+    g_dir_close(dir);
+
+    gcut_assert_error(actual_error);
+    cut_assert_operator_uint(0, <, packets->len);
+}
+
+static gboolean
+cb_decode (MilterDecoder *decoder, GError **error, gpointer user_data)
+{
+    n_commands++;
+    return TRUE;
+}
+
+/*
+ * The benchmark is too slow for a normal test run. It runs
+ * only when MILTER_TEST_BENCHMARK_ITERATIONS is set:
+ *   % MILTER_TEST_BENCHMARK_ITERATIONS=1000 test/run-test.sh \
+ *       -n test_decode_packet_logs
+ */
+static guint
+get_n_iterations (void)
+{
+    const gchar *iterations;
+
+    iterations = g_getenv("MILTER_TEST_BENCHMARK_ITERATIONS");
+    if (!iterations)
+        cut_omit("set MILTER_TEST_BENCHMARK_ITERATIONS to run benchmark");
+    return MAX(atoi(iterations), 1);
+}
+
+void
+test_decode_packet_logs (void)
+{
+    GTimer *timer;
+    gdouble elapsed, total_mbytes;
+    guint i, n_iterations;
+    gint n_commands_per_iteration = 0;
+
+    n_iterations = get_n_iterations();
+    cut_trace(load_packet_logs());
+    g_signal_connect(decoder, "decode", G_CALLBACK(cb_decode), NULL);
+
+    timer = g_timer_new();
+    for (i = 0; i < n_iterations; i++) {
+        gsize offset;
+
+        for (offset = 0; offset < packets->len; offset += BENCHMARK_CHUNK_SIZE) {
+            gsize size;
+
+            size = MIN(BENCHMARK_CHUNK_SIZE, packets->len - offset);
+            if (!milter_decoder_decode(decoder, packets->str + offset, size,
+                                       &actual_error))
+                break;
+        }
+        if (actual_error)
+            break;
+        if (i == 0)
+            n_commands_per_iteration = n_commands;
+    }
+    g_timer_stop(timer);
+    elapsed = g_timer_elapsed(timer, NULL);
+    g_timer_destroy(timer);
+
+    gcut_assert_error(actual_error);
+    cut_assert_true(milter_decoder_end_decode(decoder, &actual_error));
+    cut_assert_equal_int(n_commands_per_iteration * n_iterations, n_commands);
+
+    total_mbytes = (gdouble)packets->len * n_iterations / (1024 * 1024);
+    cut_notify("decoded %d commands (%.2fMB) in %.3fs: %.2fMB/s",
+               n_commands, total_mbytes, elapsed,
+               elapsed > 0 ? total_mbytes / elapsed : 0.0);
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
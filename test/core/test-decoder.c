@@ -34,6 +34,7 @@ void test_end_decode_immediately (void);
 void test_end_decode_in_command_length_decoding (void);
 void test_end_decode_in_command_content_decoding (void);
 void test_tag (void);
+void test_decode_pipelined_commands (void);
 
 static MilterDecoder *decoder;
 static GString *buffer;
@@ -41,6 +42,8 @@ static GString *buffer;
 static GError *expected_error;
 static GError *actual_error;
 
+static gint n_quits;
+
 void
 cut_setup (void)
 {
@@ -50,6 +53,8 @@ cut_setup (void)
     actual_error = NULL;
 
     buffer = g_string_new(NULL);
+
+    n_quits = 0;
 }
 
 void
@@ -124,6 +129,44 @@ test_tag (void)
     cut_assert_equal_uint(29, milter_decoder_get_tag(decoder));
 }
 
+static void
+cb_quit (MilterDecoder *decoder, gpointer user_data)
+{
+    n_quits++;
+}
+
+/* The buffer may be moved by each decode. It must be got again. */
+static const gchar *
+get_buffer (void)
+{
+    return milter_decoder_get_buffer(decoder);
+}
+
+void
+test_decode_pipelined_commands (void)
+{
+    g_signal_connect(decoder, "quit", G_CALLBACK(cb_quit), NULL);
+
+    g_string_append_len(buffer, "\0\0\0\1Q", 5);
+    g_string_append_len(buffer, "\0\0\0\1Q", 5);
+    g_string_append_len(buffer, "\0\0", 2);
+    cut_assert_true(milter_decoder_decode(decoder, buffer->str, buffer->len,
+                                          &actual_error));
+    gcut_assert_error(actual_error);
+    cut_assert_equal_int(2, n_quits);
+    cut_assert_equal_memory("\0\0", 2,
+                            get_buffer(),
+                            milter_decoder_get_buffered_size(decoder));
+
+    cut_assert_true(milter_decoder_decode(decoder, "\0\1Q", 3,
+                                          &actual_error));
+    gcut_assert_error(actual_error);
+    cut_assert_equal_int(3, n_quits);
+    cut_assert_equal_uint(0, milter_decoder_get_buffered_size(decoder));
+    cut_assert_equal_string("", get_buffer());
+    cut_assert_true(milter_decoder_end_decode(decoder, &actual_error));
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
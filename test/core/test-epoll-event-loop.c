@@ -0,0 +1,276 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <milter/core/milter-epoll-event-loop.h>
+
+#include <milter-test-utils.h>
+
+#include <gcutter.h>
+
+void test_watch_io (void);
+void test_watch_fd (void);
+void test_watch_fd_mixed_trigger (void);
+void test_timeout (void);
+void test_idle (void);
+void test_remove (void);
+void test_suspend (void);
+void test_watch_child (void);
+
+static MilterEventLoop *loop;
+static gint pipe_fds[2];
+static GIOChannel *channel;
+static gint n_called;
+static GIOCondition called_condition;
+static gint exit_status;
+static guint id;
+
+void
+cut_setup (void)
+{
+    loop = milter_epoll_event_loop_new();
+    pipe_fds[0] = -1;
+    pipe_fds[1] = -1;
+    if (pipe(pipe_fds) == -1)
+        cut_assert_errno();
+    channel = NULL;
+    n_called = 0;
+    called_condition = 0;
+    exit_status = -1;
+    id = 0;
+}
+
+void
+cut_teardown (void)
+{
+    if (loop)
+        g_object_unref(loop);
+    if (channel)
+        g_io_channel_unref(channel);
+    if (pipe_fds[0] != -1)
+        close(pipe_fds[0]);
+    if (pipe_fds[1] != -1)
+        close(pipe_fds[1]);
+}
+
+static void
+write_data (void)
+{
+    if (write(pipe_fds[1], "X", 1) == -1)
+        cut_assert_errno();
+}
+
+static void
+iterate_without_block (void)
+{
+    gint i;
+
+    for (i = 0; i < 10; i++) {
+        milter_event_loop_iterate(loop, FALSE);
+    }
+}
+
+static gboolean
+cb_io (GIOChannel *source, GIOCondition condition, gpointer user_data)
+{
+    n_called++;
+    called_condition = condition;
+    return TRUE;
+}
+
+void
+test_watch_io (void)
+{
+    channel = g_io_channel_unix_new(pipe_fds[0]);
+    id = milter_event_loop_watch_io(loop, channel, G_IO_IN, cb_io, NULL);
+    cut_assert_operator_int(0, <, id);
+
+    iterate_without_block();
+    cut_assert_equal_int(0, n_called);
+
+    write_data();
+    milter_event_loop_iterate(loop, TRUE);
+    cut_assert_equal_int(1, n_called);
+    gcut_assert_equal_flags(G_TYPE_IO_CONDITION, G_IO_IN, called_condition);
+
+    /* level triggered: called again while data remains. */
+    milter_event_loop_iterate(loop, FALSE);
+    cut_assert_equal_int(2, n_called);
+}
+
+static gboolean
+cb_fd (gint fd, GIOCondition condition, gpointer user_data)
+{
+    n_called++;
+    called_condition = condition;
+    return TRUE;
+}
+
+void
+test_watch_fd (void)
+{
+    id = milter_epoll_event_loop_watch_fd(loop, pipe_fds[0], G_IO_IN, TRUE,
+                                          cb_fd, NULL, NULL);
+    cut_assert_operator_int(0, <, id);
+
+    write_data();
+    milter_event_loop_iterate(loop, TRUE);
+    cut_assert_equal_int(1, n_called);
+
+    /* edge triggered: not called again until new data arrives. */
+    iterate_without_block();
+    cut_assert_equal_int(1, n_called);
+
+    write_data();
+    milter_event_loop_iterate(loop, TRUE);
+    cut_assert_equal_int(2, n_called);
+}
+
+void
+test_watch_fd_mixed_trigger (void)
+{
+    cut_assert_operator_int(0, <,
+                            milter_epoll_event_loop_watch_fd(loop,
+                                                             pipe_fds[0],
+                                                             G_IO_IN,
+                                                             TRUE,
+                                                             cb_fd,
+                                                             NULL,
+                                                             NULL));
+    cut_assert_equal_uint(0,
+                          milter_epoll_event_loop_watch_fd(loop,
+                                                           pipe_fds[0],
+                                                           G_IO_IN,
+                                                           FALSE,
+                                                           cb_fd,
+                                                           NULL,
+                                                           NULL));
+}
+
+static gboolean
+cb_count (gpointer user_data)
+{
+    gint max = GPOINTER_TO_INT(user_data);
+
+    n_called++;
+    return n_called < max;
+}
+
+void
+test_timeout (void)
+{
+    GTimer *timer;
+    gdouble elapsed;
+
+    timer = g_timer_new();
+    id = milter_event_loop_add_timeout(loop, 0.05,
+                                       cb_count, GINT_TO_POINTER(2));
+    while (n_called < 2) {
+        milter_event_loop_iterate(loop, TRUE);
+    }
+    elapsed = g_timer_elapsed(timer, NULL);
+    g_timer_destroy(timer);
+
+    cut_assert_true(elapsed >= 0.099, cut_message("<%g>", elapsed));
+    iterate_without_block();
+    cut_assert_false(milter_event_loop_remove(loop, id));
+}
+
+void
+test_idle (void)
+{
+    id = milter_event_loop_add_idle(loop, cb_count, GINT_TO_POINTER(3));
+    iterate_without_block();
+    cut_assert_equal_int(3, n_called);
+    cut_assert_false(milter_event_loop_remove(loop, id));
+}
+
+static void
+cb_notify (gpointer user_data)
+{
+    gboolean *notified = user_data;
+
+    *notified = TRUE;
+}
+
+void
+test_remove (void)
+{
+    gboolean notified = FALSE;
+
+    id = milter_event_loop_add_idle_full(loop, G_PRIORITY_DEFAULT_IDLE,
+                                         cb_count, GINT_TO_POINTER(10),
+                                         &notified, cb_notify);
+    cut_assert_true(milter_event_loop_remove(loop, id));
+    cut_assert_true(notified);
+    cut_assert_false(milter_event_loop_remove(loop, id));
+
+    iterate_without_block();
+    cut_assert_equal_int(0, n_called);
+}
+
+void
+test_suspend (void)
+{
+    id = milter_epoll_event_loop_watch_fd(loop, pipe_fds[0], G_IO_IN, FALSE,
+                                          cb_fd, NULL, NULL);
+    cut_assert_true(milter_event_loop_suspend(loop, id));
+
+    write_data();
+    iterate_without_block();
+    cut_assert_equal_int(0, n_called);
+
+    cut_assert_true(milter_event_loop_resume(loop, id));
+    milter_event_loop_iterate(loop, TRUE);
+    cut_assert_equal_int(1, n_called);
+}
+
+static void
+cb_child (GPid pid, gint status, gpointer user_data)
+{
+    n_called++;
+    exit_status = WEXITSTATUS(status);
+}
+
+void
+test_watch_child (void)
+{
+    GPid pid;
+
+    pid = fork();
+    if (pid == -1)
+        cut_assert_errno();
+    if (pid == 0)
+        _exit(29);
+
+    id = milter_event_loop_watch_child(loop, pid, cb_child, NULL);
+    while (n_called == 0) {
+        milter_event_loop_iterate(loop, TRUE);
+    }
+    cut_assert_equal_int(29, exit_status);
+    cut_assert_false(milter_event_loop_remove(loop, id));
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
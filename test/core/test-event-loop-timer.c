@@ -0,0 +1,197 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <milter/core/milter-event-loop.h>
+
+#include <milter-test-utils.h>
+
+#include <gcutter.h>
+
+void test_fire (void);
+void test_disarm (void);
+void test_rearm (void);
+void test_repeat (void);
+void test_level2 (void);
+void test_beyond_level2 (void);
+void test_disarm_after_loop_change (void);
+void test_unref_armed (void);
+
+static MilterEventLoop *loop;
+static MilterEventLoop *other_loop;
+static MilterEventLoopTimer timer;
+static MilterEventLoopTimer other_timer;
+static gint n_fired;
+static gint n_repeats;
+static gboolean timed_out;
+static guint timeout_id;
+
+void
+cut_setup (void)
+{
+    loop = milter_test_event_loop_new();
+    other_loop = NULL;
+    milter_event_loop_timer_init(&timer);
+    milter_event_loop_timer_init(&other_timer);
+    n_fired = 0;
+    n_repeats = 0;
+    timed_out = FALSE;
+    timeout_id = 0;
+}
+
+void
+cut_teardown (void)
+{
+    if (loop) {
+        milter_event_loop_disarm_timer(loop, &timer);
+        milter_event_loop_disarm_timer(loop, &other_timer);
+        if (timeout_id > 0)
+            milter_event_loop_remove(loop, timeout_id);
+        g_object_unref(loop);
+    }
+    if (other_loop)
+        g_object_unref(other_loop);
+}
+
+static gboolean
+cb_timer (gpointer user_data)
+{
+    n_fired++;
+    return n_fired < n_repeats;
+}
+
+static gboolean
+cb_timeout (gpointer user_data)
+{
+    timed_out = TRUE;
+    timeout_id = 0;
+    return FALSE;
+}
+
+static void
+wait_seconds (gdouble seconds)
+{
+    timed_out = FALSE;
+    timeout_id = milter_event_loop_add_timeout(loop, seconds,
+                                               cb_timeout, NULL);
+    while (!timed_out) {
+        milter_event_loop_iterate(loop, TRUE);
+    }
+}
+
+void
+test_fire (void)
+{
+    milter_event_loop_arm_timer(loop, &timer, 0.1, cb_timer, NULL);
+    cut_assert_true(milter_event_loop_timer_is_armed(&timer));
+
+    wait_seconds(0.5);
+    cut_assert_equal_int(1, n_fired);
+    cut_assert_false(milter_event_loop_timer_is_armed(&timer));
+}
+
+void
+test_disarm (void)
+{
+    milter_event_loop_arm_timer(loop, &timer, 0.1, cb_timer, NULL);
+    milter_event_loop_disarm_timer(loop, &timer);
+    cut_assert_false(milter_event_loop_timer_is_armed(&timer));
+
+    wait_seconds(0.3);
+    cut_assert_equal_int(0, n_fired);
+}
+
+void
+test_rearm (void)
+{
+    milter_event_loop_arm_timer(loop, &timer, 60, cb_timer, NULL);
+    milter_event_loop_arm_timer(loop, &timer, 0.1, cb_timer, NULL);
+
+    wait_seconds(0.5);
+    cut_assert_equal_int(1, n_fired);
+}
+
+void
+test_repeat (void)
+{
+    n_repeats = 3;
+    milter_event_loop_arm_timer(loop, &timer, 0.1, cb_timer, NULL);
+
+    wait_seconds(1.0);
+    cut_assert_equal_int(3, n_fired);
+    cut_assert_false(milter_event_loop_timer_is_armed(&timer));
+}
+
+void
+test_level2 (void)
+{
+    milter_event_loop_arm_timer(loop, &timer, 30, cb_timer, NULL);
+
+    milter_event_loop_advance_timer_clock(loop, 29);
+    wait_seconds(0.3);
+    cut_assert_equal_int(0, n_fired);
+    cut_assert_true(milter_event_loop_timer_is_armed(&timer));
+
+    milter_event_loop_advance_timer_clock(loop, 1);
+    wait_seconds(0.3);
+    cut_assert_equal_int(1, n_fired);
+    cut_assert_false(milter_event_loop_timer_is_armed(&timer));
+}
+
+void
+test_beyond_level2 (void)
+{
+    milter_event_loop_arm_timer(loop, &timer, 2000, cb_timer, NULL);
+
+    milter_event_loop_advance_timer_clock(loop, 1999);
+    wait_seconds(0.3);
+    cut_assert_equal_int(0, n_fired);
+    cut_assert_true(milter_event_loop_timer_is_armed(&timer));
+
+    milter_event_loop_advance_timer_clock(loop, 1);
+    wait_seconds(0.3);
+    cut_assert_equal_int(1, n_fired);
+    cut_assert_false(milter_event_loop_timer_is_armed(&timer));
+}
+
+void
+test_disarm_after_loop_change (void)
+{
+    other_loop = milter_test_event_loop_new();
+    milter_event_loop_arm_timer(other_loop, &other_timer, 60, cb_timer, NULL);
+    milter_event_loop_disarm_timer(loop, &other_timer);
+    cut_assert_false(milter_event_loop_timer_is_armed(&other_timer));
+
+    milter_event_loop_arm_timer(loop, &timer, 0.1, cb_timer, NULL);
+    wait_seconds(0.5);
+    cut_assert_equal_int(1, n_fired);
+}
+
+void
+test_unref_armed (void)
+{
+    milter_event_loop_arm_timer(loop, &timer, 60, cb_timer, NULL);
+
+    g_object_add_weak_pointer(G_OBJECT(loop), (gpointer *)&loop);
+    g_object_unref(loop);
+    cut_assert_null(loop);
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -38,6 +38,8 @@ void test_insert_header (void);
 void test_change_header (void);
 void test_delete_header_with_change_header (void);
 void test_delete_header (void);
+void test_lookup_by_name_after_insert (void);
+void test_iter (void);
 
 static MilterHeaders *headers;
 static GList *expected_list;
@@ -531,6 +533,67 @@ test_delete_header (void)
             NULL);
 }
 
+void
+test_lookup_by_name_after_insert (void)
+{
+    cut_assert_true(milter_headers_append_header(headers,
+                                                 "Test header",
+                                                 "Second test header value"));
+    cut_assert_true(milter_headers_append_header(headers,
+                                                 "Unique header",
+                                                 "Unique header value"));
+    cut_assert_true(milter_headers_insert_header(headers,
+                                                 0,
+                                                 "Test header",
+                                                 "First test header value"));
+
+    cut_assert_equal_string(
+        "First test header value",
+        milter_headers_lookup_by_name(headers, "Test header")->value);
+    cut_assert_equal_int(
+        2,
+        milter_headers_index_in_same_header_name(
+            headers, milter_headers_get_nth_header(headers, 2)));
+    cut_assert_equal_string(
+        "Unique header value",
+        milter_headers_get_nth_header(headers, 3)->value);
+}
+
+void
+test_iter (void)
+{
+    MilterHeadersIter iter;
+    MilterHeader *header;
+    GList *actual_list = NULL;
+
+    expected_list = g_list_append(expected_list,
+                                  milter_header_new("First header",
+                                                    "First header value"));
+    expected_list = g_list_append(expected_list,
+                                  milter_header_new("Second header",
+                                                    "Second header value"));
+
+    cut_assert_true(milter_headers_append_header(headers,
+                                                 "First header",
+                                                 "First header value"));
+    cut_assert_true(milter_headers_append_header(headers,
+                                                 "Second header",
+                                                 "Second header value"));
+
+    milter_headers_iter_init(&iter, headers);
+    while (milter_headers_iter_next(&iter, &header)) {
+        actual_list = g_list_append(actual_list, header);
+    }
+    gcut_take_list(actual_list, NULL);
+
+    gcut_assert_equal_list(
+            expected_list,
+            actual_list,
+            milter_header_equal,
+            (GCutInspectFunction)milter_header_inspect,
+            NULL);
+}
+
 
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
@@ -46,6 +46,8 @@ void test_interesting_level (void);
 void test_path_success (void);
 void test_path_null (void);
 void test_path_nonexistent (void);
+void test_async (void);
+void test_async_reopen (void);
 
 static MilterLogger *logger;
 
@@ -400,6 +402,83 @@ test_path_nonexistent (void)
     cut_assert_equal_string(NULL, milter_logger_get_path(logger));
 }
 
+static const gchar *
+setup_async_logger (void)
+{
+    const gchar *path;
+    GError *error = NULL;
+
+    logger = milter_logger_new();
+    milter_logger_set_target_level(logger, MILTER_LOG_LEVEL_INFO);
+    milter_logger_set_target_item(logger, MILTER_LOG_ITEM_NONE);
+    milter_logger_connect_default_handler(logger);
+
+    path = cut_build_path(tmp_dir, "output.log", NULL);
+    cut_assert_true(milter_logger_set_path(logger, path, &error));
+    gcut_assert_error(error);
+
+    milter_logger_set_async(logger, TRUE);
+
+    return path;
+}
+
+static const gchar *
+read_log (const gchar *path)
+{
+    gchar *content = NULL;
+    GError *error = NULL;
+
+    g_file_get_contents(path, &content, NULL, &error);
+    gcut_assert_error(error);
+
+    return cut_take_string(content);
+}
+
+void
+test_async (void)
+{
+    const gchar *path;
+
+    path = setup_async_logger();
+    cut_assert_true(milter_logger_is_async(logger));
+
+    milter_logger_log(logger, "domain", MILTER_LOG_LEVEL_INFO,
+                      "file", 29, "function", "first");
+    milter_logger_log(logger, "domain", MILTER_LOG_LEVEL_INFO,
+                      "file", 29, "function", "second");
+    milter_logger_flush(logger);
+    cut_assert_equal_string("first\nsecond\n", read_log(path));
+
+    milter_logger_set_async(logger, FALSE);
+    cut_assert_false(milter_logger_is_async(logger));
+    milter_logger_log(logger, "domain", MILTER_LOG_LEVEL_INFO,
+                      "file", 29, "function", "third");
+    cut_assert_equal_string("first\nsecond\nthird\n", read_log(path));
+}
+
+void
+test_async_reopen (void)
+{
+    const gchar *path, *rotated_path;
+
+    path = setup_async_logger();
+    rotated_path = cut_build_path(tmp_dir, "output.log.1", NULL);
+
+    milter_logger_log(logger, "domain", MILTER_LOG_LEVEL_INFO,
+                      "file", 29, "function", "before");
+    milter_logger_flush(logger);
+    if (g_rename(path, rotated_path) == -1)
+        cut_assert_errno();
+
+    milter_logger_reopen(logger);
+    milter_logger_set_async(logger, FALSE);
+    milter_logger_log(logger, "domain", MILTER_LOG_LEVEL_INFO,
+                      "file", 29, "function", "after");
+
+    cut_assert_equal_string("before\n", read_log(rotated_path));
+    cut_assert_equal_string("after\n", read_log(path));
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -0,0 +1,125 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include <milter/core/milter-macro-snapshot.h>
+#include <milter/core/milter-enum-types.h>
+
+#include <gcutter.h>
+
+void test_new (void);
+void test_encode (void);
+void test_intern_bracketed_name (void);
+
+static MilterMacroSnapshot *snapshot;
+static MilterCommandEncoder *encoder;
+
+void
+cut_setup (void)
+{
+    snapshot = NULL;
+    encoder = MILTER_COMMAND_ENCODER(milter_command_encoder_new());
+}
+
+void
+cut_teardown (void)
+{
+    if (snapshot)
+        milter_macro_snapshot_unref(snapshot);
+    if (encoder)
+        g_object_unref(encoder);
+}
+
+void
+test_new (void)
+{
+    GHashTable *macros;
+
+    macros = gcut_take_hash_table(
+        gcut_hash_table_string_string_new("j", "mail.example.com",
+                                          "daemon_name", NULL,
+                                          "{if_name}", "localhost",
+                                          NULL));
+    snapshot = milter_macro_snapshot_new(MILTER_COMMAND_CONNECT, macros);
+    g_hash_table_insert(macros, g_strdup("i"), g_strdup("4CAD4E9F"));
+
+    gcut_assert_equal_enum(MILTER_TYPE_COMMAND,
+                           MILTER_COMMAND_CONNECT,
+                           milter_macro_snapshot_get_command(snapshot));
+    gcut_assert_equal_hash_table_string_string(
+        gcut_hash_table_string_string_new("j", "mail.example.com",
+                                          "{if_name}", "localhost",
+                                          NULL),
+        milter_macro_snapshot_get_macros(snapshot));
+}
+
+void
+test_encode (void)
+{
+    const gchar *expected_packet, *packet, *cached_packet;
+    gsize expected_packet_size, packet_size, cached_packet_size;
+    GHashTable *macros;
+
+    macros = gcut_take_hash_table(
+        gcut_hash_table_string_string_new("j", "mail.example.com",
+                                          "if_name", "localhost",
+                                          NULL));
+    snapshot = milter_macro_snapshot_new(MILTER_COMMAND_HELO, macros);
+
+    milter_command_encoder_encode_define_macro(encoder,
+                                               &expected_packet,
+                                               &expected_packet_size,
+                                               MILTER_COMMAND_HELO,
+                                               macros);
+    expected_packet = cut_take_memdup(expected_packet, expected_packet_size);
+
+    milter_macro_snapshot_encode(snapshot, encoder, &packet, &packet_size);
+    cut_assert_equal_memory(expected_packet, expected_packet_size,
+                            packet, packet_size);
+
+    milter_macro_snapshot_encode(snapshot, encoder,
+                                 &cached_packet, &cached_packet_size);
+    cut_assert_equal_pointer(packet, cached_packet);
+    cut_assert_equal_size(packet_size, cached_packet_size);
+}
+
+void
+test_intern_bracketed_name (void)
+{
+    cut_assert_equal_string(
+        "{if_name}",
+        milter_macro_snapshot_intern_bracketed_name("if_name"));
+    cut_assert_equal_pointer(
+        g_intern_string("{if_name}"),
+        milter_macro_snapshot_intern_bracketed_name("if_name"));
+    cut_assert_equal_string(
+        NULL,
+        milter_macro_snapshot_intern_bracketed_name("{if_name}"));
+    cut_assert_equal_string(
+        "{j}",
+        milter_macro_snapshot_intern_bracketed_name("j"));
+    cut_assert_equal_string(
+        NULL,
+        milter_macro_snapshot_intern_bracketed_name(""));
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
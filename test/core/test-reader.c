@@ -25,6 +25,9 @@
 #define shutdown inet_shutdown
 #include <milter-test-utils.h>
 #include <milter/core/milter-reader.h>
+#include <milter/core/milter-command-decoder.h>
+#include <milter/core/milter-command-encoder.h>
+#include <sys/socket.h>
 #undef shutdown
 #include <unistd.h>
 
@@ -35,6 +38,7 @@ void test_io_error (void);
 void test_finished_signal (void);
 void test_shutdown (void);
 void test_tag (void);
+void test_socket_decoder (void);
 
 static MilterEventLoop *loop;
 
@@ -53,6 +57,11 @@ static GError *expected_error;
 
 static gboolean finished;
 
+static MilterDecoder *decoder;
+static MilterEncoder *encoder;
+static gint peer_fd;
+static gint n_decodes;
+
 void
 cut_setup (void)
 {
@@ -74,6 +83,11 @@ cut_setup (void)
     expected_error = NULL;
 
     finished = FALSE;
+
+    decoder = NULL;
+    encoder = NULL;
+    peer_fd = -1;
+    n_decodes = 0;
 }
 
 void
@@ -100,6 +114,13 @@ cut_teardown (void)
         g_error_free(actual_error);
     if (expected_error)
         g_error_free(expected_error);
+
+    if (decoder)
+        g_object_unref(decoder);
+    if (encoder)
+        g_object_unref(encoder);
+    if (peer_fd != -1)
+        close(peer_fd);
 }
 
 static void
@@ -252,6 +273,47 @@ test_tag (void)
     cut_assert_equal_uint(29, milter_reader_get_tag(reader));
 }
 
+static gboolean
+cb_decode (MilterDecoder *decoder, GError **error, gpointer user_data)
+{
+    n_decodes++;
+    return TRUE;
+}
+
+void
+test_socket_decoder (void)
+{
+    gint fds[2];
+    GIOChannel *socket_channel;
+    const gchar *packet;
+    gsize packet_size;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+        cut_assert_errno();
+    peer_fd = fds[1];
+    socket_channel = g_io_channel_unix_new(fds[0]);
+    g_io_channel_set_close_on_unref(socket_channel, TRUE);
+    cut_take(socket_channel, (CutDestroyFunction)g_io_channel_unref);
+
+    g_object_unref(reader);
+    reader = milter_reader_socket_io_channel_new(socket_channel);
+    decoder = milter_command_decoder_new();
+    g_signal_connect(decoder, "decode", G_CALLBACK(cb_decode), NULL);
+    milter_reader_set_decoder(reader, decoder, NULL, NULL);
+    signal_id = g_signal_connect(reader, "flow", G_CALLBACK(cb_flow), NULL);
+    milter_reader_start(reader, loop);
+
+    encoder = milter_command_encoder_new();
+    milter_command_encoder_encode_helo(MILTER_COMMAND_ENCODER(encoder),
+                                       &packet, &packet_size, "delian");
+    cut_assert_equal_int(packet_size, write(peer_fd, packet, packet_size));
+    milter_test_pump_all_events(loop);
+
+    cut_assert_equal_int(1, n_decodes);
+    cut_assert_equal_memory(packet, packet_size,
+                            actual_read_string->str, actual_read_size);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -43,6 +43,8 @@ void data_encode_delete_recipient (void);
 void test_encode_delete_recipient (gconstpointer data);
 void test_encode_replace_body (void);
 void test_encode_replace_body_large (void);
+void test_encode_replace_body_scattered (void);
+void test_encode_replace_body_scattered_empty (void);
 void test_encode_progress (void);
 void data_encode_quarantine (void);
 void test_encode_quarantine (gconstpointer data);
@@ -53,6 +55,7 @@ void test_encode_negotiate (void);
 
 static MilterReplyEncoder *encoder;
 static GString *expected;
+static GString *scattered;
 static MilterMacrosRequests *macros_requests;
 
 void
@@ -61,6 +64,7 @@ setup (void)
     encoder = MILTER_REPLY_ENCODER(milter_reply_encoder_new());
 
     expected = g_string_new(NULL);
+    scattered = g_string_new(NULL);
 
     macros_requests = NULL;
 }
@@ -75,6 +79,9 @@ teardown (void)
     if (expected)
         g_string_free(expected, TRUE);
 
+    if (scattered)
+        g_string_free(scattered, TRUE);
+
     if (macros_requests)
         g_object_unref(macros_requests);
 }
@@ -553,6 +560,50 @@ test_encode_replace_body_large (void)
     cut_assert_equal_uint(MILTER_CHUNK_SIZE, written_size);
 }
 
+void
+test_encode_replace_body_scattered (void)
+{
+    const gchar body[] =
+        "La de da de da 1.\n"
+        "La de da de da 2.\n"
+        "La de da de da 3.\n"
+        "La de da de da 4.";
+    gsize written_size = 0;
+    const gchar *header;
+    gsize header_size = 0;
+
+    g_string_append(expected, "b");
+    g_string_append(expected, body);
+    pack(expected);
+
+    milter_reply_encoder_encode_replace_body_scattered(encoder,
+                                                       &header, &header_size,
+                                                       body, sizeof(body) - 1,
+                                                       &written_size);
+    cut_assert_equal_uint(sizeof(body) - 1, written_size);
+
+    g_string_append_len(scattered, header, header_size);
+    g_string_append_len(scattered, body, written_size);
+    cut_assert_equal_memory(expected->str, expected->len,
+                            scattered->str, scattered->len);
+}
+
+void
+test_encode_replace_body_scattered_empty (void)
+{
+    gsize written_size = 1;
+    const gchar *header = "";
+    gsize header_size = 1;
+
+    milter_reply_encoder_encode_replace_body_scattered(encoder,
+                                                       &header, &header_size,
+                                                       "", 0,
+                                                       &written_size);
+    cut_assert_null(header);
+    cut_assert_equal_uint(0, header_size);
+    cut_assert_equal_uint(0, written_size);
+}
+
 void
 test_encode_progress (void)
 {
@@ -24,11 +24,17 @@
 #include <milter/core/milter-writer.h>
 #undef shutdown
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
 
 void test_writer (void);
 void test_writer_huge_data (void);
 void test_writer_error (void);
 void test_tag (void);
+void test_writev (void);
+void test_writev_huge_data (void);
+void test_writev_flushed (void);
 
 static MilterEventLoop *loop;
 
@@ -36,8 +42,13 @@ static MilterWriter *writer;
 
 static GIOChannel *channel;
 
+static GIOChannel *socket_channel;
+static gint peer_fd;
+static GString *received_data;
+
 static GError *expected_error;
 static GError *actual_error;
+static guint n_flushed;
 
 static void
 cb_error (MilterErrorEmittable *emittable, GError *error)
@@ -63,8 +74,13 @@ cut_setup (void)
     milter_writer_start(writer, loop);
     setup_error_callback();
 
+    socket_channel = NULL;
+    peer_fd = -1;
+    received_data = g_string_new(NULL);
+
     expected_error = NULL;
     actual_error = NULL;
+    n_flushed = 0;
 }
 
 void
@@ -76,6 +92,13 @@ cut_teardown (void)
     if (writer)
         g_object_unref(writer);
 
+    if (socket_channel)
+        g_io_channel_unref(socket_channel);
+    if (peer_fd != -1)
+        close(peer_fd);
+    if (received_data)
+        g_string_free(received_data, TRUE);
+
     if (loop)
         g_object_unref(loop);
 
@@ -205,6 +228,132 @@ test_tag (void)
     cut_assert_equal_uint(29, milter_writer_get_tag(writer));
 }
 
+static void
+setup_socket_writer (void)
+{
+    gint fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+        cut_assert_errno();
+    peer_fd = fds[1];
+    fcntl(peer_fd, F_SETFL, fcntl(peer_fd, F_GETFL) | O_NONBLOCK);
+
+    socket_channel = g_io_channel_unix_new(fds[0]);
+    g_io_channel_set_encoding(socket_channel, NULL, NULL);
+    g_io_channel_set_flags(socket_channel, G_IO_FLAG_NONBLOCK, NULL);
+    g_io_channel_set_close_on_unref(socket_channel, TRUE);
+
+    g_object_unref(writer);
+    writer = milter_writer_io_channel_new(socket_channel);
+    milter_writer_set_use_writev(writer, TRUE);
+    milter_writer_start(writer, loop);
+    setup_error_callback();
+}
+
+static void
+receive_data (gsize expected_size)
+{
+    while (received_data->len < expected_size) {
+        gchar buffer[4096];
+        gssize size;
+
+        milter_event_loop_iterate(loop, FALSE);
+        size = read(peer_fd, buffer, sizeof(buffer));
+        if (size == -1) {
+            if (errno == EAGAIN)
+                continue;
+            cut_assert_errno();
+        }
+        if (size == 0)
+            break;
+        g_string_append_len(received_data, buffer, size);
+    }
+    gcut_assert_error(actual_error);
+}
+
+void
+test_writev (void)
+{
+    const gchar first_chunk[] = "first\n";
+    const gchar second_chunk[] = "sec\0ond\n";
+    GError *error = NULL;
+
+    cut_trace(setup_socket_writer());
+    cut_assert_true(milter_writer_get_use_writev(writer));
+
+    milter_writer_write(writer, first_chunk, sizeof(first_chunk) - 1, &error);
+    gcut_assert_error(error);
+    milter_writer_write(writer, second_chunk, sizeof(second_chunk) - 1, &error);
+    gcut_assert_error(error);
+
+    milter_writer_flush(writer, &error);
+    gcut_assert_error(error);
+
+    cut_trace(receive_data(sizeof(first_chunk) - 1 +
+                           sizeof(second_chunk) - 1));
+    cut_assert_equal_memory("first\nsec\0ond\n",
+                            sizeof(first_chunk) - 1 + sizeof(second_chunk) - 1,
+                            received_data->str, received_data->len);
+}
+
+void
+test_writev_huge_data (void)
+{
+    gchar *binary_data;
+    gsize i, data_size;
+    GError *error = NULL;
+
+    cut_trace(setup_socket_writer());
+
+    data_size = 192 * 8192;
+    binary_data = g_new(gchar, data_size);
+    cut_take_memory(binary_data);
+    for (i = 0; i < data_size; i++) {
+        binary_data[i] = i % 251;
+    }
+
+    milter_writer_write(writer, binary_data, data_size / 2, &error);
+    gcut_assert_error(error);
+    milter_writer_write(writer, binary_data + data_size / 2,
+                        data_size - data_size / 2, &error);
+    gcut_assert_error(error);
+
+    milter_writer_flush(writer, &error);
+    gcut_assert_error(error);
+
+    cut_trace(receive_data(data_size));
+    cut_assert_equal_memory(binary_data, data_size,
+                            received_data->str, received_data->len);
+}
+
+static void
+cb_flushed (MilterWriter *writer, gpointer user_data)
+{
+    n_flushed++;
+}
+
+void
+test_writev_flushed (void)
+{
+    const gchar chunk[] = "chunk\n";
+    GError *error = NULL;
+
+    cut_trace(setup_socket_writer());
+    g_signal_connect(writer, "flushed", G_CALLBACK(cb_flushed), NULL);
+
+    milter_writer_write(writer, chunk, sizeof(chunk) - 1, &error);
+    gcut_assert_error(error);
+    milter_writer_flush(writer, &error);
+    gcut_assert_error(error);
+    cut_assert_equal_uint(0, n_flushed);
+
+    cut_trace(receive_data(sizeof(chunk) - 1));
+    while (n_flushed == 0) {
+        milter_event_loop_iterate(loop, TRUE);
+    }
+    cut_assert_equal_uint(1, n_flushed);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
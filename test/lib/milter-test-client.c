@@ -44,6 +44,8 @@ struct _MilterTestClientPrivate
 
     guint watch_id;
     guint server_watch_id;
+
+    guint n_accepted;
 };
 
 G_DEFINE_TYPE(MilterTestClient, milter_test_client, G_TYPE_OBJECT);
@@ -78,6 +80,8 @@ milter_test_client_init (MilterTestClient *client)
     priv->fd = -1;
     priv->channel = NULL;
     priv->watch_id = -1;
+
+    priv->n_accepted = 0;
 }
 
 static void
@@ -139,6 +143,7 @@ accept_server (MilterTestClient *client)
     priv = MILTER_TEST_CLIENT_GET_PRIVATE(client);
 
     priv->server_fd = accept(priv->fd, NULL, NULL);
+    priv->n_accepted++;
 
     priv->server_channel = g_io_channel_unix_new(priv->server_fd);
     g_io_channel_set_encoding(priv->server_channel, NULL, &error);
@@ -251,6 +256,12 @@ milter_test_client_write_with_error_check (MilterTestClient *client,
                                          data, data_size);
 }
 
+guint
+milter_test_client_get_n_accepted (MilterTestClient *client)
+{
+    return MILTER_TEST_CLIENT_GET_PRIVATE(client)->n_accepted;
+}
+
 /*
 vi:nowrap:ai:expandtab:sw=4
 */
@@ -63,6 +63,8 @@ void              milter_test_client_write_with_error_check
                                                 (MilterTestClient  *client,
                                                  const gchar       *data,
                                                  gsize              data_size);
+guint             milter_test_client_get_n_accepted
+                                                (MilterTestClient  *client);
 
 G_END_DECLS
 
@@ -112,6 +112,12 @@ class MilterTestClient
         @negotiate_flags += flag.split(/\|/)
       end
 
+      opts.on("--negotiate-actions=ACTION1|ACTION2|..",
+              "Restrict action flags of negotiate option") do |action|
+        @negotiate_actions ||= []
+        @negotiate_actions += action.split(/\|/)
+      end
+
       opts.on("--quarantine=REASON",
               "Send quarantine with REASON on end-of-message") do |reason|
         @end_of_message_actions << ["quarantine", reason]
@@ -278,6 +284,7 @@ class MilterTestClient
     @end_of_message_chunks = []
     @negotiate_version = nil
     @negotiate_flags = ["none"]
+    @negotiate_actions = nil
     @quit_without_reply_action = nil
   end
 
@@ -419,6 +426,9 @@ class MilterTestClient
     @option = option
     @option.version = @negotiate_version || @option.version
     @option.step &= resolve_flags(Milter::StepFlags, @negotiate_flags)
+    if @negotiate_actions
+      @option.action &= resolve_flags(Milter::ActionFlags, @negotiate_actions)
+    end
 
     write(:negotiated, :negotiate, @option)
   end
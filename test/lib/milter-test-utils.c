@@ -17,6 +17,10 @@
  *
  */
 
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
 #include <unistd.h>
 
 #include "milter-test-utils.h"
@@ -320,6 +324,10 @@ milter_test_event_loop_new (void)
     const gchar *env = g_getenv("MILTER_EVENT_LOOP_BACKEND");
     if (env && strcmp(env, "libev") == 0) {
         return milter_libev_event_loop_default();
+#ifdef HAVE_EPOLL_EVENT_LOOP
+    } else if (env && strcmp(env, "epoll") == 0) {
+        return milter_epoll_event_loop_default();
+#endif
     } else {
         return milter_glib_event_loop_new(NULL);
     }
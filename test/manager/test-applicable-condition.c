@@ -30,15 +30,26 @@ void test_name (void);
 void test_description (void);
 void test_data (void);
 void test_merge (void);
+void test_stopper (void);
+void test_stopper_not_stop (void);
+void test_reset_stopper_statistics (void);
 
 static MilterManagerApplicableCondition *condition;
 static MilterManagerApplicableCondition *merged_condition;
+static MilterManagerChild *attached_child;
+
+static gboolean stop;
+static gchar *actual_fqdn;
 
 void
 setup (void)
 {
     condition = NULL;
     merged_condition = NULL;
+    attached_child = NULL;
+
+    stop = TRUE;
+    actual_fqdn = NULL;
 }
 
 void
@@ -48,6 +59,11 @@ teardown (void)
         g_object_unref(condition);
     if (merged_condition)
         g_object_unref(merged_condition);
+    if (attached_child)
+        g_object_unref(attached_child);
+
+    if (actual_fqdn)
+        g_free(actual_fqdn);
 }
 
 void
@@ -162,6 +178,100 @@ test_merge (void)
         milter_manager_applicable_condition_get_data(merged_condition));
 }
 
+static gboolean
+stop_on_helo (MilterManagerApplicableCondition *condition,
+              MilterManagerApplicableConditionStage stage,
+              MilterManagerChild *child,
+              MilterManagerChildren *children,
+              MilterClientContext *context,
+              guint n_arguments,
+              const GValue *arguments,
+              gpointer user_data)
+{
+    cut_assert_equal_uint(1, n_arguments);
+    actual_fqdn = g_value_dup_string(&arguments[0]);
+    return stop;
+}
+
+static gboolean
+emit_stop_on_helo (const gchar *fqdn)
+{
+    gboolean stopped = FALSE;
+
+    g_signal_emit_by_name(attached_child, "stop-on-helo", fqdn, &stopped);
+    return stopped;
+}
+
+static void
+setup_helo_stopper (void)
+{
+    condition = milter_manager_applicable_condition_new("Trust");
+    milter_manager_applicable_condition_set_stopper(
+        condition,
+        MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_HELO,
+        stop_on_helo, NULL, NULL);
+
+    attached_child = milter_manager_child_new("milter@10025");
+    milter_manager_applicable_condition_attach_to(condition, attached_child,
+                                                  NULL, NULL);
+}
+
+void
+test_stopper (void)
+{
+    cut_trace(setup_helo_stopper());
+    cut_assert_true(milter_manager_applicable_condition_has_stopper(
+                        condition,
+                        MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_HELO));
+    cut_assert_false(milter_manager_applicable_condition_has_stopper(
+                         condition,
+                         MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_CONNECT));
+
+    cut_assert_true(emit_stop_on_helo("mx.example.com"));
+    cut_assert_equal_string("mx.example.com", actual_fqdn);
+    cut_assert_equal_uint(
+        1,
+        milter_manager_applicable_condition_get_n_stopper_calls(
+            condition, MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_HELO));
+    cut_assert_equal_uint(
+        0,
+        milter_manager_applicable_condition_get_n_stopper_calls(
+            condition, MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_CONNECT));
+}
+
+void
+test_stopper_not_stop (void)
+{
+    stop = FALSE;
+    cut_trace(setup_helo_stopper());
+
+    cut_assert_false(emit_stop_on_helo("mx.example.com"));
+    cut_assert_equal_string("mx.example.com", actual_fqdn);
+}
+
+void
+test_reset_stopper_statistics (void)
+{
+    cut_trace(setup_helo_stopper());
+
+    emit_stop_on_helo("mx.example.com");
+    emit_stop_on_helo("mx.example.com");
+    cut_assert_equal_uint(
+        2,
+        milter_manager_applicable_condition_get_n_stopper_calls(
+            condition, MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_HELO));
+
+    milter_manager_applicable_condition_reset_stopper_statistics(condition);
+    cut_assert_equal_uint(
+        0,
+        milter_manager_applicable_condition_get_n_stopper_calls(
+            condition, MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_HELO));
+    cut_assert_equal_double(
+        0.0, 0.0,
+        milter_manager_applicable_condition_get_stopper_elapsed(
+            condition, MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_HELO));
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -0,0 +1,175 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include <milter/manager/milter-manager-body-spool.h>
+
+#include <gcutter.h>
+
+void test_new (void);
+void test_append (void);
+void test_append_empty (void);
+void test_grow (void);
+void test_memory_to_file (void);
+void test_extent_size (void);
+
+static MilterManagerBodySpool *spool;
+static GError *actual_error;
+
+void
+cut_setup (void)
+{
+    spool = milter_manager_body_spool_new();
+    actual_error = NULL;
+}
+
+void
+cut_teardown (void)
+{
+    if (spool)
+        g_object_unref(spool);
+    if (actual_error)
+        g_error_free(actual_error);
+}
+
+void
+test_new (void)
+{
+    cut_assert_equal_size(0, milter_manager_body_spool_get_size(spool));
+    cut_assert_equal_size(0, milter_manager_body_spool_get_capacity(spool));
+    cut_assert_null(milter_manager_body_spool_get_data(spool));
+}
+
+void
+test_append (void)
+{
+    milter_manager_body_spool_append(spool, "Hello ", 6, &actual_error);
+    gcut_assert_error(actual_error);
+    milter_manager_body_spool_append(spool, "World", 5, &actual_error);
+    gcut_assert_error(actual_error);
+
+    cut_assert_equal_size(11, milter_manager_body_spool_get_size(spool));
+    cut_assert_operator_uint(milter_manager_body_spool_get_capacity(spool),
+                             <=,
+                             MILTER_MANAGER_BODY_SPOOL_MEMORY_SIZE);
+    cut_assert_equal_memory("Hello World", 11,
+                            milter_manager_body_spool_get_data(spool),
+                            milter_manager_body_spool_get_size(spool));
+}
+
+void
+test_append_empty (void)
+{
+    cut_assert_true(milter_manager_body_spool_append(spool, NULL, 0,
+                                                     &actual_error));
+    gcut_assert_error(actual_error);
+    cut_assert_equal_size(0, milter_manager_body_spool_get_capacity(spool));
+}
+
+void
+test_grow (void)
+{
+    gchar *chunk;
+    gsize chunk_size;
+    const gchar *data;
+
+    chunk_size = MILTER_MANAGER_BODY_SPOOL_EXTENT_SIZE - 1;
+    chunk = g_malloc(chunk_size);
+    cut_take_memory(chunk);
+
+    memset(chunk, 'a', chunk_size);
+    milter_manager_body_spool_append(spool, chunk, chunk_size, &actual_error);
+    gcut_assert_error(actual_error);
+    memset(chunk, 'b', chunk_size);
+    milter_manager_body_spool_append(spool, chunk, chunk_size, &actual_error);
+    gcut_assert_error(actual_error);
+
+    cut_assert_equal_size(chunk_size * 2,
+                          milter_manager_body_spool_get_size(spool));
+    cut_assert_equal_size(MILTER_MANAGER_BODY_SPOOL_EXTENT_SIZE * 2,
+                          milter_manager_body_spool_get_capacity(spool));
+
+    data = milter_manager_body_spool_get_data(spool);
+    cut_assert_equal_int('a', data[0]);
+    cut_assert_equal_int('a', data[chunk_size - 1]);
+    cut_assert_equal_int('b', data[chunk_size]);
+    cut_assert_equal_int('b', data[chunk_size * 2 - 1]);
+}
+
+void
+test_memory_to_file (void)
+{
+    gchar *chunk;
+    gsize chunk_size;
+    const gchar *data;
+
+    chunk_size = MILTER_MANAGER_BODY_SPOOL_MEMORY_SIZE - 1;
+    chunk = g_malloc(chunk_size);
+    cut_take_memory(chunk);
+
+    memset(chunk, 'a', chunk_size);
+    milter_manager_body_spool_append(spool, chunk, chunk_size, &actual_error);
+    gcut_assert_error(actual_error);
+    cut_assert_equal_size(MILTER_MANAGER_BODY_SPOOL_MEMORY_SIZE,
+                          milter_manager_body_spool_get_capacity(spool));
+
+    milter_manager_body_spool_append(spool, "b", 1, &actual_error);
+    gcut_assert_error(actual_error);
+    cut_assert_equal_size(chunk_size + 1,
+                          milter_manager_body_spool_get_size(spool));
+    cut_assert_equal_size(MILTER_MANAGER_BODY_SPOOL_EXTENT_SIZE,
+                          milter_manager_body_spool_get_capacity(spool));
+
+    data = milter_manager_body_spool_get_data(spool);
+    cut_assert_equal_int('a', data[0]);
+    cut_assert_equal_int('a', data[chunk_size - 1]);
+    cut_assert_equal_int('b', data[chunk_size]);
+    cut_assert_equal_int('\0', data[chunk_size + 1]);
+}
+
+void
+test_extent_size (void)
+{
+    gchar *chunk;
+    gsize chunk_size;
+    const gchar *data;
+
+    chunk_size = MILTER_MANAGER_BODY_SPOOL_EXTENT_SIZE;
+    chunk = g_malloc(chunk_size);
+    cut_take_memory(chunk);
+
+    memset(chunk, 'a', chunk_size);
+    milter_manager_body_spool_append(spool, chunk, chunk_size, &actual_error);
+    gcut_assert_error(actual_error);
+
+    cut_assert_equal_size(chunk_size,
+                          milter_manager_body_spool_get_size(spool));
+    cut_assert_equal_size(MILTER_MANAGER_BODY_SPOOL_EXTENT_SIZE * 2,
+                          milter_manager_body_spool_get_capacity(spool));
+
+    data = milter_manager_body_spool_get_data(spool);
+    cut_assert_equal_int('a', data[chunk_size - 1]);
+    cut_assert_equal_int('\0', data[chunk_size]);
+    cut_assert_equal_size(chunk_size, strlen(data));
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
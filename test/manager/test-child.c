@@ -31,6 +31,7 @@ void test_get_command_line_string (void);
 void test_get_user_name (void);
 void test_get_fallback_status (void);
 void test_evaluation_mode (void);
+void test_parallel (void);
 
 static MilterManagerChild *milter;
 
@@ -95,6 +96,14 @@ test_evaluation_mode (void)
     cut_assert_true(milter_manager_child_is_evaluation_mode(milter));
 }
 
+void
+test_parallel (void)
+{
+    cut_assert_false(milter_manager_child_is_parallel(milter));
+    milter_manager_child_set_parallel(milter, TRUE);
+    cut_assert_true(milter_manager_child_is_parallel(milter));
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -72,6 +72,8 @@ void test_connection_timeout (void);
 void test_end_of_message_timeout (void);
 void test_writing_timeout (void);
 void test_end_of_message_with_protocol_version2 (void);
+void test_reuse (void);
+void test_connection_pool_reuse (void);
 
 static gchar *scenario_dir;
 static MilterManagerTestScenario *main_scenario;
@@ -132,6 +134,13 @@ static struct sockaddr *actual_address;
 static MilterLogLevelFlags original_log_level;
 static gboolean default_handler_disconnected;
 
+static MilterTestClient *pooled_client;
+static MilterDecoder *pooled_client_decoder;
+static MilterEncoder *pooled_client_encoder;
+static guint n_pooled_client_negotiates;
+static guint n_pooled_client_connects;
+static guint n_pooled_client_quit_new_connections;
+
 #define collect_n_received(event)                                       \
     milter_manager_test_clients_collect_n_received(                     \
         test_clients,                                                   \
@@ -428,6 +437,13 @@ cut_setup (void)
 
     original_log_level = milter_get_log_level();
     default_handler_disconnected = FALSE;
+
+    pooled_client = NULL;
+    pooled_client_decoder = NULL;
+    pooled_client_encoder = NULL;
+    n_pooled_client_negotiates = 0;
+    n_pooled_client_connects = 0;
+    n_pooled_client_quit_new_connections = 0;
 }
 
 static void
@@ -516,6 +532,13 @@ cut_teardown (void)
     if (actual_address)
         g_free(actual_address);
 
+    if (pooled_client)
+        g_object_unref(pooled_client);
+    if (pooled_client_decoder)
+        g_object_unref(pooled_client_decoder);
+    if (pooled_client_encoder)
+        g_object_unref(pooled_client_encoder);
+
     if (loop)
         g_object_unref(loop);
 }
@@ -2112,6 +2135,180 @@ test_end_of_message_with_protocol_version2 (void)
     cut_assert_equal_uint(1, collect_n_received(data));
 }
 
+void
+test_reuse (void)
+{
+    MilterManagerConfiguration *new_config;
+    MilterEventLoop *new_loop, *actual_loop = NULL;
+
+    new_config = milter_manager_configuration_new(NULL);
+    gcut_take_object(G_OBJECT(new_config));
+    new_loop = milter_test_event_loop_new();
+    gcut_take_object(G_OBJECT(new_loop));
+
+    milter_manager_children_reset(children);
+    gcut_assert_equal_object(NULL,
+                             milter_manager_children_get_configuration(children));
+
+    milter_manager_children_reuse(children, new_config, new_loop);
+    gcut_assert_equal_object(new_config,
+                             milter_manager_children_get_configuration(children));
+    g_object_get(children, "event-loop", &actual_loop, NULL);
+    gcut_take_object(G_OBJECT(actual_loop));
+    gcut_assert_equal_object(new_loop, actual_loop);
+}
+
+static void
+cb_pooled_client_negotiate (MilterDecoder *decoder, MilterOption *option,
+                            gpointer user_data)
+{
+    const gchar *packet;
+    gsize packet_size;
+
+    n_pooled_client_negotiates++;
+    milter_reply_encoder_encode_negotiate(
+        MILTER_REPLY_ENCODER(pooled_client_encoder),
+        &packet, &packet_size, option, NULL);
+    milter_test_client_write(pooled_client, packet, packet_size);
+}
+
+static void
+cb_pooled_client_connect (MilterDecoder *decoder, const gchar *host_name,
+                          struct sockaddr *address, socklen_t address_length,
+                          gpointer user_data)
+{
+    const gchar *packet;
+    gsize packet_size;
+
+    n_pooled_client_connects++;
+    milter_reply_encoder_encode_continue(
+        MILTER_REPLY_ENCODER(pooled_client_encoder),
+        &packet, &packet_size);
+    milter_test_client_write(pooled_client, packet, packet_size);
+}
+
+static void
+cb_pooled_client_quit_new_connection (MilterDecoder *decoder,
+                                      gpointer user_data)
+{
+    n_pooled_client_quit_new_connections++;
+}
+
+static void
+start_pooled_client (const gchar *spec)
+{
+    pooled_client_decoder = milter_command_decoder_new();
+    g_signal_connect(pooled_client_decoder, "negotiate",
+                     G_CALLBACK(cb_pooled_client_negotiate), NULL);
+    g_signal_connect(pooled_client_decoder, "connect",
+                     G_CALLBACK(cb_pooled_client_connect), NULL);
+    g_signal_connect(pooled_client_decoder, "quit-new-connection",
+                     G_CALLBACK(cb_pooled_client_quit_new_connection), NULL);
+    pooled_client_encoder = milter_reply_encoder_new();
+    cut_trace(pooled_client = milter_test_client_new(spec,
+                                                     pooled_client_decoder,
+                                                     loop));
+}
+
+#define wait_pooled_client(expected, actual)                    \
+    cut_trace_with_info_expression(                             \
+        wait_pooled_client_helper(expected, &actual),           \
+        wait_pooled_client(expected, actual))
+
+static void
+wait_pooled_client_helper (guint expected, guint *actual)
+{
+    gboolean timeout_waiting = TRUE;
+    guint timeout_waiting_id;
+
+    timeout_waiting_id = milter_event_loop_add_timeout(loop, 0.5,
+                                                       cb_timeout_waiting,
+                                                       &timeout_waiting);
+    while (timeout_waiting && expected > *actual) {
+        milter_event_loop_iterate(loop, TRUE);
+    }
+    milter_event_loop_remove(loop, timeout_waiting_id);
+
+    cut_assert_equal_uint(expected, *actual);
+}
+
+#define wait_idle_connection(pool)                      \
+    cut_trace_with_info_expression(                     \
+        wait_idle_connection_helper(pool),              \
+        wait_idle_connection(pool))
+
+static void
+wait_idle_connection_helper (MilterManagerConnectionPool *pool)
+{
+    gboolean timeout_waiting = TRUE;
+    guint timeout_waiting_id;
+
+    timeout_waiting_id = milter_event_loop_add_timeout(loop, 0.5,
+                                                       cb_timeout_waiting,
+                                                       &timeout_waiting);
+    while (timeout_waiting &&
+           milter_manager_connection_pool_get_n_idle_connections(pool) == 0) {
+        milter_event_loop_iterate(loop, TRUE);
+    }
+    milter_event_loop_remove(loop, timeout_waiting_id);
+
+    cut_assert_equal_uint(
+        1, milter_manager_connection_pool_get_n_idle_connections(pool));
+}
+
+void
+test_connection_pool_reuse (void)
+{
+    const gchar spec[] = "inet:9999@127.0.0.1";
+    MilterManagerEgg *egg;
+    MilterManagerChild *child;
+    MilterManagerConnectionPool *pool;
+    struct sockaddr_in address;
+
+    cut_trace(start_pooled_client(spec));
+
+    egg = egg_new("milter@9999", spec);
+    cut_assert_not_null(egg);
+    gcut_take_object(G_OBJECT(egg));
+    milter_manager_egg_set_connection_pool_size(egg, 1);
+    milter_manager_configuration_add_egg(config, egg);
+    pool = milter_manager_egg_get_connection_pool(egg);
+
+    option = milter_option_new(6, MILTER_ACTION_ADD_HEADERS, MILTER_STEP_NONE);
+    child = milter_manager_egg_hatch(egg);
+    milter_manager_children_add_child(children, child);
+    g_object_unref(child);
+    milter_manager_children_negotiate(children, option, NULL);
+    wait_reply(1, n_negotiate_reply_emitted);
+
+    milter_manager_children_quit(children);
+    wait_pooled_client(1, n_pooled_client_quit_new_connections);
+    wait_idle_connection(pool);
+
+    g_object_unref(children);
+    children = milter_manager_children_new(config, loop);
+    setup_signals(children);
+    clear_n_emitted();
+
+    child = milter_manager_egg_hatch(egg);
+    milter_manager_children_add_child(children, child);
+    g_object_unref(child);
+    milter_manager_children_negotiate(children, option, NULL);
+    wait_reply(1, n_negotiate_reply_emitted);
+    cut_assert_equal_uint(1, milter_manager_connection_pool_get_n_hits(pool));
+
+    address.sin_family = AF_INET;
+    address.sin_port = g_htons(50443);
+    inet_pton(AF_INET, "192.168.123.123", &(address.sin_addr));
+    milter_manager_children_connect(children, "mx.example.net",
+                                    (struct sockaddr *)&address,
+                                    sizeof(address));
+    wait_pooled_client(1, n_pooled_client_connects);
+
+    cut_assert_equal_uint(1, n_pooled_client_negotiates);
+    cut_assert_equal_uint(1, milter_test_client_get_n_accepted(pooled_client));
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -0,0 +1,241 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <milter/manager/milter-manager-cidr-table.h>
+
+#include <gcutter.h>
+
+void test_empty (void);
+void test_exact_match_ipv4 (void);
+void test_network_match_ipv4 (void);
+void test_first_match_wins (void);
+void test_all_match_ipv4 (void);
+void test_network_match_ipv6 (void);
+void test_family (void);
+void test_lookup_address (void);
+void test_invalid_address (void);
+void test_invalid_prefix_length (void);
+void test_invalid_prefix_length_sign (void);
+void test_invalid_value_destroy (void);
+void test_clear (void);
+
+static MilterManagerCIDRTable *table;
+static GError *actual_error;
+
+void
+cut_setup (void)
+{
+    table = milter_manager_cidr_table_new(NULL);
+    actual_error = NULL;
+}
+
+void
+cut_teardown (void)
+{
+    if (table)
+        milter_manager_cidr_table_free(table);
+    if (actual_error)
+        g_error_free(actual_error);
+}
+
+static void
+add (const gchar *network, const gchar *value)
+{
+    milter_manager_cidr_table_add(table, network, (gpointer)value,
+                                  &actual_error);
+    gcut_assert_error(actual_error);
+}
+
+void
+test_empty (void)
+{
+    cut_assert_null(milter_manager_cidr_table_lookup(table, "127.0.0.1"));
+    cut_assert_equal_uint(0, milter_manager_cidr_table_get_size(table));
+}
+
+void
+test_exact_match_ipv4 (void)
+{
+    cut_trace(add("192.168.1.1", "OK"));
+    cut_trace(add("192.168.1.0/24", "REJECT"));
+
+    cut_assert_equal_string("OK",
+                            milter_manager_cidr_table_lookup(table,
+                                                             "192.168.1.1"));
+    cut_assert_equal_uint(2, milter_manager_cidr_table_get_size(table));
+}
+
+void
+test_network_match_ipv4 (void)
+{
+    cut_trace(add("192.168.1.1", "OK"));
+    cut_trace(add("192.168.1.0/24", "REJECT"));
+
+    cut_assert_equal_string("REJECT",
+                            milter_manager_cidr_table_lookup(table,
+                                                             "192.168.1.29"));
+    cut_assert_null(milter_manager_cidr_table_lookup(table, "192.168.2.1"));
+}
+
+void
+test_first_match_wins (void)
+{
+    cut_trace(add("192.168.1.0/24", "REJECT"));
+    cut_trace(add("192.168.1.1", "OK"));
+    cut_trace(add("192.168.1.0/24", "DUPLICATED"));
+
+    cut_assert_equal_string("REJECT",
+                            milter_manager_cidr_table_lookup(table,
+                                                             "192.168.1.1"));
+    cut_assert_equal_uint(2, milter_manager_cidr_table_get_size(table));
+}
+
+void
+test_all_match_ipv4 (void)
+{
+    cut_trace(add("0.0.0.0/0", "OK"));
+    cut_trace(add("192.168.1.1", "REJECT"));
+
+    cut_assert_equal_string("OK",
+                            milter_manager_cidr_table_lookup(table,
+                                                             "192.168.1.1"));
+}
+
+void
+test_network_match_ipv6 (void)
+{
+    cut_trace(add("2001:2f8:c2:201::fff0", "OK"));
+    cut_trace(add("2001:2f8:c2:201::0/64", "REJECT"));
+
+    cut_assert_equal_string("OK",
+                            milter_manager_cidr_table_lookup(
+                                table, "2001:2f8:c2:201::fff0"));
+    cut_assert_equal_string("REJECT",
+                            milter_manager_cidr_table_lookup(
+                                table, "2001:2f8:c2:201::1"));
+    cut_assert_null(milter_manager_cidr_table_lookup(table,
+                                                     "2001:2f8:c2:202::1"));
+}
+
+void
+test_family (void)
+{
+    cut_trace(add("0.0.0.0/0", "IPv4"));
+
+    cut_assert_null(milter_manager_cidr_table_lookup(table, "::1"));
+}
+
+void
+test_lookup_address (void)
+{
+    struct sockaddr_in address;
+
+    cut_trace(add("160.29.167.0/24", "local"));
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    inet_pton(AF_INET, "160.29.167.10", &(address.sin_addr));
+    cut_assert_equal_string("local",
+                            milter_manager_cidr_table_lookup_address(
+                                table, (struct sockaddr *)&address));
+
+    inet_pton(AF_INET, "160.29.168.10", &(address.sin_addr));
+    cut_assert_null(milter_manager_cidr_table_lookup_address(
+                        table, (struct sockaddr *)&address));
+}
+
+void
+test_invalid_address (void)
+{
+    GError *expected_error;
+
+    cut_assert_false(milter_manager_cidr_table_add(table, "192.168.1", "OK",
+                                                   &actual_error));
+    expected_error = g_error_new(MILTER_MANAGER_CIDR_TABLE_ERROR,
+                                 MILTER_MANAGER_CIDR_TABLE_ERROR_INVALID_ADDRESS,
+                                 "invalid address: <192.168.1>");
+    gcut_take_error(expected_error);
+    gcut_assert_equal_error(expected_error, actual_error);
+    cut_assert_equal_uint(0, milter_manager_cidr_table_get_size(table));
+}
+
+void
+test_invalid_prefix_length (void)
+{
+    GError *expected_error;
+
+    cut_assert_false(milter_manager_cidr_table_add(table, "192.168.1.0/33",
+                                                   "OK", &actual_error));
+    expected_error =
+        g_error_new(MILTER_MANAGER_CIDR_TABLE_ERROR,
+                    MILTER_MANAGER_CIDR_TABLE_ERROR_INVALID_PREFIX_LENGTH,
+                    "invalid prefix length: <192.168.1.0/33>");
+    gcut_take_error(expected_error);
+    gcut_assert_equal_error(expected_error, actual_error);
+}
+
+void
+test_invalid_prefix_length_sign (void)
+{
+    GError *expected_error;
+
+    cut_assert_false(milter_manager_cidr_table_add(table, "192.168.1.0/+8",
+                                                   "OK", &actual_error));
+    expected_error =
+        g_error_new(MILTER_MANAGER_CIDR_TABLE_ERROR,
+                    MILTER_MANAGER_CIDR_TABLE_ERROR_INVALID_PREFIX_LENGTH,
+                    "invalid prefix length: <192.168.1.0/+8>");
+    gcut_take_error(expected_error);
+    gcut_assert_equal_error(expected_error, actual_error);
+    cut_assert_equal_uint(0, milter_manager_cidr_table_get_size(table));
+}
+
+void
+test_invalid_value_destroy (void)
+{
+    milter_manager_cidr_table_free(table);
+    table = milter_manager_cidr_table_new(g_free);
+
+    cut_assert_false(milter_manager_cidr_table_add(table, "192.168.1",
+                                                   g_strdup("OK"),
+                                                   &actual_error));
+    g_clear_error(&actual_error);
+    cut_assert_false(milter_manager_cidr_table_add(table, "192.168.1.0/ 8",
+                                                   g_strdup("OK"),
+                                                   &actual_error));
+    cut_assert_equal_uint(0, milter_manager_cidr_table_get_size(table));
+}
+
+void
+test_clear (void)
+{
+    cut_trace(add("192.168.1.0/24", "REJECT"));
+
+    milter_manager_cidr_table_clear(table);
+    cut_assert_null(milter_manager_cidr_table_lookup(table, "192.168.1.1"));
+    cut_assert_equal_uint(0, milter_manager_cidr_table_get_size(table));
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
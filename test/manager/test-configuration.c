@@ -54,6 +54,7 @@ void test_event_loop_backend (void);
 void test_connection_check_interval (void);
 void test_location (void);
 void test_n_workers (void);
+void test_n_threads (void);
 void test_default_packet_buffer_size (void);
 void test_prefix (void);
 void test_use_syslog (void);
@@ -61,6 +62,8 @@ void test_syslog_facility (void);
 void test_chunk_size (void);
 void test_chunk_size_over (void);
 void test_max_pending_finished_sessions (void);
+void test_max_pooled_sessions (void);
+void test_result_stream_spec (void);
 void test_egg (void);
 void test_find_egg (void);
 void test_remove_egg (void);
@@ -73,6 +76,10 @@ void test_load_absolute_path (void);
 void test_save_custom (void);
 void test_to_xml_full (void);
 void test_to_xml_signal (void);
+void test_snapshot (void);
+void test_check_multi_thread (void);
+void test_check_multi_thread_connection_check_interval (void);
+void test_check_multi_thread_applicable_condition (void);
 
 static MilterManagerConfiguration *config;
 static MilterEventLoop *loop;
@@ -567,6 +574,18 @@ test_n_workers (void)
         milter_manager_configuration_get_n_workers(config));
 }
 
+void
+test_n_threads (void)
+{
+    cut_assert_equal_uint(
+        0,
+        milter_manager_configuration_get_n_threads(config));
+    milter_manager_configuration_set_n_threads(config, 4);
+    cut_assert_equal_uint(
+        4,
+        milter_manager_configuration_get_n_threads(config));
+}
+
 void
 test_default_packet_buffer_size (void)
 {
@@ -643,6 +662,32 @@ test_max_pending_finished_sessions (void)
         milter_manager_configuration_get_max_pending_finished_sessions(config));
 }
 
+void
+test_max_pooled_sessions (void)
+{
+    cut_assert_equal_uint(
+        0,
+        milter_manager_configuration_get_max_pooled_sessions(config));
+    milter_manager_configuration_set_max_pooled_sessions(config, 29);
+    cut_assert_equal_uint(
+        29,
+        milter_manager_configuration_get_max_pooled_sessions(config));
+}
+
+void
+test_result_stream_spec (void)
+{
+    const gchar spec[] = "unix:/tmp/milter-manager-results.sock";
+
+    cut_assert_equal_string(
+        NULL,
+        milter_manager_configuration_get_result_stream_spec(config));
+    milter_manager_configuration_set_result_stream_spec(config, spec);
+    cut_assert_equal_string(
+        spec,
+        milter_manager_configuration_get_result_stream_spec(config));
+}
+
 static void
 milter_assert_default_configuration_helper (MilterManagerConfiguration *config)
 {
@@ -722,6 +767,9 @@ milter_assert_default_configuration_helper (MilterManagerConfiguration *config)
     cut_assert_equal_uint(
         0,
         milter_manager_configuration_get_n_workers(config));
+    cut_assert_equal_uint(
+        0,
+        milter_manager_configuration_get_n_threads(config));
 
     cut_assert_equal_uint(
         0,
@@ -742,6 +790,14 @@ milter_assert_default_configuration_helper (MilterManagerConfiguration *config)
         0,
         milter_manager_configuration_get_max_pending_finished_sessions(config));
 
+    cut_assert_equal_uint(
+        0,
+        milter_manager_configuration_get_max_pooled_sessions(config));
+
+    cut_assert_equal_string(
+        NULL,
+        milter_manager_configuration_get_result_stream_spec(config));
+
     if (expected_children)
         g_object_unref(expected_children);
     expected_children = milter_manager_children_new(config, loop);
@@ -961,11 +1017,14 @@ test_clear (void)
     test_event_loop_backend();
     test_connection_check_interval();
     test_n_workers();
+    test_n_threads();
     test_default_packet_buffer_size();
     test_use_syslog();
     test_syslog_facility();
     test_chunk_size();
     test_max_pending_finished_sessions();
+    test_max_pooled_sessions();
+    test_result_stream_spec();
 
     handler_id = g_signal_connect(config, "connected",
                                   G_CALLBACK(cb_connected), NULL);
@@ -1186,6 +1245,107 @@ test_location (void)
     milter_assert_equal_location_keys(NULL);
 }
 
+void
+test_snapshot (void)
+{
+    MilterManagerConfiguration *snapshot;
+    GError *error = NULL;
+
+    milter_manager_configuration_set_fallback_status(config,
+                                                     MILTER_STATUS_REJECT);
+    milter_manager_configuration_set_chunk_size(config, 29);
+    egg = milter_manager_egg_new("child-milter");
+    milter_manager_egg_set_connection_spec(egg, "inet:2929@localhost", &error);
+    gcut_assert_error(error);
+    milter_manager_configuration_add_egg(config, egg);
+
+    snapshot = milter_manager_configuration_snapshot(config);
+    gcut_take_object(G_OBJECT(snapshot));
+    cut_assert_equal_string("MilterManagerConfiguration",
+                            G_OBJECT_TYPE_NAME(snapshot));
+    gcut_assert_equal_enum(
+        MILTER_TYPE_STATUS,
+        MILTER_STATUS_REJECT,
+        milter_manager_configuration_get_fallback_status(snapshot));
+    cut_assert_equal_uint(
+        29,
+        milter_manager_configuration_get_chunk_size(snapshot));
+
+    milter_manager_configuration_clear_eggs(config);
+    expected_eggs = g_list_append(expected_eggs, egg);
+    gcut_assert_equal_list_object(
+        expected_eggs,
+        milter_manager_configuration_get_eggs(snapshot));
+}
+
+void
+test_check_multi_thread (void)
+{
+    GError *error = NULL;
+
+    milter_manager_configuration_check_multi_thread(config, &error);
+    gcut_assert_error(error);
+}
+
+void
+test_check_multi_thread_connection_check_interval (void)
+{
+    GError *expected_error, *actual_error = NULL;
+
+    milter_manager_configuration_set_connection_check_interval(config, 5);
+    expected_error = g_error_new(MILTER_MANAGER_CONFIGURATION_ERROR,
+                                 MILTER_MANAGER_CONFIGURATION_ERROR_MULTI_THREAD,
+                                 "manager.connection_check_interval "
+                                 "can't be used in multi thread mode: <5>");
+    gcut_take_error(expected_error);
+
+    milter_manager_configuration_check_multi_thread(config, &actual_error);
+    gcut_take_error(actual_error);
+    gcut_assert_equal_error(expected_error, actual_error);
+}
+
+static gboolean
+cb_stop (MilterManagerApplicableCondition *condition,
+         MilterManagerApplicableConditionStage stage,
+         MilterManagerChild *child,
+         MilterManagerChildren *children,
+         MilterClientContext *context,
+         guint n_arguments,
+         const GValue *arguments,
+         gpointer user_data)
+{
+    return FALSE;
+}
+
+void
+test_check_multi_thread_applicable_condition (void)
+{
+    GError *expected_error, *actual_error = NULL;
+
+    condition = milter_manager_applicable_condition_new("S25R");
+    egg = milter_manager_egg_new("child-milter");
+    milter_manager_egg_add_applicable_condition(egg, condition);
+    milter_manager_configuration_add_egg(config, egg);
+
+    milter_manager_configuration_check_multi_thread(config, &actual_error);
+    gcut_assert_error(actual_error);
+
+    milter_manager_applicable_condition_set_stopper(
+        condition,
+        MILTER_MANAGER_APPLICABLE_CONDITION_STAGE_CONNECT,
+        cb_stop, NULL, NULL);
+    expected_error = g_error_new(MILTER_MANAGER_CONFIGURATION_ERROR,
+                                 MILTER_MANAGER_CONFIGURATION_ERROR_MULTI_THREAD,
+                                 "applicable condition <S25R> of milter "
+                                 "<child-milter> "
+                                 "can't be used in multi thread mode");
+    gcut_take_error(expected_error);
+
+    milter_manager_configuration_check_multi_thread(config, &actual_error);
+    gcut_take_error(actual_error);
+    gcut_assert_equal_error(expected_error, actual_error);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
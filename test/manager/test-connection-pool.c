@@ -0,0 +1,301 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <milter-test-utils.h>
+#include <milter/manager/milter-manager-connection-pool.h>
+#include <milter/core/milter-glib-compatible.h>
+
+#include <gcutter.h>
+
+void test_new (void);
+void test_push_pop (void);
+void test_pop_empty (void);
+void test_pop_option_mismatch (void);
+void test_push_disabled (void);
+void test_push_full (void);
+void test_shrink (void);
+void test_clear (void);
+void test_expire_on_close (void);
+void test_clear_on_other_thread (void);
+
+static MilterManagerConnectionPool *pool;
+static MilterEventLoop *loop;
+static MilterOption *option;
+static MilterOption *reply_option;
+static GIOChannel *channel;
+static gint peer_fd;
+
+static GIOChannel *actual_channel;
+static MilterOption *actual_reply_option;
+static MilterMacrosRequests *actual_macros_requests;
+
+void
+cut_setup (void)
+{
+    pool = milter_manager_connection_pool_new();
+    loop = milter_test_event_loop_new();
+    option = milter_option_new(6,
+                               MILTER_ACTION_ADD_HEADERS,
+                               MILTER_STEP_NO_CONNECT);
+    reply_option = milter_option_new(6,
+                                     MILTER_ACTION_ADD_HEADERS,
+                                     MILTER_STEP_NO_CONNECT);
+    channel = NULL;
+    peer_fd = -1;
+
+    actual_channel = NULL;
+    actual_reply_option = NULL;
+    actual_macros_requests = NULL;
+}
+
+void
+cut_teardown (void)
+{
+    if (pool)
+        g_object_unref(pool);
+    if (loop)
+        g_object_unref(loop);
+    if (option)
+        g_object_unref(option);
+    if (reply_option)
+        g_object_unref(reply_option);
+    if (channel)
+        g_io_channel_unref(channel);
+    if (peer_fd != -1)
+        close(peer_fd);
+
+    if (actual_channel)
+        g_io_channel_unref(actual_channel);
+    if (actual_reply_option)
+        g_object_unref(actual_reply_option);
+    if (actual_macros_requests)
+        g_object_unref(actual_macros_requests);
+}
+
+static void
+setup_channel (void)
+{
+    gint fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+        cut_assert_errno();
+    peer_fd = fds[1];
+
+    channel = g_io_channel_unix_new(fds[0]);
+    g_io_channel_set_encoding(channel, NULL, NULL);
+    g_io_channel_set_close_on_unref(channel, TRUE);
+}
+
+static gboolean
+pop (MilterOption *pop_option)
+{
+    return milter_manager_connection_pool_pop(pool, loop, pop_option,
+                                              &actual_channel,
+                                              &actual_reply_option,
+                                              &actual_macros_requests);
+}
+
+void
+test_new (void)
+{
+    cut_assert_equal_uint(0, milter_manager_connection_pool_get_max_size(pool));
+    cut_assert_equal_double(MILTER_MANAGER_CONNECTION_POOL_DEFAULT_IDLE_TIMEOUT,
+                            0.0,
+                            milter_manager_connection_pool_get_idle_timeout(pool));
+    cut_assert_false(milter_manager_connection_pool_is_enabled(pool));
+}
+
+void
+test_push_pop (void)
+{
+    cut_trace(setup_channel());
+    milter_manager_connection_pool_set_max_size(pool, 2);
+
+    cut_assert_true(milter_manager_connection_pool_push(pool, loop, channel,
+                                                        option, reply_option,
+                                                        NULL));
+    cut_assert_equal_uint(1,
+                          milter_manager_connection_pool_get_n_idle_connections(pool));
+
+    cut_assert_true(pop(option));
+    cut_assert_equal_pointer(channel, actual_channel);
+    milter_assert_equal_option(reply_option, actual_reply_option);
+    cut_assert_equal_uint(0,
+                          milter_manager_connection_pool_get_n_idle_connections(pool));
+    cut_assert_equal_uint(1, milter_manager_connection_pool_get_n_hits(pool));
+    cut_assert_equal_uint(0, milter_manager_connection_pool_get_n_misses(pool));
+}
+
+void
+test_pop_empty (void)
+{
+    milter_manager_connection_pool_set_max_size(pool, 2);
+
+    cut_assert_false(pop(option));
+    cut_assert_equal_uint(0, milter_manager_connection_pool_get_n_hits(pool));
+    cut_assert_equal_uint(1, milter_manager_connection_pool_get_n_misses(pool));
+}
+
+void
+test_pop_option_mismatch (void)
+{
+    MilterOption *other_option;
+
+    cut_trace(setup_channel());
+    milter_manager_connection_pool_set_max_size(pool, 2);
+    cut_assert_true(milter_manager_connection_pool_push(pool, loop, channel,
+                                                        option, reply_option,
+                                                        NULL));
+
+    other_option = milter_option_new(6,
+                                     MILTER_ACTION_CHANGE_BODY,
+                                     MILTER_STEP_NO_CONNECT);
+    gcut_take_object(G_OBJECT(other_option));
+    cut_assert_false(pop(other_option));
+    cut_assert_equal_uint(1,
+                          milter_manager_connection_pool_get_n_idle_connections(pool));
+    cut_assert_equal_uint(1, milter_manager_connection_pool_get_n_misses(pool));
+}
+
+void
+test_push_disabled (void)
+{
+    cut_trace(setup_channel());
+
+    cut_assert_false(milter_manager_connection_pool_push(pool, loop, channel,
+                                                         option, reply_option,
+                                                         NULL));
+    cut_assert_equal_uint(0,
+                          milter_manager_connection_pool_get_n_idle_connections(pool));
+}
+
+void
+test_push_full (void)
+{
+    cut_trace(setup_channel());
+    milter_manager_connection_pool_set_max_size(pool, 1);
+
+    cut_assert_true(milter_manager_connection_pool_push(pool, loop, channel,
+                                                        option, reply_option,
+                                                        NULL));
+    cut_assert_true(milter_manager_connection_pool_is_full(pool));
+    cut_assert_false(milter_manager_connection_pool_push(pool, loop, channel,
+                                                         option, reply_option,
+                                                         NULL));
+    cut_assert_equal_uint(1,
+                          milter_manager_connection_pool_get_n_idle_connections(pool));
+}
+
+void
+test_shrink (void)
+{
+    cut_trace(setup_channel());
+    milter_manager_connection_pool_set_max_size(pool, 2);
+    cut_assert_true(milter_manager_connection_pool_push(pool, loop, channel,
+                                                        option, reply_option,
+                                                        NULL));
+
+    milter_manager_connection_pool_set_max_size(pool, 0);
+    cut_assert_equal_uint(0,
+                          milter_manager_connection_pool_get_n_idle_connections(pool));
+}
+
+void
+test_clear (void)
+{
+    cut_trace(setup_channel());
+    milter_manager_connection_pool_set_max_size(pool, 2);
+    cut_assert_true(milter_manager_connection_pool_push(pool, loop, channel,
+                                                        option, reply_option,
+                                                        NULL));
+
+    milter_manager_connection_pool_clear(pool);
+    cut_assert_equal_uint(0,
+                          milter_manager_connection_pool_get_n_idle_connections(pool));
+    cut_assert_false(pop(option));
+}
+
+void
+test_expire_on_close (void)
+{
+    cut_trace(setup_channel());
+    milter_manager_connection_pool_set_max_size(pool, 2);
+    cut_assert_true(milter_manager_connection_pool_push(pool, loop, channel,
+                                                        option, reply_option,
+                                                        NULL));
+
+    close(peer_fd);
+    peer_fd = -1;
+    milter_event_loop_iterate(loop, FALSE);
+
+    cut_assert_equal_uint(0,
+                          milter_manager_connection_pool_get_n_idle_connections(pool));
+}
+
+static gpointer
+clear_thread (gpointer data)
+{
+    milter_manager_connection_pool_clear(pool);
+    return NULL;
+}
+
+static gboolean
+is_peer_closed (void)
+{
+    gchar buffer[1];
+    gssize read_size;
+
+    read_size = recv(peer_fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    return read_size == 0;
+}
+
+void
+test_clear_on_other_thread (void)
+{
+    GThread *thread;
+    GError *error = NULL;
+
+    cut_trace(setup_channel());
+    milter_manager_connection_pool_set_max_size(pool, 2);
+    cut_assert_true(milter_manager_connection_pool_push(pool, loop, channel,
+                                                        option, reply_option,
+                                                        NULL));
+    g_io_channel_unref(channel);
+    channel = NULL;
+
+    thread = g_thread_try_new("clear_thread", clear_thread, NULL, &error);
+    gcut_assert_error(error);
+    g_thread_join(thread);
+
+    cut_assert_equal_uint(0,
+                          milter_manager_connection_pool_get_n_idle_connections(pool));
+    cut_assert_false(is_peer_closed());
+
+    cut_assert_false(pop(option));
+    cut_assert_true(is_peer_closed());
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -46,11 +46,14 @@ void test_connection_timeout (void);
 void test_writing_timeout (void);
 void test_reading_timeout (void);
 void test_end_of_message_timeout (void);
+void test_connection_pool_size (void);
+void test_connection_pool_idle_timeout (void);
 void test_user_name (void);
 void test_command (void);
 void test_command_options (void);
 void test_fallback_status (void);
 void test_evaluation_mode (void);
+void test_parallel (void);
 void test_merge (void);
 void test_applicable_condition (void);
 void test_attach_applicable_conditions (void);
@@ -317,6 +320,34 @@ test_end_of_message_timeout (void)
                             milter_manager_egg_get_end_of_message_timeout(egg));
 }
 
+void
+test_connection_pool_size (void)
+{
+    MilterManagerConnectionPool *pool;
+
+    egg = milter_manager_egg_new("child-milter");
+    pool = milter_manager_egg_get_connection_pool(egg);
+    cut_assert_equal_uint(0, milter_manager_egg_get_connection_pool_size(egg));
+    cut_assert_false(milter_manager_connection_pool_is_enabled(pool));
+
+    milter_manager_egg_set_connection_pool_size(egg, 4);
+    cut_assert_equal_uint(4, milter_manager_egg_get_connection_pool_size(egg));
+    cut_assert_true(milter_manager_connection_pool_is_enabled(pool));
+}
+
+void
+test_connection_pool_idle_timeout (void)
+{
+    egg = milter_manager_egg_new("child-milter");
+    cut_assert_equal_double(MILTER_MANAGER_CONNECTION_POOL_DEFAULT_IDLE_TIMEOUT,
+                            0.0,
+                            milter_manager_egg_get_connection_pool_idle_timeout(egg));
+
+    milter_manager_egg_set_connection_pool_idle_timeout(egg, 10.0);
+    cut_assert_equal_double(10.0, 0.0,
+                            milter_manager_egg_get_connection_pool_idle_timeout(egg));
+}
+
 void
 test_user_name (void)
 {
@@ -392,6 +423,30 @@ test_evaluation_mode (void)
     cut_assert_true(milter_manager_child_is_evaluation_mode(child));
 }
 
+void
+test_parallel (void)
+{
+    const gchar spec[] = "inet:9999@127.0.0.1";
+    GError *error = NULL;
+
+    egg = milter_manager_egg_new("child-milter");
+    milter_manager_egg_set_connection_spec(egg, spec, &error);
+    gcut_assert_error(error);
+
+    cut_assert_false(milter_manager_egg_is_parallel(egg));
+    child = milter_manager_egg_hatch(egg);
+    cut_assert_not_null(child);
+    cut_assert_false(milter_manager_child_is_parallel(child));
+
+    milter_manager_egg_set_parallel(egg, TRUE);
+    cut_assert_true(milter_manager_egg_is_parallel(egg));
+
+    g_object_unref(child);
+    child = milter_manager_egg_hatch(egg);
+    cut_assert_not_null(child);
+    cut_assert_true(milter_manager_child_is_parallel(child));
+}
+
 void
 test_applicable_condition (void)
 {
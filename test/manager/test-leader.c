@@ -38,6 +38,9 @@ void data_large_body (void);
 void test_large_body (gconstpointer data);
 
 void test_configuration (void);
+void test_reset (void);
+void test_reset_negotiate (void);
+void test_poolable (void);
 
 static gchar *scenario_dir;
 static MilterManagerTestScenario *main_scenario;
@@ -1787,6 +1790,20 @@ data_scenario_end_of_message (void)
                  NULL);
 }
 
+static void
+data_scenario_parallel (void)
+{
+    cut_add_data("parallel - accept",
+                 g_strdup("parallel-accept.txt"), g_free,
+                 "parallel - reject",
+                 g_strdup("parallel-reject.txt"), g_free,
+                 "parallel - replace body",
+                 g_strdup("parallel-replace-body.txt"), g_free,
+                 "parallel - modifiable",
+                 g_strdup("parallel-modifiable.txt"), g_free,
+                 NULL);
+}
+
 static void
 data_scenario_reply_code (void)
 {
@@ -1816,6 +1833,7 @@ data_scenario (void)
     data_scenario_end_of_header();
     data_scenario_body();
     data_scenario_end_of_message();
+    data_scenario_parallel();
     data_scenario_reply_code();
     data_scenario_applicable_condition();
 }
@@ -1895,6 +1913,59 @@ test_configuration (void)
                              milter_manager_leader_get_configuration(leader));
 }
 
+void
+test_reset (void)
+{
+    guint finished_id;
+
+    finished_id = g_signal_lookup("finished", MILTER_TYPE_FINISHED_EMITTABLE);
+    cut_assert_true(g_signal_has_handler_pending(leader, finished_id,
+                                                 0, FALSE));
+
+    milter_manager_leader_reset(leader);
+    gcut_assert_equal_object(NULL,
+                             milter_manager_leader_get_configuration(leader));
+    gcut_assert_equal_object(NULL, milter_manager_leader_get_children(leader));
+    cut_assert_false(g_signal_has_handler_pending(leader, finished_id,
+                                                  0, FALSE));
+
+    milter_manager_leader_reuse(leader, config, client_context);
+    gcut_assert_equal_object(config,
+                             milter_manager_leader_get_configuration(leader));
+}
+
+void
+test_reset_negotiate (void)
+{
+    MilterOption *option;
+    MilterManagerChildren *children;
+
+    cut_trace(test_scenario("negotiate.txt"));
+
+    milter_manager_leader_reset(leader);
+    milter_manager_leader_reuse(leader, config, client_context);
+
+    option = milter_option_new(2,
+                               MILTER_ACTION_ADD_HEADERS,
+                               MILTER_STEP_NONE);
+    gcut_take_object(G_OBJECT(option));
+    milter_manager_leader_negotiate(leader, option, NULL);
+
+    children = milter_manager_leader_get_children(leader);
+    cut_assert_not_null(children);
+    gcut_assert_equal_object(config,
+                             milter_manager_children_get_configuration(children));
+}
+
+void
+test_poolable (void)
+{
+    cut_assert_true(milter_manager_leader_is_poolable(leader));
+
+    milter_manager_leader_set_poolable(leader, FALSE);
+    cut_assert_false(milter_manager_leader_is_poolable(leader));
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -47,6 +47,8 @@ void test_remove_manager_unix_socket_on_close (void);
 
 void data_scenario (void);
 void test_scenario (gconstpointer data);
+void data_scenario_multi_thread (void);
+void test_scenario_multi_thread (gconstpointer data);
 
 static MilterEventLoop *loop;
 
@@ -231,6 +233,8 @@ cut_teardown (void)
         g_unsetenv("LANG");
     }
 
+    g_unsetenv("MILTER_N_THREADS");
+
     if (loop)
         g_object_unref(loop);
 }
@@ -516,10 +520,9 @@ data_scenario (void)
                  g_strdup("skip-on-body.txt"), g_free);
 }
 
-void
-test_scenario (gconstpointer data)
+static void
+run_scenario (const gchar *scenario_name)
 {
-    const gchar *scenario_name = data;
     const gchar omit_key[] = "omit";
 
     start_manager();
@@ -543,6 +546,25 @@ test_scenario (gconstpointer data)
     wait_for_server_reaping();
 }
 
+void
+test_scenario (gconstpointer data)
+{
+    cut_trace(run_scenario(data));
+}
+
+void
+data_scenario_multi_thread (void)
+{
+    data_scenario();
+}
+
+void
+test_scenario_multi_thread (gconstpointer data)
+{
+    g_setenv("MILTER_N_THREADS", "2", TRUE);
+    cut_trace(run_scenario(data));
+}
+
 void
 test_check_controller_port (void)
 {
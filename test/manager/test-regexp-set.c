@@ -0,0 +1,140 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <milter/manager/milter-manager-regexp-set.h>
+
+#include <gcutter.h>
+
+void test_empty (void);
+void test_match (void);
+void test_first_match (void);
+void test_caseless (void);
+void test_add_after_match (void);
+void test_back_reference (void);
+void test_invalid_pattern (void);
+
+static MilterManagerRegexpSet *set;
+static GError *actual_error;
+
+void
+cut_setup (void)
+{
+    set = milter_manager_regexp_set_new();
+    actual_error = NULL;
+}
+
+void
+cut_teardown (void)
+{
+    if (set)
+        milter_manager_regexp_set_free(set);
+    if (actual_error)
+        g_error_free(actual_error);
+}
+
+static void
+add (const gchar *pattern, GRegexCompileFlags flags)
+{
+    milter_manager_regexp_set_add(set, pattern, flags, &actual_error);
+    gcut_assert_error(actual_error);
+}
+
+void
+test_empty (void)
+{
+    cut_assert_equal_int(-1, milter_manager_regexp_set_match(set, "unknown"));
+    cut_assert_equal_uint(0, milter_manager_regexp_set_get_size(set));
+}
+
+void
+test_match (void)
+{
+    cut_trace(add("\\Aunknown\\z", 0));
+    cut_trace(add("\\A\\[.+\\]\\z", 0));
+    cut_trace(add("\\A[^.]*\\d{5}", 0));
+
+    cut_assert_equal_int(0, milter_manager_regexp_set_match(set, "unknown"));
+    cut_assert_equal_int(1, milter_manager_regexp_set_match(set,
+                                                            "[192.168.1.1]"));
+    cut_assert_equal_int(2, milter_manager_regexp_set_match(
+                             set, "p12345-ipad.example.ne.jp"));
+    cut_assert_equal_int(-1, milter_manager_regexp_set_match(
+                             set, "mail.example.com"));
+    cut_assert_equal_uint(3, milter_manager_regexp_set_get_size(set));
+}
+
+void
+test_first_match (void)
+{
+    cut_trace(add("\\.jp\\z", 0));
+    cut_trace(add("\\Ap\\d+", 0));
+
+    cut_assert_equal_int(0, milter_manager_regexp_set_match(
+                             set, "p12345.example.jp"));
+}
+
+void
+test_caseless (void)
+{
+    cut_trace(add("\\A(?:dhcp|dialup|ppp)[^.]*\\d", G_REGEX_CASELESS));
+    cut_trace(add("\\Amail\\.", 0));
+
+    cut_assert_equal_int(0, milter_manager_regexp_set_match(
+                             set, "PPP123.example.com"));
+    cut_assert_equal_int(-1, milter_manager_regexp_set_match(
+                             set, "MAIL.example.com"));
+}
+
+void
+test_add_after_match (void)
+{
+    cut_trace(add("\\Aunknown\\z", 0));
+    cut_assert_equal_int(-1, milter_manager_regexp_set_match(
+                             set, "mail.example.com"));
+
+    cut_trace(add("\\Amail\\.", 0));
+    cut_assert_equal_int(1, milter_manager_regexp_set_match(
+                             set, "mail.example.com"));
+}
+
+void
+test_back_reference (void)
+{
+    cut_trace(add("\\A(a)b", 0));
+    cut_trace(add("\\A(x)\\1", 0));
+
+    cut_assert_equal_int(1, milter_manager_regexp_set_match(set, "xx"));
+    cut_assert_equal_int(-1, milter_manager_regexp_set_match(set, "xa"));
+}
+
+void
+test_invalid_pattern (void)
+{
+    cut_assert_false(milter_manager_regexp_set_add(set, "(", 0,
+                                                   &actual_error));
+    cut_assert_not_null(actual_error);
+    cut_assert_true(g_error_matches(actual_error,
+                                    MILTER_MANAGER_REGEXP_SET_ERROR,
+                                    MILTER_MANAGER_REGEXP_SET_ERROR_INVALID_PATTERN));
+    cut_assert_equal_uint(0, milter_manager_regexp_set_get_size(set));
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
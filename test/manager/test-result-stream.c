@@ -0,0 +1,343 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <glib/gstdio.h>
+
+#include <milter/manager/milter-manager-result-stream.h>
+
+#include <milter-test-utils.h>
+
+#include <gcutter.h>
+
+void test_session (void);
+void test_child (void);
+void test_header (void);
+void test_invalid_utf8 (void);
+void test_message (void);
+void test_not_opened (void);
+void test_invalid_spec (void);
+void test_reopen (void);
+void test_unix_socket (void);
+
+static gchar *tmp_dir;
+static gchar *path;
+static gint socket_fd;
+static MilterMessageResult *message_result;
+static GError *expected_error;
+static GError *actual_error;
+
+void
+cut_setup (void)
+{
+    tmp_dir = g_build_filename(milter_test_get_base_dir(), "tmp", NULL);
+    cut_remove_path(tmp_dir, NULL);
+    if (g_mkdir_with_parents(tmp_dir, 0700) == -1)
+        cut_assert_errno();
+
+    path = g_build_filename(tmp_dir, "results.log", NULL);
+    socket_fd = -1;
+    message_result = NULL;
+    expected_error = NULL;
+    actual_error = NULL;
+}
+
+void
+cut_teardown (void)
+{
+    milter_manager_result_stream_close();
+
+    if (socket_fd != -1)
+        close(socket_fd);
+    if (message_result)
+        g_object_unref(message_result);
+    if (expected_error)
+        g_error_free(expected_error);
+    if (actual_error)
+        g_error_free(actual_error);
+
+    g_free(path);
+    if (tmp_dir) {
+        cut_remove_path(tmp_dir, NULL);
+        g_free(tmp_dir);
+    }
+}
+
+static const gchar *
+read_records (const gchar *records_path)
+{
+    gchar *content;
+    GError *error = NULL;
+
+    g_file_get_contents(records_path, &content, NULL, &error);
+    gcut_assert_error(error);
+    cut_take_string(content);
+
+    return content;
+}
+
+static const gchar *
+strip_time (const gchar *record)
+{
+    const gchar *type;
+
+    type = strstr(record, ",\"type\"");
+    cut_assert_not_null(type, cut_message("<%s>", record));
+    cut_assert_true(g_str_has_prefix(record, "{\"time\":"),
+                    cut_message("<%s>", record));
+
+    return cut_take_printf("{%s", type + 1);
+}
+
+static const GList *
+take_records (const gchar *records_path)
+{
+    GList *records = NULL;
+    gchar **lines;
+    gint i;
+
+    lines = cut_take_string_array(g_strsplit(read_records(records_path),
+                                             "\n", -1));
+    for (i = 0; lines[i]; i++) {
+        if (lines[i][0] == '\0')
+            continue;
+        records = g_list_append(records, g_strdup(strip_time(lines[i])));
+    }
+
+    return gcut_take_list(records, g_free);
+}
+
+static void
+open_stream (const gchar *spec)
+{
+    GError *error = NULL;
+
+    milter_manager_result_stream_open(spec, &error);
+    gcut_assert_error(error);
+    cut_assert_true(milter_manager_result_stream_is_open());
+}
+
+void
+test_session (void)
+{
+    open_stream(path);
+    milter_manager_result_stream_emit_session(
+        29,
+        MILTER_CLIENT_CONTEXT_STATE_END_OF_MESSAGE,
+        MILTER_STATUS_CONTINUE,
+        0.5,
+        3);
+    milter_manager_result_stream_emit_session(
+        30,
+        MILTER_CLIENT_CONTEXT_STATE_ENVELOPE_RECIPIENT,
+        MILTER_STATUS_REJECT,
+        0.25,
+        2);
+    milter_manager_result_stream_emit_disconnected(31, 1.5);
+    milter_manager_result_stream_close();
+
+    gcut_assert_equal_list_string(
+        gcut_take_new_list_string(
+            "{\"type\":\"session\",\"tag\":29,"
+            "\"state\":\"end-of-message\",\"status\":\"pass\","
+            "\"elapsed\":0.5,\"n-sessions\":3}",
+            "{\"type\":\"session\",\"tag\":30,"
+            "\"state\":\"envelope-recipient\",\"status\":\"reject\","
+            "\"elapsed\":0.25,\"n-sessions\":2}",
+            "{\"type\":\"disconnected\",\"tag\":31,\"elapsed\":1.5}",
+            NULL),
+        take_records(path));
+}
+
+void
+test_child (void)
+{
+    open_stream(cut_take_printf("file:%s", path));
+    milter_manager_result_stream_emit_child(
+        29,
+        "milter@10026",
+        MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE,
+        MILTER_STATUS_TEMPORARY_FAILURE,
+        0.125);
+    milter_manager_result_stream_close();
+
+    cut_assert_equal_string(
+        "{\"type\":\"milter\",\"tag\":29,\"name\":\"milter@10026\","
+        "\"state\":\"end-of-message\",\"status\":\"temporary-failure\","
+        "\"elapsed\":0.125}\n",
+        strip_time(read_records(path)));
+}
+
+void
+test_header (void)
+{
+    open_stream(path);
+    milter_manager_result_stream_emit_header(29,
+                                             "spamass-milter",
+                                             "insert",
+                                             "X-Spam-Status",
+                                             "Yes, score=\"9.9\"\n\tBAYES_99");
+    milter_manager_result_stream_close();
+
+    cut_assert_equal_string(
+        "{\"type\":\"header\",\"tag\":29,\"name\":\"spamass-milter\","
+        "\"action\":\"insert\",\"header\":\"X-Spam-Status\","
+        "\"value\":\"Yes, score=\\\"9.9\\\"\\n\\tBAYES_99\"}\n",
+        strip_time(read_records(path)));
+}
+
+void
+test_invalid_utf8 (void)
+{
+    open_stream(path);
+    milter_manager_result_stream_emit_header(29,
+                                             "milter@10026",
+                                             "insert",
+                                             "Subject",
+                                             "caf\xc3\xa9 \xe9t\xe9\x01");
+    milter_manager_result_stream_close();
+
+    cut_assert_equal_string(
+        "{\"type\":\"header\",\"tag\":29,\"name\":\"milter@10026\","
+        "\"action\":\"insert\",\"header\":\"Subject\","
+        "\"value\":\"caf\xc3\xa9 \\ufffdt\\ufffd\\u0001\"}\n",
+        strip_time(read_records(path)));
+}
+
+void
+test_message (void)
+{
+    message_result = milter_message_result_new();
+    milter_message_result_set_from(message_result, "<kou@example.com>");
+    milter_message_result_add_recipient(message_result, "<a@example.com>");
+    milter_message_result_add_recipient(message_result, "<b@example.com>");
+    milter_message_result_add_rejected_recipient(message_result,
+                                                 "<b@example.com>");
+    milter_message_result_set_body_size(message_result, 1024);
+    milter_message_result_set_state(message_result,
+                                    MILTER_STATE_END_OF_MESSAGE_REPLIED);
+    milter_message_result_set_status(message_result, MILTER_STATUS_DISCARD);
+    milter_message_result_set_elapsed_time(message_result, 2.0);
+
+    open_stream(path);
+    milter_manager_result_stream_emit_message(29, message_result);
+    milter_manager_result_stream_close();
+
+    cut_assert_equal_string(
+        "{\"type\":\"message\",\"tag\":29,"
+        "\"from\":\"<kou@example.com>\","
+        "\"recipients\":[\"<a@example.com>\",\"<b@example.com>\"],"
+        "\"temporary-failed-recipients\":[],"
+        "\"rejected-recipients\":[\"<b@example.com>\"],"
+        "\"body-size\":1024,"
+        "\"state\":\"end-of-message-replied\",\"status\":\"discard\","
+        "\"quarantine\":false,\"elapsed\":2}\n",
+        strip_time(read_records(path)));
+}
+
+void
+test_not_opened (void)
+{
+    cut_assert_false(milter_manager_result_stream_is_open());
+    milter_manager_result_stream_emit_disconnected(29, 1.0);
+    cut_assert_false(g_file_test(path, G_FILE_TEST_EXISTS));
+
+    open_stream(path);
+    cut_assert_equal_string(path, milter_manager_result_stream_get_spec());
+    milter_manager_result_stream_open(NULL, &actual_error);
+    gcut_assert_error(actual_error);
+    cut_assert_false(milter_manager_result_stream_is_open());
+    cut_assert_equal_string(NULL, milter_manager_result_stream_get_spec());
+}
+
+void
+test_invalid_spec (void)
+{
+    expected_error = g_error_new(MILTER_MANAGER_RESULT_STREAM_ERROR,
+                                 MILTER_MANAGER_RESULT_STREAM_ERROR_INVALID_SPEC,
+                                 "result stream path must be absolute: "
+                                 "<unix:results.sock>");
+    cut_assert_false(milter_manager_result_stream_open("unix:results.sock",
+                                                       &actual_error));
+    gcut_assert_equal_error(expected_error, actual_error);
+    cut_assert_false(milter_manager_result_stream_is_open());
+}
+
+void
+test_reopen (void)
+{
+    const gchar *rotated_path;
+
+    rotated_path = cut_take_printf("%s.1", path);
+
+    open_stream(path);
+    milter_manager_result_stream_emit_disconnected(1, 1.0);
+    milter_manager_result_stream_flush();
+    if (g_rename(path, rotated_path) == -1)
+        cut_assert_errno();
+    milter_manager_result_stream_reopen();
+    milter_manager_result_stream_emit_disconnected(2, 2.0);
+    milter_manager_result_stream_close();
+
+    cut_assert_equal_string("{\"type\":\"disconnected\",\"tag\":1,"
+                            "\"elapsed\":1}\n",
+                            strip_time(read_records(rotated_path)));
+    cut_assert_equal_string("{\"type\":\"disconnected\",\"tag\":2,"
+                            "\"elapsed\":2}\n",
+                            strip_time(read_records(path)));
+}
+
+void
+test_unix_socket (void)
+{
+    struct sockaddr_un address;
+    const gchar *socket_path;
+    gchar buffer[4096];
+    ssize_t size;
+
+    socket_path = cut_take_printf("%s/results.sock", tmp_dir);
+    socket_fd = socket(PF_UNIX, SOCK_DGRAM, 0);
+    if (socket_fd == -1)
+        cut_assert_errno();
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+    if (bind(socket_fd, (struct sockaddr *)&address, sizeof(address)) == -1)
+        cut_assert_errno();
+
+    open_stream(cut_take_printf("unix:%s", socket_path));
+    milter_manager_result_stream_emit_disconnected(29, 0.5);
+
+    size = recv(socket_fd, buffer, sizeof(buffer) - 1, 0);
+    if (size == -1)
+        cut_assert_errno();
+    buffer[size] = '\0';
+    cut_assert_equal_string("{\"type\":\"disconnected\",\"tag\":29,"
+                            "\"elapsed\":0.5}\n",
+                            strip_time(buffer));
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
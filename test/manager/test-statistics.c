@@ -0,0 +1,231 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include <milter/manager/milter-manager-statistics.h>
+#include <milter/manager/milter-manager-body-spool.h>
+
+#include <gcutter.h>
+
+void test_leader_transit (void);
+void test_child (void);
+void test_body_spool (void);
+void test_event_loop_lag (void);
+void test_reset (void);
+void test_to_xml (void);
+void test_to_xml_shared (void);
+
+static MilterManagerBodySpool *spool;
+static GString *xml;
+
+void
+cut_setup (void)
+{
+    milter_manager_statistics_reset();
+    spool = NULL;
+    xml = g_string_new(NULL);
+}
+
+void
+cut_teardown (void)
+{
+    if (spool)
+        g_object_unref(spool);
+    g_string_free(xml, TRUE);
+    milter_manager_statistics_unshare();
+}
+
+void
+test_leader_transit (void)
+{
+    guint n_active_leaders, n_helo_leaders;
+
+    n_active_leaders = milter_manager_statistics_get_n_active_leaders();
+    n_helo_leaders =
+        milter_manager_statistics_get_n_leaders(MILTER_MANAGER_LEADER_STATE_HELO);
+
+    milter_manager_statistics_leader_transit(MILTER_MANAGER_LEADER_STATE_INVALID,
+                                             MILTER_MANAGER_LEADER_STATE_START);
+    milter_manager_statistics_leader_transit(MILTER_MANAGER_LEADER_STATE_START,
+                                             MILTER_MANAGER_LEADER_STATE_HELO);
+    cut_assert_equal_uint(n_active_leaders + 1,
+                          milter_manager_statistics_get_n_active_leaders());
+    cut_assert_equal_uint(1, milter_manager_statistics_get_n_total_leaders());
+    cut_assert_equal_uint(n_helo_leaders + 1,
+                          milter_manager_statistics_get_n_leaders(
+                              MILTER_MANAGER_LEADER_STATE_HELO));
+
+    milter_manager_statistics_leader_transit(MILTER_MANAGER_LEADER_STATE_HELO,
+                                             MILTER_MANAGER_LEADER_STATE_INVALID);
+    cut_assert_equal_uint(n_active_leaders,
+                          milter_manager_statistics_get_n_active_leaders());
+    cut_assert_equal_uint(1, milter_manager_statistics_get_n_total_leaders());
+    cut_assert_equal_uint(n_helo_leaders,
+                          milter_manager_statistics_get_n_leaders(
+                              MILTER_MANAGER_LEADER_STATE_HELO));
+}
+
+void
+test_child (void)
+{
+    milter_manager_statistics_child_connected("milter@10025");
+    milter_manager_statistics_child_connected("milter@10025");
+    milter_manager_statistics_child_connection_failed("milter@10025");
+    milter_manager_statistics_child_replied("milter@10025",
+                                            MILTER_STATUS_REJECT);
+    milter_manager_statistics_child_replied("milter@10025",
+                                            MILTER_STATUS_ACCEPT);
+    milter_manager_statistics_child_replied("milter@10025",
+                                            MILTER_STATUS_ACCEPT);
+    milter_manager_statistics_child_timed_out("milter@10025");
+
+    cut_assert_equal_uint(
+        2, milter_manager_statistics_get_n_child_connections("milter@10025"));
+    cut_assert_equal_uint(
+        1,
+        milter_manager_statistics_get_n_child_connection_failures("milter@10025"));
+    cut_assert_equal_uint(
+        1,
+        milter_manager_statistics_get_n_child_replies("milter@10025",
+                                                      MILTER_STATUS_REJECT));
+    cut_assert_equal_uint(
+        2,
+        milter_manager_statistics_get_n_child_replies("milter@10025",
+                                                      MILTER_STATUS_ACCEPT));
+    cut_assert_equal_uint(
+        1, milter_manager_statistics_get_n_child_timeouts("milter@10025"));
+    cut_assert_equal_uint(
+        0, milter_manager_statistics_get_n_child_connections("unknown"));
+}
+
+void
+test_body_spool (void)
+{
+    guint n_spools;
+    gsize size, capacity;
+    GError *error = NULL;
+
+    n_spools = milter_manager_statistics_get_n_body_spools();
+    size = milter_manager_statistics_get_body_spool_size();
+    capacity = milter_manager_statistics_get_body_spool_capacity();
+
+    spool = milter_manager_body_spool_new();
+    milter_manager_body_spool_append(spool, "Hello", 5, &error);
+    gcut_assert_error(error);
+    cut_assert_equal_uint(n_spools + 1,
+                          milter_manager_statistics_get_n_body_spools());
+    cut_assert_equal_size(size + 5,
+                          milter_manager_statistics_get_body_spool_size());
+    cut_assert_equal_size(capacity +
+                          milter_manager_body_spool_get_capacity(spool),
+                          milter_manager_statistics_get_body_spool_capacity());
+
+    g_object_unref(spool);
+    spool = NULL;
+    cut_assert_equal_uint(n_spools,
+                          milter_manager_statistics_get_n_body_spools());
+    cut_assert_equal_size(size,
+                          milter_manager_statistics_get_body_spool_size());
+    cut_assert_equal_size(capacity,
+                          milter_manager_statistics_get_body_spool_capacity());
+}
+
+void
+test_event_loop_lag (void)
+{
+    milter_manager_statistics_event_loop_lagged(0.1);
+    milter_manager_statistics_event_loop_lagged(0.5);
+    milter_manager_statistics_event_loop_lagged(0.3);
+
+    cut_assert_equal_double(0.3, 0.0001,
+                            milter_manager_statistics_get_last_event_loop_lag());
+    cut_assert_equal_double(0.5, 0.0001,
+                            milter_manager_statistics_get_max_event_loop_lag());
+    cut_assert_equal_double(0.3, 0.0001,
+                            milter_manager_statistics_get_average_event_loop_lag());
+}
+
+void
+test_reset (void)
+{
+    milter_manager_statistics_child_connected("milter@10025");
+    milter_manager_statistics_event_loop_lagged(0.5);
+
+    milter_manager_statistics_reset();
+    cut_assert_equal_uint(
+        0, milter_manager_statistics_get_n_child_connections("milter@10025"));
+    cut_assert_equal_double(0.0, 0.0001,
+                            milter_manager_statistics_get_max_event_loop_lag());
+}
+
+void
+test_to_xml (void)
+{
+    milter_manager_statistics_child_connected("milter@10025");
+    milter_manager_statistics_child_replied("milter@10025",
+                                            MILTER_STATUS_REJECT);
+    milter_manager_statistics_event_loop_lagged(0.25);
+
+    milter_manager_statistics_to_xml_string(xml, 0);
+    cut_assert_not_null(strstr(xml->str,
+                               "<children>\n"
+                               "  <child name=\"milter@10025\">\n"
+                               "    <connections>1</connections>\n"
+                               "    <connection-failures>0</connection-failures>\n"
+                               "    <timeouts>0</timeouts>\n"
+                               "    <replies>\n"
+                               "      <reply status=\"reject\">1</reply>\n"
+                               "    </replies>\n"
+                               "  </child>\n"
+                               "</children>\n"),
+                        cut_message("<%s>", xml->str));
+    cut_assert_not_null(strstr(xml->str, "<last-lag>0.250000</last-lag>\n"),
+                        cut_message("<%s>", xml->str));
+}
+
+void
+test_to_xml_shared (void)
+{
+    GError *error = NULL;
+
+    milter_manager_statistics_share(1, &error);
+    gcut_assert_error(error);
+
+    milter_manager_statistics_child_connected("milter@10025");
+    milter_manager_statistics_use_worker_slot(1);
+    milter_manager_statistics_child_connected("milter@10025");
+    milter_manager_statistics_child_connected("milter@10026");
+    cut_assert_equal_uint(
+        1, milter_manager_statistics_get_n_child_connections("milter@10025"));
+
+    milter_manager_statistics_to_xml_string(xml, 0);
+    cut_assert_not_null(strstr(xml->str,
+                               "  <child name=\"milter@10025\">\n"
+                               "    <connections>2</connections>\n"),
+                        cut_message("<%s>", xml->str));
+    cut_assert_not_null(strstr(xml->str,
+                               "  <child name=\"milter@10026\">\n"
+                               "    <connections>1</connections>\n"),
+                        cut_message("<%s>", xml->str));
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
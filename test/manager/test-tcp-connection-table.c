@@ -0,0 +1,186 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  agent
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <milter/manager/milter-manager-tcp-connection-table.h>
+
+#include <gcutter.h>
+
+void test_lookup (void);
+void test_lookup_not_found (void);
+void test_cache_lifetime (void);
+void data_state_to_string (void);
+void test_state_to_string (gconstpointer data);
+
+static MilterManagerTCPConnectionTable *table;
+static gint listen_fd;
+static gint client_fd;
+static gint server_fd;
+static struct sockaddr_in server_address;
+static struct sockaddr_in client_address;
+
+void
+cut_setup (void)
+{
+    table = milter_manager_tcp_connection_table_new();
+    listen_fd = -1;
+    client_fd = -1;
+    server_fd = -1;
+}
+
+void
+cut_teardown (void)
+{
+    if (table)
+        milter_manager_tcp_connection_table_free(table);
+    if (server_fd != -1)
+        close(server_fd);
+    if (client_fd != -1)
+        close(client_fd);
+    if (listen_fd != -1)
+        close(listen_fd);
+}
+
+static void
+connect_on_localhost (void)
+{
+    socklen_t address_size;
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd == -1)
+        cut_assert_errno();
+
+    memset(&server_address, 0, sizeof(server_address));
+    server_address.sin_family = AF_INET;
+    server_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listen_fd, (struct sockaddr *)&server_address,
+             sizeof(server_address)) == -1)
+        cut_assert_errno();
+    if (listen(listen_fd, 1) == -1)
+        cut_assert_errno();
+    address_size = sizeof(server_address);
+    if (getsockname(listen_fd, (struct sockaddr *)&server_address,
+                    &address_size) == -1)
+        cut_assert_errno();
+
+    client_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (client_fd == -1)
+        cut_assert_errno();
+    if (connect(client_fd, (struct sockaddr *)&server_address,
+                sizeof(server_address)) == -1)
+        cut_assert_errno();
+    server_fd = accept(listen_fd, NULL, NULL);
+    if (server_fd == -1)
+        cut_assert_errno();
+
+    address_size = sizeof(client_address);
+    if (getsockname(client_fd, (struct sockaddr *)&client_address,
+                    &address_size) == -1)
+        cut_assert_errno();
+}
+
+void
+test_lookup (void)
+{
+    MilterManagerTCPState state = MILTER_MANAGER_TCP_STATE_UNKNOWN;
+    MilterGenericSocketAddress local_address;
+
+    if (!milter_manager_tcp_connection_table_is_available(table))
+        cut_omit("TCP connection table isn't available");
+
+    cut_trace(connect_on_localhost());
+
+    cut_assert_true(milter_manager_tcp_connection_table_lookup(
+                        table,
+                        (struct sockaddr *)&client_address,
+                        &state,
+                        &local_address));
+    cut_assert_equal_string("ESTABLISHED",
+                            milter_manager_tcp_state_to_string(state));
+    cut_assert_equal_int(AF_INET, local_address.address.base.sa_family);
+    cut_assert_equal_uint(ntohs(server_address.sin_port),
+                          ntohs(local_address.address.inet.sin_port));
+}
+
+void
+test_lookup_not_found (void)
+{
+    MilterManagerTCPState state;
+    struct sockaddr_in address;
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = inet_addr("192.0.2.1");
+    address.sin_port = htons(29);
+
+    cut_assert_false(milter_manager_tcp_connection_table_lookup(
+                         table, (struct sockaddr *)&address, &state, NULL));
+}
+
+void
+test_cache_lifetime (void)
+{
+    cut_assert_equal_double(
+        MILTER_MANAGER_TCP_CONNECTION_TABLE_DEFAULT_CACHE_LIFETIME,
+        0.001,
+        milter_manager_tcp_connection_table_get_cache_lifetime(table));
+    milter_manager_tcp_connection_table_set_cache_lifetime(table, 0.5);
+    cut_assert_equal_double(
+        0.5,
+        0.001,
+        milter_manager_tcp_connection_table_get_cache_lifetime(table));
+}
+
+void
+data_state_to_string (void)
+{
+#define ADD_DATUM(label, state, string)                 \
+    gcut_add_datum(label,                               \
+                   "state", G_TYPE_INT, state,          \
+                   "string", G_TYPE_STRING, string,     \
+                   NULL)
+
+    ADD_DATUM("established", MILTER_MANAGER_TCP_STATE_ESTABLISHED,
+              "ESTABLISHED");
+    ADD_DATUM("close wait", MILTER_MANAGER_TCP_STATE_CLOSE_WAIT,
+              "CLOSE_WAIT");
+    ADD_DATUM("time wait", MILTER_MANAGER_TCP_STATE_TIME_WAIT,
+              "TIME_WAIT");
+    ADD_DATUM("unknown", MILTER_MANAGER_TCP_STATE_UNKNOWN,
+              "UNKNOWN");
+
+#undef ADD_DATUM
+}
+
+void
+test_state_to_string (gconstpointer data)
+{
+    cut_assert_equal_string(gcut_data_get_string(data, "string"),
+                            milter_manager_tcp_state_to_string(
+                                gcut_data_get_int(data, "state")));
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
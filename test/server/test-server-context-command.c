@@ -34,6 +34,8 @@ void test_negotiated_newer_version (void);
 void test_connect (void);
 void test_connect_with_macro (void);
 void test_helo (void);
+void test_helo_with_command_packet (void);
+void test_helo_with_other_command_packet (void);
 void test_envelope_from (void);
 void test_envelope_recipient (void);
 void test_data (void);
@@ -533,6 +535,63 @@ test_helo (void)
     cut_assert_equal_uint(0, n_message_processed);
 }
 
+void
+test_helo_with_command_packet (void)
+{
+    const gchar *packet;
+    gsize packet_size;
+    MilterCommandPacket *command_packet;
+
+    test_connect_with_macro();
+    channel_free();
+
+    reply_continue();
+
+    milter_command_encoder_encode_helo(encoder, &packet, &packet_size,
+                                       "shared.example.com");
+    command_packet = milter_command_packet_new(MILTER_COMMAND_HELO,
+                                               packet, packet_size);
+    milter_server_context_set_command_packet(context, command_packet);
+    milter_command_packet_unref(command_packet);
+
+    cut_assert_true(milter_server_context_helo(context, "delian"));
+    pump_all_events();
+    milter_test_assert_state(HELO);
+
+    milter_command_encoder_encode_helo(encoder, &packet, &packet_size,
+                                       "shared.example.com");
+    milter_test_assert_packet(channel, packet, packet_size);
+}
+
+void
+test_helo_with_other_command_packet (void)
+{
+    const gchar fqdn[] = "delian";
+    const gchar *packet;
+    gsize packet_size;
+    MilterCommandPacket *command_packet;
+
+    test_connect_with_macro();
+    channel_free();
+
+    reply_continue();
+
+    milter_command_encoder_encode_envelope_from(encoder,
+                                                &packet, &packet_size,
+                                                "sender@example.com");
+    command_packet = milter_command_packet_new(MILTER_COMMAND_ENVELOPE_FROM,
+                                               packet, packet_size);
+    milter_server_context_set_command_packet(context, command_packet);
+    milter_command_packet_unref(command_packet);
+
+    cut_assert_true(milter_server_context_helo(context, fqdn));
+    pump_all_events();
+    milter_test_assert_state(HELO);
+
+    milter_command_encoder_encode_helo(encoder, &packet, &packet_size, fqdn);
+    milter_test_assert_packet(channel, packet, packet_size);
+}
+
 void
 test_envelope_from (void)
 {
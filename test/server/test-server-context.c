@@ -37,6 +37,7 @@ void test_establish_connection_failure (void);
 void test_negotiate (void);
 void test_connect (void);
 void test_helo (void);
+void test_no_reply_command_and_next_command (void);
 void test_envelope_from (void);
 void test_envelope_recipient (void);
 void test_envelope_recipient_again (void);
@@ -49,6 +50,8 @@ void test_state (void);
 void test_last_state (void);
 void test_macro (void);
 void test_macros_hash_table (void);
+void test_macro_snapshot (void);
+void test_stop_on_body_chunk (void);
 void data_has_accepted_recipient (void);
 void test_has_accepted_recipient (gconstpointer data);
 
@@ -64,6 +67,7 @@ static MilterOption *option;
 
 static MilterStatus reply_status;
 static gboolean command_received;
+static gboolean reply_suppressed;
 static gboolean reply_received;
 static gboolean ready_received;
 static gboolean connection_timeout_received;
@@ -150,6 +154,8 @@ static void
 cb_command_received (MilterDecoder *decoder, gpointer user_data)
 {
     command_received = TRUE;
+    if (reply_suppressed)
+        return;
     switch (reply_status) {
     case MILTER_STATUS_TEMPORARY_FAILURE:
         send_temporary_failure();
@@ -285,6 +291,7 @@ cut_setup (void)
     expected_error = NULL;
 
     reply_status = MILTER_STATUS_CONTINUE;
+    reply_suppressed = FALSE;
     ready_received = FALSE;
     connection_timeout_received = FALSE;
 
@@ -500,6 +507,61 @@ test_helo (void)
                            milter_server_context_get_status(context));
 }
 
+static void
+wait_for_processed (void)
+{
+    gboolean timeout_waiting = TRUE;
+    guint timeout_waiting_id;
+
+    timeout_waiting_id = milter_event_loop_add_timeout(loop, 1,
+                                                       cb_timeout_waiting,
+                                                       &timeout_waiting);
+    while (timeout_waiting &&
+           milter_server_context_is_processing(context)) {
+        milter_event_loop_iterate(loop, TRUE);
+    }
+    milter_event_loop_remove(loop, timeout_waiting_id);
+    cut_assert_true(timeout_waiting, cut_message("timeout"));
+}
+
+void
+test_no_reply_command_and_next_command (void)
+{
+    struct sockaddr_in address;
+    const gchar host_name[] = "mx.example.com";
+    const gchar ip_address[] = "192.168.123.123";
+    const gchar fqdn[] = "delian";
+
+    milter_option_add_step(option, MILTER_STEP_NO_REPLY_CONNECT);
+    cut_trace(test_negotiate());
+
+    address.sin_family = AF_INET;
+    address.sin_port = g_htons(50443);
+    inet_pton(AF_INET, ip_address, &(address.sin_addr));
+
+    reply_suppressed = TRUE;
+    milter_server_context_connect(context, host_name,
+                                  (struct sockaddr *)&address,
+                                  sizeof(address));
+    cut_assert_true(milter_server_context_is_processing(context));
+    cut_trace(wait_for_processed());
+    gcut_assert_equal_enum(MILTER_TYPE_SERVER_CONTEXT_STATE,
+                           MILTER_SERVER_CONTEXT_STATE_CONNECT,
+                           milter_server_context_get_state(context));
+
+    reply_suppressed = FALSE;
+    milter_server_context_helo(context, fqdn);
+    gcut_assert_error(actual_error);
+    cut_assert_true(milter_server_context_is_processing(context));
+
+    wait_for_receiving_command();
+    wait_for_receiving_reply();
+    cut_assert_false(milter_server_context_is_processing(context));
+    gcut_assert_equal_enum(MILTER_TYPE_SERVER_CONTEXT_STATE,
+                           MILTER_SERVER_CONTEXT_STATE_HELO,
+                           milter_server_context_get_state(context));
+}
+
 void
 test_envelope_from (void)
 {
@@ -798,6 +860,72 @@ test_macros_hash_table (void)
         milter_protocol_agent_get_available_macros(agent));
 }
 
+void
+test_macro_snapshot (void)
+{
+    MilterProtocolAgent *agent;
+    MilterMacroSnapshot *snapshot;
+
+    agent = MILTER_PROTOCOL_AGENT(context);
+    milter_protocol_agent_set_macro_context(agent, MILTER_COMMAND_CONNECT);
+
+    snapshot = milter_macro_snapshot_new(
+        MILTER_COMMAND_CONNECT,
+        gcut_take_hash_table(
+            gcut_hash_table_string_string_new("if_name", "localhost",
+                                              "i", "4F1B2C3D4E",
+                                              "daemon_name", NULL,
+                                              NULL)));
+    milter_protocol_agent_set_macro_snapshot(agent, snapshot);
+    milter_macro_snapshot_unref(snapshot);
+    cut_assert_equal_pointer(
+        snapshot,
+        milter_protocol_agent_get_macro_snapshot(agent,
+                                                 MILTER_COMMAND_CONNECT));
+    cut_assert_equal_string("localhost",
+                            milter_protocol_agent_get_macro(agent,
+                                                            "{if_name}"));
+    cut_assert_equal_string("4F1B2C3D4E",
+                            milter_protocol_agent_get_macro(agent, "i"));
+    cut_assert_equal_string("4F1B2C3D4E",
+                            milter_protocol_agent_get_macro(agent, "{i}"));
+
+    milter_protocol_agent_set_macro(agent, MILTER_COMMAND_CONNECT,
+                                    "if_addr", "IPv6:::1");
+    cut_assert_null(
+        milter_protocol_agent_get_macro_snapshot(agent,
+                                                 MILTER_COMMAND_CONNECT));
+    gcut_assert_equal_hash_table_string_string(
+        gcut_hash_table_string_string_new("if_name", "localhost",
+                                          "i", "4F1B2C3D4E",
+                                          "if_addr", "IPv6:::1",
+                                          NULL),
+        milter_protocol_agent_get_available_macros(agent));
+}
+
+static gboolean
+cb_stop_on_body (MilterServerContext *context,
+                 const gchar *chunk, gsize size,
+                 gpointer user_data)
+{
+    const gchar **received_chunk = user_data;
+
+    *received_chunk = chunk;
+    return TRUE;
+}
+
+void
+test_stop_on_body_chunk (void)
+{
+    const gchar body[] = "Hi\n\nI'm here.";
+    const gchar *received_chunk = NULL;
+
+    g_signal_connect(context, "stop-on-body",
+                     G_CALLBACK(cb_stop_on_body), &received_chunk);
+    milter_server_context_body(context, body + 4, 3);
+    cut_assert_equal_pointer(body + 4, received_chunk);
+}
+
 void
 data_has_accepted_recipient (void)
 {